@@ -42,6 +42,13 @@
                                         } while(0);
 #endif
 
+// Number of words in the bitmap tracking the use of n data pool buffers
+#define DATA_POOL_BITMAP_WORDS(n)      (((n) + 31) / 32)
+
+// Declares a buffer large enough to hold a queue item with inline_size bytes of inline data
+#define POST_INSTANCE_BUF(name, inline_size)  esp_event_post_instance_t name[1 + ((inline_size) + \
+                                            sizeof(esp_event_post_instance_t) - 1) / sizeof(esp_event_post_instance_t)]
+
 /* ------------------------- Static Variables ------------------------------- */
 
 static const char* TAG = "event";
@@ -122,30 +129,16 @@ static void esp_event_loop_run_task(void* args)
     vTaskSuspend(NULL);
 }
 
-static void handler_execute(esp_event_loop_instance_t* loop, esp_event_handler_node_t *handler, esp_event_post_instance_t post)
+static void handler_execute(esp_event_loop_instance_t* loop, esp_event_handler_node_t *handler, esp_event_post_instance_t* post, void* data_ptr)
 {
-    ESP_LOGD(TAG, "running post %s:%d with handler %p and context %p on loop %p", post.base, post.id, handler->handler_ctx->handler, &handler->handler_ctx, loop);
+    ESP_LOGD(TAG, "running post %s:%d with handler %p and context %p on loop %p", post->base, post->id, handler->handler_ctx->handler, &handler->handler_ctx, loop);
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     int64_t start, diff;
     start = esp_timer_get_time();
 #endif
     // Execute the handler
-#if CONFIG_ESP_EVENT_POST_FROM_ISR
-    void* data_ptr = NULL;
-
-    if (post.data_set) {
-        if (post.data_allocated) {
-            data_ptr = post.data.ptr;
-        } else {
-            data_ptr = &post.data.val;
-        }
-    }
-
-    (*(handler->handler_ctx->handler))(handler->handler_ctx->arg, post.base, post.id, data_ptr);
-#else
-    (*(handler->handler_ctx->handler))(handler->handler_ctx->arg, post.base, post.id, post.data);
-#endif
+    (*(handler->handler_ctx->handler))(handler->handler_ctx->arg, post->base, post->id, data_ptr);
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     diff = esp_timer_get_time() - start;
@@ -395,6 +388,21 @@ static esp_err_t loop_node_remove_handler(esp_event_loop_node_t* loop_node, esp_
     return ESP_ERR_NOT_FOUND;
 }
 
+static void loop_remove_handler(esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
+{
+    esp_event_loop_node_t *it, *temp;
+
+    SLIST_FOREACH_SAFE(it, &(loop->loop_nodes), next, temp) {
+        esp_err_t res = loop_node_remove_handler(it, base, id, handler_ctx, legacy);
+
+        if (res == ESP_OK && SLIST_EMPTY(&(it->base_nodes)) && SLIST_EMPTY(&(it->handlers))) {
+            SLIST_REMOVE(&(loop->loop_nodes), it, esp_event_loop_node, next);
+            free(it);
+            break;
+        }
+    }
+}
+
 static void handler_instances_remove_all(esp_event_handler_nodes_t* handlers)
 {
     esp_event_handler_node_t *it, *temp;
@@ -429,17 +437,464 @@ static void loop_node_remove_all_handler(esp_event_loop_node_t* loop_node)
     }
 }
 
-static void inline __attribute__((always_inline)) post_instance_delete(esp_event_post_instance_t* post)
+// Lists the handlers to execute for an event, in the order esp_event_loop_run executes them. Passing NULL as base lists
+// only the loop level handlers. If handlers is NULL, the handlers are only counted.
+static uint32_t loop_collect_handlers(esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id, esp_event_handler_node_t** handlers)
 {
-#if CONFIG_ESP_EVENT_POST_FROM_ISR
-    if (post->data_allocated && post->data.ptr) {
-        free(post->data.ptr);
+    esp_event_handler_node_t *handler;
+    esp_event_loop_node_t *loop_node;
+    esp_event_base_node_t *base_node;
+    esp_event_id_node_t *id_node;
+    uint32_t count = 0;
+
+    SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
+        SLIST_FOREACH(handler, &(loop_node->handlers), next) {
+            if (handlers) {
+                handlers[count] = handler;
+            }
+            count++;
+        }
+
+        SLIST_FOREACH(base_node, &(loop_node->base_nodes), next) {
+            if (base_node->base == base) {
+                SLIST_FOREACH(handler, &(base_node->handlers), next) {
+                    if (handlers) {
+                        handlers[count] = handler;
+                    }
+                    count++;
+                }
+
+                SLIST_FOREACH(id_node, &(base_node->id_nodes), next) {
+                    if (id_node->id == id) {
+                        SLIST_FOREACH(handler, &(id_node->handlers), next) {
+                            if (handlers) {
+                                handlers[count] = handler;
+                            }
+                            count++;
+                        }
+                        break;
+                    }
+                }
+            }
+        }
     }
-#else
-    if (post->data) {
-        free(post->data);
+
+    return count;
+}
+
+// Checks whether a handler is still registered to be executed for an event
+static bool loop_has_handler(esp_event_loop_instance_t* loop, esp_event_handler_node_t* handler, esp_event_base_t base, int32_t id)
+{
+    esp_event_handler_node_t *it;
+    esp_event_loop_node_t *loop_node;
+    esp_event_base_node_t *base_node;
+    esp_event_id_node_t *id_node;
+
+    SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
+        SLIST_FOREACH(it, &(loop_node->handlers), next) {
+            if (it == handler) {
+                return true;
+            }
+        }
+
+        SLIST_FOREACH(base_node, &(loop_node->base_nodes), next) {
+            if (base_node->base == base) {
+                SLIST_FOREACH(it, &(base_node->handlers), next) {
+                    if (it == handler) {
+                        return true;
+                    }
+                }
+
+                SLIST_FOREACH(id_node, &(base_node->id_nodes), next) {
+                    if (id_node->id == id) {
+                        SLIST_FOREACH(it, &(id_node->handlers), next) {
+                            if (it == handler) {
+                                return true;
+                            }
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+// Checks whether an event has handlers of its own level: base level handlers if id is ESP_EVENT_ANY_ID, id level
+// handlers otherwise. The dispatch index has an entry for exactly these events.
+static bool loop_has_event(esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id)
+{
+    esp_event_loop_node_t *loop_node;
+    esp_event_base_node_t *base_node;
+    esp_event_id_node_t *id_node;
+
+    SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
+        SLIST_FOREACH(base_node, &(loop_node->base_nodes), next) {
+            if (base_node->base != base) {
+                continue;
+            }
+            if (id == ESP_EVENT_ANY_ID) {
+                if (!SLIST_EMPTY(&(base_node->handlers))) {
+                    return true;
+                }
+            } else {
+                SLIST_FOREACH(id_node, &(base_node->id_nodes), next) {
+                    if (id_node->id == id) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+// Handler arrays of the dispatch index have a hidden slot in front, which links them into the list of retired arrays
+static esp_event_handler_node_t** handler_array_alloc(uint32_t size)
+{
+    esp_event_handler_node_t** array = malloc((size + 1) * sizeof(*array));
+    return array ? array + 1 : NULL;
+}
+
+static void handler_array_free(esp_event_handler_node_t** handlers)
+{
+    if (handlers) {
+        free(handlers - 1);
+    }
+}
+
+// Frees a handler array which is no longer part of the index, or keeps it until the running dispatch is done with it
+static void handler_array_retire(esp_event_loop_instance_t* loop, esp_event_handler_node_t** handlers)
+{
+    if (handlers == NULL) {
+        return;
+    }
+    if (loop->dispatch_depth == 0) {
+        handler_array_free(handlers);
+        return;
+    }
+    handlers[-1] = (esp_event_handler_node_t*) loop->dispatch_index.retired;
+    loop->dispatch_index.retired = handlers - 1;
+}
+
+// Marks the hash table slots of removed entries, so that probing continues past them
+static const char dispatch_index_removed[] = "removed";
+
+static inline bool dispatch_slot_is_live(const esp_event_dispatch_entry_t* entry)
+{
+    return entry->base != NULL && entry->base != dispatch_index_removed;
+}
+
+static inline uint32_t dispatch_index_slot(const esp_event_dispatch_index_t* index, esp_event_base_t base, int32_t id)
+{
+    // Event bases are addresses of strings and ids are mostly small integers, mix both with multiplicative hashing
+    uint32_t hash = (((uint32_t)(uintptr_t) base >> 2) ^ ((uint32_t) id * 0x9E3779B1U)) * 0x85EBCA6BU;
+    return (hash ^ (hash >> 16)) & index->entries_mask;
+}
+
+static esp_event_dispatch_entry_t* dispatch_index_find(const esp_event_dispatch_index_t* index, esp_event_base_t base, int32_t id)
+{
+    if (index->entries == NULL) {
+        return NULL;
+    }
+
+    // The table always has unused slots, which end the probing
+    for (uint32_t slot = dispatch_index_slot(index, base, id); index->entries[slot].base != NULL;
+            slot = (slot + 1) & index->entries_mask) {
+        if (index->entries[slot].base == base && index->entries[slot].id == id) {
+            return &(index->entries[slot]);
+        }
+    }
+
+    return NULL;
+}
+
+// Adds an entry for an event which has none yet, growing the table to keep it at most half full
+static esp_event_dispatch_entry_t* dispatch_index_insert(esp_event_dispatch_index_t* index, esp_event_base_t base, int32_t id)
+{
+    uint32_t slots = index->entries ? index->entries_mask + 1 : 0;
+
+    if (2 * (index->entries_used + 1) > slots) {
+        // Rehash the live entries, which drops the removed ones. Dispatches only keep handler arrays, which don't move.
+        uint32_t live = 0;
+        for (uint32_t slot = 0; slot < slots; slot++) {
+            live += dispatch_slot_is_live(&(index->entries[slot]));
+        }
+
+        uint32_t new_slots = 4;
+        while (new_slots < 2 * (live + 1)) {
+            new_slots <<= 1;
+        }
+
+        esp_event_dispatch_index_t grown = {
+            .entries = calloc(new_slots, sizeof(esp_event_dispatch_entry_t)),
+            .entries_mask = new_slots - 1,
+            .entries_used = live,
+        };
+        if (grown.entries == NULL) {
+            return NULL;
+        }
+
+        for (uint32_t slot = 0; slot < slots; slot++) {
+            esp_event_dispatch_entry_t* entry = &(index->entries[slot]);
+            if (dispatch_slot_is_live(entry)) {
+                uint32_t new_slot = dispatch_index_slot(&grown, entry->base, entry->id);
+                while (grown.entries[new_slot].base != NULL) {
+                    new_slot = (new_slot + 1) & grown.entries_mask;
+                }
+                grown.entries[new_slot] = *entry;
+            }
+        }
+
+        free(index->entries);
+        index->entries = grown.entries;
+        index->entries_mask = grown.entries_mask;
+        index->entries_used = grown.entries_used;
+    }
+
+    uint32_t slot = dispatch_index_slot(index, base, id);
+    while (dispatch_slot_is_live(&(index->entries[slot]))) {
+        slot = (slot + 1) & index->entries_mask;
+    }
+
+    esp_event_dispatch_entry_t* entry = &(index->entries[slot]);
+    if (entry->base == NULL) {
+        index->entries_used++;
+    }
+    memset(entry, 0, sizeof(*entry));
+    entry->base = base;
+    entry->id = id;
+
+    return entry;
+}
+
+// Brings the handlers of an entry up to date with the handler lists. Handler arrays are not changed in place while
+// a dispatch may be walking them, except for clearing the handlers unregistered in the meantime.
+static esp_err_t dispatch_entry_update(esp_event_loop_instance_t* loop, esp_event_dispatch_entry_t* entry, bool removing)
+{
+    // The loop entry lists the loop level handlers only
+    esp_event_base_t base = (entry == &(loop->dispatch_index.loop_entry)) ? NULL : entry->base;
+
+    if (removing && loop->dispatch_depth > 0) {
+        for (uint32_t i = 0; i < entry->count; i++) {
+            if (entry->handlers[i] != NULL && !loop_has_handler(loop, entry->handlers[i], base, entry->id)) {
+                entry->handlers[i] = NULL;
+                loop->dispatch_index.holes = true;
+            }
+        }
+        return ESP_OK;
+    }
+
+    uint32_t count = loop_collect_handlers(loop, base, entry->id, NULL);
+
+    if (count > entry->size || loop->dispatch_depth > 0) {
+        esp_event_handler_node_t** handlers = handler_array_alloc(count);
+        if (handlers == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        handler_array_retire(loop, entry->handlers);
+        entry->handlers = handlers;
+        entry->size = count;
+    }
+
+    loop_collect_handlers(loop, base, entry->id, entry->handlers);
+    entry->count = count;
+
+    return ESP_OK;
+}
+
+// Adds, updates or removes the entry of an event after its own level handlers were (un)registered
+static esp_err_t dispatch_index_update_event(esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id, bool removing)
+{
+    esp_event_dispatch_index_t* index = &(loop->dispatch_index);
+    esp_event_dispatch_entry_t* entry = dispatch_index_find(index, base, id);
+
+    if (!loop_has_event(loop, base, id)) {
+        if (entry != NULL) {
+            handler_array_retire(loop, entry->handlers);
+            memset(entry, 0, sizeof(*entry));
+            entry->base = dispatch_index_removed;
+        }
+        return ESP_OK;
+    }
+
+    if (entry == NULL) {
+        entry = dispatch_index_insert(index, base, id);
+        if (entry == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    return dispatch_entry_update(loop, entry, removing);
+}
+
+// Updates the dispatch index after handlers were (un)registered for an event. Loop level handlers are part of every
+// entry, and base level handlers part of every entry of their base. Unregistering handlers never fails.
+static esp_err_t dispatch_index_update(esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id, bool removing)
+{
+    esp_event_dispatch_index_t* index = &(loop->dispatch_index);
+    esp_err_t err = ESP_OK;
+
+    if (base == esp_event_any_base) {
+        err = dispatch_entry_update(loop, &(index->loop_entry), removing);
+    } else {
+        err = dispatch_index_update_event(loop, base, id, removing);
+        if (id != ESP_EVENT_ANY_ID) {
+            return err;
+        }
+    }
+
+    uint32_t slots = index->entries ? index->entries_mask + 1 : 0;
+    for (uint32_t slot = 0; slot < slots && err == ESP_OK; slot++) {
+        esp_event_dispatch_entry_t* entry = &(index->entries[slot]);
+        if (dispatch_slot_is_live(entry) && (base == esp_event_any_base || (entry->base == base && entry->id != ESP_EVENT_ANY_ID))) {
+            err = dispatch_entry_update(loop, entry, removing);
+        }
+    }
+
+    return err;
+}
+
+static void dispatch_entry_compact(esp_event_dispatch_entry_t* entry)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < entry->count; i++) {
+        if (entry->handlers[i] != NULL) {
+            entry->handlers[count++] = entry->handlers[i];
+        }
+    }
+    entry->count = count;
+}
+
+// Once no dispatch is running, frees the retired handler arrays and removes the handlers cleared during dispatches
+static void dispatch_index_tidy(esp_event_dispatch_index_t* index)
+{
+    while (index->retired != NULL) {
+        void** array = (void**) index->retired;
+        index->retired = array[0];
+        free(array);
+    }
+
+    if (index->holes) {
+        dispatch_entry_compact(&(index->loop_entry));
+        uint32_t slots = index->entries ? index->entries_mask + 1 : 0;
+        for (uint32_t slot = 0; slot < slots; slot++) {
+            if (dispatch_slot_is_live(&(index->entries[slot]))) {
+                dispatch_entry_compact(&(index->entries[slot]));
+            }
+        }
+        index->holes = false;
+    }
+}
+
+static void dispatch_index_free(esp_event_dispatch_index_t* index)
+{
+    dispatch_index_tidy(index);
+    handler_array_free(index->loop_entry.handlers);
+    uint32_t slots = index->entries ? index->entries_mask + 1 : 0;
+    for (uint32_t slot = 0; slot < slots; slot++) {
+        if (dispatch_slot_is_live(&(index->entries[slot]))) {
+            handler_array_free(index->entries[slot].handlers);
+        }
+    }
+    free(index->entries);
+    memset(index, 0, sizeof(*index));
+}
+
+// Executes the handlers for a post, returns whether any handler was executed. The handlers are those registered for
+// the event when its dispatch starts: handlers registered by a handler are executed from the next event on, handlers
+// unregistered by a handler are skipped if they were still to be executed.
+static bool loop_dispatch(esp_event_loop_instance_t* loop, esp_event_post_instance_t* post, void* data_ptr)
+{
+    esp_event_dispatch_index_t* index = &(loop->dispatch_index);
+    esp_event_dispatch_entry_t* entry = dispatch_index_find(index, post->base, post->id);
+
+    if (entry == NULL) {
+        // No id level handlers for the event, but maybe base level ones
+        entry = dispatch_index_find(index, post->base, ESP_EVENT_ANY_ID);
+    }
+    if (entry == NULL) {
+        entry = &(index->loop_entry);
+    }
+
+    // The array stays allocated until the outermost dispatch ends, even if the entry is updated in the meantime
+    esp_event_handler_node_t** handlers = entry->handlers;
+    uint32_t count = entry->count;
+    uint32_t generation = loop->handlers_generation;
+    bool exec = false;
+
+    loop->dispatch_depth++;
+
+    for (uint32_t i = 0; i < count; i++) {
+        esp_event_handler_node_t* handler = handlers[i];
+        // Once a handler (un)registers handlers, the array may be a retired copy holding freed handlers, so the
+        // remaining ones are only executed if still registered for the event
+        if (handler == NULL ||
+                (loop->handlers_generation != generation && !loop_has_handler(loop, handler, post->base, post->id))) {
+            continue;
+        }
+        handler_execute(loop, handler, post, data_ptr);
+        exec = true;
+    }
+
+    loop->dispatch_depth--;
+
+    if (loop->dispatch_depth == 0 && (index->retired != NULL || index->holes)) {
+        dispatch_index_tidy(index);
+    }
+
+    return exec;
+}
+
+static void* data_pool_alloc(esp_event_loop_instance_t* loop, size_t size)
+{
+    if (size > loop->data_pool_item_size) {
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < DATA_POOL_BITMAP_WORDS(loop->data_pool_size); i++) {
+        uint32_t used = atomic_load(&loop->data_pool_used[i]);
+        // Claim the lowest free buffer of this word, retry if another task claimed or released one meanwhile
+        while (used != UINT32_MAX) {
+            uint32_t bit = __builtin_ctz(~used);
+            if (atomic_compare_exchange_weak(&loop->data_pool_used[i], &used, used | (1U << bit))) {
+                return loop->data_pool + (i * 32 + bit) * loop->data_pool_item_size;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static void inline __attribute__((always_inline)) data_pool_free(esp_event_loop_instance_t* loop, void* ptr)
+{
+    uint32_t index = ((uint8_t*) ptr - loop->data_pool) / loop->data_pool_item_size;
+    atomic_fetch_and(&loop->data_pool_used[index / 32], ~(1U << (index % 32)));
+}
+
+static inline __attribute__((always_inline)) void* post_instance_data(esp_event_post_instance_t* post)
+{
+    switch (post->data_type) {
+        case ESP_EVENT_POST_DATA_INLINE:
+            return &post->data;
+        case ESP_EVENT_POST_DATA_POOL:
+        case ESP_EVENT_POST_DATA_HEAP:
+            return post->data.ptr;
+        default:
+            return NULL;
+    }
+}
+
+static void inline __attribute__((always_inline)) post_instance_delete(esp_event_loop_instance_t* loop, esp_event_post_instance_t* post)
+{
+    if (post->data_type == ESP_EVENT_POST_DATA_POOL) {
+        data_pool_free(loop, post->data.ptr);
+    } else if (post->data_type == ESP_EVENT_POST_DATA_HEAP) {
+        free(post->data.ptr);
     }
-#endif
     memset(post, 0, sizeof(*post));
 }
 
@@ -457,6 +912,12 @@ esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, es
         return ESP_ERR_INVALID_ARG;
     }
 
+    // Queue items are copied through stack buffers of this size
+    if (event_loop_args->inline_data_size > ESP_EVENT_INLINE_DATA_SIZE_MAX) {
+        ESP_LOGE(TAG, "inline_data_size larger than %d", ESP_EVENT_INLINE_DATA_SIZE_MAX);
+        return ESP_ERR_INVALID_ARG;
+    }
+
     esp_event_loop_instance_t* loop;
     esp_err_t err = ESP_ERR_NO_MEM; // most likely error
 
@@ -466,12 +927,29 @@ esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, es
         return err;
     }
 
-    loop->queue = xQueueCreate(event_loop_args->queue_size , sizeof(esp_event_post_instance_t));
+    loop->inline_data_size = event_loop_args->inline_data_size;
+    loop->queue = xQueueCreate(event_loop_args->queue_size , sizeof(esp_event_post_instance_t) + loop->inline_data_size);
     if (loop->queue == NULL) {
         ESP_LOGE(TAG, "create event loop queue failed");
         goto on_err;
     }
 
+    if (event_loop_args->data_pool_size > 0 && event_loop_args->data_pool_item_size > 0) {
+        // Keep the buffers aligned in the same way as heap allocations
+        loop->data_pool_item_size = (event_loop_args->data_pool_item_size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+        loop->data_pool_size = event_loop_args->data_pool_size;
+        loop->data_pool = calloc(loop->data_pool_size, loop->data_pool_item_size);
+        loop->data_pool_used = calloc(DATA_POOL_BITMAP_WORDS(loop->data_pool_size), sizeof(*loop->data_pool_used));
+        if (loop->data_pool == NULL || loop->data_pool_used == NULL) {
+            ESP_LOGE(TAG, "alloc for event data pool failed");
+            goto on_err;
+        }
+        // Mark the bits past the last buffer as used, so that they are never claimed
+        if (loop->data_pool_size % 32) {
+            atomic_init(&loop->data_pool_used[loop->data_pool_size / 32], ~((1U << (loop->data_pool_size % 32)) - 1));
+        }
+    }
+
     loop->mutex = xSemaphoreCreateRecursiveMutex();
     if (loop->mutex == NULL) {
         ESP_LOGE(TAG, "create event loop mutex failed");
@@ -537,23 +1015,22 @@ on_err:
     }
 #endif
 
+    free(loop->data_pool);
+    free(loop->data_pool_used);
     free(loop);
 
     return err;
 }
 
-// On event lookup performance: The library implements the event list as a linked list, which results to O(n)
-// lookup time. The test comparing this implementation to the O(lg n) performance of rbtrees
-// (https://github.com/freebsd/freebsd/blob/master/sys/sys/tree.h)
-// indicate that the difference is not that substantial, especially considering the additional
-// pointers per node of rbtrees. Code for the rbtree implementation of the event loop library is archived
-// in feature/esp_event_loop_library_rbtrees if needed.
+// On event lookup performance: The library keeps the registered handlers in linked lists, which results in O(n)
+// lookup time. Dispatch therefore uses an index, a hash table from event base and id to an array with the handlers to
+// execute, which (un)registering handlers updates under the loop mutex. Dispatch neither walks the lists nor allocates.
 esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t ticks_to_run)
 {
     assert(event_loop);
 
     esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
-    esp_event_post_instance_t post;
+    POST_INSTANCE_BUF(post, loop->inline_data_size);
     TickType_t marker = xTaskGetTickCount();
     TickType_t end = 0;
 
@@ -563,53 +1040,19 @@ esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t tick
     int64_t remaining_ticks = ticks_to_run;
 #endif
 
-    while(xQueueReceive(loop->queue, &post, ticks_to_run) == pdTRUE) {
+    while(xQueueReceive(loop->queue, post, ticks_to_run) == pdTRUE) {
         // The event has already been unqueued, so ensure it gets executed.
         xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
 
         loop->running_task = xTaskGetCurrentTaskHandle();
 
-        bool exec = false;
-
-        esp_event_handler_node_t *handler, *temp_handler;
-        esp_event_loop_node_t *loop_node, *temp_node;
-        esp_event_base_node_t *base_node, *temp_base;
-        esp_event_id_node_t *id_node, *temp_id_node;
-
-        SLIST_FOREACH_SAFE(loop_node, &(loop->loop_nodes), next, temp_node) {
-            // Execute loop level handlers
-            SLIST_FOREACH_SAFE(handler, &(loop_node->handlers), next, temp_handler) {
-                handler_execute(loop, handler, post);
-                exec |= true;
-            }
-
-            SLIST_FOREACH_SAFE(base_node, &(loop_node->base_nodes), next, temp_base) {
-                if (base_node->base == post.base) {
-                    // Execute base level handlers
-                    SLIST_FOREACH_SAFE(handler, &(base_node->handlers), next, temp_handler) {
-                        handler_execute(loop, handler, post);
-                        exec |= true;
-                    }
-
-                    SLIST_FOREACH_SAFE(id_node, &(base_node->id_nodes), next, temp_id_node) {
-                        if (id_node->id == post.id) {
-                            // Execute id level handlers
-                            SLIST_FOREACH_SAFE(handler, &(id_node->handlers), next, temp_handler) {
-                                handler_execute(loop, handler, post);
-                                exec |= true;
-                            }
-                            // Skip to next base node
-                            break;
-                        }
-                    }
-                }
-            }
-        }
+        void* data_ptr = post_instance_data(post);
+        bool exec = loop_dispatch(loop, post, data_ptr);
 
-        esp_event_base_t base = post.base;
-        int32_t id = post.id;
+        esp_event_base_t base = post->base;
+        int32_t id = post->id;
 
-        post_instance_delete(&post);
+        post_instance_delete(loop, post);
 
         if (ticks_to_run != portMAX_DELAY) {
             end = xTaskGetTickCount();
@@ -669,13 +1112,16 @@ esp_err_t esp_event_loop_delete(esp_event_loop_handle_t event_loop)
     }
 
     // Drop existing posts on the queue
-    esp_event_post_instance_t post;
-    while(xQueueReceive(loop->queue, &post, 0) == pdTRUE) {
-        post_instance_delete(&post);
+    POST_INSTANCE_BUF(post, loop->inline_data_size);
+    while(xQueueReceive(loop->queue, post, 0) == pdTRUE) {
+        post_instance_delete(loop, post);
     }
 
     // Cleanup loop
     vQueueDelete(loop->queue);
+    dispatch_index_free(&(loop->dispatch_index));
+    free(loop->data_pool);
+    free(loop->data_pool_used);
     free(loop);
     // Free loop mutex before deleting
     xSemaphoreGiveRecursive(loop_mutex);
@@ -709,9 +1155,13 @@ esp_err_t esp_event_handler_register_with_internal(esp_event_loop_handle_t event
     }
 
     esp_err_t err = ESP_OK;
+    // Not set if a legacy registration only replaced the argument of the handler
+    esp_event_handler_instance_context_t* handler_ctx = NULL;
 
     xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
 
+    loop->handlers_generation++;
+
     esp_event_loop_node_t *loop_node = NULL, *last_loop_node = NULL;
 
     SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
@@ -733,7 +1183,7 @@ esp_err_t esp_event_handler_register_with_internal(esp_event_loop_handle_t event
         SLIST_INIT(&(loop_node->handlers));
         SLIST_INIT(&(loop_node->base_nodes));
 
-        err = loop_node_add_handler(loop_node, event_base, event_id, event_handler, event_handler_arg, handler_ctx_arg, legacy);
+        err = loop_node_add_handler(loop_node, event_base, event_id, event_handler, event_handler_arg, &handler_ctx, legacy);
 
         if (err == ESP_OK) {
             if (!last_loop_node) {
@@ -747,7 +1197,18 @@ esp_err_t esp_event_handler_register_with_internal(esp_event_loop_handle_t event
         }
     }
     else {
-        err = loop_node_add_handler(last_loop_node, event_base, event_id, event_handler, event_handler_arg, handler_ctx_arg, legacy);
+        err = loop_node_add_handler(last_loop_node, event_base, event_id, event_handler, event_handler_arg, &handler_ctx, legacy);
+    }
+
+    if (err == ESP_OK && handler_ctx != NULL) {
+        err = dispatch_index_update(loop, event_base, event_id, false);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "alloc for dispatch index failed");
+            loop_remove_handler(loop, event_base, event_id, handler_ctx, false);
+            dispatch_index_update(loop, event_base, event_id, true);
+        } else if (handler_ctx_arg) {
+            *handler_ctx_arg = handler_ctx;
+        }
     }
 
 on_err:
@@ -787,17 +1248,10 @@ esp_err_t esp_event_handler_unregister_with_internal(esp_event_loop_handle_t eve
 
     xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
 
-    esp_event_loop_node_t *it, *temp;
-
-    SLIST_FOREACH_SAFE(it, &(loop->loop_nodes), next, temp) {
-        esp_err_t res = loop_node_remove_handler(it, event_base, event_id, handler_ctx, legacy);
+    loop->handlers_generation++;
 
-        if (res == ESP_OK && SLIST_EMPTY(&(it->base_nodes)) && SLIST_EMPTY(&(it->handlers))) {
-            SLIST_REMOVE(&(loop->loop_nodes), it, esp_event_loop_node, next);
-            free(it);
-            break;
-        }
-    }
+    loop_remove_handler(loop, event_base, event_id, handler_ctx, legacy);
+    dispatch_index_update(loop, event_base, event_id, true);
 
     xSemaphoreGiveRecursive(loop->mutex);
 
@@ -833,28 +1287,34 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t
 
     esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
 
-    esp_event_post_instance_t post;
-    memset((void*)(&post), 0, sizeof(post));
+    POST_INSTANCE_BUF(post, loop->inline_data_size);
+    memset(post, 0, sizeof(*post));
 
     if (event_data != NULL && event_data_size != 0) {
-        // Make persistent copy of event data on heap.
-        void* event_data_copy = calloc(1, event_data_size);
+        if (event_data_size <= sizeof(post->data) + loop->inline_data_size) {
+            // Small enough to travel in the queue item itself
+            memcpy(&post->data, event_data, event_data_size);
+            post->data_type = ESP_EVENT_POST_DATA_INLINE;
+        } else {
+            // Make persistent copy of event data, in the data pool if possible, on heap otherwise.
+            void* event_data_copy = data_pool_alloc(loop, event_data_size);
+            post->data_type = ESP_EVENT_POST_DATA_POOL;
 
-        if (event_data_copy == NULL) {
-            return ESP_ERR_NO_MEM;
-        }
+            if (event_data_copy == NULL) {
+                event_data_copy = calloc(1, event_data_size);
 
-        memcpy(event_data_copy, event_data, event_data_size);
-#if CONFIG_ESP_EVENT_POST_FROM_ISR
-        post.data.ptr = event_data_copy;
-        post.data_allocated = true;
-        post.data_set = true;
-#else
-        post.data = event_data_copy;
-#endif
+                if (event_data_copy == NULL) {
+                    return ESP_ERR_NO_MEM;
+                }
+                post->data_type = ESP_EVENT_POST_DATA_HEAP;
+            }
+
+            memcpy(event_data_copy, event_data, event_data_size);
+            post->data.ptr = event_data_copy;
+        }
     }
-    post.base = event_base;
-    post.id = event_id;
+    post->base = event_base;
+    post->id = event_id;
 
     BaseType_t result = pdFALSE;
 
@@ -867,23 +1327,23 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t
         if (result == pdTRUE) {
             if (loop->running_task != xTaskGetCurrentTaskHandle()) {
                 xSemaphoreGiveRecursive(loop->mutex);
-                result = xQueueSendToBack(loop->queue, &post, ticks_to_wait);
+                result = xQueueSendToBack(loop->queue, post, ticks_to_wait);
             } else {
                 xSemaphoreGiveRecursive(loop->mutex);
-                result = xQueueSendToBack(loop->queue, &post, 0);
+                result = xQueueSendToBack(loop->queue, post, 0);
             }
         }
     } else {
         // The loop has a dedicated task.
         if (loop->task != xTaskGetCurrentTaskHandle()) {
-            result = xQueueSendToBack(loop->queue, &post, ticks_to_wait);
+            result = xQueueSendToBack(loop->queue, post, ticks_to_wait);
         } else {
-            result = xQueueSendToBack(loop->queue, &post, 0);
+            result = xQueueSendToBack(loop->queue, post, 0);
         }
     }
 
     if (result != pdTRUE) {
-        post_instance_delete(&post);
+        post_instance_delete(loop, post);
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
         atomic_fetch_add(&loop->events_dropped, 1);
@@ -910,28 +1370,28 @@ esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop, esp_event_ba
 
     esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
 
-    esp_event_post_instance_t post;
-    memset((void*)(&post), 0, sizeof(post));
+    // Sized for the largest possible queue item, to keep the ISR stack usage bounded at compile time
+    POST_INSTANCE_BUF(post, ESP_EVENT_INLINE_DATA_SIZE_MAX);
+    memset(post, 0, sizeof(*post));
 
-    if (event_data_size > sizeof(post.data.val)) {
+    if (event_data_size > sizeof(post->data) + loop->inline_data_size) {
         return ESP_ERR_INVALID_ARG;
     }
 
     if (event_data != NULL && event_data_size != 0) {
-        memcpy((void*)(&(post.data.val)), event_data, event_data_size);
-        post.data_allocated = false;
-        post.data_set = true;
+        memcpy(&post->data, event_data, event_data_size);
+        post->data_type = ESP_EVENT_POST_DATA_INLINE;
     }
-    post.base = event_base;
-    post.id = event_id;
+    post->base = event_base;
+    post->id = event_id;
 
     BaseType_t result = pdFALSE;
 
     // Post the event from an ISR,
-    result = xQueueSendToBackFromISR(loop->queue, &post, task_unblocked);
+    result = xQueueSendToBackFromISR(loop->queue, post, task_unblocked);
 
     if (result != pdTRUE) {
-        post_instance_delete(&post);
+        post_instance_delete(loop, post);
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
         atomic_fetch_add(&loop->events_dropped, 1);
@@ -10,6 +10,9 @@
 #define CATCH_CONFIG_MAIN
 
 #include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
 #include "esp_event.h"
 
 #include "catch.hpp"
@@ -61,6 +64,17 @@ TEST_CASE("create an event loop with any NULL argument fails")
     CHECK(ESP_ERR_INVALID_ARG == esp_event_loop_create(&loop_args, NULL));
 }
 
+TEST_CASE("create an event loop with too much inline data fails")
+{
+    MockQueue queue(CreateAnd::IGNORE);
+    MockMutex sem(CreateAnd::IGNORE);
+    MockTask task(CreateAnd::IGNORE);
+    esp_event_loop_handle_t loop;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.inline_data_size = ESP_EVENT_INLINE_DATA_SIZE_MAX + 1;
+    CHECK(ESP_ERR_INVALID_ARG == esp_event_loop_create(&loop_args, &loop));
+}
+
 TEST_CASE("test esp_event_loop_create create_queue_fails(void)")
 {
     MockQueue queue(CreateAnd::FAIL);
@@ -150,3 +164,192 @@ TEST_CASE("registering with ANY_BASE but specific ID fails") {
             dummy_handler,
             nullptr) == ESP_ERR_INVALID_ARG);
 }
+
+namespace {
+
+/* Minimal FIFO standing in for the FreeRTOS queue, so that posted events actually reach the handlers.
+   Storage is allocated once at queue creation, to not add heap allocations to the measurements. */
+size_t s_fake_queue_item_size;
+std::vector<uint8_t> s_fake_queue;
+size_t s_fake_queue_head;
+size_t s_fake_queue_count;
+
+QueueHandle_t fake_queue_create(const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize, const uint8_t ucQueueType, int cmock_num_calls)
+{
+    s_fake_queue_item_size = uxItemSize;
+    s_fake_queue.assign(uxQueueLength * uxItemSize, 0);
+    s_fake_queue_head = 0;
+    s_fake_queue_count = 0;
+    return reinterpret_cast<QueueHandle_t>(0xdeadbeef);
+}
+
+BaseType_t fake_queue_send(QueueHandle_t xQueue, const void * const pvItemToQueue, TickType_t xTicksToWait, const BaseType_t xCopyPosition, int cmock_num_calls)
+{
+    size_t length = s_fake_queue.size() / s_fake_queue_item_size;
+    if (s_fake_queue_count == length) {
+        return pdFALSE;
+    }
+    size_t tail = (s_fake_queue_head + s_fake_queue_count++) % length;
+    memcpy(&s_fake_queue[tail * s_fake_queue_item_size], pvItemToQueue, s_fake_queue_item_size);
+    return pdTRUE;
+}
+
+BaseType_t fake_queue_receive(QueueHandle_t xQueue, void * const pvBuffer, TickType_t xTicksToWait, int cmock_num_calls)
+{
+    if (s_fake_queue_count == 0) {
+        return pdFALSE;
+    }
+    memcpy(pvBuffer, &s_fake_queue[s_fake_queue_head * s_fake_queue_item_size], s_fake_queue_item_size);
+    s_fake_queue_head = (s_fake_queue_head + 1) % (s_fake_queue.size() / s_fake_queue_item_size);
+    s_fake_queue_count--;
+    return pdTRUE;
+}
+
+/* Loop without a task, running on the fake queue, with the mutex and task functions ignored */
+struct FakeQueueFixture {
+    FakeQueueFixture() : sem(CreateAnd::IGNORE)
+    {
+        xQueueGenericCreate_StubWithCallback(fake_queue_create);
+        xQueueGenericSend_StubWithCallback(fake_queue_send);
+        xQueueReceive_StubWithCallback(fake_queue_receive);
+        vQueueDelete_Ignore();
+        xQueueTakeMutexRecursive_IgnoreAndReturn(pdTRUE);
+        xQueueGiveMutexRecursive_IgnoreAndReturn(pdTRUE);
+        xTaskGetCurrentTaskHandle_IgnoreAndReturn(nullptr);
+        xTaskGetTickCount_IgnoreAndReturn(0);
+    }
+
+    ~FakeQueueFixture()
+    {
+        xQueueGenericCreate_StubWithCallback(nullptr);
+        xQueueGenericSend_StubWithCallback(nullptr);
+        xQueueReceive_StubWithCallback(nullptr);
+        vQueueDelete_StopIgnore();
+        xQueueTakeMutexRecursive_StopIgnore();
+        xQueueGiveMutexRecursive_StopIgnore();
+        xTaskGetCurrentTaskHandle_StopIgnore();
+        xTaskGetTickCount_StopIgnore();
+    }
+
+    MockMutex sem;
+};
+
+struct post_latency_data_t {
+    std::chrono::steady_clock::time_point posted;
+    std::chrono::nanoseconds total;
+    uint32_t received;
+};
+
+void post_latency_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    post_latency_data_t *latency = static_cast<post_latency_data_t*>(event_handler_arg);
+    latency->total += std::chrono::steady_clock::now() - latency->posted;
+    latency->received++;
+}
+
+ESP_EVENT_DEFINE_BASE(s_latency_base);
+
+/* Average time from posting an event with data_size bytes of data until its handler runs */
+double measure_post_latency(esp_event_loop_args_t loop_args, size_t data_size)
+{
+    const int ITERATIONS = 100000;
+    esp_event_loop_handle_t loop = nullptr;
+    post_latency_data_t latency = {};
+    uint8_t data[64] = {};
+
+    REQUIRE(ESP_OK == esp_event_loop_create(&loop_args, &loop));
+    REQUIRE(ESP_OK == esp_event_handler_register_with(loop, s_latency_base, 0, post_latency_handler, &latency));
+
+    // Results are only checked at the end, as CATCH assertions take longer than the post itself
+    int failed = 0;
+    for (int i = 0; i < ITERATIONS; i++) {
+        latency.posted = std::chrono::steady_clock::now();
+        failed += esp_event_post_to(loop, s_latency_base, 0, data, data_size, 0) != ESP_OK;
+        failed += esp_event_loop_run(loop, 0) != ESP_OK;
+    }
+    CHECK(0 == failed);
+    CHECK(ITERATIONS == latency.received);
+
+    CHECK(ESP_OK == esp_event_loop_delete(loop));
+
+    return static_cast<double>(latency.total.count()) / ITERATIONS;
+}
+
+}
+
+TEST_CASE("post to handler latency with heap allocated and preallocated event data")
+{
+    FakeQueueFixture fix;
+
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_name = nullptr;
+
+    const size_t DATA_SIZE = 32;
+    double heap_latency = measure_post_latency(loop_args, DATA_SIZE);
+
+    loop_args.inline_data_size = DATA_SIZE;
+    double inline_latency = measure_post_latency(loop_args, DATA_SIZE);
+
+    loop_args.inline_data_size = 0;
+    loop_args.data_pool_size = 4;
+    loop_args.data_pool_item_size = DATA_SIZE;
+    double pool_latency = measure_post_latency(loop_args, DATA_SIZE);
+
+    printf("post to handler latency, %zu bytes of data: heap %.0f ns, inline %.0f ns, data pool %.0f ns\n",
+            DATA_SIZE, heap_latency, inline_latency, pool_latency);
+}
+
+namespace {
+
+void count_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    (*static_cast<uint32_t*>(event_handler_arg))++;
+}
+
+/* Bases are compared by address, so each element is a distinct base */
+const char s_dispatch_bases[8][8] = {"base0", "base1", "base2", "base3", "base4", "base5", "base6", "base7"};
+
+/* Events dispatched per second with handler_num handlers, each registered for its own event */
+double measure_dispatch_rate(uint32_t handler_num)
+{
+    const uint32_t BASE_NUM = sizeof(s_dispatch_bases) / sizeof(s_dispatch_bases[0]);
+    const uint32_t ITERATIONS = 100000;
+    esp_event_loop_handle_t loop = nullptr;
+    uint32_t handled = 0;
+
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_name = nullptr;
+    REQUIRE(ESP_OK == esp_event_loop_create(&loop_args, &loop));
+
+    for (uint32_t i = 0; i < handler_num; i++) {
+        REQUIRE(ESP_OK == esp_event_handler_register_with(loop, s_dispatch_bases[i % BASE_NUM], i / BASE_NUM,
+                count_handler, &handled));
+    }
+
+    int failed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        // Spread the events over all the registered ones
+        uint32_t event = (i * 7919) % handler_num;
+        failed += esp_event_post_to(loop, s_dispatch_bases[event % BASE_NUM], event / BASE_NUM, nullptr, 0, 0) != ESP_OK;
+        failed += esp_event_loop_run(loop, 0) != ESP_OK;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    CHECK(0 == failed);
+    CHECK(ITERATIONS == handled);
+
+    CHECK(ESP_OK == esp_event_loop_delete(loop));
+
+    return ITERATIONS / elapsed.count();
+}
+
+}
+
+TEST_CASE("dispatch rate against the number of registered handlers")
+{
+    FakeQueueFixture fix;
+
+    for (uint32_t handler_num = 1; handler_num <= 1024; handler_num *= 4) {
+        printf("dispatch rate with %4u handlers: %.0f events/s\n", handler_num, measure_dispatch_rate(handler_num));
+    }
+}
@@ -24,6 +24,9 @@
 extern "C" {
 #endif
 
+/// Largest inline_data_size accepted by esp_event_loop_create
+#define ESP_EVENT_INLINE_DATA_SIZE_MAX 256
+
 /// Configuration for creating event loops
 typedef struct {
     int32_t queue_size;                         /**< size of the event loop queue */
@@ -33,6 +36,15 @@ typedef struct {
     uint32_t task_stack_size;                   /**< stack size of the event loop task, ignored if task name is NULL */
     BaseType_t task_core_id;                    /**< core to which the event loop task is pinned to,
                                                         ignored if task name is NULL */
+    size_t inline_data_size;                    /**< number of event data bytes stored directly in each queue
+                                                        item, in addition to 4 bytes that are always available;
+                                                        adds to the queue memory and to the stack usage of the
+                                                        posting and loop tasks; at most
+                                                        ESP_EVENT_INLINE_DATA_SIZE_MAX */
+    uint32_t data_pool_size;                    /**< number of preallocated buffers for event data that does not
+                                                        fit inline; 0 to always copy such data to the heap */
+    size_t data_pool_item_size;                 /**< size of each preallocated event data buffer, ignored if
+                                                        data_pool_size is 0 */
 } esp_event_loop_args_t;
 
 /**
@@ -43,7 +55,8 @@ typedef struct {
  *
  * @return
  *  - ESP_OK: Success
- *  - ESP_ERR_INVALID_ARG: event_loop_args or event_loop was NULL
+ *  - ESP_ERR_INVALID_ARG: event_loop_args or event_loop was NULL, or inline_data_size was larger than
+ *                          ESP_EVENT_INLINE_DATA_SIZE_MAX
  *  - ESP_ERR_NO_MEM: Cannot allocate memory for event loops list
  *  - ESP_FAIL: Failed to create task loop
  *  - Others: Fail
@@ -385,6 +398,10 @@ esp_err_t esp_event_post(esp_event_base_t event_base,
  * This function behaves in the same manner as esp_event_post_to, except the additional specification of the event loop
  * to post the event to.
  *
+ * @note The copy is stored in the queue item if event_data_size is at most 4 bytes plus the inline_data_size of the
+ *       loop, otherwise in one of the loop's preallocated data buffers if it fits and one is free. Only when neither
+ *       is possible, the copy is allocated from the heap.
+ *
  * @param[in] event_loop the event loop to post to, must not be NULL
  * @param[in] event_base the event base that identifies the event
  * @param[in] event_id the event ID that identifies the event
@@ -413,7 +430,8 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop,
  * @param[in] event_base the event base that identifies the event
  * @param[in] event_id the event ID that identifies the event
  * @param[in] event_data the data, specific to the event occurrence, that gets passed to the handler
- * @param[in] event_data_size the size of the event data; max is 4 bytes
+ * @param[in] event_data_size the size of the event data; max is 4 bytes plus
+ *                            CONFIG_ESP_EVENT_DEFAULT_LOOP_INLINE_DATA_SIZE
  * @param[out] task_unblocked an optional parameter (can be NULL) which indicates that an event task with
  *                            higher priority than currently running task has been unblocked by the posted event;
  *                            a context switch should be requested before the interrupt is existed.
@@ -426,7 +444,7 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop,
  *  - ESP_OK: Success
  *  - ESP_FAIL: Event queue for the default event loop full
  *  - ESP_ERR_INVALID_ARG: Invalid combination of event base and event ID,
- *                          data size of more than 4 bytes
+ *                          data size of more than 4 bytes plus CONFIG_ESP_EVENT_DEFAULT_LOOP_INLINE_DATA_SIZE
  *  - Others: Fail
  */
 esp_err_t esp_event_isr_post(esp_event_base_t event_base,
@@ -442,7 +460,7 @@ esp_err_t esp_event_isr_post(esp_event_base_t event_base,
  * @param[in] event_base the event base that identifies the event
  * @param[in] event_id the event ID that identifies the event
  * @param[in] event_data the data, specific to the event occurrence, that gets passed to the handler
- * @param[in] event_data_size the size of the event data
+ * @param[in] event_data_size the size of the event data; max is 4 bytes plus the inline_data_size of the loop
  * @param[out] task_unblocked an optional parameter (can be NULL) which indicates that an event task with
  *                            higher priority than currently running task has been unblocked by the posted event;
  *                            a context switch should be requested before the interrupt is existed.
@@ -450,12 +468,14 @@ esp_err_t esp_event_isr_post(esp_event_base_t event_base,
  * @note this function is only available when CONFIG_ESP_EVENT_POST_FROM_ISR is enabled
  * @note when this function is called from an interrupt handler placed in IRAM, this function should
  *       be placed in IRAM as well by enabling CONFIG_ESP_EVENT_POST_FROM_IRAM_ISR
+ * @note this function uses a buffer of ESP_EVENT_INLINE_DATA_SIZE_MAX bytes plus a queue item header on the
+ *       interrupt stack, whatever the inline_data_size of the loop
  *
  * @return
  *  - ESP_OK: Success
  *  - ESP_FAIL: Event queue for the loop full
  *  - ESP_ERR_INVALID_ARG: Invalid combination of event base and event ID,
- *                          data size of more than 4 bytes
+ *                          data size of more than 4 bytes plus the inline_data_size of the loop
  *  - Others: Fail
  */
 esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop,
@@ -73,6 +73,28 @@ typedef struct esp_event_loop_node {
 
 typedef SLIST_HEAD(esp_event_loop_nodes, esp_event_loop_node) esp_event_loop_nodes_t;
 
+/// Handlers to execute for an event, in dispatch order
+typedef struct esp_event_dispatch_entry {
+    esp_event_base_t base;                                          /**< base of the event, NULL if the slot is unused */
+    int32_t id;                                                     /**< id of the event, ESP_EVENT_ANY_ID for the events of the
+                                                                            base without id level handlers */
+    esp_event_handler_node_t** handlers;                            /**< handlers to execute, NULL where a handler was
+                                                                            unregistered during a dispatch */
+    uint32_t count;                                                 /**< number of handlers */
+    uint32_t size;                                                  /**< number of handlers the array can hold */
+} esp_event_dispatch_entry_t;
+
+/// Index of the handlers to execute for each event, updated whenever handlers are (un)registered
+typedef struct esp_event_dispatch_index {
+    esp_event_dispatch_entry_t* entries;                            /**< hash table of the events with base or id level handlers */
+    uint32_t entries_mask;                                          /**< number of hash table slots minus one */
+    uint32_t entries_used;                                          /**< number of used and removed hash table slots */
+    esp_event_dispatch_entry_t loop_entry;                          /**< loop level handlers, executed for events without an entry */
+    void* retired;                                                  /**< handler arrays replaced while a dispatch may still
+                                                                            use them, freed once no dispatch is running */
+    bool holes;                                                     /**< some handler arrays contain NULL */
+} esp_event_dispatch_index_t;
+
 /// Event loop
 typedef struct esp_event_loop_instance {
     const char* name;                                               /**< name of this event loop */
@@ -83,6 +105,14 @@ typedef struct esp_event_loop_instance {
     SemaphoreHandle_t mutex;                                        /**< mutex for updating the events linked list */
     esp_event_loop_nodes_t loop_nodes;                              /**< set of linked lists containing the
                                                                             registered handlers for the loop */
+    uint32_t handlers_generation;                                   /**< incremented whenever handlers are (un)registered */
+    esp_event_dispatch_index_t dispatch_index;                      /**< index of the handlers for each event */
+    uint32_t dispatch_depth;                                        /**< number of nested dispatches using the index */
+    size_t inline_data_size;                                        /**< extra data bytes stored in each queue item */
+    size_t data_pool_item_size;                                     /**< size of each data pool buffer */
+    uint32_t data_pool_size;                                        /**< number of data pool buffers */
+    uint8_t* data_pool;                                             /**< data pool buffers */
+    atomic_uint_least32_t* data_pool_used;                          /**< bitmap of data pool buffers in use */
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     atomic_uint_least32_t events_recieved;                          /**< number of events successfully posted to the loop */
     atomic_uint_least32_t events_dropped;                           /**< number of events dropped due to queue being full */
@@ -91,24 +121,27 @@ typedef struct esp_event_loop_instance {
 #endif
 } esp_event_loop_instance_t;
 
-#if CONFIG_ESP_EVENT_POST_FROM_ISR
 typedef union esp_event_post_data {
     uint32_t val;
     void *ptr;
 } esp_event_post_data_t;
-#else
-typedef void* esp_event_post_data_t;
-#endif
+
+/// Storage of the data associated with a posted event
+typedef enum {
+    ESP_EVENT_POST_DATA_NONE = 0,                                    /**< event has no data */
+    ESP_EVENT_POST_DATA_INLINE,                                      /**< data is stored in the queue item */
+    ESP_EVENT_POST_DATA_POOL,                                        /**< data is stored in a buffer of the loop data pool */
+    ESP_EVENT_POST_DATA_HEAP,                                        /**< data is allocated from heap */
+} esp_event_post_data_type_t;
 
 /// Event posted to the event queue
 typedef struct esp_event_post_instance {
-#if CONFIG_ESP_EVENT_POST_FROM_ISR
-    bool data_allocated;                                             /**< indicates whether data is allocated from heap */
-    bool data_set;                                                   /**< indicates if data is null */
-#endif
     esp_event_base_t base;                                           /**< the event base */
     int32_t id;                                                      /**< the event id */
-    esp_event_post_data_t data;                                      /**< data associated with the event */
+    uint8_t data_type;                                               /**< where the data is stored, esp_event_post_data_type_t */
+    esp_event_post_data_t data;                                      /**< pointer to the data, or the start of inline data
+                                                                            which continues for inline_data_size bytes
+                                                                            past the end of the structure */
 } esp_event_post_instance_t;
 
 #ifdef __cplusplus
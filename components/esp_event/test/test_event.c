@@ -984,6 +984,44 @@ TEST_CASE("handler can unregister itself", "[event]")
     TEST_TEARDOWN();
 }
 
+static void test_handler_count(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    (*((int*) event_handler_arg))++;
+}
+
+static void test_handler_unregister_other(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    esp_event_loop_handle_t* loop = (esp_event_loop_handle_t*) event_data;
+
+    // Base level handlers are executed first, unregister the id level handler before it is executed
+    TEST_ESP_OK(esp_event_handler_unregister_with(*loop, event_base, TEST_EVENT_BASE1_EV1, test_handler_count));
+}
+
+TEST_CASE("handler can unregister handlers of the event being dispatched", "[event]")
+{
+    TEST_SETUP();
+
+    esp_event_loop_handle_t loop;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+
+    loop_args.task_name = NULL;
+    TEST_ESP_OK(esp_event_loop_create(&loop_args, &loop));
+
+    int count = 0;
+
+    TEST_ESP_OK(esp_event_handler_register_with(loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_handler_count, &count));
+    TEST_ESP_OK(esp_event_handler_register_with(loop, s_test_base1, ESP_EVENT_ANY_ID, test_handler_unregister_other, NULL));
+
+    TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, &loop, sizeof(loop), portMAX_DELAY));
+    TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, &loop, sizeof(loop), portMAX_DELAY));
+    TEST_ESP_OK(esp_event_loop_run(loop, pdMS_TO_TICKS(10)));
+    TEST_ASSERT_EQUAL(0, count);
+
+    TEST_ESP_OK(esp_event_loop_delete(loop));
+
+    TEST_TEARDOWN();
+}
+
 TEST_CASE("handler instance can unregister itself", "[event]")
 {
     /* this test aims to verify that handlers can unregister themselves */
@@ -1932,6 +1970,69 @@ TEST_CASE("events are dispatched in the order they are registered", "[event]")
     TEST_TEARDOWN();
 }
 
+static void test_event_data_check_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    uint8_t* data = (uint8_t*) event_data;
+    int* received = (int*) event_handler_arg;
+
+    // Each event carries event_id bytes of data, byte i holding the value i
+    for (int i = 0; i < event_id; i++) {
+        TEST_ASSERT_EQUAL(i, data[i]);
+    }
+    (*received)++;
+}
+
+TEST_CASE("can post events with data stored inline and in the data pool", "[event]")
+{
+    TEST_SETUP();
+
+    esp_event_loop_handle_t loop;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+
+    loop_args.task_name = NULL;
+    loop_args.inline_data_size = 12;
+    loop_args.data_pool_size = 2;
+    loop_args.data_pool_item_size = 32;
+    TEST_ESP_OK(esp_event_loop_create(&loop_args, &loop));
+
+    int received = 0;
+    TEST_ESP_OK(esp_event_handler_register_with(loop, s_test_base1, ESP_EVENT_ANY_ID, test_event_data_check_handler, &received));
+
+    uint8_t data[64];
+    for (int i = 0; i < sizeof(data); i++) {
+        data[i] = i;
+    }
+
+    // 16 bytes fit inline and never allocate, even with the data pool exhausted
+    size_t free_mem = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, 16, data, 16, portMAX_DELAY));
+    TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, 32, data, 32, portMAX_DELAY));
+    TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, 20, data, 20, portMAX_DELAY));
+    TEST_ASSERT_EQUAL(free_mem, heap_caps_get_free_size(MALLOC_CAP_DEFAULT));
+    TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, 4, data, 4, portMAX_DELAY));
+    TEST_ASSERT_EQUAL(free_mem, heap_caps_get_free_size(MALLOC_CAP_DEFAULT));
+
+    // Falls back to heap once the data pool is exhausted, or if the data is too large for it
+    TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, 24, data, 24, portMAX_DELAY));
+    TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, 64, data, 64, portMAX_DELAY));
+    TEST_ASSERT_LESS_THAN(free_mem, heap_caps_get_free_size(MALLOC_CAP_DEFAULT));
+
+    TEST_ESP_OK(esp_event_loop_run(loop, pdMS_TO_TICKS(10)));
+    TEST_ASSERT_EQUAL(6, received);
+    TEST_ASSERT_EQUAL(free_mem, heap_caps_get_free_size(MALLOC_CAP_DEFAULT));
+
+    // Buffers returned to the data pool can be used again
+    TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, 32, data, 32, portMAX_DELAY));
+    TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, 17, data, 17, portMAX_DELAY));
+    TEST_ASSERT_EQUAL(free_mem, heap_caps_get_free_size(MALLOC_CAP_DEFAULT));
+    TEST_ESP_OK(esp_event_loop_run(loop, pdMS_TO_TICKS(10)));
+    TEST_ASSERT_EQUAL(8, received);
+
+    TEST_ESP_OK(esp_event_loop_delete(loop));
+
+    TEST_TEARDOWN();
+}
+
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
 TEST_CASE("can properly prepare event data posted to loop", "[event]")
 {
@@ -1948,15 +2049,13 @@ TEST_CASE("can properly prepare event data posted to loop", "[event]")
 
     TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, portMAX_DELAY));
     TEST_ASSERT_EQUAL(pdTRUE, xQueueReceive(loop_def->queue, &post, portMAX_DELAY));
-    TEST_ASSERT_EQUAL(false, post.data_set);
-    TEST_ASSERT_EQUAL(false, post.data_allocated);
+    TEST_ASSERT_EQUAL(ESP_EVENT_POST_DATA_NONE, post.data_type);
     TEST_ASSERT_EQUAL(NULL, post.data.ptr);
 
     int sample = 0;
     TEST_ESP_OK(esp_event_isr_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, &sample, sizeof(sample), NULL));
     TEST_ASSERT_EQUAL(pdTRUE, xQueueReceive(loop_def->queue, &post, portMAX_DELAY));
-    TEST_ASSERT_EQUAL(true, post.data_set);
-    TEST_ASSERT_EQUAL(false, post.data_allocated);
+    TEST_ASSERT_EQUAL(ESP_EVENT_POST_DATA_INLINE, post.data_type);
     TEST_ASSERT_EQUAL(false, post.data.val);
 
     TEST_ESP_OK(esp_event_loop_delete(loop));
@@ -48,6 +48,14 @@ typedef enum {
     RINGBUF_TYPE_MAX,
 } RingbufferType_t;
 
+/**
+ * @brief Item (or contiguous piece of data) retrieved by uxRingbufferReceiveMultiple()
+ */
+typedef struct {
+    void *pvItem;       /**< Pointer to the item in the ring buffer's storage */
+    size_t xItemSize;   /**< Size of the item in bytes */
+} RingbufferItem_t;
+
 /**
  * @brief Struct that is equivalent in size to the ring buffer's data structure
  *
@@ -66,6 +74,8 @@ typedef struct xSTATIC_RINGBUFFER {
     void *pvDummy4[11];
     StaticSemaphore_t xDummy5[2];
     portMUX_TYPE muxDummy;
+    size_t xDummy6[6];
+    UBaseType_t uxDummy7[2];
     /** @endcond */
 } StaticRingbuffer_t;
 #endif
@@ -118,6 +128,55 @@ RingbufHandle_t xRingbufferCreateStatic(size_t xBufferSize,
                                         StaticRingbuffer_t *pxStaticRingbuffer);
 #endif
 
+/**
+ * @brief       Create a ring buffer for a single producer and a single consumer
+ *
+ * The ring buffer can be used with the same functions as one created by
+ * xRingbufferCreate(), but only one task or ISR may send items to it and only
+ * one task or ISR may retrieve items from it. Sending, retrieving and returning
+ * items then only update the position of the calling side with atomic
+ * operations: there is no critical section, and the semaphores are only used
+ * when a side needs to block because the buffer is full or empty.
+ *
+ * @param[in]   xBufferSize Size of the buffer in bytes. Note that items require
+ *              space for a header in no-split buffers
+ * @param[in]   xBufferType Type of ring buffer, RINGBUF_TYPE_NOSPLIT or RINGBUF_TYPE_BYTEBUF
+ *
+ * @note    Items of a no-split buffer may be retrieved before the previous
+ *          ones are returned, but they must be returned in the order they were
+ *          retrieved. Returning an item also returns the items retrieved before it.
+ *          Items acquired with xRingbufferSendAcquire() must be sent in the order
+ *          they were acquired.
+ * @note    The ring buffer can't be added to a queue set.
+ *
+ * @return  A handle to the created ring buffer, or NULL in case of error.
+ */
+RingbufHandle_t xRingbufferCreateSPSC(size_t xBufferSize, RingbufferType_t xBufferType);
+
+/**
+ * @brief       Create a ring buffer for a single producer and a single consumer,
+ *              but manually provide the required memory
+ *
+ * See xRingbufferCreateSPSC() and xRingbufferCreateStatic().
+ *
+ * @param[in]   xBufferSize Size of the buffer in bytes.
+ * @param[in]   xBufferType Type of ring buffer, RINGBUF_TYPE_NOSPLIT or RINGBUF_TYPE_BYTEBUF
+ * @param[in]   pucRingbufferStorage Pointer to the ring buffer's storage area.
+ *              Storage area must have the same size as specified by xBufferSize
+ * @param[in]   pxStaticRingbuffer Pointed to a struct of type StaticRingbuffer_t
+ *              which will be used to hold the ring buffer's data structure
+ *
+ * @note    xBufferSize of no-split buffers MUST be 32-bit aligned.
+ *
+ * @return  A handle to the created ring buffer
+ */
+#if ( configSUPPORT_STATIC_ALLOCATION == 1)
+RingbufHandle_t xRingbufferCreateStaticSPSC(size_t xBufferSize,
+                                            RingbufferType_t xBufferType,
+                                            uint8_t *pucRingbufferStorage,
+                                            StaticRingbuffer_t *pxStaticRingbuffer);
+#endif
+
 /**
  * @brief       Insert an item into the ring buffer
  *
@@ -212,6 +271,94 @@ BaseType_t xRingbufferSendAcquire(RingbufHandle_t xRingbuffer, void **ppvItem, s
  */
 BaseType_t xRingbufferSendComplete(RingbufHandle_t xRingbuffer, void *pvItem);
 
+/**
+ * @brief Acquire memory for several items at once, to be written to by an
+ *        external source (e.g. DMA) and to be sent later.
+ *
+ * Either all of the items are acquired in a single critical section or none of
+ * them is. This function will block until there is enough free space for all
+ * of the items or until it times out.
+ *
+ * On no-split ring buffers, uxItemNum items of the sizes in pxItemSizes are
+ * acquired. On byte buffers, uxItemNum must be 1 and a contiguous span of
+ * pxItemSizes[0] bytes is acquired. Only one span can be acquired at a time,
+ * and further data can't be sent into the byte buffer until the span is sent.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to allocate the memory
+ * @param[out]  ppvItems        Array of uxItemNum pointers to the memory acquired for each item
+ * @param[in]   pxItemSizes     Array of uxItemNum item sizes
+ * @param[in]   uxItemNum       Number of items to acquire
+ * @param[in]   xTicksToWait    Ticks to wait for room in the ring buffer.
+ *
+ * @note Only applicable for no-split and byte buffers. Byte buffers created by
+ *       xRingbufferCreateSPSC() or xRingbufferCreateStaticSPSC() are not supported.
+ *
+ * @return
+ *      - pdTRUE if succeeded
+ *      - pdFALSE on time-out or when an item is larger than the maximum permissible size of the buffer
+ */
+BaseType_t xRingbufferSendAcquireMultiple(RingbufHandle_t xRingbuffer,
+                                          void **ppvItems,
+                                          const size_t *pxItemSizes,
+                                          UBaseType_t uxItemNum,
+                                          TickType_t xTicksToWait);
+
+/**
+ * @brief Acquire memory for several items at once in an ISR
+ *
+ * Same as xRingbufferSendAcquireMultiple(), but returns immediately if there
+ * is not enough free space for all of the items.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to allocate the memory
+ * @param[out]  ppvItems        Array of uxItemNum pointers to the memory acquired for each item
+ * @param[in]   pxItemSizes     Array of uxItemNum item sizes
+ * @param[in]   uxItemNum       Number of items to acquire
+ *
+ * @return
+ *      - pdTRUE if succeeded
+ *      - pdFALSE when there is not enough free space for the items
+ */
+BaseType_t xRingbufferSendAcquireMultipleFromISR(RingbufHandle_t xRingbuffer,
+                                                 void **ppvItems,
+                                                 const size_t *pxItemSizes,
+                                                 UBaseType_t uxItemNum);
+
+/**
+ * @brief       Send several items acquired before by ``xRingbufferSendAcquireMultiple``
+ *              into the ring buffer at once
+ *
+ * @param[in]   xRingbuffer     Ring buffer to insert the items into
+ * @param[in]   ppvItems        Array of uxItemNum pointers to the items to insert,
+ *                              as returned by ``xRingbufferSendAcquireMultiple``
+ * @param[in]   uxItemNum       Number of items to insert
+ *
+ * @note Items of ring buffers created by xRingbufferCreateSPSC() or
+ *       xRingbufferCreateStaticSPSC() must be sent in the order they were acquired.
+ *
+ * @return
+ *      - pdTRUE if succeeded
+ *      - pdFALSE if fail for some reason.
+ */
+BaseType_t xRingbufferSendCompleteMultiple(RingbufHandle_t xRingbuffer, void **ppvItems, UBaseType_t uxItemNum);
+
+/**
+ * @brief       Send several items acquired before into the ring buffer at once in an ISR
+ *
+ * @param[in]   xRingbuffer     Ring buffer to insert the items into
+ * @param[in]   ppvItems        Array of uxItemNum pointers to the items to insert
+ * @param[in]   uxItemNum       Number of items to insert
+ * @param[out]  pxHigherPriorityTaskWoken   Value pointed to will be set to pdTRUE
+ *                                          if the function woke up a higher priority task.
+ *
+ * @return
+ *      - pdTRUE if succeeded
+ *      - pdFALSE if fail for some reason.
+ */
+BaseType_t xRingbufferSendCompleteMultipleFromISR(RingbufHandle_t xRingbuffer,
+                                                  void **ppvItems,
+                                                  UBaseType_t uxItemNum,
+                                                  BaseType_t *pxHigherPriorityTaskWoken);
+
 /**
  * @brief   Retrieve an item from the ring buffer
  *
@@ -378,6 +525,71 @@ void vRingbufferReturnItem(RingbufHandle_t xRingbuffer, void *pvItem);
  */
 void vRingbufferReturnItemFromISR(RingbufHandle_t xRingbuffer, void *pvItem, BaseType_t *pxHigherPriorityTaskWoken);
 
+/**
+ * @brief   Retrieve all available items from the ring buffer, up to uxMaxItems
+ *
+ * Attempt to retrieve items from the ring buffer in a single critical section.
+ * This function will block until at least one item is available or until it
+ * times out. On byte buffers, the available data is retrieved as up to two
+ * contiguous pieces, the second one starting at the beginning of the buffer.
+ * On allow-split buffers, each part of a split item is retrieved as an item.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to retrieve the items from
+ * @param[out]  pxItems         Array of uxMaxItems entries filled with the retrieved items
+ * @param[in]   uxMaxItems      Maximum number of items to retrieve
+ * @param[in]   xTicksToWait    Ticks to wait for items in the ring buffer.
+ *
+ * @note    A call to vRingbufferReturnItems() or calls to vRingbufferReturnItem()
+ *          are required after this to free the items retrieved.
+ *
+ * @return  Number of items retrieved, 0 on timeout
+ */
+UBaseType_t uxRingbufferReceiveMultiple(RingbufHandle_t xRingbuffer,
+                                        RingbufferItem_t *pxItems,
+                                        UBaseType_t uxMaxItems,
+                                        TickType_t xTicksToWait);
+
+/**
+ * @brief   Retrieve all available items from the ring buffer, up to uxMaxItems, in an ISR
+ *
+ * @param[in]   xRingbuffer     Ring buffer to retrieve the items from
+ * @param[out]  pxItems         Array of uxMaxItems entries filled with the retrieved items
+ * @param[in]   uxMaxItems      Maximum number of items to retrieve
+ *
+ * @note    A call to vRingbufferReturnItemsFromISR() is required after this to free the items retrieved.
+ *
+ * @return  Number of items retrieved, 0 when the ring buffer is empty
+ */
+UBaseType_t uxRingbufferReceiveMultipleFromISR(RingbufHandle_t xRingbuffer,
+                                               RingbufferItem_t *pxItems,
+                                               UBaseType_t uxMaxItems);
+
+/**
+ * @brief   Return several previously-retrieved items to the ring buffer at once
+ *
+ * @param[in]   xRingbuffer Ring buffer the items were retrieved from
+ * @param[in]   pxItems     Array of uxItemNum items that were received earlier
+ * @param[in]   uxItemNum   Number of items to return
+ *
+ * @note    Items of ring buffers created by xRingbufferCreateSPSC() or
+ *          xRingbufferCreateStaticSPSC() must be returned in the order they were retrieved.
+ */
+void vRingbufferReturnItems(RingbufHandle_t xRingbuffer, const RingbufferItem_t *pxItems, UBaseType_t uxItemNum);
+
+/**
+ * @brief   Return several previously-retrieved items to the ring buffer at once from an ISR
+ *
+ * @param[in]   xRingbuffer Ring buffer the items were retrieved from
+ * @param[in]   pxItems     Array of uxItemNum items that were received earlier
+ * @param[in]   uxItemNum   Number of items to return
+ * @param[out]  pxHigherPriorityTaskWoken   Value pointed to will be set to pdTRUE
+ *                                          if the function woke up a higher priority task.
+ */
+void vRingbufferReturnItemsFromISR(RingbufHandle_t xRingbuffer,
+                                   const RingbufferItem_t *pxItems,
+                                   UBaseType_t uxItemNum,
+                                   BaseType_t *pxHigherPriorityTaskWoken);
+
 /**
  * @brief   Delete a ring buffer
  *
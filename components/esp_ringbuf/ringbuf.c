@@ -6,6 +6,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <stdatomic.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
@@ -21,6 +22,7 @@
 #define rbBYTE_BUFFER_FLAG          ( ( UBaseType_t ) 2 )   //The ring buffer is a byte buffer
 #define rbBUFFER_FULL_FLAG          ( ( UBaseType_t ) 4 )   //The ring buffer is currently full (write pointer == free pointer)
 #define rbBUFFER_STATIC_FLAG        ( ( UBaseType_t ) 8 )   //The ring buffer is statically allocated
+#define rbSPSC_FLAG                 ( ( UBaseType_t ) 16 )  //The ring buffer has a single producer and a single consumer, see xRingbufferCreateSPSC()
 
 //Item flags
 #define rbITEM_FREE_FLAG            ( ( UBaseType_t ) 1 )   //Item has been retrieved and returned by application, free to overwrite
@@ -95,6 +97,21 @@ typedef struct RingbufferDefinition {
     SemaphoreHandle_t xRecvSemHandle;
 #endif
     portMUX_TYPE mux;                           //Spinlock required for SMP
+
+    /*
+     * Single-producer/single-consumer ring buffers do not use the pointers and
+     * the spinlock above. The producer and the consumer each own one position,
+     * which the other side only reads. Positions are in the range [0, 2 * xSize)
+     * so that a full buffer can be told apart from an empty one.
+     */
+    atomic_size_t xSpscWrite;                   //End of the items sent by the producer
+    atomic_size_t xSpscFree;                    //End of the items returned by the consumer
+    size_t xSpscAcquire;                        //End of the items acquired by the producer, only used by the producer
+    size_t xSpscRead;                           //End of the items retrieved by the consumer, only used by the consumer
+    size_t xSpscItemsSent;                      //Number of items sent, only written by the producer
+    size_t xSpscItemsReceived;                  //Number of items retrieved, only written by the consumer
+    atomic_uint uxSpscTxWaiting;                //Set while the producer waits for free space
+    atomic_uint uxSpscRxWaiting;                //Set while the consumer waits for items
 } Ringbuffer_t;
 
 #if ( configSUPPORT_STATIC_ALLOCATION == 1 )
@@ -223,6 +240,60 @@ static BaseType_t prvReceiveGenericFromISR(Ringbuffer_t *pxRingbuffer,
                                            size_t *xItemSize2,
                                            size_t xMaxSize);
 
+/*
+Acquire memory for uxItemNum items in a no-split buffer, or for a contiguous
+span of pxItemSizes[0] bytes in a byte buffer. Either all items are acquired or
+none of them is. Must be called in a critical section.
+*/
+static BaseType_t prvAcquireMultiple(Ringbuffer_t *pxRingbuffer, void **ppvItems, const size_t *pxItemSizes, UBaseType_t uxItemNum);
+
+//Send items acquired by prvAcquireMultiple(). Must be called in a critical section.
+static void prvSendCompleteMultiple(Ringbuffer_t *pxRingbuffer, void **ppvItems, UBaseType_t uxItemNum);
+
+//Retrieve the available items, up to uxMaxItems. Must be called in a critical section.
+static UBaseType_t prvGetItems(Ringbuffer_t *pxRingbuffer, RingbufferItem_t *pxItems, UBaseType_t uxMaxItems);
+
+/*
+ * The following functions implement single-producer/single-consumer ring
+ * buffers. They do not use the spinlock: the producer only writes xSpscWrite,
+ * xSpscAcquire and xSpscItemsSent, the consumer only writes xSpscFree,
+ * xSpscRead and xSpscItemsReceived. The semaphores are only given when the
+ * other side has set its waiting flag before blocking.
+ */
+
+//Set up a no-split or byte buffer for a single producer and a single consumer
+static void prvInitializeSpsc(Ringbuffer_t *pxRingbuffer);
+
+//Try to send an item without blocking. If ppvItem is not NULL, the space is only acquired and its address returned.
+static BaseType_t prvSpscTrySend(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize, void **ppvItem);
+
+//Send (or acquire space for) an item, blocking for up to xTicksToWait when the buffer is full
+static BaseType_t prvSpscSend(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize, void **ppvItem, TickType_t xTicksToWait);
+
+//Try to acquire space for several no-split items without blocking. Either all items are acquired or none of them is.
+static BaseType_t prvSpscTryAcquireMultiple(Ringbuffer_t *pxRingbuffer, void **ppvItems, const size_t *pxItemSizes, UBaseType_t uxItemNum);
+
+//Acquire space for several no-split items, blocking for up to xTicksToWait when the buffer is full
+static BaseType_t prvSpscAcquireMultiple(Ringbuffer_t *pxRingbuffer, void **ppvItems, const size_t *pxItemSizes, UBaseType_t uxItemNum, TickType_t xTicksToWait);
+
+//Make the uxItemNum items acquired up to pucItem available to the consumer, they must be completed in the order they were acquired
+static void prvSpscSendComplete(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem, UBaseType_t uxItemNum, BaseType_t *pxHigherPriorityTaskWoken);
+
+//Try to retrieve an item without blocking. xMaxSize only takes effect on byte buffers.
+static void *prvSpscTryReceive(Ringbuffer_t *pxRingbuffer, size_t xMaxSize, size_t *pxItemSize);
+
+//Retrieve an item, blocking for up to xTicksToWait when the buffer is empty
+static void *prvSpscReceive(Ringbuffer_t *pxRingbuffer, size_t xMaxSize, size_t *pxItemSize, TickType_t xTicksToWait);
+
+//Retrieve the available items up to uxMaxItems, blocking for up to xTicksToWait until there is one
+static UBaseType_t prvSpscReceiveMultiple(Ringbuffer_t *pxRingbuffer, RingbufferItem_t *pxItems, UBaseType_t uxMaxItems, TickType_t xTicksToWait);
+
+//Return the items retrieved up to pucItem, they must be returned in the order they were retrieved
+static void prvSpscReturnItem(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem, BaseType_t *pxHigherPriorityTaskWoken);
+
+//Get the maximum size an item can currently have if sent to a single-producer/single-consumer ring buffer
+static size_t prvSpscGetCurMaxSize(Ringbuffer_t *pxRingbuffer);
+
 /* --------------------------- Static Definitions --------------------------- */
 
 static void prvInitializeNewRingbuffer(size_t xBufferSize,
@@ -326,6 +397,9 @@ static BaseType_t prvCheckItemFitsByteBuffer( Ringbuffer_t *pxRingbuffer, size_t
     //Check arguments and buffer state
     configASSERT(pxRingbuffer->pucAcquire >= pxRingbuffer->pucHead && pxRingbuffer->pucAcquire < pxRingbuffer->pucTail);    //Check acquire pointer is within bounds
 
+    if (pxRingbuffer->pucWrite != pxRingbuffer->pucAcquire) {
+        return pdFALSE;     //A span acquired by prvAcquireMultiple() must be sent first
+    }
     if (pxRingbuffer->pucAcquire == pxRingbuffer->pucFree) {
         //Buffer is either complete empty or completely full
         return (pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG) ? pdFALSE : pdTRUE;
@@ -513,7 +587,7 @@ static void prvCopyItemByteBuf(Ringbuffer_t *pxRingbuffer, const uint8_t *pucIte
         pxRingbuffer->uxRingbufferFlags |= rbBUFFER_FULL_FLAG;      //Mark the buffer as full to avoid confusion with an empty buffer
     }
 
-    //Currently, acquiring memory is not supported in byte mode. pucWrite tracks the pucAcquire.
+    //Data is only copied when no span is acquired (see prvAcquireMultiple()), pucWrite tracks the pucAcquire.
     pxRingbuffer->pucWrite = pxRingbuffer->pucAcquire;
 }
 
@@ -581,7 +655,9 @@ static void *prvGetItemByteBuf(Ringbuffer_t *pxRingbuffer,
     configASSERT(pxRingbuffer->pucRead == pxRingbuffer->pucFree);
 
     uint8_t *ret = pxRingbuffer->pucRead;
-    if ((pxRingbuffer->pucRead > pxRingbuffer->pucWrite) || (pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG)) {     //Available data wraps around
+    //Read and write pointers are equal if the data fills the whole buffer. The full flag is not checked, as
+    //the buffer is also full when a span acquired by prvAcquireMultiple() reaches the free pointer.
+    if (pxRingbuffer->pucRead >= pxRingbuffer->pucWrite) {     //Available data wraps around
         //Return contiguous piece from read pointer until buffer tail, or xMaxSize
         if (xMaxSize == 0 || pxRingbuffer->pucTail - pxRingbuffer->pucRead <= xMaxSize) {
             //All contiguous data from read pointer to tail
@@ -633,8 +709,11 @@ static void prvReturnItemDefault(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
      * freed or items with dummy data should be skipped over
      */
     pxCurHeader = (ItemHeader_t *)pxRingbuffer->pucFree;
+    //If a full buffer has been retrieved completely, the read pointer is a whole buffer ahead of the free pointer
+    BaseType_t xAllRetrieved = ((pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG) && pxRingbuffer->pucFree == pxRingbuffer->pucRead && pxRingbuffer->xItemsWaiting == 0) ? pdTRUE : pdFALSE;
     //Skip over Items that have already been freed or are dummy items
-    while (((pxCurHeader->uxItemFlags & rbITEM_FREE_FLAG) || (pxCurHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG)) && pxRingbuffer->pucFree != pxRingbuffer->pucRead) {
+    while (((pxCurHeader->uxItemFlags & rbITEM_FREE_FLAG) || (pxCurHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG)) && (pxRingbuffer->pucFree != pxRingbuffer->pucRead || xAllRetrieved == pdTRUE)) {
+        xAllRetrieved = pdFALSE;
         if (pxCurHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) {
             pxCurHeader->uxItemFlags |= rbITEM_FREE_FLAG;   //Mark as freed (not strictly necessary but adds redundancy)
             pxRingbuffer->pucFree = pxRingbuffer->pucHead;    //Wrap around due to dummy data
@@ -656,7 +735,7 @@ static void prvReturnItemDefault(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
     if (pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG) {
         if (pxRingbuffer->pucFree != pxRingbuffer->pucAcquire) {
             pxRingbuffer->uxRingbufferFlags &= ~rbBUFFER_FULL_FLAG;
-        } else if (pxRingbuffer->pucFree == pxRingbuffer->pucAcquire && pxRingbuffer->pucFree == pxRingbuffer->pucRead) {
+        } else if (pxRingbuffer->pucFree == pxRingbuffer->pucAcquire && pxRingbuffer->pucFree == pxRingbuffer->pucRead && xAllRetrieved == pdFALSE) {
             //Special case where a full buffer is completely freed in one go
             pxRingbuffer->uxRingbufferFlags &= ~rbBUFFER_FULL_FLAG;
         }
@@ -743,8 +822,8 @@ static size_t prvGetCurMaxSizeAllowSplit(Ringbuffer_t *pxRingbuffer)
 static size_t prvGetCurMaxSizeByteBuf(Ringbuffer_t *pxRingbuffer)
 {
     BaseType_t xFreeSize;
-    //Check if buffer is full
-    if (pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG) {
+    //Check if buffer is full, or if data can't be sent until an acquired span is sent
+    if ((pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG) || pxRingbuffer->pucWrite != pxRingbuffer->pucAcquire) {
         return 0;
     }
 
@@ -767,6 +846,11 @@ static BaseType_t prvReceiveGeneric(Ringbuffer_t *pxRingbuffer,
                                     size_t xMaxSize,
                                     TickType_t xTicksToWait)
 {
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        *pvItem1 = prvSpscReceive(pxRingbuffer, xMaxSize, xItemSize1, xTicksToWait);
+        return (*pvItem1 != NULL) ? pdTRUE : pdFALSE;
+    }
+
     BaseType_t xReturn = pdFALSE;
     BaseType_t xReturnSemaphore = pdFALSE;
     TickType_t xTicksEnd = xTaskGetTickCount() + xTicksToWait;
@@ -831,6 +915,11 @@ static BaseType_t prvReceiveGenericFromISR(Ringbuffer_t *pxRingbuffer,
                                            size_t *xItemSize2,
                                            size_t xMaxSize)
 {
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        *pvItem1 = prvSpscTryReceive(pxRingbuffer, xMaxSize, xItemSize1);
+        return (*pvItem1 != NULL) ? pdTRUE : pdFALSE;
+    }
+
     BaseType_t xReturn = pdFALSE;
     BaseType_t xReturnSemaphore = pdFALSE;
 
@@ -867,6 +956,422 @@ static BaseType_t prvReceiveGenericFromISR(Ringbuffer_t *pxRingbuffer,
     return xReturn;
 }
 
+static BaseType_t prvAcquireMultiple(Ringbuffer_t *pxRingbuffer, void **ppvItems, const size_t *pxItemSizes, UBaseType_t uxItemNum)
+{
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        configASSERT(uxItemNum == 1);
+        size_t xSize = pxItemSizes[0];
+        if (pxRingbuffer->pucWrite != pxRingbuffer->pucAcquire) {
+            return pdFALSE;     //Only one span can be acquired at a time
+        }
+        if (!(pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG) && pxRingbuffer->pucAcquire == pxRingbuffer->pucFree && pxRingbuffer->pucRead == pxRingbuffer->pucFree) {
+            //Buffer is empty, restart at its head so that the largest possible span is contiguous
+            pxRingbuffer->pucAcquire = pxRingbuffer->pucHead;
+            pxRingbuffer->pucWrite = pxRingbuffer->pucHead;
+            pxRingbuffer->pucRead = pxRingbuffer->pucHead;
+            pxRingbuffer->pucFree = pxRingbuffer->pucHead;
+        }
+        //Get the contiguous free space from the acquire pointer
+        size_t xContiguous;
+        if (pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG) {
+            xContiguous = 0;
+        } else if (pxRingbuffer->pucFree > pxRingbuffer->pucAcquire) {
+            xContiguous = pxRingbuffer->pucFree - pxRingbuffer->pucAcquire;
+        } else {
+            xContiguous = pxRingbuffer->pucTail - pxRingbuffer->pucAcquire;
+        }
+        if (xSize > xContiguous) {
+            return pdFALSE;
+        }
+        ppvItems[0] = pxRingbuffer->pucAcquire;
+        pxRingbuffer->pucAcquire += xSize;
+        if (pxRingbuffer->pucAcquire == pxRingbuffer->pucTail) {
+            pxRingbuffer->pucAcquire = pxRingbuffer->pucHead;
+        }
+        if (pxRingbuffer->pucAcquire == pxRingbuffer->pucFree) {
+            pxRingbuffer->uxRingbufferFlags |= rbBUFFER_FULL_FLAG;
+        }
+        return pdTRUE;
+    }
+
+    //Save the buffer state, so that the items acquired so far can be released if one doesn't fit
+    uint8_t *pucAcquire = pxRingbuffer->pucAcquire;
+    UBaseType_t uxFlags = pxRingbuffer->uxRingbufferFlags;
+    for (UBaseType_t i = 0; i < uxItemNum; i++) {
+        if (pxRingbuffer->xCheckItemFits(pxRingbuffer, pxItemSizes[i]) == pdFALSE) {
+            pxRingbuffer->pucAcquire = pucAcquire;
+            pxRingbuffer->uxRingbufferFlags = uxFlags;
+            return pdFALSE;
+        }
+        ppvItems[i] = prvAcquireItemNoSplit(pxRingbuffer, pxItemSizes[i]);
+    }
+    return pdTRUE;
+}
+
+static void prvSendCompleteMultiple(Ringbuffer_t *pxRingbuffer, void **ppvItems, UBaseType_t uxItemNum)
+{
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        configASSERT(uxItemNum == 1);
+        configASSERT((uint8_t *)ppvItems[0] == pxRingbuffer->pucWrite);
+        //The span is never empty, so it fills the whole buffer if the pointers are equal
+        BaseType_t xSpanSize = pxRingbuffer->pucAcquire - pxRingbuffer->pucWrite;
+        if (xSpanSize <= 0) {
+            xSpanSize += pxRingbuffer->xSize;
+        }
+        pxRingbuffer->xItemsWaiting += xSpanSize;
+        pxRingbuffer->pucWrite = pxRingbuffer->pucAcquire;
+        return;
+    }
+    for (UBaseType_t i = 0; i < uxItemNum; i++) {
+        prvSendItemDoneNoSplit(pxRingbuffer, ppvItems[i]);
+    }
+}
+
+static UBaseType_t prvGetItems(Ringbuffer_t *pxRingbuffer, RingbufferItem_t *pxItems, UBaseType_t uxMaxItems)
+{
+    UBaseType_t uxItems = 0;
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        if (uxMaxItems > 0 && prvCheckItemAvail(pxRingbuffer) == pdTRUE) {
+            pxItems[0].pvItem = prvGetItemByteBuf(pxRingbuffer, NULL, 0, &pxItems[0].xItemSize);
+            uxItems = 1;
+            //Data left after retrieving the contiguous piece has wrapped around, and is contiguous from the head
+            if (uxMaxItems > 1 && pxRingbuffer->xItemsWaiting > 0) {
+                configASSERT(pxRingbuffer->pucRead == pxRingbuffer->pucHead);
+                pxItems[1].pvItem = pxRingbuffer->pucRead;
+                pxItems[1].xItemSize = pxRingbuffer->xItemsWaiting;
+                pxRingbuffer->pucRead += pxRingbuffer->xItemsWaiting;
+                pxRingbuffer->xItemsWaiting = 0;
+                uxItems = 2;
+            }
+        }
+        return uxItems;
+    }
+    while (uxItems < uxMaxItems && prvCheckItemAvail(pxRingbuffer) == pdTRUE) {
+        //Parts of split items are retrieved as separate items
+        BaseType_t xIsSplit;
+        pxItems[uxItems].pvItem = pxRingbuffer->pvGetItem(pxRingbuffer, &xIsSplit, 0, &pxItems[uxItems].xItemSize);
+        uxItems++;
+    }
+    return uxItems;
+}
+
+/* ------------------- Single-Producer/Single-Consumer Mode ------------------ */
+
+static inline size_t prvSpscOffset(Ringbuffer_t *pxRingbuffer, size_t xPos)
+{
+    return (xPos < pxRingbuffer->xSize) ? xPos : xPos - pxRingbuffer->xSize;
+}
+
+static inline size_t prvSpscAdvance(Ringbuffer_t *pxRingbuffer, size_t xPos, size_t xLen)
+{
+    xPos += xLen;
+    if (xPos >= 2 * pxRingbuffer->xSize) {
+        xPos -= 2 * pxRingbuffer->xSize;
+    }
+    return xPos;
+}
+
+//Number of bytes from xFrom to xTo
+static inline size_t prvSpscDistance(Ringbuffer_t *pxRingbuffer, size_t xFrom, size_t xTo)
+{
+    return (xTo >= xFrom) ? xTo - xFrom : xTo + 2 * pxRingbuffer->xSize - xFrom;
+}
+
+/*
+Position of the end of the no-split item at pucItem, starting from the position xPos before it.
+Any dummy data between xPos and the item is skipped over.
+*/
+static size_t prvSpscItemEnd(Ringbuffer_t *pxRingbuffer, size_t xPos, uint8_t *pucItem)
+{
+    ItemHeader_t *pxHeader = (ItemHeader_t *)(pucItem - rbHEADER_SIZE);
+    configASSERT((uint8_t *)pxHeader >= pxRingbuffer->pucHead && (uint8_t *)pxHeader < pxRingbuffer->pucTail);
+    size_t xOffset = prvSpscOffset(pxRingbuffer, xPos);
+    size_t xHeaderOffset = (uint8_t *)pxHeader - pxRingbuffer->pucHead;
+    size_t xSkipLen = (xHeaderOffset >= xOffset) ? xHeaderOffset - xOffset : pxRingbuffer->xSize - xOffset + xHeaderOffset;
+    return prvSpscAdvance(pxRingbuffer, xPos, xSkipLen + rbHEADER_SIZE + rbALIGN_SIZE(pxHeader->xItemLen));
+}
+
+//Give the semaphore of the other side if it is waiting for it
+static void prvSpscNotify(atomic_uint *puxWaiting, SemaphoreHandle_t xSemaphore, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    //Sequentially consistent, so that the waiting flag is read after the position was updated
+    if (atomic_load_explicit(puxWaiting, memory_order_seq_cst)) {
+        if (pxHigherPriorityTaskWoken != NULL) {
+            xSemaphoreGiveFromISR(xSemaphore, pxHigherPriorityTaskWoken);
+        } else {
+            xSemaphoreGive(xSemaphore);
+        }
+    }
+}
+
+/*
+Called when the producer or the consumer can't make progress. The first call
+only sets the waiting flag, so that the caller checks the ring buffer again
+before blocking and an update by the other side is not missed. The following
+calls block on the semaphore. Returns pdFALSE on time-out.
+*/
+static BaseType_t prvSpscWait(atomic_uint *puxWaiting, SemaphoreHandle_t xSemaphore, TickType_t xTicksEnd, TickType_t xTicksToWait)
+{
+    if (atomic_load_explicit(puxWaiting, memory_order_relaxed) == 0) {
+        atomic_store_explicit(puxWaiting, 1, memory_order_seq_cst);
+        atomic_thread_fence(memory_order_seq_cst);
+        return pdTRUE;
+    }
+    TickType_t xTicksRemaining = xTicksToWait;
+    if (xTicksToWait != portMAX_DELAY) {
+        xTicksRemaining = xTicksEnd - xTaskGetTickCount();
+        if (xTicksRemaining > xTicksToWait) {
+            return pdFALSE;     //xTicksRemaining has underflowed, timed out
+        }
+    }
+    return xSemaphoreTake(xSemaphore, xTicksRemaining);
+}
+
+static void prvInitializeSpsc(Ringbuffer_t *pxRingbuffer)
+{
+    configASSERT((pxRingbuffer->uxRingbufferFlags & rbALLOW_SPLIT_FLAG) == 0);
+    pxRingbuffer->uxRingbufferFlags |= rbSPSC_FLAG;
+    atomic_init(&pxRingbuffer->xSpscWrite, 0);
+    atomic_init(&pxRingbuffer->xSpscFree, 0);
+    pxRingbuffer->xSpscAcquire = 0;
+    pxRingbuffer->xSpscRead = 0;
+    pxRingbuffer->xSpscItemsSent = 0;
+    pxRingbuffer->xSpscItemsReceived = 0;
+    atomic_init(&pxRingbuffer->uxSpscTxWaiting, 0);
+    atomic_init(&pxRingbuffer->uxSpscRxWaiting, 0);
+    //The transmit semaphore is only given when the producer waits
+    xSemaphoreTake(rbGET_TX_SEM_HANDLE(pxRingbuffer), 0);
+}
+
+static BaseType_t prvSpscTrySend(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize, void **ppvItem)
+{
+    size_t xFree = atomic_load_explicit(&pxRingbuffer->xSpscFree, memory_order_acquire);
+    size_t xFreeSize = pxRingbuffer->xSize - prvSpscDistance(pxRingbuffer, xFree, pxRingbuffer->xSpscAcquire);
+    size_t xOffset = prvSpscOffset(pxRingbuffer, pxRingbuffer->xSpscAcquire);
+    size_t xRemLen = pxRingbuffer->xSize - xOffset;     //Length from the acquire position until end of buffer
+
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        if (xItemSize > xFreeSize) {
+            return pdFALSE;
+        }
+        //Copy the data, wrapping around if necessary
+        size_t xFirstLen = (xItemSize < xRemLen) ? xItemSize : xRemLen;
+        memcpy(pxRingbuffer->pucHead + xOffset, pucItem, xFirstLen);
+        memcpy(pxRingbuffer->pucHead, pucItem + xFirstLen, xItemSize - xFirstLen);
+        pxRingbuffer->xSpscAcquire = prvSpscAdvance(pxRingbuffer, pxRingbuffer->xSpscAcquire, xItemSize);
+    } else {
+        //If the remaining length can't fit the item, it is dummy data and the item is stored at the head
+        size_t xTotalItemSize = rbALIGN_SIZE(xItemSize) + rbHEADER_SIZE;
+        size_t xDummyLen = (xRemLen < xTotalItemSize) ? xRemLen : 0;
+        if (xDummyLen + xTotalItemSize > xFreeSize) {
+            return pdFALSE;
+        }
+        if (xDummyLen > 0) {
+            //Less than a header of dummy data has no header, the consumer skips it as well
+            if (xDummyLen >= rbHEADER_SIZE) {
+                ItemHeader_t *pxDummy = (ItemHeader_t *)(pxRingbuffer->pucHead + xOffset);
+                pxDummy->uxItemFlags = rbITEM_DUMMY_DATA_FLAG;
+                pxDummy->xItemLen = 0;
+            }
+            xOffset = 0;
+        }
+        ItemHeader_t *pxHeader = (ItemHeader_t *)(pxRingbuffer->pucHead + xOffset);
+        pxHeader->xItemLen = xItemSize;
+        size_t xAcquire = pxRingbuffer->xSpscAcquire;
+        pxRingbuffer->xSpscAcquire = prvSpscAdvance(pxRingbuffer, xAcquire, xDummyLen + xTotalItemSize);
+        if (ppvItem != NULL) {
+            pxHeader->uxItemFlags = 0;
+            *ppvItem = pxRingbuffer->pucHead + xOffset + rbHEADER_SIZE;
+            return pdTRUE;
+        }
+        memcpy(pxRingbuffer->pucHead + xOffset + rbHEADER_SIZE, pucItem, xItemSize);
+        pxHeader->uxItemFlags = rbITEM_WRITTEN_FLAG;
+        if (xAcquire != atomic_load_explicit(&pxRingbuffer->xSpscWrite, memory_order_relaxed)) {
+            //Acquired items precede this one, it is made available by prvSpscSendComplete() after them
+            return pdTRUE;
+        }
+    }
+    pxRingbuffer->xSpscItemsSent++;
+    //Sequentially consistent, so that the waiting flag of the consumer is read afterwards
+    atomic_store_explicit(&pxRingbuffer->xSpscWrite, pxRingbuffer->xSpscAcquire, memory_order_seq_cst);
+    return pdTRUE;
+}
+
+static BaseType_t prvSpscSend(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize, void **ppvItem, TickType_t xTicksToWait)
+{
+    BaseType_t xReturn = prvSpscTrySend(pxRingbuffer, pucItem, xItemSize, ppvItem);
+    if (xReturn == pdFALSE && xTicksToWait > 0) {
+        TickType_t xTicksEnd = xTaskGetTickCount() + xTicksToWait;
+        while (prvSpscWait(&pxRingbuffer->uxSpscTxWaiting, rbGET_TX_SEM_HANDLE(pxRingbuffer), xTicksEnd, xTicksToWait) == pdTRUE) {
+            if ((xReturn = prvSpscTrySend(pxRingbuffer, pucItem, xItemSize, ppvItem)) == pdTRUE) {
+                break;
+            }
+        }
+        atomic_store_explicit(&pxRingbuffer->uxSpscTxWaiting, 0, memory_order_relaxed);
+    }
+    if (xReturn == pdTRUE && ppvItem == NULL) {
+        prvSpscNotify(&pxRingbuffer->uxSpscRxWaiting, rbGET_RX_SEM_HANDLE(pxRingbuffer), NULL);
+    }
+    return xReturn;
+}
+
+static BaseType_t prvSpscTryAcquireMultiple(Ringbuffer_t *pxRingbuffer, void **ppvItems, const size_t *pxItemSizes, UBaseType_t uxItemNum)
+{
+    size_t xAcquire = pxRingbuffer->xSpscAcquire;
+    for (UBaseType_t i = 0; i < uxItemNum; i++) {
+        if (prvSpscTrySend(pxRingbuffer, NULL, pxItemSizes[i], &ppvItems[i]) == pdFALSE) {
+            pxRingbuffer->xSpscAcquire = xAcquire;      //Release the items acquired so far
+            return pdFALSE;
+        }
+    }
+    return pdTRUE;
+}
+
+static BaseType_t prvSpscAcquireMultiple(Ringbuffer_t *pxRingbuffer, void **ppvItems, const size_t *pxItemSizes, UBaseType_t uxItemNum, TickType_t xTicksToWait)
+{
+    BaseType_t xReturn = prvSpscTryAcquireMultiple(pxRingbuffer, ppvItems, pxItemSizes, uxItemNum);
+    if (xReturn == pdFALSE && xTicksToWait > 0) {
+        TickType_t xTicksEnd = xTaskGetTickCount() + xTicksToWait;
+        while (prvSpscWait(&pxRingbuffer->uxSpscTxWaiting, rbGET_TX_SEM_HANDLE(pxRingbuffer), xTicksEnd, xTicksToWait) == pdTRUE) {
+            if ((xReturn = prvSpscTryAcquireMultiple(pxRingbuffer, ppvItems, pxItemSizes, uxItemNum)) == pdTRUE) {
+                break;
+            }
+        }
+        atomic_store_explicit(&pxRingbuffer->uxSpscTxWaiting, 0, memory_order_relaxed);
+    }
+    return xReturn;
+}
+
+static void prvSpscSendComplete(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem, UBaseType_t uxItemNum, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    size_t xWrite = atomic_load_explicit(&pxRingbuffer->xSpscWrite, memory_order_relaxed);
+    size_t xEnd = prvSpscItemEnd(pxRingbuffer, xWrite, pucItem);
+    //Items must be completed in the order they were acquired
+    configASSERT(prvSpscDistance(pxRingbuffer, xWrite, xEnd) <= prvSpscDistance(pxRingbuffer, xWrite, pxRingbuffer->xSpscAcquire));
+    //Items sent after this one while it was acquired become available as well, up to the next acquired item
+    while (xEnd != pxRingbuffer->xSpscAcquire) {
+        size_t xOffset = prvSpscOffset(pxRingbuffer, xEnd);
+        ItemHeader_t *pxHeader = (ItemHeader_t *)(pxRingbuffer->pucHead + xOffset);
+        if (pxRingbuffer->xSize - xOffset < rbHEADER_SIZE || (pxHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG)) {
+            pxHeader = (ItemHeader_t *)pxRingbuffer->pucHead;
+        }
+        if ((pxHeader->uxItemFlags & rbITEM_WRITTEN_FLAG) == 0) {
+            break;
+        }
+        xEnd = prvSpscItemEnd(pxRingbuffer, xEnd, (uint8_t *)pxHeader + rbHEADER_SIZE);
+        uxItemNum++;
+    }
+    pxRingbuffer->xSpscItemsSent += uxItemNum;
+    atomic_store_explicit(&pxRingbuffer->xSpscWrite, xEnd, memory_order_seq_cst);
+    prvSpscNotify(&pxRingbuffer->uxSpscRxWaiting, rbGET_RX_SEM_HANDLE(pxRingbuffer), pxHigherPriorityTaskWoken);
+}
+
+static void *prvSpscTryReceive(Ringbuffer_t *pxRingbuffer, size_t xMaxSize, size_t *pxItemSize)
+{
+    size_t xWrite = atomic_load_explicit(&pxRingbuffer->xSpscWrite, memory_order_acquire);
+    if (xWrite == pxRingbuffer->xSpscRead) {
+        return NULL;
+    }
+    size_t xOffset = prvSpscOffset(pxRingbuffer, pxRingbuffer->xSpscRead);
+    size_t xRemLen = pxRingbuffer->xSize - xOffset;
+
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        //Retrieve the continuous data, up to xMaxSize bytes if it is not 0
+        size_t xLen = prvSpscDistance(pxRingbuffer, pxRingbuffer->xSpscRead, xWrite);
+        if (xLen > xRemLen) {
+            xLen = xRemLen;
+        }
+        if (xMaxSize > 0 && xLen > xMaxSize) {
+            xLen = xMaxSize;
+        }
+        pxRingbuffer->xSpscRead = prvSpscAdvance(pxRingbuffer, pxRingbuffer->xSpscRead, xLen);
+        *pxItemSize = xLen;
+        return pxRingbuffer->pucHead + xOffset;
+    }
+
+    ItemHeader_t *pxHeader = (ItemHeader_t *)(pxRingbuffer->pucHead + xOffset);
+    if (xRemLen < rbHEADER_SIZE || (pxHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG)) {
+        //Skip over the dummy data, the item is at the head of the buffer
+        pxRingbuffer->xSpscRead = prvSpscAdvance(pxRingbuffer, pxRingbuffer->xSpscRead, xRemLen);
+        configASSERT(pxRingbuffer->xSpscRead != xWrite);
+        pxHeader = (ItemHeader_t *)pxRingbuffer->pucHead;
+    }
+    configASSERT(pxHeader->xItemLen <= pxRingbuffer->xMaxItemSize);
+    *pxItemSize = pxHeader->xItemLen;
+    pxRingbuffer->xSpscRead = prvSpscItemEnd(pxRingbuffer, pxRingbuffer->xSpscRead, (uint8_t *)pxHeader + rbHEADER_SIZE);
+    pxRingbuffer->xSpscItemsReceived++;
+    return (uint8_t *)pxHeader + rbHEADER_SIZE;
+}
+
+static void *prvSpscReceive(Ringbuffer_t *pxRingbuffer, size_t xMaxSize, size_t *pxItemSize, TickType_t xTicksToWait)
+{
+    void *pvItem = prvSpscTryReceive(pxRingbuffer, xMaxSize, pxItemSize);
+    if (pvItem == NULL && xTicksToWait > 0) {
+        TickType_t xTicksEnd = xTaskGetTickCount() + xTicksToWait;
+        while (prvSpscWait(&pxRingbuffer->uxSpscRxWaiting, rbGET_RX_SEM_HANDLE(pxRingbuffer), xTicksEnd, xTicksToWait) == pdTRUE) {
+            if ((pvItem = prvSpscTryReceive(pxRingbuffer, xMaxSize, pxItemSize)) != NULL) {
+                break;
+            }
+        }
+        atomic_store_explicit(&pxRingbuffer->uxSpscRxWaiting, 0, memory_order_relaxed);
+    }
+    return pvItem;
+}
+
+static UBaseType_t prvSpscReceiveMultiple(Ringbuffer_t *pxRingbuffer, RingbufferItem_t *pxItems, UBaseType_t uxMaxItems, TickType_t xTicksToWait)
+{
+    if (uxMaxItems == 0) {
+        return 0;
+    }
+    pxItems[0].pvItem = prvSpscReceive(pxRingbuffer, 0, &pxItems[0].xItemSize, xTicksToWait);
+    if (pxItems[0].pvItem == NULL) {
+        return 0;
+    }
+    UBaseType_t uxItems = 1;
+    while (uxItems < uxMaxItems && (pxItems[uxItems].pvItem = prvSpscTryReceive(pxRingbuffer, 0, &pxItems[uxItems].xItemSize)) != NULL) {
+        uxItems++;
+    }
+    return uxItems;
+}
+
+static void prvSpscReturnItem(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    configASSERT(pucItem >= pxRingbuffer->pucHead && pucItem <= pxRingbuffer->pucTail);
+    size_t xFree = atomic_load_explicit(&pxRingbuffer->xSpscFree, memory_order_relaxed);
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        //Free all the data retrieved so far
+        xFree = pxRingbuffer->xSpscRead;
+    } else {
+        size_t xEnd = prvSpscItemEnd(pxRingbuffer, xFree, pucItem);
+        //Items must be returned in the order they were retrieved
+        configASSERT(prvSpscDistance(pxRingbuffer, xFree, xEnd) <= prvSpscDistance(pxRingbuffer, xFree, pxRingbuffer->xSpscRead));
+        xFree = xEnd;
+    }
+    //Sequentially consistent, so that the waiting flag of the producer is read afterwards
+    atomic_store_explicit(&pxRingbuffer->xSpscFree, xFree, memory_order_seq_cst);
+    prvSpscNotify(&pxRingbuffer->uxSpscTxWaiting, rbGET_TX_SEM_HANDLE(pxRingbuffer), pxHigherPriorityTaskWoken);
+}
+
+static size_t prvSpscGetCurMaxSize(Ringbuffer_t *pxRingbuffer)
+{
+    size_t xFree = atomic_load_explicit(&pxRingbuffer->xSpscFree, memory_order_acquire);
+    size_t xFreeSize = pxRingbuffer->xSize - prvSpscDistance(pxRingbuffer, xFree, pxRingbuffer->xSpscAcquire);
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        return xFreeSize;
+    }
+    //No-split items require contiguous space and a header
+    size_t xRemLen = pxRingbuffer->xSize - prvSpscOffset(pxRingbuffer, pxRingbuffer->xSpscAcquire);
+    size_t xContiguous = xFreeSize;
+    if (xFreeSize > xRemLen) {
+        xContiguous = (xRemLen > xFreeSize - xRemLen) ? xRemLen : xFreeSize - xRemLen;
+    }
+    if (xContiguous < rbHEADER_SIZE) {
+        return 0;
+    }
+    xContiguous -= rbHEADER_SIZE;
+    return (xContiguous > pxRingbuffer->xMaxItemSize) ? pxRingbuffer->xMaxItemSize : xContiguous;
+}
+
 /* --------------------------- Public Definitions --------------------------- */
 
 RingbufHandle_t xRingbufferCreate(size_t xBufferSize, RingbufferType_t xBufferType)
@@ -918,6 +1423,17 @@ RingbufHandle_t xRingbufferCreateNoSplit(size_t xItemSize, size_t xItemNum)
     return xRingbufferCreate((rbALIGN_SIZE(xItemSize) + rbHEADER_SIZE) * xItemNum, RINGBUF_TYPE_NOSPLIT);
 }
 
+RingbufHandle_t xRingbufferCreateSPSC(size_t xBufferSize, RingbufferType_t xBufferType)
+{
+    configASSERT(xBufferType == RINGBUF_TYPE_NOSPLIT || xBufferType == RINGBUF_TYPE_BYTEBUF);
+
+    Ringbuffer_t *pxNewRingbuffer = (Ringbuffer_t *)xRingbufferCreate(xBufferSize, xBufferType);
+    if (pxNewRingbuffer != NULL) {
+        prvInitializeSpsc(pxNewRingbuffer);
+    }
+    return (RingbufHandle_t)pxNewRingbuffer;
+}
+
 #if ( configSUPPORT_STATIC_ALLOCATION == 1 )
 RingbufHandle_t xRingbufferCreateStatic(size_t xBufferSize,
                                         RingbufferType_t xBufferType,
@@ -940,6 +1456,18 @@ RingbufHandle_t xRingbufferCreateStatic(size_t xBufferSize,
     pxNewRingbuffer->uxRingbufferFlags |= rbBUFFER_STATIC_FLAG;
     return (RingbufHandle_t)pxNewRingbuffer;
 }
+
+RingbufHandle_t xRingbufferCreateStaticSPSC(size_t xBufferSize,
+                                            RingbufferType_t xBufferType,
+                                            uint8_t *pucRingbufferStorage,
+                                            StaticRingbuffer_t *pxStaticRingbuffer)
+{
+    configASSERT(xBufferType == RINGBUF_TYPE_NOSPLIT || xBufferType == RINGBUF_TYPE_BYTEBUF);
+
+    Ringbuffer_t *pxNewRingbuffer = (Ringbuffer_t *)xRingbufferCreateStatic(xBufferSize, xBufferType, pucRingbufferStorage, pxStaticRingbuffer);
+    prvInitializeSpsc(pxNewRingbuffer);
+    return (RingbufHandle_t)pxNewRingbuffer;
+}
 #endif
 
 BaseType_t xRingbufferSendAcquire(RingbufHandle_t xRingbuffer, void **ppvItem, size_t xItemSize, TickType_t xTicksToWait)
@@ -958,6 +1486,9 @@ BaseType_t xRingbufferSendAcquire(RingbufHandle_t xRingbuffer, void **ppvItem, s
     if ((pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) && xItemSize == 0) {
         return pdTRUE;      //Sending 0 bytes to byte buffer has no effect
     }
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSpscSend(pxRingbuffer, NULL, xItemSize, ppvItem, xTicksToWait);
+    }
 
     //Attempt to send an item
     BaseType_t xReturn = pdFALSE;
@@ -1009,6 +1540,10 @@ BaseType_t xRingbufferSendComplete(RingbufHandle_t xRingbuffer, void *pvItem)
     configASSERT(pvItem != NULL);
     configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG)) == 0);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        prvSpscSendComplete(pxRingbuffer, pvItem, 1, NULL);
+        return pdTRUE;
+    }
     portENTER_CRITICAL(&pxRingbuffer->mux);
     prvSendItemDoneNoSplit(pxRingbuffer, pvItem);
     portEXIT_CRITICAL(&pxRingbuffer->mux);
@@ -1017,6 +1552,165 @@ BaseType_t xRingbufferSendComplete(RingbufHandle_t xRingbuffer, void *pvItem)
     return pdTRUE;
 }
 
+BaseType_t xRingbufferSendAcquireMultiple(RingbufHandle_t xRingbuffer,
+                                          void **ppvItems,
+                                          const size_t *pxItemSizes,
+                                          UBaseType_t uxItemNum,
+                                          TickType_t xTicksToWait)
+{
+    //Check arguments
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(ppvItems != NULL && pxItemSizes != NULL);
+    //Only supported in no-split buffers, and in byte buffers with both producers and consumers
+    configASSERT((pxRingbuffer->uxRingbufferFlags & rbALLOW_SPLIT_FLAG) == 0);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbSPSC_FLAG)) != (rbBYTE_BUFFER_FLAG | rbSPSC_FLAG));
+
+    for (UBaseType_t i = 0; i < uxItemNum; i++) {
+        ppvItems[i] = NULL;
+        if (pxItemSizes[i] > pxRingbuffer->xMaxItemSize) {
+            return pdFALSE;     //Data will never ever fit in the queue.
+        }
+    }
+    if (uxItemNum == 0 || ((pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) && pxItemSizes[0] == 0)) {
+        return pdTRUE;      //Acquiring 0 items or 0 bytes has no effect
+    }
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSpscAcquireMultiple(pxRingbuffer, ppvItems, pxItemSizes, uxItemNum, xTicksToWait);
+    }
+
+    //Attempt to acquire the items
+    BaseType_t xReturn = pdFALSE;
+    BaseType_t xReturnSemaphore = pdFALSE;
+    TickType_t xTicksEnd = xTaskGetTickCount() + xTicksToWait;
+    TickType_t xTicksRemaining = xTicksToWait;
+    while (xTicksRemaining <= xTicksToWait) {   //xTicksToWait will underflow once xTaskGetTickCount() > ticks_end
+        //Block until more free space becomes available or timeout
+        if (xSemaphoreTake(rbGET_TX_SEM_HANDLE(pxRingbuffer), xTicksRemaining) != pdTRUE) {
+            xReturn = pdFALSE;
+            break;
+        }
+
+        //Semaphore obtained, check if the items can fit
+        portENTER_CRITICAL(&pxRingbuffer->mux);
+        if (prvAcquireMultiple(pxRingbuffer, ppvItems, pxItemSizes, uxItemNum) == pdTRUE) {
+            xReturn = pdTRUE;
+            //Check if the free semaphore should be returned to allow other tasks to send
+            if (prvGetFreeSize(pxRingbuffer) > 0) {
+                xReturnSemaphore = pdTRUE;
+            }
+            portEXIT_CRITICAL(&pxRingbuffer->mux);
+            break;
+        }
+        //Items don't fit, adjust ticks and take the semaphore again
+        if (xTicksToWait != portMAX_DELAY) {
+            xTicksRemaining = xTicksEnd - xTaskGetTickCount();
+        }
+        portEXIT_CRITICAL(&pxRingbuffer->mux);
+        /*
+         * Gap between critical section and re-acquiring of the semaphore. If
+         * semaphore is given now, priority inversion might occur (see docs)
+         */
+    }
+
+    if (xReturn == pdFALSE) {
+        //A batch may not fit while smaller items still do, don't block other senders until space is freed
+        portENTER_CRITICAL(&pxRingbuffer->mux);
+        xReturnSemaphore = (prvGetFreeSize(pxRingbuffer) > 0) ? pdTRUE : pdFALSE;
+        portEXIT_CRITICAL(&pxRingbuffer->mux);
+    }
+    if (xReturnSemaphore == pdTRUE) {
+        xSemaphoreGive(rbGET_TX_SEM_HANDLE(pxRingbuffer));  //Give back semaphore so other tasks can acquire
+    }
+    return xReturn;
+}
+
+BaseType_t xRingbufferSendAcquireMultipleFromISR(RingbufHandle_t xRingbuffer,
+                                                 void **ppvItems,
+                                                 const size_t *pxItemSizes,
+                                                 UBaseType_t uxItemNum)
+{
+    //Check arguments
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(ppvItems != NULL && pxItemSizes != NULL);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & rbALLOW_SPLIT_FLAG) == 0);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbSPSC_FLAG)) != (rbBYTE_BUFFER_FLAG | rbSPSC_FLAG));
+
+    for (UBaseType_t i = 0; i < uxItemNum; i++) {
+        ppvItems[i] = NULL;
+        if (pxItemSizes[i] > pxRingbuffer->xMaxItemSize) {
+            return pdFALSE;     //Data will never ever fit in the queue.
+        }
+    }
+    if (uxItemNum == 0 || ((pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) && pxItemSizes[0] == 0)) {
+        return pdTRUE;      //Acquiring 0 items or 0 bytes has no effect
+    }
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSpscTryAcquireMultiple(pxRingbuffer, ppvItems, pxItemSizes, uxItemNum);
+    }
+
+    portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
+    BaseType_t xReturn = prvAcquireMultiple(pxRingbuffer, ppvItems, pxItemSizes, uxItemNum);
+    portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
+    return xReturn;
+}
+
+BaseType_t xRingbufferSendCompleteMultiple(RingbufHandle_t xRingbuffer, void **ppvItems, UBaseType_t uxItemNum)
+{
+    //Check arguments
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(ppvItems != NULL || uxItemNum == 0);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & rbALLOW_SPLIT_FLAG) == 0);
+
+    if (uxItemNum == 0 || ppvItems[0] == NULL) {
+        return pdTRUE;      //Nothing was acquired
+    }
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        prvSpscSendComplete(pxRingbuffer, ppvItems[uxItemNum - 1], uxItemNum, NULL);
+        return pdTRUE;
+    }
+    portENTER_CRITICAL(&pxRingbuffer->mux);
+    prvSendCompleteMultiple(pxRingbuffer, ppvItems, uxItemNum);
+    portEXIT_CRITICAL(&pxRingbuffer->mux);
+
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        xSemaphoreGive(rbGET_TX_SEM_HANDLE(pxRingbuffer));  //Data can be sent again now that the span was sent
+    }
+    xSemaphoreGive(rbGET_RX_SEM_HANDLE(pxRingbuffer));
+    return pdTRUE;
+}
+
+BaseType_t xRingbufferSendCompleteMultipleFromISR(RingbufHandle_t xRingbuffer,
+                                                  void **ppvItems,
+                                                  UBaseType_t uxItemNum,
+                                                  BaseType_t *pxHigherPriorityTaskWoken)
+{
+    //Check arguments
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(ppvItems != NULL || uxItemNum == 0);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & rbALLOW_SPLIT_FLAG) == 0);
+
+    if (uxItemNum == 0 || ppvItems[0] == NULL) {
+        return pdTRUE;      //Nothing was acquired
+    }
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        prvSpscSendComplete(pxRingbuffer, ppvItems[uxItemNum - 1], uxItemNum, pxHigherPriorityTaskWoken);
+        return pdTRUE;
+    }
+    portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
+    prvSendCompleteMultiple(pxRingbuffer, ppvItems, uxItemNum);
+    portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
+
+    if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+        xSemaphoreGiveFromISR(rbGET_TX_SEM_HANDLE(pxRingbuffer), pxHigherPriorityTaskWoken);  //Data can be sent again now that the span was sent
+    }
+    xSemaphoreGiveFromISR(rbGET_RX_SEM_HANDLE(pxRingbuffer), pxHigherPriorityTaskWoken);
+    return pdTRUE;
+}
+
 BaseType_t xRingbufferSend(RingbufHandle_t xRingbuffer,
                            const void *pvItem,
                            size_t xItemSize,
@@ -1032,6 +1726,9 @@ BaseType_t xRingbufferSend(RingbufHandle_t xRingbuffer,
     if ((pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) && xItemSize == 0) {
         return pdTRUE;      //Sending 0 bytes to byte buffer has no effect
     }
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSpscSend(pxRingbuffer, pvItem, xItemSize, NULL, xTicksToWait);
+    }
 
     //Attempt to send an item
     BaseType_t xReturn = pdFALSE;
@@ -1094,6 +1791,14 @@ BaseType_t xRingbufferSendFromISR(RingbufHandle_t xRingbuffer,
         return pdTRUE;      //Sending 0 bytes to byte buffer has no effect
     }
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        BaseType_t xReturn = prvSpscTrySend(pxRingbuffer, pvItem, xItemSize, NULL);
+        if (xReturn == pdTRUE) {
+            prvSpscNotify(&pxRingbuffer->uxSpscRxWaiting, rbGET_RX_SEM_HANDLE(pxRingbuffer), pxHigherPriorityTaskWoken);
+        }
+        return xReturn;
+    }
+
     //Attempt to send an item
     BaseType_t xReturn;
     BaseType_t xReturnSemaphore = pdFALSE;
@@ -1291,6 +1996,10 @@ void vRingbufferReturnItem(RingbufHandle_t xRingbuffer, void *pvItem)
     configASSERT(pxRingbuffer);
     configASSERT(pvItem != NULL);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        prvSpscReturnItem(pxRingbuffer, (uint8_t *)pvItem, NULL);
+        return;
+    }
     portENTER_CRITICAL(&pxRingbuffer->mux);
     pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pvItem);
     portEXIT_CRITICAL(&pxRingbuffer->mux);
@@ -1303,12 +2012,141 @@ void vRingbufferReturnItemFromISR(RingbufHandle_t xRingbuffer, void *pvItem, Bas
     configASSERT(pxRingbuffer);
     configASSERT(pvItem != NULL);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        prvSpscReturnItem(pxRingbuffer, (uint8_t *)pvItem, pxHigherPriorityTaskWoken);
+        return;
+    }
     portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
     pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pvItem);
     portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
     xSemaphoreGiveFromISR(rbGET_TX_SEM_HANDLE(pxRingbuffer), pxHigherPriorityTaskWoken);
 }
 
+UBaseType_t uxRingbufferReceiveMultiple(RingbufHandle_t xRingbuffer,
+                                        RingbufferItem_t *pxItems,
+                                        UBaseType_t uxMaxItems,
+                                        TickType_t xTicksToWait)
+{
+    //Check arguments
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(pxItems != NULL || uxMaxItems == 0);
+
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSpscReceiveMultiple(pxRingbuffer, pxItems, uxMaxItems, xTicksToWait);
+    }
+
+    //Attempt to retrieve the items
+    UBaseType_t uxItems = 0;
+    BaseType_t xReturnSemaphore = pdFALSE;
+    TickType_t xTicksEnd = xTaskGetTickCount() + xTicksToWait;
+    TickType_t xTicksRemaining = xTicksToWait;
+    while (uxMaxItems > 0 && xTicksRemaining <= xTicksToWait) {   //xTicksToWait will underflow once xTaskGetTickCount() > ticks_end
+        //Block until an item becomes available or timeout
+        if (xSemaphoreTake(rbGET_RX_SEM_HANDLE(pxRingbuffer), xTicksRemaining) != pdTRUE) {
+            break;
+        }
+
+        //Semaphore obtained, retrieve all available items
+        portENTER_CRITICAL(&pxRingbuffer->mux);
+        uxItems = prvGetItems(pxRingbuffer, pxItems, uxMaxItems);
+        if (uxItems > 0) {
+            if (pxRingbuffer->xItemsWaiting > 0) {
+                xReturnSemaphore = pdTRUE;
+            }
+            portEXIT_CRITICAL(&pxRingbuffer->mux);
+            break;
+        }
+        //No item available for retrieval, adjust ticks and take the semaphore again
+        if (xTicksToWait != portMAX_DELAY) {
+            xTicksRemaining = xTicksEnd - xTaskGetTickCount();
+        }
+        portEXIT_CRITICAL(&pxRingbuffer->mux);
+        /*
+         * Gap between critical section and re-acquiring of the semaphore. If
+         * semaphore is given now, priority inversion might occur (see docs)
+         */
+    }
+
+    if (xReturnSemaphore == pdTRUE) {
+        xSemaphoreGive(rbGET_RX_SEM_HANDLE(pxRingbuffer));  //Give semaphore back so other tasks can retrieve
+    }
+    return uxItems;
+}
+
+UBaseType_t uxRingbufferReceiveMultipleFromISR(RingbufHandle_t xRingbuffer,
+                                               RingbufferItem_t *pxItems,
+                                               UBaseType_t uxMaxItems)
+{
+    //Check arguments
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(pxItems != NULL || uxMaxItems == 0);
+
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSpscReceiveMultiple(pxRingbuffer, pxItems, uxMaxItems, 0);
+    }
+
+    BaseType_t xReturnSemaphore = pdFALSE;
+    portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
+    UBaseType_t uxItems = prvGetItems(pxRingbuffer, pxItems, uxMaxItems);
+    if (uxItems > 0 && pxRingbuffer->xItemsWaiting > 0) {
+        xReturnSemaphore = pdTRUE;
+    }
+    portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
+
+    if (xReturnSemaphore == pdTRUE) {
+        xSemaphoreGiveFromISR(rbGET_RX_SEM_HANDLE(pxRingbuffer), NULL);  //Give semaphore back so other tasks can retrieve
+    }
+    return uxItems;
+}
+
+void vRingbufferReturnItems(RingbufHandle_t xRingbuffer, const RingbufferItem_t *pxItems, UBaseType_t uxItemNum)
+{
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(pxItems != NULL || uxItemNum == 0);
+
+    if (uxItemNum == 0) {
+        return;
+    }
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        //Returning the last item returns all items before it
+        prvSpscReturnItem(pxRingbuffer, (uint8_t *)pxItems[uxItemNum - 1].pvItem, NULL);
+        return;
+    }
+    portENTER_CRITICAL(&pxRingbuffer->mux);
+    for (UBaseType_t i = 0; i < uxItemNum; i++) {
+        pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pxItems[i].pvItem);
+    }
+    portEXIT_CRITICAL(&pxRingbuffer->mux);
+    xSemaphoreGive(rbGET_TX_SEM_HANDLE(pxRingbuffer));
+}
+
+void vRingbufferReturnItemsFromISR(RingbufHandle_t xRingbuffer,
+                                   const RingbufferItem_t *pxItems,
+                                   UBaseType_t uxItemNum,
+                                   BaseType_t *pxHigherPriorityTaskWoken)
+{
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(pxItems != NULL || uxItemNum == 0);
+
+    if (uxItemNum == 0) {
+        return;
+    }
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        prvSpscReturnItem(pxRingbuffer, (uint8_t *)pxItems[uxItemNum - 1].pvItem, pxHigherPriorityTaskWoken);
+        return;
+    }
+    portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
+    for (UBaseType_t i = 0; i < uxItemNum; i++) {
+        pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pxItems[i].pvItem);
+    }
+    portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
+    xSemaphoreGiveFromISR(rbGET_TX_SEM_HANDLE(pxRingbuffer), pxHigherPriorityTaskWoken);
+}
+
 void vRingbufferDelete(RingbufHandle_t xRingbuffer)
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
@@ -1339,6 +2177,9 @@ size_t xRingbufferGetCurFreeSize(RingbufHandle_t xRingbuffer)
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
     configASSERT(pxRingbuffer);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSpscGetCurMaxSize(pxRingbuffer);
+    }
     size_t xFreeSize;
     portENTER_CRITICAL(&pxRingbuffer->mux);
     xFreeSize = pxRingbuffer->xGetCurMaxSize(pxRingbuffer);
@@ -1350,6 +2191,8 @@ BaseType_t xRingbufferAddToQueueSetRead(RingbufHandle_t xRingbuffer, QueueSetHan
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
     configASSERT(pxRingbuffer);
+    //The read semaphore of a single-producer/single-consumer ring buffer is only given when the consumer waits
+    configASSERT((pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) == 0);
 
     BaseType_t xReturn;
     portENTER_CRITICAL(&pxRingbuffer->mux);
@@ -1376,6 +2219,8 @@ BaseType_t xRingbufferRemoveFromQueueSetRead(RingbufHandle_t xRingbuffer, QueueS
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
     configASSERT(pxRingbuffer);
+    //The read semaphore of a single-producer/single-consumer ring buffer is only given when the consumer waits
+    configASSERT((pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) == 0);
 
     BaseType_t xReturn;
     portENTER_CRITICAL(&pxRingbuffer->mux);
@@ -1400,6 +2245,28 @@ void vRingbufferGetInfo(RingbufHandle_t xRingbuffer,
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
     configASSERT(pxRingbuffer);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        if (uxFree != NULL) {
+            *uxFree = (UBaseType_t)prvSpscOffset(pxRingbuffer, atomic_load(&pxRingbuffer->xSpscFree));
+        }
+        if (uxRead != NULL) {
+            *uxRead = (UBaseType_t)prvSpscOffset(pxRingbuffer, pxRingbuffer->xSpscRead);
+        }
+        if (uxWrite != NULL) {
+            *uxWrite = (UBaseType_t)prvSpscOffset(pxRingbuffer, atomic_load(&pxRingbuffer->xSpscWrite));
+        }
+        if (uxAcquire != NULL) {
+            *uxAcquire = (UBaseType_t)prvSpscOffset(pxRingbuffer, pxRingbuffer->xSpscAcquire);
+        }
+        if (uxItemsWaiting != NULL) {
+            if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
+                *uxItemsWaiting = (UBaseType_t)prvSpscDistance(pxRingbuffer, pxRingbuffer->xSpscRead, atomic_load(&pxRingbuffer->xSpscWrite));
+            } else {
+                *uxItemsWaiting = (UBaseType_t)(pxRingbuffer->xSpscItemsSent - pxRingbuffer->xSpscItemsReceived);
+            }
+        }
+        return;
+    }
     portENTER_CRITICAL(&pxRingbuffer->mux);
     if (uxFree != NULL) {
         *uxFree = (UBaseType_t)(pxRingbuffer->pucFree - pxRingbuffer->pucHead);
@@ -1423,6 +2290,13 @@ void xRingbufferPrintInfo(RingbufHandle_t xRingbuffer)
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
     configASSERT(pxRingbuffer);
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        UBaseType_t uxFree, uxRead, uxWrite, uxAcquire;
+        vRingbufferGetInfo(xRingbuffer, &uxFree, &uxRead, &uxWrite, &uxAcquire, NULL);
+        printf("Rb size:%d\tfree: %d\trptr: %d\tfreeptr: %d\twptr: %d, aptr: %d\n",
+               pxRingbuffer->xSize, prvSpscGetCurMaxSize(pxRingbuffer), uxRead, uxFree, uxWrite, uxAcquire);
+        return;
+    }
     printf("Rb size:%d\tfree: %d\trptr: %d\tfreeptr: %d\twptr: %d, aptr: %d\n",
            pxRingbuffer->xSize, prvGetFreeSize(pxRingbuffer),
            pxRingbuffer->pucRead - pxRingbuffer->pucHead,
@@ -6,6 +6,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
@@ -17,6 +18,7 @@
 #include "unity.h"
 #include "test_utils.h"
 #include "esp_rom_sys.h"
+#include "hal/cpu_hal.h"
 
 //Definitions used in multiple test cases
 #define TIMEOUT_TICKS               10
@@ -1046,3 +1048,331 @@ TEST_CASE("Test ringbuffer functions work with flash cache disabled", "[esp_ring
 {
     TEST_ASSERT( iram_ringbuf_test() );
 }
+
+/* ---------------- Test single-producer/single-consumer ring buffer -------------- */
+
+TEST_CASE("Test SPSC ring buffer with items returned in order", "[esp_ringbuf]")
+{
+    RingbufHandle_t handle = xRingbufferCreateSPSC(BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT);
+    TEST_ASSERT_NOT_NULL(handle);
+    TEST_ASSERT_EQUAL(BUFFER_SIZE / 2 - ITEM_HDR_SIZE, xRingbufferGetMaxItemSize(handle));
+
+    //Fill the buffer several times so that items wrap around
+    for (int iter = 0; iter < 10; iter++) {
+        int sent = 0;
+        while (xRingbufferSend(handle, large_item, LARGE_ITEM_SIZE, 0) == pdTRUE) {
+            sent++;
+        }
+        TEST_ASSERT(sent > 0);
+        UBaseType_t items_waiting;
+        vRingbufferGetInfo(handle, NULL, NULL, NULL, NULL, &items_waiting);
+        TEST_ASSERT_EQUAL(sent, items_waiting);
+
+        //Retrieve all items before returning them, returning the last one returns the others too
+        void *items[BUFFER_SIZE / (LARGE_ITEM_SIZE + ITEM_HDR_SIZE)];
+        TEST_ASSERT(sent <= sizeof(items) / sizeof(items[0]));
+        for (int i = 0; i < sent; i++) {
+            size_t item_size;
+            items[i] = xRingbufferReceive(handle, &item_size, 0);
+            TEST_ASSERT_NOT_NULL(items[i]);
+            TEST_ASSERT_EQUAL(LARGE_ITEM_SIZE, item_size);
+            TEST_ASSERT_EQUAL_HEX8_ARRAY(large_item, items[i], LARGE_ITEM_SIZE);
+        }
+        TEST_ASSERT_NULL(xRingbufferReceive(handle, NULL, 0));
+        vRingbufferReturnItem(handle, items[sent / 2]);
+        vRingbufferReturnItem(handle, items[sent - 1]);
+        //Send a small item to shift the position of the next round
+        send_item_and_check(handle, small_item, SMALL_ITEM_SIZE, 0, false);
+        receive_check_and_return_item_no_split(handle, small_item, SMALL_ITEM_SIZE, 0, false);
+    }
+    vRingbufferDelete(handle);
+}
+
+TEST_CASE("Test SPSC ring buffer items sent while an item is acquired", "[esp_ringbuf]")
+{
+    //Items sent after an acquired item can only be retrieved once it has been sent
+    RingbufHandle_t handle = xRingbufferCreateSPSC(BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT);
+    TEST_ASSERT_NOT_NULL(handle);
+    //The position moves on in each round, so that the items wrap around
+    for (int iter = 0; iter < 10; iter++) {
+        void *first, *second;
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendAcquire(handle, &first, SMALL_ITEM_SIZE, 0));
+        send_item_and_check(handle, large_item, LARGE_ITEM_SIZE, 0, false);
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendAcquire(handle, &second, SMALL_ITEM_SIZE, 0));
+        send_item_and_check(handle, large_item, MEDIUM_ITEM_SIZE, 0, false);
+        TEST_ASSERT_NULL(xRingbufferReceive(handle, NULL, 0));
+
+        memcpy(first, small_item, SMALL_ITEM_SIZE);
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendComplete(handle, first));
+        receive_check_and_return_item_no_split(handle, small_item, SMALL_ITEM_SIZE, 0, false);
+        receive_check_and_return_item_no_split(handle, large_item, LARGE_ITEM_SIZE, 0, false);
+        TEST_ASSERT_NULL(xRingbufferReceive(handle, NULL, 0));
+
+        memcpy(second, small_item, SMALL_ITEM_SIZE);
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendComplete(handle, second));
+        receive_check_and_return_item_no_split(handle, small_item, SMALL_ITEM_SIZE, 0, false);
+        receive_check_and_return_item_no_split(handle, large_item, MEDIUM_ITEM_SIZE, 0, false);
+        TEST_ASSERT_NULL(xRingbufferReceive(handle, NULL, 0));
+
+        UBaseType_t items_waiting;
+        vRingbufferGetInfo(handle, NULL, NULL, NULL, NULL, &items_waiting);
+        TEST_ASSERT_EQUAL(0, items_waiting);
+    }
+    vRingbufferDelete(handle);
+}
+
+TEST_CASE("Test SPSC ring buffer SMP", "[esp_ringbuf]")
+{
+    setup();
+    const RingbufferType_t types[] = { RINGBUF_TYPE_NOSPLIT, RINGBUF_TYPE_BYTEBUF };
+    for (int i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        task_args_t task_args;
+        task_args.buffer = xRingbufferCreateSPSC(CONT_DATA_TEST_BUFF_LEN, types[i]);
+        task_args.type = types[i];
+        TEST_ASSERT_MESSAGE(task_args.buffer != NULL, "Failed to create ring buffer");
+
+        for (int prior_mod = -1; prior_mod < 2; prior_mod++) {  //Test different relative priorities
+            for (int send_core = 0; send_core < portNUM_PROCESSORS; send_core++) {
+                for (int rec_core = 0; rec_core < portNUM_PROCESSORS; rec_core ++) {
+                    esp_rom_printf("Type: %d, PM: %d, SC: %d, RC: %d\n", types[i], prior_mod, send_core, rec_core);
+                    xTaskCreatePinnedToCore(send_task, "send tsk", 2048, (void *)&task_args, 10 + prior_mod, NULL, send_core);
+                    xTaskCreatePinnedToCore(rec_task, "rec tsk", 2048, (void *)&task_args, 10, NULL, rec_core);
+                    xSemaphoreTake(tasks_done, portMAX_DELAY);
+                    vTaskDelay(5);  //Allow idle to clean up
+                }
+            }
+        }
+        vRingbufferDelete(task_args.buffer);
+        vTaskDelay(10);
+    }
+    cleanup();
+}
+
+#define THROUGHPUT_ITEMS        10000
+#define THROUGHPUT_ITEM_SIZE    16
+
+static void throughput_send_task(void *args)
+{
+    RingbufHandle_t buffer = (RingbufHandle_t)args;
+    uint8_t item[THROUGHPUT_ITEM_SIZE] = { 0 };
+    for (int i = 0; i < THROUGHPUT_ITEMS; i++) {
+        TEST_ASSERT(xRingbufferSend(buffer, item, sizeof(item), portMAX_DELAY) == pdTRUE);
+    }
+    xSemaphoreGive(tx_done);
+    vTaskDelete(NULL);
+}
+
+static void throughput_rec_task(void *args)
+{
+    RingbufHandle_t buffer = (RingbufHandle_t)args;
+    for (int i = 0; i < THROUGHPUT_ITEMS; i++) {
+        size_t item_size;
+        void *item = xRingbufferReceive(buffer, &item_size, portMAX_DELAY);
+        TEST_ASSERT_NOT_NULL(item);
+        vRingbufferReturnItem(buffer, item);
+    }
+    xSemaphoreGive(rx_done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("Test SPSC ring buffer throughput", "[esp_ringbuf]")
+{
+    setup();
+    uint8_t item[THROUGHPUT_ITEM_SIZE] = { 0 };
+    for (int spsc = 0; spsc < 2; spsc++) {
+        RingbufHandle_t buffer = spsc ? xRingbufferCreateSPSC(1024, RINGBUF_TYPE_NOSPLIT) : xRingbufferCreate(1024, RINGBUF_TYPE_NOSPLIT);
+        TEST_ASSERT_NOT_NULL(buffer);
+        const char *name = spsc ? "SPSC" : "default";
+
+        //Send, receive and return in one task, the ring buffer never blocks
+        uint32_t start = cpu_hal_get_cycle_count();
+        for (int i = 0; i < THROUGHPUT_ITEMS; i++) {
+            size_t item_size;
+            xRingbufferSend(buffer, item, sizeof(item), 0);
+            vRingbufferReturnItem(buffer, xRingbufferReceive(buffer, &item_size, 0));
+        }
+        uint32_t end = cpu_hal_get_cycle_count();
+        printf("%s ring buffer: %d cycles per item in one task\n", name, (end - start) / THROUGHPUT_ITEMS);
+
+        //Producer and consumer tasks, on different cores if possible
+        start = cpu_hal_get_cycle_count();
+        xTaskCreatePinnedToCore(throughput_send_task, "send tsk", 2048, buffer, 10, NULL, 0);
+        xTaskCreatePinnedToCore(throughput_rec_task, "rec tsk", 2048, buffer, 10, NULL, portNUM_PROCESSORS - 1);
+        xSemaphoreTake(tx_done, portMAX_DELAY);
+        xSemaphoreTake(rx_done, portMAX_DELAY);
+        end = cpu_hal_get_cycle_count();
+        printf("%s ring buffer: %d cycles per item between two tasks\n", name, (end - start) / THROUGHPUT_ITEMS);
+
+        vTaskDelay(5);  //Allow idle to clean up
+        vRingbufferDelete(buffer);
+    }
+    cleanup();
+}
+
+/* ------------------ Test sending and retrieving items in batches ----------------- */
+
+#define BATCH_ITEMS     4
+
+TEST_CASE("Test ring buffer batch acquire and receive", "[esp_ringbuf]")
+{
+    const size_t sizes[BATCH_ITEMS] = { SMALL_ITEM_SIZE, MEDIUM_ITEM_SIZE, LARGE_ITEM_SIZE, SMALL_ITEM_SIZE };
+    for (int spsc = 0; spsc < 2; spsc++) {
+        RingbufHandle_t handle = spsc ? xRingbufferCreateSPSC(BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT) : xRingbufferCreate(BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT);
+        TEST_ASSERT_NOT_NULL(handle);
+
+        //Send batches several times so that items wrap around
+        for (int iter = 0; iter < 10; iter++) {
+            void *items[BATCH_ITEMS];
+            TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendAcquireMultiple(handle, items, sizes, BATCH_ITEMS, 0));
+            for (int i = 0; i < BATCH_ITEMS; i++) {
+                memcpy(items[i], large_item, sizes[i]);
+            }
+            //Items can't be received until they are sent
+            TEST_ASSERT_NULL(xRingbufferReceive(handle, NULL, 0));
+            TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendCompleteMultiple(handle, items, BATCH_ITEMS));
+
+            RingbufferItem_t rx_items[BATCH_ITEMS + 1];
+            TEST_ASSERT_EQUAL(BATCH_ITEMS, uxRingbufferReceiveMultiple(handle, rx_items, BATCH_ITEMS + 1, 0));
+            for (int i = 0; i < BATCH_ITEMS; i++) {
+                TEST_ASSERT_EQUAL(sizes[i], rx_items[i].xItemSize);
+                TEST_ASSERT_EQUAL_HEX8_ARRAY(large_item, rx_items[i].pvItem, sizes[i]);
+            }
+            vRingbufferReturnItems(handle, rx_items, BATCH_ITEMS);
+            //Send an item to shift the position of the next round
+            send_item_and_check(handle, small_item, SMALL_ITEM_SIZE, 0, false);
+            receive_check_and_return_item_no_split(handle, small_item, SMALL_ITEM_SIZE, 0, false);
+        }
+
+        //Either all items of a batch are acquired or none of them
+        const size_t max_item_size = xRingbufferGetMaxItemSize(handle);
+        const size_t large_sizes[3] = { max_item_size, max_item_size, max_item_size };
+        void *items[3];
+        TEST_ASSERT_EQUAL(pdFALSE, xRingbufferSendAcquireMultiple(handle, items, large_sizes, 3, TIMEOUT_TICKS));
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendAcquireMultiple(handle, items, large_sizes, 1, 0));
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendCompleteMultiple(handle, items, 1));
+        RingbufferItem_t rx_item;
+        TEST_ASSERT_EQUAL(1, uxRingbufferReceiveMultiple(handle, &rx_item, 1, 0));
+        TEST_ASSERT_EQUAL_PTR(items[0], rx_item.pvItem);
+        TEST_ASSERT_EQUAL(max_item_size, rx_item.xItemSize);
+        vRingbufferReturnItems(handle, &rx_item, 1);
+        vRingbufferDelete(handle);
+    }
+}
+
+TEST_CASE("Test ring buffer returning items after retrieving the whole buffer", "[esp_ringbuf]")
+{
+    RingbufHandle_t handle = xRingbufferCreate(4 * (LARGE_ITEM_SIZE + ITEM_HDR_SIZE), RINGBUF_TYPE_NOSPLIT);
+    TEST_ASSERT_NOT_NULL(handle);
+    for (int i = 0; i < 4; i++) {
+        send_item_and_check(handle, large_item, LARGE_ITEM_SIZE, 0, false);
+    }
+    RingbufferItem_t rx_items[4];
+    TEST_ASSERT_EQUAL(4, uxRingbufferReceiveMultiple(handle, rx_items, 4, 0));
+    //Returning some of the items must not free the others
+    vRingbufferReturnItems(handle, rx_items, 2);
+    TEST_ASSERT_EQUAL(2 * (LARGE_ITEM_SIZE + ITEM_HDR_SIZE) - ITEM_HDR_SIZE, xRingbufferGetCurFreeSize(handle));
+    send_item_and_check(handle, small_item, SMALL_ITEM_SIZE, 0, false);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(large_item, rx_items[2].pvItem, LARGE_ITEM_SIZE);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(large_item, rx_items[3].pvItem, LARGE_ITEM_SIZE);
+    vRingbufferReturnItems(handle, &rx_items[2], 2);
+    receive_check_and_return_item_no_split(handle, small_item, SMALL_ITEM_SIZE, 0, false);
+    vRingbufferDelete(handle);
+}
+
+TEST_CASE("Test byte buffer span acquire", "[esp_ringbuf]")
+{
+    RingbufHandle_t handle = xRingbufferCreate(BUFFER_SIZE, RINGBUF_TYPE_BYTEBUF);
+    TEST_ASSERT_NOT_NULL(handle);
+    uint8_t data[BUFFER_SIZE];
+    for (int i = 0; i < BUFFER_SIZE; i++) {
+        data[i] = i;
+    }
+
+    //Move the pointers to the middle of the buffer, so that data wraps around
+    TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSend(handle, data, BUFFER_SIZE / 2, 0));
+    size_t size = BUFFER_SIZE / 4;
+    void *span;
+    TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendAcquireMultiple(handle, &span, &size, 1, 0));
+    //No other data can be sent while the span is acquired
+    TEST_ASSERT_EQUAL(pdFALSE, xRingbufferSend(handle, data, 1, 0));
+    TEST_ASSERT_EQUAL(0, xRingbufferGetCurFreeSize(handle));
+    memcpy(span, data + BUFFER_SIZE / 2, size);
+    TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendCompleteMultiple(handle, &span, 1));
+
+    RingbufferItem_t rx_items[2];
+    TEST_ASSERT_EQUAL(1, uxRingbufferReceiveMultiple(handle, rx_items, 2, 0));
+    TEST_ASSERT_EQUAL(3 * BUFFER_SIZE / 4, rx_items[0].xItemSize);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(data, rx_items[0].pvItem, rx_items[0].xItemSize);
+    vRingbufferReturnItems(handle, rx_items, 1);
+
+    //Data wrapping around is retrieved as two pieces
+    TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSend(handle, data, BUFFER_SIZE / 2, 0));
+    TEST_ASSERT_EQUAL(2, uxRingbufferReceiveMultiple(handle, rx_items, 2, 0));
+    TEST_ASSERT_EQUAL(BUFFER_SIZE / 4, rx_items[0].xItemSize);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(data, rx_items[0].pvItem, BUFFER_SIZE / 4);
+    TEST_ASSERT_EQUAL(BUFFER_SIZE / 4, rx_items[1].xItemSize);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(data + BUFFER_SIZE / 4, rx_items[1].pvItem, BUFFER_SIZE / 4);
+    vRingbufferReturnItems(handle, rx_items, 2);
+
+    //Once the buffer is empty, a span of the whole buffer can be acquired
+    size = BUFFER_SIZE;
+    TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendAcquireMultiple(handle, &span, &size, 1, 0));
+    memcpy(span, data, size);
+    TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendCompleteMultiple(handle, &span, 1));
+    TEST_ASSERT_EQUAL(1, uxRingbufferReceiveMultiple(handle, rx_items, 2, 0));
+    TEST_ASSERT_EQUAL(BUFFER_SIZE, rx_items[0].xItemSize);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(data, rx_items[0].pvItem, BUFFER_SIZE);
+    vRingbufferReturnItems(handle, rx_items, 1);
+
+    //The span must be contiguous, it doesn't fit if the free space wraps around
+    TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSend(handle, data, BUFFER_SIZE / 2, 0));
+    TEST_ASSERT_NOT_NULL(rx_items[0].pvItem = xRingbufferReceiveUpTo(handle, &rx_items[0].xItemSize, 0, BUFFER_SIZE / 4));
+    vRingbufferReturnItems(handle, rx_items, 1);
+    TEST_ASSERT_EQUAL(3 * BUFFER_SIZE / 4, xRingbufferGetCurFreeSize(handle));
+    size = BUFFER_SIZE / 2 + 4;
+    TEST_ASSERT_EQUAL(pdFALSE, xRingbufferSendAcquireMultipleFromISR(handle, &span, &size, 1));
+    size = BUFFER_SIZE / 4;
+    TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendAcquireMultipleFromISR(handle, &span, &size, 1));
+    TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendCompleteMultipleFromISR(handle, &span, 1, NULL));
+    vRingbufferDelete(handle);
+}
+
+TEST_CASE("Test ring buffer batch throughput", "[esp_ringbuf]")
+{
+    size_t sizes[BATCH_ITEMS];
+    for (int i = 0; i < BATCH_ITEMS; i++) {
+        sizes[i] = THROUGHPUT_ITEM_SIZE;
+    }
+    for (int spsc = 0; spsc < 2; spsc++) {
+        RingbufHandle_t buffer = spsc ? xRingbufferCreateSPSC(1024, RINGBUF_TYPE_NOSPLIT) : xRingbufferCreate(1024, RINGBUF_TYPE_NOSPLIT);
+        TEST_ASSERT_NOT_NULL(buffer);
+        const char *name = spsc ? "SPSC" : "default";
+
+        //Acquire, send, receive and return one item at a time
+        uint32_t start = cpu_hal_get_cycle_count();
+        for (int i = 0; i < THROUGHPUT_ITEMS; i++) {
+            void *item;
+            size_t item_size;
+            xRingbufferSendAcquire(buffer, &item, THROUGHPUT_ITEM_SIZE, 0);
+            xRingbufferSendComplete(buffer, item);
+            vRingbufferReturnItem(buffer, xRingbufferReceive(buffer, &item_size, 0));
+        }
+        uint32_t end = cpu_hal_get_cycle_count();
+        printf("%s ring buffer: %d cycles per item one at a time\n", name, (end - start) / THROUGHPUT_ITEMS);
+
+        //The same in batches
+        start = cpu_hal_get_cycle_count();
+        for (int i = 0; i < THROUGHPUT_ITEMS; i += BATCH_ITEMS) {
+            void *items[BATCH_ITEMS];
+            RingbufferItem_t rx_items[BATCH_ITEMS];
+            xRingbufferSendAcquireMultiple(buffer, items, sizes, BATCH_ITEMS, 0);
+            xRingbufferSendCompleteMultiple(buffer, items, BATCH_ITEMS);
+            UBaseType_t count = uxRingbufferReceiveMultiple(buffer, rx_items, BATCH_ITEMS, 0);
+            TEST_ASSERT_EQUAL(BATCH_ITEMS, count);
+            vRingbufferReturnItems(buffer, rx_items, count);
+        }
+        end = cpu_hal_get_cycle_count();
+        printf("%s ring buffer: %d cycles per item in batches of %d\n", name, (end - start) / THROUGHPUT_ITEMS, BATCH_ITEMS);
+        vRingbufferDelete(buffer);
+    }
+}
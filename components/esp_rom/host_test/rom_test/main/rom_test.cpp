@@ -14,6 +14,9 @@
 #include <cstdio>
 #include <regex>
 #include <cstring>
+#include <chrono>
+#include <vector>
+#include <algorithm>
 #include "esp_rom_sys.h"
 #include "esp_rom_efuse.h"
 #include "esp_rom_crc.h"
@@ -58,6 +61,88 @@ TEST_CASE("crc quick check")
     CHECK(result == expected_result);
 }
 
+static uint32_t crc32_le_bitwise(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+TEST_CASE("crc32_le matches bitwise calculation for all lengths and alignments")
+{
+    vector<uint8_t> data(2048 + 16);
+    uint32_t seed = 0x12345678;
+    for (auto &b : data) {
+        seed = seed * 1103515245 + 12345;
+        b = seed >> 16;
+    }
+
+    size_t mismatches = 0;
+    for (size_t offset = 0; offset < 16; offset++) {
+        for (size_t len = 0; len <= 2048; len += (len < 300) ? 1 : 61) {
+            uint32_t init = offset * 0x01000193 + len;
+            if (esp_rom_crc32_le(init, data.data() + offset, len) != crc32_le_bitwise(init, data.data() + offset, len)) {
+                mismatches++;
+            }
+        }
+    }
+    CHECK(mismatches == 0);
+
+    // calculating in pieces gives the same result as in one go
+    uint32_t crc = 0xffffffff;
+    for (size_t pos = 0; pos < 2048; pos += 100) {
+        crc = esp_rom_crc32_le(crc, data.data() + pos, min<size_t>(100, 2048 - pos));
+    }
+    CHECK(crc == esp_rom_crc32_le(0xffffffff, data.data(), 2048));
+}
+
+// The byte-at-a-time table lookup which esp_rom_crc32_le used before
+static uint32_t crc32_le_bytewise(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    static uint32_t table[256];
+    if (table[1] == 0) {
+        for (int i = 0; i < 256; i++) {
+            const uint8_t byte = i;
+            table[i] = ~crc32_le_bitwise(~0u, &byte, 1);
+        }
+    }
+    crc = ~crc;
+    while (len--) {
+        crc = table[(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+TEST_CASE("crc32_le throughput")
+{
+    const size_t TOTAL = 64 * 1024 * 1024;
+    const size_t sizes[] = {32, 4096};
+    vector<uint8_t> data(4096, 0xa5);
+
+    for (size_t size : sizes) {
+        volatile uint32_t sink = 0;
+        auto start = chrono::steady_clock::now();
+        for (size_t done = 0; done < TOTAL; done += size) {
+            sink = esp_rom_crc32_le(sink, data.data(), size);
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        start = chrono::steady_clock::now();
+        for (size_t done = 0; done < TOTAL; done += size) {
+            sink = crc32_le_bytewise(sink, data.data(), size);
+        }
+        double bytewise_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        printf("crc32_le, %4zu byte buffers: %8.1f MB/s (byte-wise table: %6.1f MB/s)\n", size,
+               TOTAL / seconds / 1e6, TOTAL / bytewise_seconds / 1e6);
+    }
+}
+
 TEST_CASE("reset reason basic check")
 {
     CHECK(esp_rom_get_reset_reason(0) == RESET_REASON_CHIP_POWER_ON);
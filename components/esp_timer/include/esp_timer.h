@@ -73,6 +73,8 @@ typedef struct {
     esp_timer_dispatch_t dispatch_method;   //!< Call the callback from task or from ISR
     const char* name;               //!< Timer name, used in esp_timer_dump function
     bool skip_unhandled_events;     //!< Skip unhandled events for periodic timers
+    uint32_t slack_us;              //!< Time in microseconds by which the callback may be delayed, so that it can be
+                                    //!< called together with the callbacks of other timers instead of at its own wakeup
 } esp_timer_create_args_t;
 
 
@@ -206,6 +208,9 @@ int64_t esp_timer_get_next_alarm(void);
 
 /**
  * @brief Get the timestamp when the next timeout is expected to occur skipping those which have skip_unhandled_events flag
+ *
+ * The slack of the timers is taken into account, so this is the latest time at which the CPU needs to wake up.
+ *
  * @return Timestamp of the nearest timer event, in microseconds.
  *         The timebase is the same as for the values returned by esp_timer_get_time.
  */
@@ -252,7 +257,7 @@ esp_err_t esp_timer_get_expiry_time(esp_timer_handle_t timer, uint64_t *expiry);
  *
  * The format is:
  *
- *   name  period  alarm  times_armed  times_triggered  total_callback_run_time
+ *   name  period  alarm  times_armed  times_triggered  times_skipped  total_callback_run_time  slack  times_coalesced
  *
  * where:
  *
@@ -265,7 +270,11 @@ esp_err_t esp_timer_get_expiry_time(esp_timer_handle_t timer, uint64_t *expiry);
  *
  * times_armed — number of times the timer was armed via esp_timer_start_X
  * times_triggered - number of times the callback was called
+ * times_skipped - number of times the callback was skipped, for periodic timers with skip_unhandled_events
  * total_callback_run_time - total time taken by callback to execute, across all calls
+ * slack - time by which the callback may be delayed, in microseconds
+ * times_coalesced - number of times the callback was called before the end of its slack, on a wakeup needed by
+ *                   another timer, so that the timer did not need a wakeup of its own
  *
  * @param stream stream (such as stdout) to dump the information to
  * @return
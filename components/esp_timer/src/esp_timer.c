@@ -43,6 +43,10 @@
 #define WITH_PROFILING 1
 #endif
 
+#ifdef CONFIG_ESP_TIMER_LIST_PAIRING_HEAP
+#define WITH_PAIRING_HEAP 1
+#endif
+
 #ifndef NDEBUG
 // Enable built-in checks in queue.h in debug builds
 #define INVARIANTS
@@ -65,14 +69,22 @@ struct esp_timer {
         uint32_t event_id;
     };
     void* arg;
+    uint32_t slack;     // the callback may be called up to this many microseconds after the alarm
 #if WITH_PROFILING
     const char* name;
     size_t times_triggered;
     size_t times_armed;
     size_t times_skipped;
+    size_t times_coalesced;
     uint64_t total_callback_run_time;
 #endif // WITH_PROFILING
     LIST_ENTRY(esp_timer) list_entry;
+#if WITH_PAIRING_HEAP
+    struct esp_timer* heap_child;   // first child
+    struct esp_timer* heap_next;    // next sibling
+    struct esp_timer* heap_prev;    // previous sibling, or parent for the first child
+    uint32_t heap_seq;              // orders timers with the same alarm by the time they were armed
+#endif // WITH_PAIRING_HEAP
 };
 
 static inline bool is_initialized(void);
@@ -89,10 +101,17 @@ static void timer_remove_inactive(esp_timer_handle_t timer);
 
 __attribute__((unused)) static const char* TAG = "esp_timer";
 
+#if WITH_PAIRING_HEAP
+// pairing heaps of currently armed timers for two dispatch methods: ISR and TASK
+static esp_timer_handle_t s_timer_heap[ESP_TIMER_MAX];
+// sequence number given to the next armed timer
+static uint32_t s_timer_heap_seq[ESP_TIMER_MAX];
+#else
 // lists of currently armed timers for two dispatch methods: ISR and TASK
 static LIST_HEAD(esp_timer_list, esp_timer) s_timers[ESP_TIMER_MAX] = {
     [0 ... (ESP_TIMER_MAX - 1)] = LIST_HEAD_INITIALIZER(s_timers)
 };
+#endif
 #if WITH_PROFILING
 // lists of unarmed timers for two dispatch methods: ISR and TASK,
 // used only to be able to dump statistics about all the timers
@@ -100,6 +119,10 @@ static LIST_HEAD(esp_inactive_timer_list, esp_timer) s_inactive_timers[ESP_TIMER
     [0 ... (ESP_TIMER_MAX - 1)] = LIST_HEAD_INITIALIZER(s_timers)
 };
 #endif
+// time at which the hardware alarm is set for each dispatch method, the earliest deadline of the armed timers
+static uint64_t s_timer_deadline[ESP_TIMER_MAX] = {
+    [0 ... (ESP_TIMER_MAX - 1)] = UINT64_MAX
+};
 // task used to dispatch timer callbacks
 static TaskHandle_t s_timer_task;
 
@@ -129,6 +152,7 @@ esp_err_t esp_timer_create(const esp_timer_create_args_t* args,
     }
     result->callback = args->callback;
     result->arg = args->arg;
+    result->slack = args->slack_us;
     result->flags = (args->dispatch_method ? FL_ISR_DISPATCH_METHOD : 0) |
                     (args->skip_unhandled_events ? FL_SKIP_UNHANDLED_EVENTS : 0);
 #if WITH_PROFILING
@@ -215,18 +239,161 @@ esp_err_t esp_timer_delete(esp_timer_handle_t timer)
     timer->event_id = EVENT_ID_DELETE_TIMER;
     timer->alarm = alarm;
     timer->period = 0;
+    timer->slack = 0;
     timer_insert(timer, false);
     timer_list_unlock(ESP_TIMER_TASK);
     return ESP_OK;
 }
 
-static IRAM_ATTR esp_err_t timer_insert(esp_timer_handle_t timer, bool without_update_alarm)
+#if WITH_PAIRING_HEAP
+
+/* Armed timers are kept in a pairing heap ordered by alarm time, then by the order in which they were armed,
+ * so that timers with the same alarm fire in the same order as with a sorted list.
+ * Inserting a timer takes constant time, removing one takes amortized logarithmic time.
+ */
+
+static IRAM_ATTR inline bool timer_heap_before(esp_timer_handle_t a, esp_timer_handle_t b)
+{
+    if (a->alarm != b->alarm) {
+        return a->alarm < b->alarm;
+    }
+    return (int32_t)(a->heap_seq - b->heap_seq) < 0;
+}
+
+/* Merge two heaps, returns the new root */
+static IRAM_ATTR esp_timer_handle_t timer_heap_meld(esp_timer_handle_t a, esp_timer_handle_t b)
+{
+    if (timer_heap_before(b, a)) {
+        esp_timer_handle_t tmp = a;
+        a = b;
+        b = tmp;
+    }
+    b->heap_prev = a;
+    b->heap_next = a->heap_child;
+    if (a->heap_child) {
+        a->heap_child->heap_prev = b;
+    }
+    a->heap_child = b;
+    return a;
+}
+
+/* Merge a list of sibling heaps into one: meld them in pairs from left to right, then meld the pairs from right
+ * to left. Returns the new root.
+ */
+static IRAM_ATTR esp_timer_handle_t timer_heap_merge_pairs(esp_timer_handle_t first)
+{
+    esp_timer_handle_t pairs = NULL;
+    while (first) {
+        esp_timer_handle_t a = first;
+        esp_timer_handle_t b = a->heap_next;
+        first = b ? b->heap_next : NULL;
+        a->heap_next = a->heap_prev = NULL;
+        if (b) {
+            b->heap_next = b->heap_prev = NULL;
+            a = timer_heap_meld(a, b);
+        }
+        a->heap_next = pairs;
+        pairs = a;
+    }
+    esp_timer_handle_t root = pairs;
+    if (root) {
+        pairs = root->heap_next;
+        root->heap_next = NULL;
+        while (pairs) {
+            esp_timer_handle_t a = pairs;
+            pairs = a->heap_next;
+            a->heap_next = NULL;
+            root = timer_heap_meld(root, a);
+        }
+    }
+    return root;
+}
+
+static IRAM_ATTR inline esp_timer_handle_t timer_list_first(esp_timer_dispatch_t dispatch_method)
+{
+    return s_timer_heap[dispatch_method];
+}
+
+static IRAM_ATTR void timer_list_add(esp_timer_handle_t timer, esp_timer_dispatch_t dispatch_method)
+{
+    timer->heap_child = timer->heap_next = timer->heap_prev = NULL;
+    timer->heap_seq = s_timer_heap_seq[dispatch_method]++;
+    esp_timer_handle_t root = s_timer_heap[dispatch_method];
+    s_timer_heap[dispatch_method] = root ? timer_heap_meld(root, timer) : timer;
+}
+
+static IRAM_ATTR void timer_list_del(esp_timer_handle_t timer, esp_timer_dispatch_t dispatch_method)
+{
+    esp_timer_handle_t children = timer_heap_merge_pairs(timer->heap_child);
+    if (timer == s_timer_heap[dispatch_method]) {
+        s_timer_heap[dispatch_method] = children;
+        return;
+    }
+    // unlink the subtree of the timer from its parent and siblings, then meld what remains of it with the root
+    if (timer->heap_prev->heap_child == timer) {
+        timer->heap_prev->heap_child = timer->heap_next;
+    } else {
+        timer->heap_prev->heap_next = timer->heap_next;
+    }
+    if (timer->heap_next) {
+        timer->heap_next->heap_prev = timer->heap_prev;
+    }
+    if (children) {
+        s_timer_heap[dispatch_method] = timer_heap_meld(s_timer_heap[dispatch_method], children);
+    }
+}
+
+/* Next timer of the heap in pre-order, for walking through all armed timers.
+ * If descend is false, the children of the timer, which all have a later alarm, are skipped.
+ */
+static IRAM_ATTR esp_timer_handle_t timer_list_next(esp_timer_handle_t timer, bool descend)
+{
+    if (descend && timer->heap_child) {
+        return timer->heap_child;
+    }
+    while (timer) {
+        if (timer->heap_next) {
+            return timer->heap_next;
+        }
+        // go up to the parent, through the first sibling
+        while (timer->heap_prev && timer->heap_prev->heap_child != timer) {
+            timer = timer->heap_prev;
+        }
+        timer = timer->heap_prev;
+    }
+    return NULL;
+}
+
+#define TIMER_LIST_FOREACH(it, dispatch_method) \
+    for ((it) = timer_list_first(dispatch_method); (it) != NULL; (it) = timer_list_next(it, true))
+
+/* Earliest alarm plus slack of the timers which have the skip_flags clear, only timers with an earlier alarm need
+ * to be looked at.
+ */
+static IRAM_ATTR uint64_t timer_list_deadline(esp_timer_dispatch_t dispatch_method, flags_t skip_flags)
+{
+    uint64_t deadline = UINT64_MAX;
+    esp_timer_handle_t it = timer_list_first(dispatch_method);
+    while (it != NULL) {
+        bool earlier = it->alarm < deadline;
+        if (earlier && (it->flags & skip_flags) == 0) {
+            deadline = MIN(deadline, it->alarm + it->slack);
+        }
+        it = timer_list_next(it, earlier);
+    }
+    return deadline;
+}
+
+#else // !WITH_PAIRING_HEAP
+
+static IRAM_ATTR inline esp_timer_handle_t timer_list_first(esp_timer_dispatch_t dispatch_method)
+{
+    return LIST_FIRST(&s_timers[dispatch_method]);
+}
+
+static IRAM_ATTR void timer_list_add(esp_timer_handle_t timer, esp_timer_dispatch_t dispatch_method)
 {
-#if WITH_PROFILING
-    timer_remove_inactive(timer);
-#endif
     esp_timer_handle_t it, last = NULL;
-    esp_timer_dispatch_t dispatch_method = timer->flags & FL_ISR_DISPATCH_METHOD;
     if (LIST_FIRST(&s_timers[dispatch_method]) == NULL) {
         LIST_INSERT_HEAD(&s_timers[dispatch_method], timer, list_entry);
     } else {
@@ -242,8 +409,56 @@ static IRAM_ATTR esp_err_t timer_insert(esp_timer_handle_t timer, bool without_u
             LIST_INSERT_AFTER(last, timer, list_entry);
         }
     }
-    if (without_update_alarm == false && timer == LIST_FIRST(&s_timers[dispatch_method])) {
-        esp_timer_impl_set_alarm_id(timer->alarm, dispatch_method);
+}
+
+static IRAM_ATTR inline void timer_list_del(esp_timer_handle_t timer, esp_timer_dispatch_t dispatch_method)
+{
+    LIST_REMOVE(timer, list_entry);
+}
+
+#define TIMER_LIST_FOREACH(it, dispatch_method) \
+    LIST_FOREACH(it, &s_timers[dispatch_method], list_entry)
+
+/* Earliest alarm plus slack of the timers which have the skip_flags clear, only timers with an earlier alarm need
+ * to be looked at.
+ */
+static IRAM_ATTR uint64_t timer_list_deadline(esp_timer_dispatch_t dispatch_method, flags_t skip_flags)
+{
+    uint64_t deadline = UINT64_MAX;
+    esp_timer_handle_t it;
+    LIST_FOREACH(it, &s_timers[dispatch_method], list_entry) {
+        if (it->alarm >= deadline) {
+            break;
+        }
+        if ((it->flags & skip_flags) == 0) {
+            deadline = MIN(deadline, it->alarm + it->slack);
+        }
+    }
+    return deadline;
+}
+
+#endif // !WITH_PAIRING_HEAP
+
+/* Set the hardware alarm. Timers with slack do not get a wakeup of their own if another timer needs one
+ * before the end of their slack: the alarm is set at the earliest deadline, and timer_process_alarm then calls
+ * all the timers whose alarm has passed.
+ */
+static IRAM_ATTR void timer_set_alarm(esp_timer_dispatch_t dispatch_method, uint64_t deadline)
+{
+    s_timer_deadline[dispatch_method] = deadline;
+    esp_timer_impl_set_alarm_id(deadline, dispatch_method);
+}
+
+static IRAM_ATTR esp_err_t timer_insert(esp_timer_handle_t timer, bool without_update_alarm)
+{
+#if WITH_PROFILING
+    timer_remove_inactive(timer);
+#endif
+    esp_timer_dispatch_t dispatch_method = timer->flags & FL_ISR_DISPATCH_METHOD;
+    timer_list_add(timer, dispatch_method);
+    uint64_t deadline = timer->alarm + timer->slack;
+    if (without_update_alarm == false && deadline < s_timer_deadline[dispatch_method]) {
+        timer_set_alarm(dispatch_method, deadline);
     }
     return ESP_OK;
 }
@@ -252,17 +467,12 @@ static IRAM_ATTR esp_err_t timer_remove(esp_timer_handle_t timer)
 {
     esp_timer_dispatch_t dispatch_method = timer->flags & FL_ISR_DISPATCH_METHOD;
     timer_list_lock(dispatch_method);
-    esp_timer_handle_t first_timer = LIST_FIRST(&s_timers[dispatch_method]);
-    LIST_REMOVE(timer, list_entry);
+    uint64_t deadline = timer->alarm + timer->slack;
+    timer_list_del(timer, dispatch_method);
     timer->alarm = 0;
     timer->period = 0;
-    if (timer == first_timer) { // if this timer was the first in the list.
-        uint64_t next_timestamp = UINT64_MAX;
-        first_timer = LIST_FIRST(&s_timers[dispatch_method]);
-        if (first_timer) { // if after removing the timer from the list, this list is not empty.
-            next_timestamp = first_timer->alarm;
-        }
-        esp_timer_impl_set_alarm_id(next_timestamp, dispatch_method);
+    if (deadline == s_timer_deadline[dispatch_method]) { // if the alarm was set for this timer
+        timer_set_alarm(dispatch_method, timer_list_deadline(dispatch_method, 0));
     }
 #if WITH_PROFILING
     timer_insert_inactive(timer);
@@ -322,13 +532,13 @@ static bool timer_process_alarm(esp_timer_dispatch_t dispatch_method)
     bool processed = false;
     esp_timer_handle_t it;
     while (1) {
-        it = LIST_FIRST(&s_timers[dispatch_method]);
+        it = timer_list_first(dispatch_method);
         int64_t now = esp_timer_impl_get_time();
         if (it == NULL || it->alarm > now) {
             break;
         }
         processed = true;
-        LIST_REMOVE(it, list_entry);
+        timer_list_del(it, dispatch_method);
         if (it->event_id == EVENT_ID_DELETE_TIMER) {
             // It is handled only by ESP_TIMER_TASK (see esp_timer_delete()).
             // All the ESP_TIMER_ISR timers which should be deleted are moved by esp_timer_delete() to the ESP_TIMER_TASK list.
@@ -336,6 +546,12 @@ static bool timer_process_alarm(esp_timer_dispatch_t dispatch_method)
             free(it);
             it = NULL;
         } else {
+#if WITH_PROFILING
+            if (it->alarm + it->slack > now) {
+                // called on a wakeup needed by another timer, before the end of its slack
+                it->times_coalesced++;
+            }
+#endif
             if (it->period > 0) {
                 int skipped = (now - it->alarm) / it->period;
                 if ((it->flags & FL_SKIP_UNHANDLED_EVENTS) && (skipped > 1)) {
@@ -369,11 +585,11 @@ static bool timer_process_alarm(esp_timer_dispatch_t dispatch_method)
     } // while(1)
     if (it) {
         if (dispatch_method == ESP_TIMER_TASK || (dispatch_method != ESP_TIMER_TASK && processed == true)) {
-            esp_timer_impl_set_alarm_id(it->alarm, dispatch_method);
+            timer_set_alarm(dispatch_method, timer_list_deadline(dispatch_method, 0));
         }
     } else {
         if (processed) {
-            esp_timer_impl_set_alarm_id(UINT64_MAX, dispatch_method);
+            timer_set_alarm(dispatch_method, UINT64_MAX);
         }
     }
     timer_list_unlock(dispatch_method);
@@ -469,7 +685,7 @@ esp_err_t esp_timer_deinit(void)
 
     /* Check if there are any active timers */
     for (esp_timer_dispatch_t dispatch_method = ESP_TIMER_TASK; dispatch_method < ESP_TIMER_MAX; ++dispatch_method) {
-        if (!LIST_EMPTY(&s_timers[dispatch_method])) {
+        if (timer_list_first(dispatch_method) != NULL) {
             return ESP_ERR_INVALID_STATE;
         }
     }
@@ -502,11 +718,12 @@ static void print_timer_info(esp_timer_handle_t t, char** dst, size_t* dst_size)
     } else {
         cb = snprintf(*dst, *dst_size, "timer@%-10p  ", t);
     }
-    cb += snprintf(*dst + cb, *dst_size + cb, "%-10lld  %-12lld  %-12d  %-12d  %-12d  %-12lld\n",
+    cb += snprintf(*dst + cb, *dst_size + cb, "%-10lld  %-12lld  %-12d  %-12d  %-12d  %-12lld  %-10u  %-12d\n",
                     (uint64_t)t->period, t->alarm, t->times_armed,
-                    t->times_triggered, t->times_skipped, t->total_callback_run_time);
+                    t->times_triggered, t->times_skipped, t->total_callback_run_time,
+                    t->slack, t->times_coalesced);
     /* keep this in sync with the format string, used in esp_timer_dump */
-#define TIMER_INFO_LINE_LEN 90
+#define TIMER_INFO_LINE_LEN 116
 #else
     size_t cb = snprintf(*dst, *dst_size, "timer@%-14p  %-10lld  %-12lld\n", t, (uint64_t)t->period, t->alarm);
 #define TIMER_INFO_LINE_LEN 46
@@ -530,7 +747,7 @@ esp_err_t esp_timer_dump(FILE* stream)
     size_t timer_count = 0;
     for (esp_timer_dispatch_t dispatch_method = ESP_TIMER_TASK; dispatch_method < ESP_TIMER_MAX; ++dispatch_method) {
         timer_list_lock(dispatch_method);
-        LIST_FOREACH(it, &s_timers[dispatch_method], list_entry) {
+        TIMER_LIST_FOREACH(it, dispatch_method) {
             ++timer_count;
         }
 #if WITH_PROFILING
@@ -556,7 +773,7 @@ esp_err_t esp_timer_dump(FILE* stream)
     char* pos = print_buf;
     for (esp_timer_dispatch_t dispatch_method = ESP_TIMER_TASK; dispatch_method < ESP_TIMER_MAX; ++dispatch_method) {
         timer_list_lock(dispatch_method);
-        LIST_FOREACH(it, &s_timers[dispatch_method], list_entry) {
+        TIMER_LIST_FOREACH(it, dispatch_method) {
             print_timer_info(it, &pos, &buf_size);
         }
 #if WITH_PROFILING
@@ -570,8 +787,9 @@ esp_err_t esp_timer_dump(FILE* stream)
     if (stream != NULL) {
         fprintf(stream, "Timer stats:\n");
 #if WITH_PROFILING
-        fprintf(stream, "%-20s  %-10s  %-12s  %-12s  %-12s  %-12s  %-12s\n",
-                "Name", "Period", "Alarm", "Times_armed", "Times_trigg", "Times_skip", "Cb_exec_time");
+        fprintf(stream, "%-20s  %-10s  %-12s  %-12s  %-12s  %-12s  %-12s  %-10s  %-12s\n",
+                "Name", "Period", "Alarm", "Times_armed", "Times_trigg", "Times_skip", "Cb_exec_time",
+                "Slack", "Times_coal");
 #else
         fprintf(stream, "%-20s  %-10s  %-12s\n", "Name", "Period", "Alarm");
 #endif
@@ -589,7 +807,7 @@ int64_t IRAM_ATTR esp_timer_get_next_alarm(void)
     int64_t next_alarm = INT64_MAX;
     for (esp_timer_dispatch_t dispatch_method = ESP_TIMER_TASK; dispatch_method < ESP_TIMER_MAX; ++dispatch_method) {
         timer_list_lock(dispatch_method);
-        esp_timer_handle_t it = LIST_FIRST(&s_timers[dispatch_method]);
+        esp_timer_handle_t it = timer_list_first(dispatch_method);
         if (it) {
             if (next_alarm > it->alarm) {
                 next_alarm = it->alarm;
@@ -605,15 +823,11 @@ int64_t IRAM_ATTR esp_timer_get_next_alarm_for_wake_up(void)
     int64_t next_alarm = INT64_MAX;
     for (esp_timer_dispatch_t dispatch_method = ESP_TIMER_TASK; dispatch_method < ESP_TIMER_MAX; ++dispatch_method) {
         timer_list_lock(dispatch_method);
-        esp_timer_handle_t it = NULL;
-        LIST_FOREACH(it, &s_timers[dispatch_method], list_entry) {
-            // timers with the SKIP_UNHANDLED_EVENTS flag do not want to wake up CPU from a sleep mode.
-            if ((it->flags & FL_SKIP_UNHANDLED_EVENTS) == 0) {
-                if (next_alarm > it->alarm) {
-                    next_alarm = it->alarm;
-                }
-                break;
-            }
+        // timers with the SKIP_UNHANDLED_EVENTS flag do not want to wake up CPU from a sleep mode,
+        // the others need to be called by the end of their slack.
+        uint64_t deadline = timer_list_deadline(dispatch_method, FL_SKIP_UNHANDLED_EVENTS);
+        if ((uint64_t) next_alarm > deadline) {
+            next_alarm = deadline;
         }
         timer_list_unlock(dispatch_method);
     }
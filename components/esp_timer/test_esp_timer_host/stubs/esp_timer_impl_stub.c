@@ -0,0 +1,99 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Hardware timer and FreeRTOS stand-ins for running esp_timer.c on the host.
+ * Time only moves when the test calls esp_timer_impl_advance(), and timers with
+ * the ESP_TIMER_ISR dispatch method are processed when the test calls
+ * esp_timer_host_fire(). The timer task does not run, so deleted timers are not freed.
+ */
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_timer_impl.h"
+#include "freertos/task.h"
+
+static int64_t s_time;
+static uint64_t s_alarm[2] = { UINT64_MAX, UINT64_MAX };
+static intr_handler_t s_alarm_handler;
+static int s_task;
+
+esp_err_t esp_timer_impl_early_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_impl_init(intr_handler_t alarm_handler)
+{
+    s_alarm_handler = alarm_handler;
+    return ESP_OK;
+}
+
+void esp_timer_impl_deinit(void)
+{
+    s_alarm_handler = NULL;
+}
+
+void esp_timer_impl_set_alarm_id(uint64_t timestamp, unsigned alarm_id)
+{
+    s_alarm[alarm_id] = timestamp;
+}
+
+void esp_timer_impl_set_alarm(uint64_t timestamp)
+{
+    esp_timer_impl_set_alarm_id(timestamp, 0);
+}
+
+void esp_timer_impl_advance(int64_t time_us)
+{
+    s_time += time_us;
+}
+
+int64_t esp_timer_impl_get_time(void)
+{
+    return s_time;
+}
+
+int64_t esp_timer_get_time(void) __attribute__((alias("esp_timer_impl_get_time")));
+
+uint64_t esp_timer_impl_get_min_period_us(void)
+{
+    return 50;
+}
+
+uint64_t esp_timer_impl_get_alarm_reg(void)
+{
+    return s_alarm[0] < s_alarm[1] ? s_alarm[0] : s_alarm[1];
+}
+
+uint64_t esp_timer_host_get_alarm(unsigned alarm_id)
+{
+    return s_alarm[alarm_id];
+}
+
+void esp_timer_host_fire(void)
+{
+    s_alarm_handler(NULL);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stack_depth, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core_id)
+{
+    *handle = &s_task;
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait)
+{
+    return 0;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_priority_task_woken)
+{
+}
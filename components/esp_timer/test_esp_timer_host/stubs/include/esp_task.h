@@ -0,0 +1,4 @@
+#pragma once
+
+#define ESP_TASK_TIMER_STACK 4096
+#define ESP_TASK_TIMER_PRIO  22
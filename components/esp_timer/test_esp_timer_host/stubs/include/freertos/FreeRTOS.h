@@ -0,0 +1,25 @@
+/* Single threaded stand-ins for the parts of FreeRTOS used by esp_timer.c */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+typedef int portMUX_TYPE;
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  1
+#define portMAX_DELAY 0xffffffff
+#define PRO_CPU_NUM 0
+
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL_SAFE(mux) ((void)(mux))
+#define portEXIT_CRITICAL_SAFE(mux) ((void)(mux))
+#define portYIELD_FROM_ISR()
+#define xPortInIsrContext() true
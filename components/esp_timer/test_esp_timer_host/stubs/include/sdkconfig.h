@@ -0,0 +1,2 @@
+/* Options of the host build are passed on the command line, see Makefile */
+#pragma once
@@ -0,0 +1,20 @@
+#!/usr/bin/env bash
+#
+# Run the test suite with both data structures for armed timers
+#
+
+FAIL=0
+
+for FLAGS in "CONFIG_ESP_TIMER_LIST_SORTED" "CONFIG_ESP_TIMER_LIST_PAIRING_HEAP" ; do
+    echo "==== Testing with config: ${FLAGS} ===="
+    CPPFLAGS="-D${FLAGS}" make clean test || FAIL=1
+done
+
+make clean
+
+if [ $FAIL == 0 ]; then
+    echo "All configurations passed"
+else
+    echo "Some configurations failed, see log."
+    exit 1
+fi
@@ -0,0 +1,271 @@
+#include "catch.hpp"
+#include "esp_timer.h"
+extern "C" {
+#include "esp_timer_impl.h"
+}
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+extern "C" void esp_timer_host_fire(void);
+extern "C" uint64_t esp_timer_host_get_alarm(unsigned alarm_id);
+
+namespace {
+
+struct fired_t {
+    std::vector<int> order;
+};
+
+struct timer_arg_t {
+    int id;
+    fired_t *fired;
+};
+
+void record_cb(void *arg)
+{
+    timer_arg_t *t = static_cast<timer_arg_t *>(arg);
+    t->fired->order.push_back(t->id);
+}
+
+void noop_cb(void *arg)
+{
+}
+
+void count_cb(void *arg)
+{
+    (*static_cast<int *>(arg))++;
+}
+
+esp_timer_handle_t create_timer(esp_timer_cb_t cb, void *arg, uint32_t slack_us = 0)
+{
+    esp_timer_init();  // only does something the first time
+    esp_timer_create_args_t args = {};
+    args.callback = cb;
+    args.arg = arg;
+    args.dispatch_method = ESP_TIMER_ISR;
+    args.slack_us = slack_us;
+    esp_timer_handle_t timer;
+    REQUIRE(esp_timer_create(&args, &timer) == ESP_OK);
+    return timer;
+}
+
+/* Move the time to the next alarm and process the timers due, returns false if no timer is armed.
+
+   Deleted timers are freed by the timer task, which does not run here, so only the alarm of the timers with the
+   ESP_TIMER_ISR dispatch method is used.
+*/
+bool fire_next(void)
+{
+    uint64_t next = esp_timer_host_get_alarm(ESP_TIMER_ISR);
+    if (next == UINT64_MAX) {
+        return false;
+    }
+    uint64_t now = esp_timer_get_time();
+    if (next > now) {
+        esp_timer_impl_advance(next - now);
+    }
+    esp_timer_host_fire();
+    return true;
+}
+
+} // namespace
+
+TEST_CASE("timers fire in order of alarm, then of start", "[esp_timer]")
+{
+    const int N = 500;
+    fired_t fired;
+    std::vector<timer_arg_t> args(N);
+    std::vector<esp_timer_handle_t> timers(N);
+    std::vector<int64_t> alarms(N);
+
+    srand(1);
+    for (int i = 0; i < N; i++) {
+        args[i] = { i, &fired };
+        timers[i] = create_timer(record_cb, &args[i]);
+    }
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < N; i++) {
+        // few different values, so that many timers share the same alarm
+        uint64_t timeout = 100 * (1 + rand() % 20);
+        alarms[i] = start + timeout;
+        REQUIRE(esp_timer_start_once(timers[i], timeout) == ESP_OK);
+    }
+    // stop every third timer
+    for (int i = 0; i < N; i += 3) {
+        REQUIRE(esp_timer_stop(timers[i]) == ESP_OK);
+    }
+    while (fire_next()) {
+    }
+
+    std::vector<int> expected;
+    for (int i = 0; i < N; i++) {
+        if (i % 3 != 0) {
+            expected.push_back(i);
+        }
+    }
+    std::stable_sort(expected.begin(), expected.end(), [&](int a, int b) {
+        return alarms[a] < alarms[b];
+    });
+    CHECK(fired.order == expected);
+
+    for (int i = 0; i < N; i++) {
+        REQUIRE(esp_timer_delete(timers[i]) == ESP_OK);
+    }
+}
+
+TEST_CASE("periodic timers keep firing while others are started and stopped", "[esp_timer]")
+{
+    fired_t fired;
+    timer_arg_t periodic_arg[3] = { { 0, &fired }, { 1, &fired }, { 2, &fired } };
+    esp_timer_handle_t periodic[3];
+    for (int i = 0; i < 3; i++) {
+        periodic[i] = create_timer(record_cb, &periodic_arg[i]);
+        REQUIRE(esp_timer_start_periodic(periodic[i], 1000 * (i + 1)) == ESP_OK);
+    }
+    std::vector<esp_timer_handle_t> others;
+    for (int i = 0; i < 50; i++) {
+        others.push_back(create_timer(noop_cb, NULL));
+        REQUIRE(esp_timer_start_once(others.back(), 500 + 7919 * i % 10000) == ESP_OK);
+    }
+    int64_t end = esp_timer_get_time() + 12000;
+    for (int i = 0; i < 50; i += 2) {
+        esp_timer_stop(others[i]);  // may have fired already
+    }
+    while (esp_timer_host_get_alarm(ESP_TIMER_ISR) <= (uint64_t)end) {
+        fire_next();
+    }
+
+    int count[3] = { 0 };
+    for (int id : fired.order) {
+        count[id]++;
+    }
+    CHECK(count[0] == 12);
+    CHECK(count[1] == 6);
+    CHECK(count[2] == 4);
+
+    for (int i = 0; i < 3; i++) {
+        REQUIRE(esp_timer_stop(periodic[i]) == ESP_OK);
+        REQUIRE(esp_timer_delete(periodic[i]) == ESP_OK);
+    }
+    for (esp_timer_handle_t t : others) {
+        esp_timer_stop(t);
+        REQUIRE(esp_timer_delete(t) == ESP_OK);
+    }
+}
+
+TEST_CASE("timers with slack are called on the wakeup of other timers", "[esp_timer]")
+{
+    fired_t fired;
+    timer_arg_t arg[3] = { { 0, &fired }, { 1, &fired }, { 2, &fired } };
+    esp_timer_handle_t timers[3];
+    timers[0] = create_timer(record_cb, &arg[0], 500);
+    timers[1] = create_timer(record_cb, &arg[1]);
+    timers[2] = create_timer(record_cb, &arg[2], 100);
+    int64_t start = esp_timer_get_time();
+
+    // the deadline of timer 0 is after the alarm of timer 1, so a single wakeup calls both
+    REQUIRE(esp_timer_start_once(timers[0], 1000) == ESP_OK);
+    CHECK(esp_timer_host_get_alarm(ESP_TIMER_ISR) == start + 1500);
+    REQUIRE(esp_timer_start_once(timers[1], 1300) == ESP_OK);
+    CHECK(esp_timer_host_get_alarm(ESP_TIMER_ISR) == start + 1300);
+    // ends after the next wakeup, so it gets one of its own
+    REQUIRE(esp_timer_start_once(timers[2], 1400) == ESP_OK);
+    CHECK(esp_timer_host_get_alarm(ESP_TIMER_ISR) == start + 1300);
+
+    int wakeups = 0;
+    while (fire_next()) {
+        wakeups++;
+    }
+    CHECK(wakeups == 2);
+    CHECK(fired.order == std::vector<int>({ 0, 1, 2 }));
+    CHECK(esp_timer_get_time() == start + 1500);
+
+    // stopping the timer which set the alarm moves it to the deadline of the others
+    fired.order.clear();
+    start = esp_timer_get_time();
+    REQUIRE(esp_timer_start_once(timers[0], 1000) == ESP_OK);
+    REQUIRE(esp_timer_start_once(timers[1], 1300) == ESP_OK);
+    REQUIRE(esp_timer_stop(timers[1]) == ESP_OK);
+    CHECK(esp_timer_host_get_alarm(ESP_TIMER_ISR) == start + 1500);
+    REQUIRE(fire_next());
+    CHECK(fired.order == std::vector<int>({ 0 }));
+    CHECK(esp_timer_host_get_alarm(ESP_TIMER_ISR) == UINT64_MAX);
+
+    for (int i = 0; i < 3; i++) {
+        REQUIRE(esp_timer_delete(timers[i]) == ESP_OK);
+    }
+}
+
+TEST_CASE("slack reduces the number of wakeups of periodic timers", "[esp_timer]")
+{
+    const int N = 20;
+    const uint32_t slacks[] = { 0, 100, 1000 };
+    printf("%8s  %8s  %8s\n", "slack", "calls", "wakeups");
+    int prev_wakeups = 0;
+    for (uint32_t slack : slacks) {
+        std::vector<esp_timer_handle_t> timers(N);
+        int calls = 0;
+        for (int i = 0; i < N; i++) {
+            timers[i] = create_timer(count_cb, &calls, slack);
+            REQUIRE(esp_timer_start_periodic(timers[i], 1000 + 37 * i) == ESP_OK);
+        }
+        int64_t end = esp_timer_get_time() + 100000;
+        int wakeups = 0;
+        while (esp_timer_host_get_alarm(ESP_TIMER_ISR) <= (uint64_t)end) {
+            fire_next();
+            wakeups++;
+        }
+        for (int i = 0; i < N; i++) {
+            REQUIRE(esp_timer_stop(timers[i]) == ESP_OK);
+            REQUIRE(esp_timer_delete(timers[i]) == ESP_OK);
+        }
+        printf("%8u  %8d  %8d\n", slack, calls, wakeups);
+        // each timer is called about 100000 / period times in any case
+        CHECK(calls > N * 100000 / 2000);
+        if (slack > 0) {
+            CHECK(wakeups < prev_wakeups);
+        }
+        prev_wakeups = wakeups;
+    }
+}
+
+TEST_CASE("esp_timer start, stop and fire performance", "[esp_timer]")
+{
+    using clock = std::chrono::steady_clock;
+    const int counts[] = { 10, 100, 300, 1000, 3000 };
+
+    printf("%8s  %12s  %12s  %12s\n", "timers", "start (ns)", "stop (ns)", "fire (ns)");
+    for (int n : counts) {
+        std::vector<esp_timer_handle_t> timers(n);
+        for (int i = 0; i < n; i++) {
+            timers[i] = create_timer(noop_cb, NULL);
+        }
+        srand(n);
+        const int ROUNDS = 20;
+        double start_ns = 0, stop_ns = 0, fire_ns = 0;
+        for (int round = 0; round < ROUNDS; round++) {
+            auto t0 = clock::now();
+            for (int i = 0; i < n; i++) {
+                esp_timer_start_once(timers[i], 1000 + rand() % 1000000);
+            }
+            auto t1 = clock::now();
+            for (int i = 0; i < n; i += 2) {
+                esp_timer_stop(timers[i]);
+            }
+            auto t2 = clock::now();
+            while (fire_next()) {
+            }
+            auto t3 = clock::now();
+            start_ns += std::chrono::duration<double, std::nano>(t1 - t0).count() / n;
+            stop_ns += std::chrono::duration<double, std::nano>(t2 - t1).count() / ((n + 1) / 2);
+            fire_ns += std::chrono::duration<double, std::nano>(t3 - t2).count() / (n / 2);
+        }
+        printf("%8d  %12.0f  %12.0f  %12.0f\n", n, start_ns / ROUNDS, stop_ns / ROUNDS, fire_ns / ROUNDS);
+        for (int i = 0; i < n; i++) {
+            REQUIRE(esp_timer_delete(timers[i]) == ESP_OK);
+        }
+    }
+}
@@ -20,6 +20,7 @@
 #include <sys/time.h>
 #include <sys/unistd.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <errno.h>
 #include <utime.h>
 #include "unity.h"
@@ -183,6 +184,45 @@ void test_fatfs_pwrite_file(const char *filename)
     test_file_content(filename, "Hello, Dolly!");
 }
 
+void test_fatfs_iov_file(const char *filename)
+{
+    int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC);
+    TEST_ASSERT_NOT_EQUAL(-1, fd);
+
+    char hello[] = "Hello", empty[] = "", world[] = ", world!";
+    const struct iovec wr_iov[] = {
+        { .iov_base = hello, .iov_len = strlen(hello) },
+        { .iov_base = empty, .iov_len = 0 },
+        { .iov_base = world, .iov_len = strlen(world) },
+    };
+    TEST_ASSERT_EQUAL(strlen("Hello, world!"), writev(fd, wr_iov, 3));
+    TEST_ASSERT_EQUAL(strlen("Hello, world!"), lseek(fd, 0, SEEK_CUR));
+
+    char dolly[] = "Dolly";
+    const struct iovec pwr_iov[] = { { .iov_base = dolly, .iov_len = strlen(dolly) } };
+    TEST_ASSERT_EQUAL(strlen(dolly), pwritev(fd, pwr_iov, 1, strlen("Hello, ")));
+    TEST_ASSERT_EQUAL(strlen("Hello, world!"), lseek(fd, 0, SEEK_CUR)); // pwritev should not move the pointer
+
+    char head[8] = { 0 }, tail[16] = { 0 };
+    struct iovec rd_iov[] = {
+        { .iov_base = head, .iov_len = 7 },
+        { .iov_base = tail, .iov_len = sizeof(tail) - 1 },
+    };
+    TEST_ASSERT_EQUAL(strlen("Hello, Dolly!"), preadv(fd, rd_iov, 2, 0));
+    TEST_ASSERT_EQUAL_STRING("Hello, ", head);
+    TEST_ASSERT_EQUAL_STRING("Dolly!", tail);
+    TEST_ASSERT_EQUAL(strlen("Hello, world!"), lseek(fd, 0, SEEK_CUR)); // preadv should not move the pointer
+
+    memset(head, 0, sizeof(head));
+    memset(tail, 0, sizeof(tail));
+    TEST_ASSERT_EQUAL(0, lseek(fd, 0, SEEK_SET));
+    TEST_ASSERT_EQUAL(strlen("Hello, Dolly!"), readv(fd, rd_iov, 2));
+    TEST_ASSERT_EQUAL_STRING("Hello, ", head);
+    TEST_ASSERT_EQUAL_STRING("Dolly!", tail);
+
+    TEST_ASSERT_EQUAL(0, close(fd));
+}
+
 void test_fatfs_open_max_files(const char* filename_prefix, size_t files_count)
 {
     FILE** files = calloc(files_count, sizeof(FILE*));
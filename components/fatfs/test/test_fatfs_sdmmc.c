@@ -122,6 +122,13 @@ TEST_CASE("(SD) pwrite() works well", "[fatfs][test_env=UT_T1_SDMODE][timeout=60
     test_teardown();
 }
 
+TEST_CASE("(SD) readv(), writev(), preadv() and pwritev() work well", "[fatfs][test_env=UT_T1_SDMODE][timeout=60]")
+{
+    test_setup();
+    test_fatfs_iov_file(test_filename);
+    test_teardown();
+}
+
 TEST_CASE("(SD) overwrite and append file", "[fatfs][sd][test_env=UT_T1_SDMODE][timeout=60]")
 {
     test_setup();
@@ -85,6 +85,13 @@ TEST_CASE("(WL) pwrite() works well", "[fatfs][wear_levelling]")
     test_teardown();
 }
 
+TEST_CASE("(WL) readv(), writev(), preadv() and pwritev() work well", "[fatfs][wear_levelling]")
+{
+    test_setup();
+    test_fatfs_iov_file("/spiflash/hello.txt");
+    test_teardown();
+}
+
 TEST_CASE("(WL) can open maximum number of files", "[fatfs][wear_levelling]")
 {
     size_t max_files = FOPEN_MAX - 3; /* account for stdin, stdout, stderr */
@@ -62,6 +62,10 @@ static off_t vfs_fat_lseek(void* p, int fd, off_t size, int mode);
 static ssize_t vfs_fat_read(void* ctx, int fd, void * dst, size_t size);
 static ssize_t vfs_fat_pread(void *ctx, int fd, void *dst, size_t size, off_t offset);
 static ssize_t vfs_fat_pwrite(void *ctx, int fd, const void *src, size_t size, off_t offset);
+static ssize_t vfs_fat_writev(void *ctx, int fd, const struct iovec *iov, int iovcnt);
+static ssize_t vfs_fat_readv(void *ctx, int fd, const struct iovec *iov, int iovcnt);
+static ssize_t vfs_fat_pwritev(void *ctx, int fd, const struct iovec *iov, int iovcnt, off_t offset);
+static ssize_t vfs_fat_preadv(void *ctx, int fd, const struct iovec *iov, int iovcnt, off_t offset);
 static int vfs_fat_open(void* ctx, const char * path, int flags, int mode);
 static int vfs_fat_close(void* ctx, int fd);
 static int vfs_fat_fstat(void* ctx, int fd, struct stat * st);
@@ -131,6 +135,10 @@ esp_err_t esp_vfs_fat_register(const char* base_path, const char* fat_drive, siz
         .close_p = &vfs_fat_close,
         .fstat_p = &vfs_fat_fstat,
         .fsync_p = &vfs_fat_fsync,
+        .writev_p = &vfs_fat_writev,
+        .readv_p = &vfs_fat_readv,
+        .pwritev_p = &vfs_fat_pwritev,
+        .preadv_p = &vfs_fat_preadv,
 #ifdef CONFIG_VFS_SUPPORT_DIR
         .stat_p = &vfs_fat_stat,
         .link_p = &vfs_fat_link,
@@ -473,6 +481,123 @@ pwrite_release:
     return ret;
 }
 
+/* Writes the buffers at the current position of the file, stopping at the first short write.
+ * Returns the number of bytes written, or -1 if an error occurred before anything was written.
+ */
+static ssize_t fat_write_iov(FIL *file, const struct iovec *iov, int iovcnt)
+{
+    ssize_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        unsigned written = 0;
+        FRESULT res = f_write(file, iov[i].iov_base, iov[i].iov_len, &written);
+        total += written;
+        if (res != FR_OK) {
+            ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
+            errno = fresult_to_errno(res);
+            return (total > 0) ? total : -1;
+        }
+        if (written < iov[i].iov_len) {
+            break;
+        }
+    }
+    return total;
+}
+
+/* Reads into the buffers from the current position of the file, stopping at the first short read. */
+static ssize_t fat_read_iov(FIL *file, const struct iovec *iov, int iovcnt)
+{
+    ssize_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        unsigned read = 0;
+        FRESULT res = f_read(file, iov[i].iov_base, iov[i].iov_len, &read);
+        total += read;
+        if (res != FR_OK) {
+            ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
+            errno = fresult_to_errno(res);
+            return (total > 0) ? total : -1;
+        }
+        if (read < iov[i].iov_len) {
+            break;
+        }
+    }
+    return total;
+}
+
+/* The vectored functions hold the lock for all the buffers,
+ * so that pread/pwrite can't move the file position in between.
+ */
+static ssize_t vfs_fat_writev(void *ctx, int fd, const struct iovec *iov, int iovcnt)
+{
+    vfs_fat_ctx_t *fat_ctx = (vfs_fat_ctx_t *) ctx;
+    _lock_acquire(&fat_ctx->lock);
+    FIL *file = &fat_ctx->files[fd];
+    ssize_t ret = -1;
+    if (fat_ctx->o_append[fd]) {
+        FRESULT res = f_lseek(file, f_size(file));
+        if (res != FR_OK) {
+            ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
+            errno = fresult_to_errno(res);
+            goto writev_release;
+        }
+    }
+    ret = fat_write_iov(file, iov, iovcnt);
+
+writev_release:
+    _lock_release(&fat_ctx->lock);
+    return ret;
+}
+
+static ssize_t vfs_fat_readv(void *ctx, int fd, const struct iovec *iov, int iovcnt)
+{
+    vfs_fat_ctx_t *fat_ctx = (vfs_fat_ctx_t *) ctx;
+    _lock_acquire(&fat_ctx->lock);
+    ssize_t ret = fat_read_iov(&fat_ctx->files[fd], iov, iovcnt);
+    _lock_release(&fat_ctx->lock);
+    return ret;
+}
+
+/* Transfers the buffers at 'offset' using 'func', leaving the file position unchanged like pread/pwrite do */
+static ssize_t fat_iov_at(vfs_fat_ctx_t *fat_ctx, int fd, ssize_t (*func)(FIL *, const struct iovec *, int),
+                          const struct iovec *iov, int iovcnt, off_t offset)
+{
+    ssize_t ret = -1;
+    _lock_acquire(&fat_ctx->lock);
+    FIL *file = &fat_ctx->files[fd];
+    const off_t prev_pos = f_tell(file);
+
+    FRESULT f_res = f_lseek(file, offset);
+    if (f_res != FR_OK) {
+        ESP_LOGD(TAG, "%s: fresult=%d", __func__, f_res);
+        errno = fresult_to_errno(f_res);
+        goto iov_at_release;
+    }
+
+    ret = (*func)(file, iov, iovcnt);
+
+    f_res = f_lseek(file, prev_pos);
+    if (f_res != FR_OK) {
+        ESP_LOGD(TAG, "%s: fresult=%d", __func__, f_res);
+        if (ret >= 0) {
+            errno = fresult_to_errno(f_res);
+        } // else the transfer failed so errno shouldn't be overwritten
+        ret = -1; // in case the transfer was successful but the seek wasn't
+    }
+
+iov_at_release:
+    _lock_release(&fat_ctx->lock);
+    return ret;
+}
+
+static ssize_t vfs_fat_pwritev(void *ctx, int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    return fat_iov_at((vfs_fat_ctx_t *) ctx, fd, &fat_write_iov, iov, iovcnt, offset);
+}
+
+static ssize_t vfs_fat_preadv(void *ctx, int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    return fat_iov_at((vfs_fat_ctx_t *) ctx, fd, &fat_read_iov, iov, iovcnt, offset);
+}
+
 static int vfs_fat_fsync(void* ctx, int fd)
 {
     vfs_fat_ctx_t* fat_ctx = (vfs_fat_ctx_t*) ctx;
@@ -14,6 +14,9 @@
 #include "esp_log.h"
 #include "heap_private.h"
 #include "esp_system.h"
+#ifdef CONFIG_HEAP_SIZE_CLASS_CACHE
+#include "heap_caps_cache.h"
+#endif
 
 
 // forward declaration
@@ -113,6 +116,19 @@ IRAM_ATTR static void *heap_caps_malloc_base( size_t size, uint32_t caps)
         size = (size + 3) & (~3); // int overflow checked above
     }
 
+#ifdef CONFIG_HEAP_SIZE_CLASS_CACHE
+    if (!(caps & MALLOC_CAP_EXEC)) {
+        //A small block freed on this core, from any heap with the requested caps, saves searching and locking the heaps.
+        //On a miss, the size is rounded up so the block allocated below serves the same sizes once it's cached.
+        ret = heap_caps_cache_pop(&size, caps);
+        if (ret != NULL) {
+            return ret;
+        }
+    }
+    bool cache_flushed = false;
+retry:
+#endif
+
     for (int prio = 0; prio < SOC_MEMORY_TYPE_NO_PRIOS; prio++) {
         //Iterate over heaps and check capabilities at this priority
         heap_t *heap;
@@ -146,6 +162,15 @@ IRAM_ATTR static void *heap_caps_malloc_base( size_t size, uint32_t caps)
         }
     }
 
+#ifdef CONFIG_HEAP_SIZE_CLASS_CACHE
+    if (!cache_flushed) {
+        //Give the blocks cached by this core back to the heaps, they may be what's missing
+        heap_caps_cache_flush();
+        cache_flushed = true;
+        goto retry;
+    }
+#endif
+
     //Nothing usable found.
     return NULL;
 }
@@ -329,6 +354,12 @@ IRAM_ATTR void heap_caps_free( void *ptr)
 
     heap_t *heap = find_containing_heap(ptr);
     assert(heap != NULL && "free() target pointer is outside heap areas");
+#ifdef CONFIG_HEAP_SIZE_CLASS_CACHE
+    uint32_t heap_caps = get_all_caps(heap);
+    if ((heap_caps & MALLOC_CAP_INTERNAL) && heap_caps_cache_push(heap->heap, heap_caps, ptr)) {
+        return;
+    }
+#endif
     multi_heap_free(heap->heap, ptr);
 }
 
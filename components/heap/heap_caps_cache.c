@@ -0,0 +1,136 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "multi_heap.h"
+#include "multi_heap_platform.h"
+#include "heap_caps_cache.h"
+
+/* An allocation is served from the smallest size class which is not smaller than the requested size, and a block is
+   cached in the largest size class which is not bigger than the block. Allocations which miss the cache are rounded
+   up to their size class, so their blocks are cached in the class they were allocated for. The smallest class is the
+   smallest block of the allocator. */
+static const uint16_t s_class_size[] = { 12, 16, 24, 32, 48, 64, 96, 128, 192, HEAP_CAPS_CACHE_MAX_SIZE };
+
+#define NUM_CLASSES ((int)(sizeof(s_class_size) / sizeof(s_class_size[0])))
+
+typedef struct {
+    void *ptr;
+    multi_heap_handle_t heap;
+    uint32_t caps; ///< All capabilities of the heap
+} cache_entry_t;
+
+typedef struct {
+    volatile bool flush_requested;
+    uint8_t count[NUM_CLASSES];
+    cache_entry_t entries[NUM_CLASSES][CONFIG_HEAP_SIZE_CLASS_CACHE_DEPTH];
+} core_cache_t;
+
+static core_cache_t s_cache[MULTI_HEAP_NUM_CORES];
+
+/* Smallest size class which is not smaller than a size in words, rounded up, so finding it takes no branches */
+static const uint8_t s_class_by_words[HEAP_CAPS_CACHE_MAX_SIZE / 4 + 1] = {
+    0, 0, 0, 0, 1, 2, 2, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 6, 7, 7, 7, 7, 7, 7, 7, 7,
+    8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9,
+};
+
+/* Return every block cached by the calling core to its heap. The blocks are taken from the lists one at a time, so
+   interrupts are not masked while the heaps are locked. If the task moves to another core meanwhile, that core is
+   emptied too, and the first one still has its flush request set. */
+static void flush_core(void)
+{
+    while (true) {
+        cache_entry_t entry = { 0 };
+        multi_heap_core_state_t state = MULTI_HEAP_CORE_ENTER();
+        core_cache_t *cache = &s_cache[MULTI_HEAP_CORE_ID()];
+        for (int cls = 0; cls < NUM_CLASSES; cls++) {
+            if (cache->count[cls] > 0) {
+                entry = cache->entries[cls][--cache->count[cls]];
+                break;
+            }
+        }
+        if (entry.ptr == NULL) {
+            cache->flush_requested = false;
+        }
+        MULTI_HEAP_CORE_EXIT(state);
+
+        if (entry.ptr == NULL) {
+            return;
+        }
+        multi_heap_free(entry.heap, entry.ptr);
+    }
+}
+
+void *heap_caps_cache_pop(size_t *size, uint32_t caps)
+{
+    if (*size == 0 || *size > HEAP_CAPS_CACHE_MAX_SIZE) {
+        return NULL;
+    }
+    if (s_cache[MULTI_HEAP_CORE_ID()].flush_requested) {
+        flush_core();
+        return NULL;
+    }
+
+    int cls = s_class_by_words[(*size + 3) / 4];
+    void *result = NULL;
+    multi_heap_core_state_t state = MULTI_HEAP_CORE_ENTER();
+    core_cache_t *cache = &s_cache[MULTI_HEAP_CORE_ID()];
+    cache_entry_t *entries = cache->entries[cls];
+    for (int i = cache->count[cls] - 1; i >= 0; i--) {
+        if ((entries[i].caps & caps) == caps) {
+            result = entries[i].ptr;
+            entries[i] = entries[--cache->count[cls]];
+            break;
+        }
+    }
+    MULTI_HEAP_CORE_EXIT(state);
+
+    if (result == NULL) {
+        *size = s_class_size[cls];
+    }
+    return result;
+}
+
+bool heap_caps_cache_push(multi_heap_handle_t heap, uint32_t heap_caps, void *p)
+{
+    size_t size = multi_heap_get_allocated_size(heap, p);
+    if (size < s_class_size[0] || size > HEAP_CAPS_CACHE_MAX_SIZE) {
+        return false;
+    }
+    if (s_cache[MULTI_HEAP_CORE_ID()].flush_requested) {
+        flush_core();
+        return false;
+    }
+
+    /* The class found for the size rounded down to words is one too big unless the size is a class size */
+    int cls = s_class_by_words[size / 4];
+    if (s_class_size[cls] > size) {
+        cls--;
+    }
+
+    bool cached = false;
+    multi_heap_core_state_t state = MULTI_HEAP_CORE_ENTER();
+    core_cache_t *cache = &s_cache[MULTI_HEAP_CORE_ID()];
+    if (!cache->flush_requested && cache->count[cls] < CONFIG_HEAP_SIZE_CLASS_CACHE_DEPTH) {
+        cache->entries[cls][cache->count[cls]++] = (cache_entry_t) {
+            .ptr = p,
+            .heap = heap,
+            .caps = heap_caps,
+        };
+        cached = true;
+    }
+    MULTI_HEAP_CORE_EXIT(state);
+    return cached;
+}
+
+void heap_caps_cache_flush(void)
+{
+    for (int core = 0; core < MULTI_HEAP_NUM_CORES; core++) {
+        s_cache[core].flush_requested = true;
+    }
+    flush_core();
+}
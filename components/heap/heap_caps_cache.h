@@ -0,0 +1,54 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "multi_heap.h"
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Per core cache of freed small blocks, used by heap_caps.c when CONFIG_HEAP_SIZE_CLASS_CACHE is enabled.
+
+   Each core keeps its own lists of cached blocks by size class, so it only masks its own interrupts to access them.
+   Every cached block is still allocated in its heap, and is kept with the handle and the capabilities of the heap.
+*/
+
+#ifndef CONFIG_HEAP_SIZE_CLASS_CACHE_DEPTH
+#define CONFIG_HEAP_SIZE_CLASS_CACHE_DEPTH 8
+#endif
+
+/* Largest block size which is cached */
+#define HEAP_CAPS_CACHE_MAX_SIZE 256
+
+/* Take a cached block of at least *size bytes from a heap with all the capabilities in caps.
+
+   Returns NULL if the calling core has no such block cached. Then *size is rounded up to its size class if it is
+   small enough to be cached, so the block allocated from the heaps instead can serve the same sizes once it is cached.
+*/
+void *heap_caps_cache_pop(size_t *size, uint32_t caps);
+
+/* Cache the allocated block p of heap, which has the capabilities heap_caps, instead of freeing it.
+
+   Returns false if the block is not cached, then the caller frees it.
+*/
+bool heap_caps_cache_push(multi_heap_handle_t heap, uint32_t heap_caps, void *p);
+
+/* Return the blocks cached by the calling core to their heaps, and have every other core return its blocks with
+   its next call to heap_caps_cache_pop() or heap_caps_cache_push().
+*/
+void heap_caps_cache_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -12,6 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #include <string.h>
+#include <stdint.h>
+#include <sys/param.h>
 #include <sdkconfig.h>
 
 #define HEAP_TRACE_SRCFILE /* don't warn on inclusion here */
@@ -19,6 +21,7 @@
 #undef HEAP_TRACE_SRCFILE
 
 #include "esp_attr.h"
+#include "esp_heap_caps.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
@@ -31,11 +34,58 @@ static portMUX_TYPE trace_mux = portMUX_INITIALIZER_UNLOCKED;
 static bool tracing;
 static heap_trace_mode_t mode;
 
-/* Buffer used for records, starting at offset 0
+/* Buffer used for records, starting at offset 0.
+
+   In HEAP_TRACE_CALLSITES mode, the first half of the same memory holds an open addressing hash table of call sites,
+   and the second half an entry for each allocation which has not been freed yet.
 */
 static heap_trace_record_t *buffer;
 static size_t total_records;
 
+static heap_trace_callsite_t *callsites;
+static size_t total_callsites;
+
+/* An allocation counted in a call site, so that freeing it can be taken off the call site */
+typedef struct {
+    void *address;
+    size_t size;
+    size_t site; /* index in callsites */
+} callsite_alloc_t;
+
+static callsite_alloc_t *callsite_allocs;
+static size_t total_callsite_allocs;
+
+/* Links of the entries of the buffer: the records, or the call site allocations in HEAP_TRACE_CALLSITES mode.
+
+   They are kept apart from the buffer, so that the records keep the layout of heap_trace_record_t.
+*/
+typedef struct {
+    size_t prev;      /* previous used entry, in order of allocation */
+    size_t next;      /* next used entry in order of allocation, or next unused entry */
+    size_t hash_next; /* next entry in the same hash map bucket, or NOT_HASHED */
+} entry_links_t;
+
+#define NO_ENTRY SIZE_MAX
+#define NOT_HASHED (SIZE_MAX - 1)
+
+/* Allocated from internal memory by heap_trace_init_standalone(), one per entry of the buffer */
+static entry_links_t *links;
+
+/* Number of entries of the buffer in the current mode */
+static size_t total_entries;
+
+/* Used entries, oldest allocation first, and unused entries which can be used for new allocations */
+static size_t used_first;
+static size_t used_last;
+static size_t unused_first;
+
+/* Used entries which can still be freed, by address of the allocation, newest first */
+#define HASH_MAP_SIZE CONFIG_HEAP_TRACE_HASH_MAP_SIZE
+static size_t hash_map[HASH_MAP_SIZE];
+
+/* Are the used records buffer[0..count), in order of allocation? */
+static bool records_in_order;
+
 /* Count of entries logged in the buffer.
 
    Maximum total_records
@@ -51,14 +101,36 @@ static size_t total_frees;
 /* Has the buffer overflowed and lost trace entries? */
 static bool has_overflowed = false;
 
+static void reset_entries(void);
+
 esp_err_t heap_trace_init_standalone(heap_trace_record_t *record_buffer, size_t num_records)
 {
     if (tracing) {
         return ESP_ERR_INVALID_STATE;
     }
+    heap_caps_free(links);
+    links = NULL;
+    buffer = NULL;
+    total_records = 0;
+    total_entries = 0;
+    if (record_buffer == NULL || num_records == 0) {
+        return ESP_OK;
+    }
+
+    size_t buffer_size = num_records * sizeof(heap_trace_record_t);
+    callsites = (heap_trace_callsite_t *)record_buffer;
+    total_callsites = buffer_size / 2 / sizeof(heap_trace_callsite_t);
+    callsite_allocs = (callsite_alloc_t *)&callsites[total_callsites];
+    total_callsite_allocs = (buffer_size - total_callsites * sizeof(heap_trace_callsite_t)) / sizeof(callsite_alloc_t);
+
+    size_t total_links = MAX(num_records, total_callsite_allocs);
+    links = heap_caps_malloc(total_links * sizeof(entry_links_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (links == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
     buffer = record_buffer;
     total_records = num_records;
-    memset(buffer, 0, num_records * sizeof(heap_trace_record_t));
+    memset(buffer, 0, buffer_size);
     return ESP_OK;
 }
 
@@ -76,6 +148,13 @@ esp_err_t heap_trace_start(heap_trace_mode_t mode_param)
     total_allocations = 0;
     total_frees = 0;
     has_overflowed = false;
+    if (mode == HEAP_TRACE_CALLSITES) {
+        memset(callsites, 0, total_callsites * sizeof(heap_trace_callsite_t));
+        total_entries = total_callsite_allocs;
+    } else {
+        total_entries = total_records;
+    }
+    reset_entries();
     heap_trace_resume();
 
     portEXIT_CRITICAL(&trace_mux);
@@ -106,9 +185,11 @@ size_t heap_trace_get_count(void)
     return count;
 }
 
+static void compact_records(void);
+
 esp_err_t heap_trace_get(size_t index, heap_trace_record_t *record)
 {
-    if (record == NULL) {
+    if (record == NULL || mode == HEAP_TRACE_CALLSITES) {
         return ESP_ERR_INVALID_STATE;
     }
     esp_err_t result = ESP_OK;
@@ -117,23 +198,80 @@ esp_err_t heap_trace_get(size_t index, heap_trace_record_t *record)
     if (index >= count) {
         result = ESP_ERR_INVALID_ARG; /* out of range for 'count' */
     } else {
+        if (!records_in_order) {
+            compact_records();
+        }
         memcpy(record, &buffer[index], sizeof(heap_trace_record_t));
     }
     portEXIT_CRITICAL(&trace_mux);
     return result;
 }
 
+esp_err_t heap_trace_get_callsite(size_t index, heap_trace_callsite_t *callsite)
+{
+    if (callsite == NULL || buffer == NULL || mode != HEAP_TRACE_CALLSITES) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t result = ESP_ERR_INVALID_ARG; /* out of range for 'count' */
+
+    portENTER_CRITICAL(&trace_mux);
+    for (int i = 0; i < total_callsites; i++) {
+        if (callsites[i].total_allocations == 0) {
+            continue;
+        }
+        if (index == 0) {
+            memcpy(callsite, &callsites[i], sizeof(heap_trace_callsite_t));
+            result = ESP_OK;
+            break;
+        }
+        index--;
+    }
+    portEXIT_CRITICAL(&trace_mux);
+    return result;
+}
+
+static void dump_callsites(void)
+{
+    size_t total_bytes = 0;
+    printf("%u call sites trace (%u entry buffer)\n", count, total_callsites);
+    for (int i = 0; i < total_callsites; i++) {
+        heap_trace_callsite_t *site = &callsites[i];
+        if (site->total_allocations == 0) {
+            continue;
+        }
+        printf("%u bytes in %u/%u allocations caller ", site->bytes, site->allocations, site->total_allocations);
+        for (int j = 0; j < STACK_DEPTH && site->alloced_by[j] != 0; j++) {
+            printf("%p%s", site->alloced_by[j],
+                   (j < STACK_DEPTH - 1) ? ":" : "");
+        }
+        printf("\n");
+        total_bytes += site->bytes;
+    }
+    printf("%u bytes alive in trace\n", total_bytes);
+    printf("total allocations %u total frees %u\n", total_allocations, total_frees);
+    if (has_overflowed) {
+        printf("(NB: Buffer has overflowed, so trace data is incomplete.)\n");
+    }
+}
 
 void heap_trace_dump(void)
 {
     size_t delta_size = 0;
     size_t delta_allocs = 0;
+    if (mode == HEAP_TRACE_CALLSITES) {
+        dump_callsites();
+        return;
+    }
     printf("%u allocations trace (%u entry buffer)\n",
            count, total_records);
+    portENTER_CRITICAL(&trace_mux);
+    if (!records_in_order) {
+        compact_records();
+    }
+    portEXIT_CRITICAL(&trace_mux);
     size_t start_count = count;
     for (int i = 0; i < count; i++) {
         heap_trace_record_t *rec = &buffer[i];
-
         if (rec->address != NULL) {
             printf("%d bytes (@ %p) allocated CPU %d ccount 0x%08x caller ",
                    rec->size, rec->address, rec->ccount & 1, rec->ccount & ~3);
@@ -170,6 +308,195 @@ void heap_trace_dump(void)
     }
 }
 
+/* Empty the lists of used entries and the hash map, and make all entries of the buffer unused */
+static void reset_entries(void)
+{
+    used_first = NO_ENTRY;
+    used_last = NO_ENTRY;
+    unused_first = (total_entries > 0) ? 0 : NO_ENTRY;
+    for (size_t i = 0; i < total_entries; i++) {
+        links[i].next = (i + 1 < total_entries) ? i + 1 : NO_ENTRY;
+        links[i].hash_next = NOT_HASHED;
+    }
+    for (int i = 0; i < HASH_MAP_SIZE; i++) {
+        hash_map[i] = NO_ENTRY;
+    }
+    records_in_order = true;
+}
+
+static inline IRAM_ATTR void *entry_address(size_t index)
+{
+    return (mode == HEAP_TRACE_CALLSITES) ? callsite_allocs[index].address : buffer[index].address;
+}
+
+static inline IRAM_ATTR size_t hash_address(void *p)
+{
+    // Allocations are at least 4 byte aligned
+    return ((uintptr_t)p >> 2) % HASH_MAP_SIZE;
+}
+
+/* Add an entry to the hash map. The newest entry comes first, so that a free matches the latest allocation of an address */
+static IRAM_ATTR void hash_insert(size_t index)
+{
+    size_t *head = &hash_map[hash_address(entry_address(index))];
+    links[index].hash_next = *head;
+    *head = index;
+}
+
+static IRAM_ATTR size_t hash_find(void *p)
+{
+    size_t index = hash_map[hash_address(p)];
+    while (index != NO_ENTRY && entry_address(index) != p) {
+        index = links[index].hash_next;
+    }
+    return index;
+}
+
+static IRAM_ATTR void hash_remove(size_t index)
+{
+    if (links[index].hash_next == NOT_HASHED) {
+        return;
+    }
+    size_t *prev_next = &hash_map[hash_address(entry_address(index))];
+    while (*prev_next != index) {
+        prev_next = &links[*prev_next].hash_next;
+    }
+    *prev_next = links[index].hash_next;
+    links[index].hash_next = NOT_HASHED;
+}
+
+/* Take an unused entry, as the newest used entry. There must be an unused entry. */
+static IRAM_ATTR size_t take_entry(void)
+{
+    size_t index = unused_first;
+    unused_first = links[index].next;
+    links[index].prev = used_last;
+    links[index].next = NO_ENTRY;
+    if (used_last == NO_ENTRY) {
+        used_first = index;
+    } else {
+        links[used_last].next = index;
+    }
+    used_last = index;
+    return index;
+}
+
+/* Make a used entry unused, and zero it out to avoid ambiguity */
+static IRAM_ATTR void release_entry(size_t index)
+{
+    hash_remove(index);
+    size_t prev = links[index].prev;
+    size_t next = links[index].next;
+    if (prev == NO_ENTRY) {
+        used_first = next;
+    } else {
+        links[prev].next = next;
+    }
+    if (next == NO_ENTRY) {
+        used_last = prev;
+    } else {
+        links[next].prev = prev;
+    }
+    if (mode == HEAP_TRACE_CALLSITES) {
+        memset(&callsite_allocs[index], 0, sizeof(callsite_alloc_t));
+    } else {
+        memset(&buffer[index], 0, sizeof(heap_trace_record_t));
+    }
+    links[index].next = unused_first;
+    unused_first = index;
+    records_in_order = false;
+}
+
+/* Move the used records to the start of the buffer, in order of allocation.
+
+   Records are only moved here, when they are read, so that a free does not move the rest of the buffer.
+*/
+static void compact_records(void)
+{
+    /* Destination of each record, in 'prev': the used records first, then the unused ones */
+    size_t dest = 0;
+    for (size_t i = used_first; i != NO_ENTRY; i = links[i].next) {
+        links[i].prev = dest++;
+    }
+    for (size_t i = unused_first; i != NO_ENTRY; i = links[i].next) {
+        links[i].prev = dest++;
+    }
+    /* Swap each record into place, along with its links, following the cycles of the permutation */
+    for (size_t i = 0; i < total_entries; i++) {
+        while (links[i].prev != i) {
+            size_t j = links[i].prev;
+            heap_trace_record_t record = buffer[j];
+            buffer[j] = buffer[i];
+            buffer[i] = record;
+            entry_links_t link = links[j];
+            links[j] = links[i];
+            links[i] = link;
+        }
+    }
+    /* Relink the records, and the hash map in order of allocation */
+    for (int i = 0; i < HASH_MAP_SIZE; i++) {
+        hash_map[i] = NO_ENTRY;
+    }
+    for (size_t i = 0; i < total_entries; i++) {
+        links[i].prev = (i > 0 && i < count) ? i - 1 : NO_ENTRY;
+        links[i].next = (i + 1 != count && i + 1 < total_entries) ? i + 1 : NO_ENTRY;
+        if (i < count && links[i].hash_next != NOT_HASHED) {
+            hash_insert(i);
+        }
+    }
+    used_first = (count > 0) ? 0 : NO_ENTRY;
+    used_last = (count > 0) ? count - 1 : NO_ENTRY;
+    unused_first = (count < total_entries) ? count : NO_ENTRY;
+    records_in_order = true;
+}
+
+/* Count an allocation in the call site table, which is indexed by a hash of the call stack.
+
+   Returns the index of the call site, or NO_ENTRY if the table is full.
+*/
+static IRAM_ATTR size_t record_callsite(const heap_trace_record_t *record)
+{
+    uint32_t hash = 0;
+    for (int i = 0; i < STACK_DEPTH; i++) {
+        hash = (hash ^ (uintptr_t)record->alloced_by[i]) * 16777619;
+    }
+    size_t index = hash % total_callsites;
+    for (size_t probes = 0; probes < total_callsites; probes++) {
+        heap_trace_callsite_t *site = &callsites[index];
+        if (site->total_allocations == 0) {
+            memcpy(site->alloced_by, record->alloced_by, sizeof(void *) * STACK_DEPTH);
+            count++;
+        }
+        if (memcmp(site->alloced_by, record->alloced_by, sizeof(void *) * STACK_DEPTH) == 0) {
+            site->allocations++;
+            site->bytes += record->size;
+            site->total_allocations++;
+            return index;
+        }
+        index = (index + 1 == total_callsites) ? 0 : index + 1;
+    }
+    has_overflowed = true;
+    return NO_ENTRY;
+}
+
+/* Keep the address of an allocation counted in a call site, so that a free can find it */
+static IRAM_ATTR void record_callsite_alloc(const heap_trace_record_t *record, size_t site)
+{
+    if (unused_first == NO_ENTRY) {
+        has_overflowed = true;
+        /* Drop the oldest allocation to make room. Its call site keeps counting it. */
+        release_entry(used_first);
+    }
+    size_t index = take_entry();
+    callsite_allocs[index].address = record->address;
+    callsite_allocs[index].size = record->size;
+    callsite_allocs[index].site = site;
+    hash_insert(index);
+}
+
+// remove a record, used when freeing
+static void remove_record(size_t index);
+
 /* Add a new allocation to the heap trace records */
 static IRAM_ATTR void record_allocation(const heap_trace_record_t *record)
 {
@@ -179,33 +506,35 @@ static IRAM_ATTR void record_allocation(const heap_trace_record_t *record)
 
     portENTER_CRITICAL(&trace_mux);
     if (tracing) {
+        if (mode == HEAP_TRACE_CALLSITES) {
+            size_t site = record_callsite(record);
+            if (site != NO_ENTRY) {
+                record_callsite_alloc(record, site);
+            }
+            total_allocations++;
+            portEXIT_CRITICAL(&trace_mux);
+            return;
+        }
         if (count == total_records) {
             has_overflowed = true;
-            /* Move the whole buffer back one slot.
-
-               This is a bit slow, compared to treating this buffer as a ringbuffer and rotating a head pointer.
-
-               However, ringbuffer code gets tricky when we remove elements in mid-buffer (for leak trace mode) while
-               trying to keep track of an item count that may overflow.
-            */
-            memmove(&buffer[0], &buffer[1], sizeof(heap_trace_record_t) * (total_records -1));
-            count--;
+            /* Drop the oldest record to make room */
+            remove_record(used_first);
         }
         // Copy new record into place
-        memcpy(&buffer[count], record, sizeof(heap_trace_record_t));
+        size_t index = take_entry();
+        memcpy(&buffer[index], record, sizeof(heap_trace_record_t));
+        hash_insert(index);
         count++;
         total_allocations++;
     }
     portEXIT_CRITICAL(&trace_mux);
 }
 
-// remove a record, used when freeing
-static void remove_record(int index);
-
 /* record a free event in the heap trace log
 
    For HEAP_TRACE_ALL, this means filling in the freed_by pointer.
    For HEAP_TRACE_LEAKS, this means removing the record from the log.
+   For HEAP_TRACE_CALLSITES, this means taking the allocation off its call site.
 */
 static IRAM_ATTR void record_free(void *p, void **callers)
 {
@@ -216,37 +545,32 @@ static IRAM_ATTR void record_free(void *p, void **callers)
     portENTER_CRITICAL(&trace_mux);
     if (tracing && count > 0) {
         total_frees++;
-        /* search backwards for the allocation record matching this free */
-        int i;
-        for (i = count - 1; i >= 0; i--) {
-            if (buffer[i].address == p) {
-                break;
-            }
-        }
-
-        if (i >= 0) {
-            if (mode == HEAP_TRACE_ALL) {
-                memcpy(buffer[i].freed_by, callers, sizeof(void *) * STACK_DEPTH);
+        /* look up the allocation matching this free */
+        size_t index = hash_find(p);
+
+        if (index != NO_ENTRY) {
+            if (mode == HEAP_TRACE_CALLSITES) {
+                heap_trace_callsite_t *site = &callsites[callsite_allocs[index].site];
+                site->allocations--;
+                site->bytes -= callsite_allocs[index].size;
+                release_entry(index);
+            } else if (mode == HEAP_TRACE_ALL) {
+                memcpy(buffer[index].freed_by, callers, sizeof(void *) * STACK_DEPTH);
+                // The record stays in the trace, but a later free of the same address belongs to a later allocation
+                hash_remove(index);
             } else { // HEAP_TRACE_LEAKS
                 // Leak trace mode, once an allocation is freed we remove it from the list
-                remove_record(i);
+                remove_record(index);
             }
         }
     }
     portEXIT_CRITICAL(&trace_mux);
 }
 
-/* remove the entry at 'index' from the ringbuffer of saved records */
-static IRAM_ATTR void remove_record(int index)
+/* remove a record from the saved records, and make it available for new allocations */
+static IRAM_ATTR void remove_record(size_t index)
 {
-    if (index < count - 1) {
-        // Remove the buffer entry from the list
-        memmove(&buffer[index], &buffer[index+1],
-                sizeof(heap_trace_record_t) * (total_records - index - 1));
-    } else {
-        // For last element, just zero it out to avoid ambiguity
-        memset(&buffer[index], 0, sizeof(heap_trace_record_t));
-    }
+    release_entry(index);
     count--;
 }
 
@@ -32,6 +32,7 @@ extern "C" {
 typedef enum {
     HEAP_TRACE_ALL,
     HEAP_TRACE_LEAKS,
+    HEAP_TRACE_CALLSITES,
 } heap_trace_mode_t;
 
 /**
@@ -45,6 +46,16 @@ typedef struct {
     void *freed_by[CONFIG_HEAP_TRACING_STACK_DEPTH];   ///< Call stack of the caller which freed the memory (all zero if not freed.)
 } heap_trace_record_t;
 
+/**
+ * @brief Call site summary data type. Stores the allocations made from one call stack in HEAP_TRACE_CALLSITES mode.
+ */
+typedef struct {
+    void *alloced_by[CONFIG_HEAP_TRACING_STACK_DEPTH]; ///< Call stack of the caller which allocated the memory.
+    size_t allocations;       ///< Number of allocations made from this call stack which have not been freed
+    size_t bytes;             ///< Number of bytes allocated from this call stack which have not been freed
+    size_t total_allocations; ///< Number of allocations made from this call stack, freed or not
+} heap_trace_callsite_t;
+
 /**
  * @brief Initialise heap tracing in standalone mode.
  *
@@ -54,10 +65,14 @@ typedef struct {
  *
  * @param record_buffer Provide a buffer to use for heap trace data. Must remain valid any time heap tracing is enabled, meaning
  * it must be allocated from internal memory not in PSRAM.
+ * This function also allocates an index of the buffer from internal memory, which is about half the size of the buffer
+ * with the default stack depth.
+ *
  * @param num_records Size of the heap trace buffer, as number of record structures.
  * @return
  *  - ESP_ERR_NOT_SUPPORTED Project was compiled without heap tracing enabled in menuconfig.
  *  - ESP_ERR_INVALID_STATE Heap tracing is currently in progress.
+ *  - ESP_ERR_NO_MEM The index of the records could not be allocated.
  *  - ESP_OK Heap tracing initialised successfully.
  */
 esp_err_t heap_trace_init_standalone(heap_trace_record_t *record_buffer, size_t num_records);
@@ -83,6 +98,9 @@ esp_err_t heap_trace_init_tohost(void);
  * @param mode Mode for tracing.
  * - HEAP_TRACE_ALL means all heap allocations and frees are traced.
  * - HEAP_TRACE_LEAKS means only suspected memory leaks are traced. (When memory is freed, the record is removed from the trace buffer.)
+ * - HEAP_TRACE_CALLSITES means allocations are counted per call stack, instead of being recorded one by one. Half of the
+ *   trace buffer then holds heap_trace_callsite_t entries, which can be read with heap_trace_get_callsite(), and the
+ *   other half the allocations which have not been freed yet, so that a free is taken off the count of its call stack.
  * @return
  * - ESP_ERR_NOT_SUPPORTED Project was compiled without heap tracing enabled in menuconfig.
  * - ESP_ERR_INVALID_STATE A non-zero-length buffer has not been set via heap_trace_init_standalone().
@@ -119,6 +137,8 @@ esp_err_t heap_trace_resume(void);
 /**
  * @brief Return number of records in the heap trace buffer
  *
+ * In HEAP_TRACE_CALLSITES mode, this is the number of call sites.
+ *
  * It is safe to call this function while heap tracing is running.
  */
 size_t heap_trace_get_count(void);
@@ -139,6 +159,19 @@ size_t heap_trace_get_count(void);
  */
 esp_err_t heap_trace_get(size_t index, heap_trace_record_t *record);
 
+/**
+ * @brief Return a call site summary from the heap trace buffer, in HEAP_TRACE_CALLSITES mode
+ *
+ * @param index Index (zero-based) of the call site to return.
+ * @param[out] callsite Summary where the call site data will be copied.
+ * @return
+ * - ESP_ERR_NOT_SUPPORTED Project was compiled without standalone heap tracing enabled in menuconfig.
+ * - ESP_ERR_INVALID_STATE Heap tracing was not initialised or not started in HEAP_TRACE_CALLSITES mode.
+ * - ESP_ERR_INVALID_ARG Index is out of bounds for current call site count.
+ * - ESP_OK Call site returned successfully.
+ */
+esp_err_t heap_trace_get_callsite(size_t index, heap_trace_callsite_t *callsite);
+
 /**
  * @brief Dump heap trace record data to stdout
  *
@@ -69,6 +69,14 @@ inline static void multi_heap_assert(bool condition, const char *format, int lin
     multi_heap_assert((CONDITION), "CORRUPT HEAP: multi_heap.c:%d detected at 0x%08x\n", \
                       __LINE__, (intptr_t)(ADDRESS))
 
+/* The size class cache of heap_caps_cache.c is kept per core. Masking the interrupts of the calling core keeps the
+   task on the core, and other tasks and ISRs of the core away from its cache, without taking a lock. */
+typedef UBaseType_t multi_heap_core_state_t;
+#define MULTI_HEAP_NUM_CORES portNUM_PROCESSORS
+#define MULTI_HEAP_CORE_ID() xPortGetCoreID()
+#define MULTI_HEAP_CORE_ENTER() portSET_INTERRUPT_MASK_FROM_ISR()
+#define MULTI_HEAP_CORE_EXIT(STATE) portCLEAR_INTERRUPT_MASK_FROM_ISR(STATE)
+
 #ifdef CONFIG_HEAP_TASK_TRACKING
 #include <freertos/task.h>
 #define MULTI_HEAP_BLOCK_OWNER TaskHandle_t task;
@@ -91,6 +99,12 @@ inline static void multi_heap_assert(bool condition, const char *format, int lin
 #define MULTI_HEAP_LOCK_INIT(PLOCK)  (void) (PLOCK)
 #define MULTI_HEAP_LOCK_STATIC_INITIALIZER  0
 
+typedef int multi_heap_core_state_t;
+#define MULTI_HEAP_NUM_CORES 1
+#define MULTI_HEAP_CORE_ID() 0
+#define MULTI_HEAP_CORE_ENTER() 0
+#define MULTI_HEAP_CORE_EXIT(STATE) (void) (STATE)
+
 #define MULTI_HEAP_ASSERT(CONDITION, ADDRESS) assert((CONDITION) && "Heap corrupt")
 
 #define MULTI_HEAP_BLOCK_OWNER
@@ -13,6 +13,7 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_heap_caps.h"
 
 #ifdef CONFIG_HEAP_TRACING
 // only compile in heap tracing tests if tracing is enabled
@@ -64,6 +65,91 @@ TEST_CASE("heap trace leak check", "[heap]")
     TEST_ASSERT_EQUAL_PTR(recs[0].address, trace_b.address);
 
     heap_trace_stop();
+    heap_trace_init_standalone(NULL, 0);
+}
+
+TEST_CASE("heap trace leak check with many records", "[heap]")
+{
+    const size_t N = 200;
+    heap_trace_record_t *recs = heap_caps_malloc(N * sizeof(heap_trace_record_t), MALLOC_CAP_INTERNAL);
+    void *ptrs[N / 2];
+    TEST_ASSERT_NOT_NULL(recs);
+    heap_trace_init_standalone(recs, N);
+
+    heap_trace_start(HEAP_TRACE_LEAKS);
+    for (int i = 0; i < N / 2; i++) {
+        ptrs[i] = malloc(8 + i);
+    }
+    /* free every other allocation, out of order */
+    for (int i = N / 2 - 2; i >= 0; i -= 2) {
+        free(ptrs[i]);
+    }
+    heap_trace_stop();
+
+    /* remaining allocations are still in allocation order */
+    int next = 1;
+    for (int i = 0; i < heap_trace_get_count(); i++) {
+        heap_trace_record_t rec;
+        TEST_ASSERT_EQUAL(ESP_OK, heap_trace_get(i, &rec));
+        if (next < N / 2 && rec.address == ptrs[next]) {
+            TEST_ASSERT_EQUAL(8 + next, rec.size);
+            next += 2;
+        }
+        for (int j = 0; j < N / 2; j += 2) {
+            TEST_ASSERT_NOT_EQUAL(ptrs[j], rec.address);
+        }
+    }
+    TEST_ASSERT_EQUAL(N / 2 + 1, next);
+
+    for (int i = 1; i < N / 2; i += 2) {
+        free(ptrs[i]);
+    }
+    heap_trace_init_standalone(NULL, 0);
+    free(recs);
+}
+
+static void *__attribute__((noinline)) callsite_alloc(size_t size)
+{
+    return malloc(size);
+}
+
+TEST_CASE("heap trace call site summary", "[heap]")
+{
+    heap_trace_record_t recs[20];
+    void *ptrs[20];
+    TEST_ASSERT_EQUAL(ESP_OK, heap_trace_init_standalone(recs, 20));
+
+    heap_trace_start(HEAP_TRACE_CALLSITES);
+    for (int i = 0; i < 20; i++) {
+        ptrs[i] = callsite_alloc(16);
+    }
+    /* frees while tracing are taken off the call site */
+    for (int i = 0; i < 20; i += 2) {
+        free(ptrs[i]);
+    }
+    heap_trace_stop();
+    for (int i = 1; i < 20; i += 2) {
+        free(ptrs[i]);
+    }
+
+    heap_trace_dump();
+    TEST_ASSERT(heap_trace_get_count() >= 1);
+    heap_trace_callsite_t max_site = { 0 };
+    for (int i = 0; i < heap_trace_get_count(); i++) {
+        heap_trace_callsite_t site;
+        TEST_ASSERT_EQUAL(ESP_OK, heap_trace_get_callsite(i, &site));
+        if (site.total_allocations > max_site.total_allocations) {
+            max_site = site;
+        }
+    }
+    /* all allocations come from the same call stack */
+    TEST_ASSERT_EQUAL(20, max_site.total_allocations);
+    TEST_ASSERT_EQUAL(10, max_site.allocations);
+    TEST_ASSERT_EQUAL(160, max_site.bytes);
+
+    heap_trace_callsite_t site;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, heap_trace_get_callsite(heap_trace_get_count(), &site));
+    heap_trace_init_standalone(NULL, 0);
 }
 
 TEST_CASE("heap trace wrapped buffer check", "[heap]")
@@ -121,6 +207,7 @@ TEST_CASE("heap trace wrapped buffer check", "[heap]")
     TEST_ASSERT(saw_other);
 
     heap_trace_stop();
+    heap_trace_init_standalone(NULL, 0);
 }
 
 static void print_floats_task(void *ignore)
@@ -158,6 +245,7 @@ TEST_CASE("can trace allocations made by newlib", "[heap]")
 
     /* has to be at least a few as newlib allocates via multiple different function calls */
     TEST_ASSERT(heap_trace_get_count() > 3);
+    heap_trace_init_standalone(NULL, 0);
 }
 
 
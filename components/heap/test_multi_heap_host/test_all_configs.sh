@@ -5,9 +5,10 @@
 
 FAIL=0
 
-for FLAGS in "CONFIG_HEAP_POISONING_NONE" "CONFIG_HEAP_POISONING_LIGHT" "CONFIG_HEAP_POISONING_COMPREHENSIVE" ; do
+for FLAGS in "-DCONFIG_HEAP_POISONING_NONE" "-DCONFIG_HEAP_POISONING_LIGHT" "-DCONFIG_HEAP_POISONING_COMPREHENSIVE" \
+             "-DCONFIG_HEAP_POISONING_NONE -DCONFIG_HEAP_SIZE_CLASS_CACHE" ; do
     echo "==== Testing with config: ${FLAGS} ===="
-    CPPFLAGS="-D${FLAGS}" make clean test || FAIL=1
+    CPPFLAGS="${FLAGS}" make clean test || FAIL=1
 done
 
 make clean
@@ -2,9 +2,11 @@
 #include "multi_heap.h"
 
 #include "../multi_heap_config.h"
+#include "../heap_caps_cache.h"
 
 #include <string.h>
 #include <assert.h>
+#include <time.h>
 
 /* Insurance against accidentally using libc heap functions in tests */
 #undef free
@@ -503,3 +505,217 @@ TEST_CASE("multi_heap aligned allocations", "[multi_heap]")
     printf("[ALIGNED_ALLOC] heap_size after: %d \n", multi_heap_free_size(heap));
     REQUIRE((old_size - multi_heap_free_size(heap)) <= leakage);
 }
+
+#ifdef CONFIG_HEAP_SIZE_CLASS_CACHE
+static void *cache_pop(size_t size, uint32_t caps)
+{
+    return heap_caps_cache_pop(&size, caps);
+}
+
+TEST_CASE("heap_caps size class cache", "[multi_heap]")
+{
+    const uint32_t CAP_A = 1, CAP_B = 2;
+    uint8_t heapdata_a[4 * 1024], heapdata_b[4 * 1024];
+    multi_heap_handle_t heap_a = multi_heap_register(heapdata_a, sizeof(heapdata_a));
+    multi_heap_handle_t heap_b = multi_heap_register(heapdata_b, sizeof(heapdata_b));
+    const size_t free_a = multi_heap_free_size(heap_a);
+    const size_t free_b = multi_heap_free_size(heap_b);
+
+    /* A miss rounds the size up to its size class, so the block allocated for it serves the whole class */
+    size_t size = 40;
+    REQUIRE( heap_caps_cache_pop(&size, CAP_A) == NULL );
+    REQUIRE( size == 48 );
+    void *a = multi_heap_malloc(heap_a, size);
+    REQUIRE( a != NULL );
+    REQUIRE( heap_caps_cache_push(heap_a, CAP_A | CAP_B, a) );
+    REQUIRE( cache_pop(49, CAP_A) == NULL );
+    REQUIRE( cache_pop(33, CAP_A) == a );
+    REQUIRE( cache_pop(48, CAP_A) == NULL );
+    REQUIRE( heap_caps_cache_push(heap_a, CAP_A | CAP_B, a) );
+    REQUIRE( cache_pop(0, CAP_A) == NULL );
+    size = HEAP_CAPS_CACHE_MAX_SIZE + 1;
+    REQUIRE( heap_caps_cache_pop(&size, CAP_A) == NULL );
+    REQUIRE( size == HEAP_CAPS_CACHE_MAX_SIZE + 1 );
+
+    /* A block between two class sizes is cached in the smaller class */
+    void *b = multi_heap_malloc(heap_b, 40);
+    REQUIRE( multi_heap_get_allocated_size(heap_b, b) < 48 );
+    REQUIRE( heap_caps_cache_push(heap_b, CAP_A, b) );
+    REQUIRE( cache_pop(40, CAP_A) == a );
+    REQUIRE( cache_pop(40, CAP_A) == NULL );
+    REQUIRE( cache_pop(32, CAP_A) == b );
+    REQUIRE( heap_caps_cache_push(heap_a, CAP_A | CAP_B, a) );
+    REQUIRE( heap_caps_cache_push(heap_b, CAP_A, b) );
+
+    /* Only blocks of a heap with all the requested caps are used */
+    REQUIRE( cache_pop(32, CAP_A | CAP_B) == NULL );
+    REQUIRE( cache_pop(48, CAP_A | CAP_B) == a );
+    REQUIRE( cache_pop(32, CAP_A | CAP_B) == NULL );
+    REQUIRE( cache_pop(32, CAP_A) == b );
+
+    /* Large blocks are not cached, and a full size class isn't either */
+    void *large = multi_heap_malloc(heap_a, HEAP_CAPS_CACHE_MAX_SIZE + 1);
+    REQUIRE( !heap_caps_cache_push(heap_a, CAP_A, large) );
+    multi_heap_free(heap_a, large);
+    void *p[CONFIG_HEAP_SIZE_CLASS_CACHE_DEPTH + 1];
+    for (int i = 0; i <= CONFIG_HEAP_SIZE_CLASS_CACHE_DEPTH; i++) {
+        p[i] = multi_heap_malloc(heap_b, 48);
+        REQUIRE( p[i] != NULL );
+    }
+    for (int i = 0; i < CONFIG_HEAP_SIZE_CLASS_CACHE_DEPTH; i++) {
+        REQUIRE( heap_caps_cache_push(heap_b, CAP_A, p[i]) );
+    }
+    REQUIRE( !heap_caps_cache_push(heap_b, CAP_A, p[CONFIG_HEAP_SIZE_CLASS_CACHE_DEPTH]) );
+    multi_heap_free(heap_b, p[CONFIG_HEAP_SIZE_CLASS_CACHE_DEPTH]);
+    REQUIRE( heap_caps_cache_push(heap_b, CAP_A, b) );
+    REQUIRE( !heap_caps_cache_push(heap_a, CAP_A | CAP_B, a) );
+    multi_heap_free(heap_a, a);
+    void *c = multi_heap_malloc(heap_a, 96);
+    REQUIRE( heap_caps_cache_push(heap_a, CAP_A, c) );
+
+    /* Flushing returns all cached blocks to their heaps */
+    REQUIRE( multi_heap_free_size(heap_a) < free_a );
+    REQUIRE( multi_heap_free_size(heap_b) < free_b );
+    heap_caps_cache_flush();
+    REQUIRE( multi_heap_free_size(heap_a) == free_a );
+    REQUIRE( multi_heap_free_size(heap_b) == free_b );
+    REQUIRE( cache_pop(96, CAP_A) == NULL );
+    REQUIRE( cache_pop(48, CAP_A) == NULL );
+    REQUIRE( multi_heap_check(heap_a, true) );
+    REQUIRE( multi_heap_check(heap_b, true) );
+}
+
+/* Allocates the way heap_caps_malloc() does: from the cache, or else from the first of the heaps with the requested
+   caps, or else from the heaps after flushing the cache. */
+struct caps_heaps {
+    multi_heap_handle_t heap[3];
+    uint32_t caps[3];
+    uint8_t *start[3];
+    size_t size;
+    bool cache;
+};
+
+static void *caps_heaps_malloc(caps_heaps *heaps, size_t size, uint32_t caps)
+{
+    if (heaps->cache) {
+        void *p = heap_caps_cache_pop(&size, caps);
+        if (p != NULL) {
+            return p;
+        }
+    }
+    for (int retry = 0; retry < 2; retry++) {
+        for (int i = 0; i < 3; i++) {
+            if ((heaps->caps[i] & caps) == caps) {
+                void *p = multi_heap_malloc(heaps->heap[i], size);
+                if (p != NULL) {
+                    return p;
+                }
+            }
+        }
+        if (!heaps->cache) {
+            break;
+        }
+        heap_caps_cache_flush();
+    }
+    return NULL;
+}
+
+static void caps_heaps_free(caps_heaps *heaps, void *p)
+{
+    if (p == NULL) {
+        return;
+    }
+    for (int i = 0; i < 3; i++) {
+        if ((uint8_t *)p >= heaps->start[i] && (uint8_t *)p < heaps->start[i] + heaps->size) {
+            if (!heaps->cache || !heap_caps_cache_push(heaps->heap[i], heaps->caps[i], p)) {
+                multi_heap_free(heaps->heap[i], p);
+            }
+            return;
+        }
+    }
+    FAIL("block outside of the heaps");
+}
+
+/* Mix of many short lived small blocks with different caps and fewer long lived larger blocks. Sums up the heap info
+   of the heap taking the small blocks every 10000 iterations, while the blocks are in use. */
+static double run_benchmark(caps_heaps *heaps, int iterations, multi_heap_info_t *info)
+{
+    const int NUM_SMALL = 128;
+    const int NUM_LARGE = 16;
+    void *small[NUM_SMALL] = { 0 };
+    void *large[NUM_LARGE] = { 0 };
+    int ops = 0;
+    int failed = 0;
+
+    memset(info, 0, sizeof(*info));
+    srand(1);
+    clock_t start = clock();
+    clock_t paused = 0;
+    for (int i = 0; i < iterations; i++) {
+        int n = rand() % NUM_SMALL;
+        caps_heaps_free(heaps, small[n]);
+        small[n] = caps_heaps_malloc(heaps, 8 + rand() % 120, (n % 4 == 0) ? 2 : 1);
+        failed += (small[n] == NULL);
+        ops += 2;
+        if (i % 16 == 0) {
+            int m = rand() % NUM_LARGE;
+            caps_heaps_free(heaps, large[m]);
+            large[m] = caps_heaps_malloc(heaps, 256 + rand() % 768, 1);
+            ops += 2;
+        }
+        if (i % 10000 == 9999) {
+            clock_t pause = clock();
+            multi_heap_info_t snapshot;
+            multi_heap_get_info(heaps->heap[1], &snapshot);
+            info->largest_free_block += snapshot.largest_free_block;
+            info->free_blocks += snapshot.free_blocks;
+            paused += clock() - pause;
+        }
+    }
+    double seconds = (double)(clock() - start - paused) / CLOCKS_PER_SEC;
+
+    for (int i = 0; i < NUM_SMALL; i++) {
+        caps_heaps_free(heaps, small[i]);
+    }
+    for (int i = 0; i < NUM_LARGE; i++) {
+        caps_heaps_free(heaps, large[i]);
+    }
+    heap_caps_cache_flush();
+    REQUIRE( failed == 0 );
+    return seconds > 0 ? ops / seconds : 0;
+}
+
+TEST_CASE("heap_caps size class cache performance", "[multi_heap]")
+{
+    static uint8_t heapdata[3][32 * 1024];
+    const int ITERATIONS = 200000;
+    const int SNAPSHOTS = ITERATIONS / 10000;
+    /* Caps 1 are in the last two heaps, caps 2 only in the last one, as the first heap is searched in vain */
+    const uint32_t caps[3] = { 4, 1, 1 | 2 };
+    multi_heap_info_t info[2];
+    double ops[2];
+
+    for (int cache = 0; cache < 2; cache++) {
+        caps_heaps heaps;
+        heaps.size = sizeof(heapdata[0]);
+        heaps.cache = cache;
+        for (int i = 0; i < 3; i++) {
+            heaps.start[i] = heapdata[i];
+            heaps.heap[i] = multi_heap_register(heapdata[i], sizeof(heapdata[i]));
+            heaps.caps[i] = caps[i];
+        }
+        const size_t initial_free = multi_heap_free_size(heaps.heap[1]);
+        ops[cache] = run_benchmark(&heaps, ITERATIONS, &info[cache]);
+        printf("%s cache: %.0f ops/s, largest free block %zu, %zu free blocks on average\n",
+               cache ? "with" : "without", ops[cache],
+               info[cache].largest_free_block / SNAPSHOTS, info[cache].free_blocks / SNAPSHOTS);
+        for (int i = 0; i < 3; i++) {
+            REQUIRE( multi_heap_check(heaps.heap[i], true) );
+        }
+        REQUIRE( multi_heap_free_size(heaps.heap[1]) == initial_free );
+    }
+
+    /* Cached blocks stay allocated in their heaps, which may split up the free space a little more */
+    REQUIRE( info[1].largest_free_block >= info[0].largest_free_block - info[0].largest_free_block / 5 );
+}
+#endif
@@ -35,6 +35,12 @@
 #ifndef IDF_PERFORMANCE_MAX_VFS_OPEN_WRITE_CLOSE_TIME_PSRAM
 #define IDF_PERFORMANCE_MAX_VFS_OPEN_WRITE_CLOSE_TIME_PSRAM                     25000
 #endif
+#ifndef IDF_PERFORMANCE_MAX_VFS_NESTED_PATH_OPEN_CLOSE_TIME
+#define IDF_PERFORMANCE_MAX_VFS_NESTED_PATH_OPEN_CLOSE_TIME                     20000
+#endif
+#ifndef IDF_PERFORMANCE_MAX_VFS_WRITE_DISPATCH_TIME
+#define IDF_PERFORMANCE_MAX_VFS_WRITE_DISPATCH_TIME                             2000
+#endif
 
 // throughput performance by iperf
 #ifndef IDF_PERFORMANCE_MIN_TCP_RX_THROUGHPUT
@@ -1,6 +1,63 @@
 #pragma once
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include "sdkconfig.h"
 
 void esp_log_impl_lock(void);
 bool esp_log_impl_lock_timeout(void);
 void esp_log_impl_unlock(void);
+
+// Outputs an already formatted string through the function set by esp_log_set_vprintf
+void esp_log_output_string(const char *str);
+
+// Argument of a printf conversion specification, see log_format.c
+typedef enum {
+    ESP_LOG_ARG_NONE,       // "%%", no argument
+    ESP_LOG_ARG_COUNT,      // "%n"
+    ESP_LOG_ARG_INT,
+    ESP_LOG_ARG_LONG,
+    ESP_LOG_ARG_LLONG,
+    ESP_LOG_ARG_INTMAX,
+    ESP_LOG_ARG_SIZE,
+    ESP_LOG_ARG_PTRDIFF,
+    ESP_LOG_ARG_DOUBLE,
+    ESP_LOG_ARG_LDOUBLE,
+    ESP_LOG_ARG_PTR,
+    ESP_LOG_ARG_STR,
+    ESP_LOG_ARG_INVALID,    // conversion which isn't supported
+} esp_log_arg_type_t;
+
+typedef struct {
+    const char *end;        // one past the conversion character
+    esp_log_arg_type_t type;
+    char conversion;        // conversion character, e.g. 'd'
+    char length;            // length modifier: 0, 'H' (hh), 'h', 'l', 'q' (ll), 'j', 'z', 't' or 'L'
+    bool star_width;        // width is passed as an int argument
+    bool star_precision;    // precision is passed as an int argument
+    int precision;          // precision given in the format string, -1 if none
+} esp_log_conv_spec_t;
+
+// Parses the conversion specification following a '%' at 'p'
+void esp_log_parse_conv_spec(const char *p, esp_log_conv_spec_t *spec);
+
+#if CONFIG_LOG_DEFERRED_OUTPUT && !BOOTLOADER_BUILD
+// Deferred output, implemented in log_deferred.c.
+// Returns false if deferred output is not active and the message should be output synchronously.
+bool esp_log_deferred_capture(const char *format, va_list args);
+// Renders pending messages; returns false if another task is rendering already.
+bool esp_log_deferred_render(void);
+
+// Platform specific parts of deferred output.
+// Number of buffers, one per core.
+unsigned esp_log_impl_deferred_buffer_count(void);
+// Prevents other producers of the caller's buffer from running until exit, returns the buffer index.
+unsigned esp_log_impl_deferred_enter(uint32_t *state);
+void esp_log_impl_deferred_exit(uint32_t state);
+// Creates the task calling esp_log_deferred_render(), if it doesn't exist yet.
+bool esp_log_impl_deferred_task_start(void);
+// Wakes the task up before its period elapses.
+void esp_log_impl_deferred_task_notify(void);
+// Blocks the caller for a short time, while waiting for the task to render.
+void esp_log_impl_deferred_yield(void);
+#endif
@@ -8,8 +8,12 @@
 */
 #define CATCH_CONFIG_MAIN
 #include <cstdio>
+#include <cstring>
 #include <regex>
 #include <iostream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
 #include "esp_log.h"
 
 #include "catch.hpp"
@@ -17,6 +21,7 @@
 using namespace std;
 
 static const char *TEST_TAG = "test";
+static ESP_LOG_TAG_DEFINE(s_test_tag_desc, "test_desc");
 
 class BasicLogFixture {
 public:
@@ -267,3 +272,381 @@ TEST_CASE("changing early log level")
     ESP_EARLY_LOGI(TEST_TAG, "must indeed be printed");
     CHECK(regex_search(fix.get_print_buffer_string(), test_print) == true);
 }
+
+TEST_CASE("tag descriptor log level")
+{
+    PrintFixture fix(ESP_LOG_INFO);
+    const std::regex test_print("I \\([0-9]*\\) test_desc: must indeed be printed", std::regex::ECMAScript);
+    const std::regex test_debug_print("D \\([0-9]*\\) test_desc: debug", std::regex::ECMAScript);
+
+    ESP_LOGI_TAG(&s_test_tag_desc, "must indeed be printed");
+    CHECK(regex_search(fix.get_print_buffer_string(), test_print) == true);
+
+    fix.reset_buffer();
+    esp_log_level_set("test_desc", ESP_LOG_WARN);
+
+    ESP_LOGI_TAG(&s_test_tag_desc, "must not be printed");
+    CHECK(fix.get_print_buffer_string().size() == 0);
+    CHECK(ESP_LOG_TAG_ENABLED(&s_test_tag_desc, ESP_LOG_WARN));
+    CHECK(!ESP_LOG_TAG_ENABLED(&s_test_tag_desc, ESP_LOG_INFO));
+    CHECK(esp_log_level_get("test_desc") == ESP_LOG_WARN);
+
+    fix.reset_buffer();
+    esp_log_level_set("*", ESP_LOG_DEBUG);
+
+    ESP_LOGD_TAG(&s_test_tag_desc, "debug");
+    CHECK(regex_search(fix.get_print_buffer_string(), test_debug_print) == true);
+}
+
+TEST_CASE("tag descriptor uses the level set before its first use")
+{
+    static ESP_LOG_TAG_DEFINE(first_use_tag, "first_use");
+    PrintFixture fix(ESP_LOG_INFO);
+    esp_log_level_set("first_use", ESP_LOG_ERROR);
+
+    ESP_LOGW_TAG(&first_use_tag, "must not be printed");
+    CHECK(fix.get_print_buffer_string().size() == 0);
+    CHECK(!ESP_LOG_TAG_ENABLED(&first_use_tag, ESP_LOG_WARN));
+
+    ESP_LOGE_TAG(&first_use_tag, "error");
+    CHECK(fix.get_print_buffer_string().find("first_use: error") != string::npos);
+}
+
+#if CONFIG_LOG_DEFERRED_OUTPUT
+TEST_CASE("deferred log output renders arguments")
+{
+    PrintFixture fix(ESP_LOG_INFO);
+    REQUIRE(esp_log_deferred_start(4096) == ESP_OK);
+    CHECK(esp_log_deferred_start(4096) == ESP_ERR_INVALID_STATE);
+
+    char str[16] = "temporary";
+    char expected[256];
+    snprintf(expected, sizeof(expected), "test: %d %5u %-*d| %lld %zu %.2f %s %.3s %c %p %% %.*s end",
+             -1, 2u, 4, 3, -4LL, (size_t) 5, 6.25, str, "abcdef", 'x', (void *) 0x1234, -1, "xyz");
+    ESP_LOGI(TEST_TAG, "%d %5u %-*d| %lld %zu %.2f %s %.3s %c %p %% %.*s end",
+             -1, 2u, 4, 3, -4LL, (size_t) 5, 6.25, str, "abcdef", 'x', (void *) 0x1234, -1, "xyz");
+    // string arguments are copied when the message is logged
+    std::memset(str, 0, sizeof(str));
+
+    esp_log_deferred_flush();
+    CHECK(fix.get_print_buffer_string().find(expected) != string::npos);
+
+    // arguments which don't fit into a message are output synchronously
+    fix.reset_buffer();
+    const string long_str(100, 'a');
+    ESP_LOGI(TEST_TAG, "%s %s %s", long_str.c_str(), long_str.c_str(), long_str.c_str());
+    CHECK(fix.get_print_buffer_string().find(long_str + " " + long_str + " " + long_str) != string::npos);
+
+    esp_log_deferred_stop();
+    fix.reset_buffer();
+    ESP_LOGI(TEST_TAG, "synchronous");
+    CHECK(fix.get_print_buffer_string().find("test: synchronous") != string::npos);
+}
+#endif // CONFIG_LOG_DEFERRED_OUTPUT
+
+#if CONFIG_LOG_BINARY_OUTPUT
+extern "C" const char etext[];
+
+struct BinaryFixture : BasicLogFixture {
+    BinaryFixture(esp_log_level_t log_level = ESP_LOG_VERBOSE) : BasicLogFixture(log_level)
+    {
+        output.clear();
+        old_vprintf = esp_log_set_vprintf(esp_log_binary_vprintf);
+        old_write = esp_log_binary_set_write_func(write_callback);
+    }
+
+    ~BinaryFixture()
+    {
+        esp_log_binary_set_write_func(old_write);
+        esp_log_set_vprintf(old_vprintf);
+    }
+
+    static int write(const char *format, ...)
+    {
+        va_list args;
+        va_start(args, format);
+        int ret = esp_log_binary_vprintf(format, args);
+        va_end(args);
+        return ret;
+    }
+
+    // Decodes the COBS encoded frame at the start of the output
+    vector<uint8_t> decode_frame() const
+    {
+        vector<uint8_t> record;
+        size_t pos = 0;
+        while (pos < output.size() && output[pos] != 0) {
+            uint8_t code = output[pos];
+            record.insert(record.end(), output.begin() + pos + 1, output.begin() + pos + code);
+            pos += code;
+            if (code < 0xff && output[pos] != 0) {
+                record.push_back(0);
+            }
+        }
+        return record;
+    }
+
+    static vector<uint8_t> output;
+
+private:
+    static void write_callback(const void *data, size_t size)
+    {
+        output.insert(output.end(), (const uint8_t *) data, (const uint8_t *) data + size);
+    }
+
+    vprintf_like_t old_vprintf;
+    esp_log_binary_write_t old_write;
+};
+
+vector<uint8_t> BinaryFixture::output;
+
+static uint8_t crc8(const uint8_t *data, size_t len)
+{
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80) ? (uint8_t) ((crc << 1) ^ 0x07) : (uint8_t) (crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void push_varint(vector<uint8_t> &record, uint64_t value)
+{
+    for (; value >= 0x80; value >>= 7) {
+        record.push_back((uint8_t) (value | 0x80));
+    }
+    record.push_back((uint8_t) value);
+}
+
+TEST_CASE("binary log output packs arguments")
+{
+    static const char format[] = "%d %u %s %s %s %c %.2s|";
+    static const char dict_str[] = "constant";
+    BinaryFixture fix;
+
+    char str[] = "ab";
+    char long_str[] = "abcd";
+    BinaryFixture::write(format, -2, 300u, str, dict_str, (const char *) nullptr, 'x', long_str);
+
+    vector<uint8_t> expected = {0xf1};
+    push_varint(expected, format - etext);
+    expected.push_back(3);                              // -2, zigzag encoded
+    push_varint(expected, 300);
+    expected.insert(expected.end(), {(2 + 1) << 1, 'a', 'b'});
+    push_varint(expected, ((uint64_t) (dict_str - etext) << 1) | 1);
+    expected.push_back(0);                              // NULL string
+    expected.push_back('x');
+    expected.insert(expected.end(), {(2 + 1) << 1, 'a', 'b'});   // truncated to the precision
+    expected.push_back(crc8(expected.data(), expected.size()));
+
+    CHECK(BinaryFixture::output.back() == 0);
+    CHECK(std::count(BinaryFixture::output.begin(), BinaryFixture::output.end(), 0) == 1);
+    CHECK(fix.decode_frame() == expected);
+}
+
+TEST_CASE("binary log output falls back to text")
+{
+    BinaryFixture fix;
+
+    // format string which isn't in read-only data
+    char format[] = "text %d %s\n";
+    BinaryFixture::write(format, 42, "abc");
+    CHECK(string(BinaryFixture::output.begin(), BinaryFixture::output.end()) == "text 42 abc\n");
+
+    // message which doesn't fit into a record
+    BinaryFixture::output.clear();
+    const string long_str(300, 'a');
+    BinaryFixture::write("%s", long_str.c_str());
+    CHECK(string(BinaryFixture::output.begin(), BinaryFixture::output.end()) == long_str);
+}
+
+TEST_CASE("binary log output size")
+{
+    // Typical messages, formatted like ESP_LOGx without colors about two minutes after boot
+    static const char info_format[] = "I (%u) %s: value %d name %s\n";
+    static const char warn_format[] = "W (%u) %s: connection to %s failed, retrying in %u ms (attempt %d)\n";
+    size_t text_size = 0;
+    size_t binary_size = 0;
+    char text[256];
+    const int MESSAGES = 100;
+
+    BinaryFixture fix;
+    for (int i = 0; i < MESSAGES; i++) {
+        uint32_t timestamp = 120000 + i * 25;
+        BinaryFixture::write(info_format, timestamp, TEST_TAG, i * 1000, "bench");
+        text_size += snprintf(text, sizeof(text), info_format, timestamp, TEST_TAG, i * 1000, "bench");
+        BinaryFixture::write(warn_format, timestamp, TEST_TAG, "192.168.1.1", 500u, i);
+        text_size += snprintf(text, sizeof(text), warn_format, timestamp, TEST_TAG, "192.168.1.1", 500u, i);
+    }
+    binary_size = BinaryFixture::output.size();
+    CHECK(std::count(BinaryFixture::output.begin(), BinaryFixture::output.end(), 0) == 2 * MESSAGES);
+
+    printf("binary log output: %zu bytes, text: %zu bytes (%.1fx smaller)\n",
+           binary_size, text_size, (double) text_size / binary_size);
+    // Each record takes about 16 bytes, see the notes in log_binary.c
+    CHECK(binary_size * 7 < text_size * 2);
+}
+
+static string s_round_trip_text;
+
+static int round_trip_vprintf(const char *format, va_list args)
+{
+    char text[256];
+    va_list args_copy;
+    va_copy(args_copy, args);
+    int len = vsnprintf(text, sizeof(text), format, args_copy);
+    va_end(args_copy);
+    s_round_trip_text.append(text, std::min<size_t>(len, sizeof(text) - 1));
+    return esp_log_binary_vprintf(format, args);
+}
+
+static void round_trip_write(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    round_trip_vprintf(format, args);
+    va_end(args);
+}
+
+/* Writes binary_log_output.bin and the text it should decode into,
+   binary_log_expected.txt, to the current directory.
+   test_log_binary.py runs this test and checks the output of log_binary.py.
+*/
+TEST_CASE("binary log output round trip", "[.][round_trip]")
+{
+    BinaryFixture fix;
+    s_round_trip_text.clear();
+
+    round_trip_write("plain line\n");
+    round_trip_write("%d %u %x %X %#x %o %#o %#o|\n", -123456, 4000000000u, 0xbeef, 0xbeef, 0, 8, 8, 0);
+    round_trip_write("[%5d] [%-5d] [%05d] [%+d] [% d] [%#10o] [%-#8o] [%08.3o]\n", 42, 42, -42, 7, 7, 8, 8, 8);
+    round_trip_write("%ld %lld %llu %zu %td %jd\n", -5L, -1LL << 40, ~0ULL, (size_t) 77, (ptrdiff_t) -3, (intmax_t) 9);
+    round_trip_write("%hhd %hhu %hd %hu %c%c\n", 300, 300, 70000, 70000, 'o', 'k');
+    round_trip_write("[%s] [%.3s] [%10s] [%-10s] [%s]\n", "dict", "abcdef", "r", "l", (const char *) nullptr);
+    char str[] = "inline \xc3\xa9 utf8";
+    round_trip_write("[%s] [%.*s] [%*d] [%-*d] [%*.*f]\n", str, 4, str, 6, 1, -6, 2, 8, 2, 3.14159);
+    round_trip_write("%f %.2f %e %g %10.3f %G %a\n", 1.5, 2.345, 12345.678, 0.0001, -3.5, 1e20, 1.0);
+    round_trip_write("%p %% done\n", (void *) 0x3fc80000);
+    char format[] = "text fallback %d\n";
+    round_trip_write(format, 5);
+    round_trip_write("mid\nnewline %d\n", 9);
+
+    vprintf_like_t old_vprintf = esp_log_set_vprintf(round_trip_vprintf);
+    ESP_LOGI(TEST_TAG, "log message %d %s", 3, "x");
+    ESP_LOGE(TEST_TAG, "error %s", str);
+    esp_log_set_vprintf(old_vprintf);
+
+    FILE *output = fopen("binary_log_output.bin", "wb");
+    REQUIRE(output != nullptr);
+    fwrite(BinaryFixture::output.data(), 1, BinaryFixture::output.size(), output);
+    fclose(output);
+    FILE *expected = fopen("binary_log_expected.txt", "wb");
+    REQUIRE(expected != nullptr);
+    fwrite(s_round_trip_text.data(), 1, s_round_trip_text.size(), expected);
+    fclose(expected);
+}
+#endif // CONFIG_LOG_BINARY_OUTPUT
+
+/* Counts the messages and formats them, like an output function which
+   doesn't need to wait for the UART would.
+*/
+struct CountFixture : BasicLogFixture {
+    CountFixture(esp_log_level_t log_level) : BasicLogFixture(log_level)
+    {
+        count = 0;
+        old_vprintf = esp_log_set_vprintf(count_callback);
+    }
+
+    ~CountFixture()
+    {
+        esp_log_set_vprintf(old_vprintf);
+    }
+
+    static size_t count;
+
+private:
+    static int count_callback(const char *format, va_list args)
+    {
+        char buffer[256];
+        ++count;
+        return vsnprintf(buffer, sizeof(buffer), format, args);
+    }
+
+    vprintf_like_t old_vprintf;
+};
+
+size_t CountFixture::count;
+
+static ESP_LOG_TAG_DEFINE(s_bench_tag_desc, "bench_desc");
+static const char *BENCH_TAG = "bench";
+
+/* Runs 'log_call' in batches, first timing whole batches (throughput),
+   then timing each call (latency). 'between_batches' runs outside of
+   the measurements.
+*/
+template<typename F, typename G>
+static void log_benchmark(const char *name, F log_call, G between_batches)
+{
+    using namespace std::chrono;
+    const int BATCHES = 50;
+    const int BATCH_SIZE = 1000;
+    vector<uint32_t> latencies;
+    latencies.reserve(BATCHES * BATCH_SIZE);
+    nanoseconds total(0);
+
+    for (int b = 0; b < BATCHES; b++) {
+        auto start = steady_clock::now();
+        for (int i = 0; i < BATCH_SIZE; i++) {
+            log_call(i);
+        }
+        total += duration_cast<nanoseconds>(steady_clock::now() - start);
+        between_batches();
+
+        for (int i = 0; i < BATCH_SIZE; i++) {
+            auto call_start = steady_clock::now();
+            log_call(i);
+            latencies.push_back(duration_cast<nanoseconds>(steady_clock::now() - call_start).count());
+        }
+        between_batches();
+    }
+
+    sort(latencies.begin(), latencies.end());
+    printf("%-36s %8.1f ns/call  p50 %6u ns  p99 %6u ns\n", name,
+           (double) total.count() / (BATCHES * BATCH_SIZE),
+           latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100]);
+}
+
+TEST_CASE("log throughput and latency")
+{
+    CountFixture fix(ESP_LOG_INFO);
+    auto nothing = [] { };
+
+    log_benchmark("disabled level, tag string", [](int i) {
+        ESP_LOGD(BENCH_TAG, "value %d", i);
+    }, nothing);
+    log_benchmark("disabled level, tag descriptor", [](int i) {
+        ESP_LOGD_TAG(&s_bench_tag_desc, "value %d", i);
+    }, nothing);
+    CHECK(CountFixture::count == 0);
+
+    log_benchmark("synchronous output, tag string", [](int i) {
+        ESP_LOGI(BENCH_TAG, "value %d name %s", i, "bench");
+    }, nothing);
+    log_benchmark("synchronous output, tag descriptor", [](int i) {
+        ESP_LOGI_TAG(&s_bench_tag_desc, "value %d name %s", i, "bench");
+    }, nothing);
+    CHECK(CountFixture::count == 2 * 2 * 50 * 1000);
+
+#if CONFIG_LOG_DEFERRED_OUTPUT
+    CountFixture::count = 0;
+    REQUIRE(esp_log_deferred_start(64 * 1024) == ESP_OK);
+    log_benchmark("deferred output, tag descriptor", [](int i) {
+        ESP_LOGI_TAG(&s_bench_tag_desc, "value %d name %s", i, "bench");
+    }, esp_log_deferred_flush);
+    esp_log_deferred_stop();
+    CHECK(CountFixture::count > 0);
+#endif // CONFIG_LOG_DEFERRED_OUTPUT
+}
+
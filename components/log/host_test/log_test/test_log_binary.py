@@ -0,0 +1,45 @@
+#!/usr/bin/env python
+# SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+#
+# Checks that log_binary.py decodes the binary log output of the host test back into the text
+# output. Build the host test (idf.py build) before running this.
+
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import unittest
+
+TEST_DIR = os.path.dirname(os.path.abspath(__file__))
+LOG_BINARY = os.path.join(TEST_DIR, '..', '..', 'log_binary.py')
+TEST_ELF = os.path.join(TEST_DIR, 'build', 'test_log_host.elf')
+
+
+class LogBinaryRoundTripTest(unittest.TestCase):
+    def setUp(self):  # type: () -> None
+        self.work_dir = tempfile.mkdtemp()
+
+    def tearDown(self):  # type: () -> None
+        shutil.rmtree(self.work_dir)
+
+    def test_round_trip(self):  # type: () -> None
+        # writes binary_log_output.bin and binary_log_expected.txt
+        subprocess.check_call([TEST_ELF, 'binary log output round trip'], cwd=self.work_dir)
+        dict_file = os.path.join(self.work_dir, 'log_dict.json')
+        decoded_file = os.path.join(self.work_dir, 'binary_log_decoded.txt')
+        subprocess.check_call([sys.executable, LOG_BINARY, 'dict', TEST_ELF, '-o', dict_file])
+        subprocess.check_call([sys.executable, LOG_BINARY, 'decode', '--dict', dict_file,
+                               os.path.join(self.work_dir, 'binary_log_output.bin'), '-o', decoded_file])
+
+        with open(os.path.join(self.work_dir, 'binary_log_expected.txt'), 'rb') as f:
+            expected = f.read()
+        with open(decoded_file, 'rb') as f:
+            decoded = f.read()
+        self.assertGreater(len(expected), 0)
+        self.assertEqual(expected.decode('utf-8'), decoded.decode('utf-8'))
+
+
+if __name__ == '__main__':
+    unittest.main()
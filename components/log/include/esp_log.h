@@ -8,6 +8,7 @@
 #define __ESP_LOG_H__
 
 #include <stdint.h>
+#include <stddef.h>
 #include <stdarg.h>
 #include "sdkconfig.h"
 #include "esp_rom_sys.h"
@@ -156,6 +157,136 @@ void esp_log_write(esp_log_level_t level, const char* tag, const char* format, .
  */
 void esp_log_writev(esp_log_level_t level, const char* tag, const char* format, va_list args);
 
+/** @cond */
+#define ESP_LOG_TAG_LEVEL_UNRESOLVED 0xff
+/** @endcond */
+
+/**
+ * @brief Log tag descriptor
+ *
+ * A tag descriptor holds the current log level of its tag, so that the
+ * ESP_LOGx_TAG macros check the level with a single atomic load, without
+ * taking the log lock and without looking the tag up in the tag cache.
+ *
+ * Descriptors are statically allocated with ESP_LOG_TAG_DEFINE and are linked
+ * into the log library the first time they are used. Afterwards their level
+ * follows esp_log_level_set() calls made for the descriptor name (or "*").
+ *
+ * Members are private, do not access them directly.
+ */
+typedef struct esp_log_tag {
+    const char *name;           /*!< Tag name, as used with esp_log_level_set() */
+    uint8_t level;              /*!< Level of the tag, ESP_LOG_TAG_LEVEL_UNRESOLVED until first use */
+    struct esp_log_tag *next;   /*!< Next descriptor linked into the log library */
+} esp_log_tag_t;
+
+/**
+ * @brief Define a log tag descriptor
+ *
+ * Usage: ``static ESP_LOG_TAG_DEFINE(s_log_tag, "my_module");``, then
+ * ``ESP_LOGI_TAG(&s_log_tag, "format", ...)``.
+ *
+ * @param var       name of the esp_log_tag_t variable to define
+ * @param tag_name  tag string, must stay valid for the lifetime of the application
+ */
+#define ESP_LOG_TAG_DEFINE(var, tag_name) esp_log_tag_t var = { (tag_name), ESP_LOG_TAG_LEVEL_UNRESOLVED, NULL }
+
+/**
+ * @brief Write message into the log using a tag descriptor
+ *
+ * This function is not intended to be used directly. Instead, use one of
+ * ESP_LOGE_TAG, ESP_LOGW_TAG, ESP_LOGI_TAG, ESP_LOGD_TAG, ESP_LOGV_TAG macros.
+ *
+ * This function or these macros should not be used from an interrupt.
+ */
+void esp_log_tag_write(esp_log_level_t level, esp_log_tag_t *tag, const char *format, ...) __attribute__ ((format (printf, 3, 4)));
+
+/**
+ * @brief Write message into the log using a tag descriptor, va_list variant
+ * @see esp_log_tag_write()
+ */
+void esp_log_tag_writev(esp_log_level_t level, esp_log_tag_t *tag, const char *format, va_list args);
+
+#if CONFIG_LOG_DEFERRED_OUTPUT || __DOXYGEN__
+#include "esp_err.h"
+
+/**
+ * @brief Start deferred log output
+ *
+ * In deferred mode, log calls don't format their message. They copy the format
+ * string pointer and the raw arguments (and the contents of string arguments)
+ * into a per-core buffer, and a low priority task renders the messages and
+ * passes them to the function set by esp_log_set_vprintf().
+ *
+ * Messages that don't fit into the buffer are dropped, and the number of dropped
+ * messages is reported in the log. Messages whose arguments need more than the
+ * per-message limit are written synchronously.
+ *
+ * @note Format strings must stay valid until the message is rendered,
+ *       which is always the case for string literals used with ESP_LOGx macros.
+ *
+ * @param buffer_size  size of the buffer of each core, in bytes, rounded down to a power of two.
+ *                     Buffers are allocated by the first call and kept afterwards,
+ *                     later calls ignore this argument.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if deferred output is already active
+ *      - ESP_ERR_INVALID_SIZE if buffer_size is too small
+ *      - ESP_ERR_NO_MEM if the buffers or the task can't be allocated
+ */
+esp_err_t esp_log_deferred_start(size_t buffer_size);
+
+/**
+ * @brief Stop deferred log output
+ *
+ * Outputs all pending messages, subsequent log calls output synchronously.
+ */
+void esp_log_deferred_stop(void);
+
+/**
+ * @brief Wait until all pending deferred messages are output
+ */
+void esp_log_deferred_flush(void);
+#endif // CONFIG_LOG_DEFERRED_OUTPUT || __DOXYGEN__
+
+#if CONFIG_LOG_BINARY_OUTPUT || __DOXYGEN__
+/**
+ * @brief Function which writes encoded binary log output
+ */
+typedef void (*esp_log_binary_write_t)(const void *data, size_t size);
+
+/**
+ * @brief Binary log output function
+ *
+ * Pass this function to esp_log_set_vprintf() to output logs as binary records
+ * instead of text. A record holds the offset of the format string in the read-only
+ * data of the application and the packed arguments, which takes several times less
+ * bandwidth and CPU time than formatting the message. Use ``log_binary.py decode``
+ * with the dictionary generated at build time (``build/log_dict.json``) or with
+ * the application ELF file to convert the output back into text.
+ *
+ * Messages whose format string isn't constant are output as text.
+ *
+ * @param format  printf format string
+ * @param args    arguments
+ *
+ * @return number of bytes written
+ */
+int esp_log_binary_vprintf(const char *format, va_list args);
+
+/**
+ * @brief Set function used to write binary log output
+ *
+ * By default, binary log output is written to stdout.
+ *
+ * @param func  new function used to write the output
+ *
+ * @return the previous function
+ */
+esp_log_binary_write_t esp_log_binary_set_write_func(esp_log_binary_write_t func);
+#endif // CONFIG_LOG_BINARY_OUTPUT || __DOXYGEN__
+
 /** @cond */
 
 #include "esp_log_internal.h"
@@ -445,6 +576,90 @@ void esp_log_writev(esp_log_level_t level, const char* tag, const char* format,
         if ( LOG_LOCAL_LEVEL >= level ) ESP_LOG_LEVEL(level, tag, format, ##__VA_ARGS__); \
     } while(0)
 
+/**
+ * @brief Check if a log level is enabled for a tag descriptor
+ *
+ * Can be used to avoid expensive computations only needed by a log statement.
+ *
+ * @param tag        pointer to the tag descriptor, see ``ESP_LOG_TAG_DEFINE``
+ * @param log_level  log level to check
+ */
+#define ESP_LOG_TAG_ENABLED(tag, log_level) \
+    (LOG_LOCAL_LEVEL >= (log_level) && (log_level) <= __atomic_load_n(&(tag)->level, __ATOMIC_RELAXED))
+
+/** @cond */
+#if CONFIG_LOG_TIMESTAMP_SOURCE_RTOS
+#define _ESP_LOG_TAG_FORMAT(letter, format)  LOG_FORMAT(letter, format)
+#define _ESP_LOG_TAG_TIMESTAMP()             esp_log_timestamp()
+#elif CONFIG_LOG_TIMESTAMP_SOURCE_SYSTEM
+#define _ESP_LOG_TAG_FORMAT(letter, format)  LOG_SYSTEM_TIME_FORMAT(letter, format)
+#define _ESP_LOG_TAG_TIMESTAMP()             esp_log_system_timestamp()
+#endif //CONFIG_LOG_TIMESTAMP_SOURCE_xxx
+
+#if defined(__cplusplus) && (__cplusplus >  201703L)
+#define ESP_LOG_TAG_IMPL(tag, format, log_level, log_tag_letter, ...) do {                           \
+        if (ESP_LOG_TAG_ENABLED(tag, log_level)) {                                                   \
+            esp_log_tag_write(log_level, tag, _ESP_LOG_TAG_FORMAT(log_tag_letter, format),           \
+                              _ESP_LOG_TAG_TIMESTAMP(), (tag)->name __VA_OPT__(,) __VA_ARGS__);      \
+        }} while(0)
+#else // !(defined(__cplusplus) && (__cplusplus >  201703L))
+#define ESP_LOG_TAG_IMPL(tag, format, log_level, log_tag_letter, ...) do {                           \
+        if (ESP_LOG_TAG_ENABLED(tag, log_level)) {                                                   \
+            esp_log_tag_write(log_level, tag, _ESP_LOG_TAG_FORMAT(log_tag_letter, format),           \
+                              _ESP_LOG_TAG_TIMESTAMP(), (tag)->name, ##__VA_ARGS__);                 \
+        }} while(0)
+#endif // !(defined(__cplusplus) && (__cplusplus >  201703L))
+/** @endcond */
+
+/**
+ * Macro to output logs at ESP_LOG_ERROR level, using a tag descriptor.
+ *
+ * Unlike ``ESP_LOGE``, a disabled level is rejected inline with a single atomic load of the tag level.
+ *
+ * @note This macro cannot be used when interrupts are disabled or inside an ISR.
+ *
+ * @param tag pointer to the tag descriptor defined with ``ESP_LOG_TAG_DEFINE``.
+ *
+ * @see ``ESP_LOGE``, ``printf``
+ */
+#ifndef BOOTLOADER_BUILD
+#if defined(__cplusplus) && (__cplusplus >  201703L)
+#define ESP_LOGE_TAG( tag, format, ... ) ESP_LOG_TAG_IMPL(tag, format, ESP_LOG_ERROR,   E __VA_OPT__(,) __VA_ARGS__)
+/// macro to output logs at ``ESP_LOG_WARN`` level using a tag descriptor.  @see ``ESP_LOGE_TAG``
+#define ESP_LOGW_TAG( tag, format, ... ) ESP_LOG_TAG_IMPL(tag, format, ESP_LOG_WARN,    W __VA_OPT__(,) __VA_ARGS__)
+/// macro to output logs at ``ESP_LOG_INFO`` level using a tag descriptor.  @see ``ESP_LOGE_TAG``
+#define ESP_LOGI_TAG( tag, format, ... ) ESP_LOG_TAG_IMPL(tag, format, ESP_LOG_INFO,    I __VA_OPT__(,) __VA_ARGS__)
+/// macro to output logs at ``ESP_LOG_DEBUG`` level using a tag descriptor.  @see ``ESP_LOGE_TAG``
+#define ESP_LOGD_TAG( tag, format, ... ) ESP_LOG_TAG_IMPL(tag, format, ESP_LOG_DEBUG,   D __VA_OPT__(,) __VA_ARGS__)
+/// macro to output logs at ``ESP_LOG_VERBOSE`` level using a tag descriptor.  @see ``ESP_LOGE_TAG``
+#define ESP_LOGV_TAG( tag, format, ... ) ESP_LOG_TAG_IMPL(tag, format, ESP_LOG_VERBOSE, V __VA_OPT__(,) __VA_ARGS__)
+#else // !(defined(__cplusplus) && (__cplusplus >  201703L))
+#define ESP_LOGE_TAG( tag, format, ... ) ESP_LOG_TAG_IMPL(tag, format, ESP_LOG_ERROR,   E, ##__VA_ARGS__)
+/// macro to output logs at ``ESP_LOG_WARN`` level using a tag descriptor.  @see ``ESP_LOGE_TAG``
+#define ESP_LOGW_TAG( tag, format, ... ) ESP_LOG_TAG_IMPL(tag, format, ESP_LOG_WARN,    W, ##__VA_ARGS__)
+/// macro to output logs at ``ESP_LOG_INFO`` level using a tag descriptor.  @see ``ESP_LOGE_TAG``
+#define ESP_LOGI_TAG( tag, format, ... ) ESP_LOG_TAG_IMPL(tag, format, ESP_LOG_INFO,    I, ##__VA_ARGS__)
+/// macro to output logs at ``ESP_LOG_DEBUG`` level using a tag descriptor.  @see ``ESP_LOGE_TAG``
+#define ESP_LOGD_TAG( tag, format, ... ) ESP_LOG_TAG_IMPL(tag, format, ESP_LOG_DEBUG,   D, ##__VA_ARGS__)
+/// macro to output logs at ``ESP_LOG_VERBOSE`` level using a tag descriptor.  @see ``ESP_LOGE_TAG``
+#define ESP_LOGV_TAG( tag, format, ... ) ESP_LOG_TAG_IMPL(tag, format, ESP_LOG_VERBOSE, V, ##__VA_ARGS__)
+#endif // !(defined(__cplusplus) && (__cplusplus >  201703L))
+#else
+#if defined(__cplusplus) && (__cplusplus >  201703L)
+#define ESP_LOGE_TAG( tag, format, ... ) ESP_EARLY_LOGE((tag)->name, format __VA_OPT__(,) __VA_ARGS__)
+#define ESP_LOGW_TAG( tag, format, ... ) ESP_EARLY_LOGW((tag)->name, format __VA_OPT__(,) __VA_ARGS__)
+#define ESP_LOGI_TAG( tag, format, ... ) ESP_EARLY_LOGI((tag)->name, format __VA_OPT__(,) __VA_ARGS__)
+#define ESP_LOGD_TAG( tag, format, ... ) ESP_EARLY_LOGD((tag)->name, format __VA_OPT__(,) __VA_ARGS__)
+#define ESP_LOGV_TAG( tag, format, ... ) ESP_EARLY_LOGV((tag)->name, format __VA_OPT__(,) __VA_ARGS__)
+#else // !(defined(__cplusplus) && (__cplusplus >  201703L))
+#define ESP_LOGE_TAG( tag, format, ... ) ESP_EARLY_LOGE((tag)->name, format, ##__VA_ARGS__)
+#define ESP_LOGW_TAG( tag, format, ... ) ESP_EARLY_LOGW((tag)->name, format, ##__VA_ARGS__)
+#define ESP_LOGI_TAG( tag, format, ... ) ESP_EARLY_LOGI((tag)->name, format, ##__VA_ARGS__)
+#define ESP_LOGD_TAG( tag, format, ... ) ESP_EARLY_LOGD((tag)->name, format, ##__VA_ARGS__)
+#define ESP_LOGV_TAG( tag, format, ... ) ESP_EARLY_LOGV((tag)->name, format, ##__VA_ARGS__)
+#endif // !(defined(__cplusplus) && (__cplusplus >  201703L))
+#endif  // BOOTLOADER_BUILD
+
 
 /**
  * @brief Macro to output logs when the cache is disabled. Log at ``ESP_LOG_ERROR`` level.
@@ -26,6 +26,14 @@
  * than 4 billion log entries, at which point wrap-around will not be
  * the biggest problem.
  *
+ * Tags defined with ESP_LOG_TAG_DEFINE bypass the cache: each descriptor
+ * stores the level of its tag, which the ESP_LOGx_TAG macros read with an
+ * atomic load. A descriptor starts out as ESP_LOG_TAG_LEVEL_UNRESOLVED; on
+ * first use its level is looked up under the lock and the descriptor is
+ * linked into s_log_tag_descs. esp_log_level_set walks that list (also under
+ * the lock) and stores the new level into matching descriptors, so readers
+ * never need the lock after the first message.
+ *
  */
 
 #include <stdbool.h>
@@ -68,6 +76,7 @@ static cached_tag_entry_t s_log_cache[TAG_CACHE_SIZE];
 static uint32_t s_log_cache_max_generation = 0;
 static uint32_t s_log_cache_entry_count = 0;
 static vprintf_like_t s_log_print_func = &vprintf;
+static esp_log_tag_t *s_log_tag_descs = NULL;
 
 #ifdef LOG_BUILTIN_CHECKS
 static uint32_t s_log_cache_misses = 0;
@@ -81,6 +90,8 @@ static void heap_bubble_down(int index);
 static inline void heap_swap(int i, int j);
 static inline bool should_output(esp_log_level_t level_for_message, esp_log_level_t level_for_tag);
 static inline void clear_log_level_list(void);
+static inline void set_tag_descs_level(const char *tag, esp_log_level_t level);
+static inline void log_output(const char *format, va_list args);
 
 vprintf_like_t esp_log_set_vprintf(vprintf_like_t func)
 {
@@ -99,6 +110,7 @@ void esp_log_level_set(const char *tag, esp_log_level_t level)
     if (strcmp(tag, "*") == 0) {
         esp_log_default_level = level;
         clear_log_level_list();
+        set_tag_descs_level(NULL, level);
         esp_log_impl_unlock();
         return;
     }
@@ -138,6 +150,7 @@ void esp_log_level_set(const char *tag, esp_log_level_t level)
             break;
         }
     }
+    set_tag_descs_level(tag, level);
     esp_log_impl_unlock();
 }
 
@@ -197,8 +210,7 @@ void esp_log_writev(esp_log_level_t level,
         return;
     }
 
-    (*s_log_print_func)(format, args);
-
+    log_output(format, args);
 }
 
 void esp_log_write(esp_log_level_t level,
@@ -211,6 +223,91 @@ void esp_log_write(esp_log_level_t level,
     va_end(list);
 }
 
+/* Looks up the level of a descriptor used for the first time and links
+   it into s_log_tag_descs. esp_log_impl_lock() should be held.
+*/
+static esp_log_level_t resolve_tag_desc(esp_log_tag_t *tag)
+{
+    uint8_t level = tag->level;
+    if (level == ESP_LOG_TAG_LEVEL_UNRESOLVED) {
+        esp_log_level_t level_for_tag;
+        if (!get_uncached_log_level(tag->name, &level_for_tag)) {
+            level_for_tag = esp_log_default_level;
+        }
+        level = (uint8_t) level_for_tag;
+        tag->next = s_log_tag_descs;
+        s_log_tag_descs = tag;
+        __atomic_store_n(&tag->level, level, __ATOMIC_RELAXED);
+    }
+    return (esp_log_level_t) level;
+}
+
+void esp_log_tag_writev(esp_log_level_t level,
+                        esp_log_tag_t *tag,
+                        const char *format,
+                        va_list args)
+{
+    esp_log_level_t level_for_tag = (esp_log_level_t) __atomic_load_n(&tag->level, __ATOMIC_RELAXED);
+    if (level_for_tag == (esp_log_level_t) ESP_LOG_TAG_LEVEL_UNRESOLVED) {
+        if (!esp_log_impl_lock_timeout()) {
+            return;
+        }
+        level_for_tag = resolve_tag_desc(tag);
+        esp_log_impl_unlock();
+    }
+    if (!should_output(level, level_for_tag)) {
+        return;
+    }
+
+    log_output(format, args);
+}
+
+void esp_log_tag_write(esp_log_level_t level,
+                       esp_log_tag_t *tag,
+                       const char *format, ...)
+{
+    va_list list;
+    va_start(list, format);
+    esp_log_tag_writev(level, tag, format, list);
+    va_end(list);
+}
+
+static int print_string(const char *format, ...)
+{
+    va_list list;
+    va_start(list, format);
+    int ret = (*s_log_print_func)(format, list);
+    va_end(list);
+    return ret;
+}
+
+void esp_log_output_string(const char *str)
+{
+    print_string("%s", str);
+}
+
+static inline void log_output(const char *format, va_list args)
+{
+#if CONFIG_LOG_DEFERRED_OUTPUT && !BOOTLOADER_BUILD
+    if (esp_log_deferred_capture(format, args)) {
+        return;
+    }
+#endif
+    (*s_log_print_func)(format, args);
+}
+
+/* Stores the level into all linked descriptors named 'tag', or into all
+   of them if 'tag' is NULL. esp_log_impl_lock() should be held.
+*/
+static inline void set_tag_descs_level(const char *tag, esp_log_level_t level)
+{
+    for (esp_log_tag_t *it = s_log_tag_descs; it != NULL; it = it->next) {
+        if (tag == NULL || strcmp(it->name, tag) == 0) {
+            __atomic_store_n(&it->level, (uint8_t) level, __ATOMIC_RELAXED);
+        }
+    }
+}
+
 static inline bool get_cached_log_level(const char *tag, esp_log_level_t *level)
 {
     // Look for `tag` in cache
@@ -0,0 +1,326 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Binary log output implementation notes.
+ *
+ * esp_log_binary_vprintf doesn't format messages. If the format string is
+ * located in the read-only data of the application, it writes a record
+ * holding the offset of the format string from the start of the read-only
+ * data, followed by the packed arguments:
+ *
+ * - integers as LEB128 varints, zigzag encoded for signed conversions
+ * - floating point values as 8 byte little endian doubles
+ * - strings as a varint V: if V is odd, the string is located in read-only
+ *   data at offset V >> 1, otherwise it is (V >> 1) - 1 bytes long and its
+ *   contents follow (V == 0 stands for a NULL string)
+ * - '*' widths and precisions as zigzag varints, before the value
+ *
+ * The offset of the format string and of the constant strings (such as log
+ * tags) is the id of that string in the dictionary which log_binary.py
+ * extracts from the ELF file at build time. The decoder parses the format
+ * string exactly like esp_log_parse_conv_spec does to know the argument types.
+ *
+ * A record is [type][varint format offset][arguments][CRC-8 of the previous
+ * bytes], COBS encoded and terminated by a zero byte, so it doesn't contain
+ * zeros otherwise and the decoder can resynchronize after lost data.
+ * Messages which can't be encoded (format string outside of read-only data,
+ * unsupported conversions, or too long) are written as plain text, which the
+ * decoder passes through.
+ *
+ * A typical ESP_LOGx record takes about 16 bytes: 4 bytes for the type, the
+ * CRC and the framing, 3 bytes each for the format string and the tag
+ * (offsets into read-only data of up to 1 MB), 3 bytes for the timestamp, and
+ * the other arguments. That is 3.5 to 4 times less than the text, and the
+ * fixed part keeps short messages from getting smaller. Shorter ids would
+ * need a separate table of the strings on the device.
+ */
+
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_log_private.h"
+
+// Maximum size of a record before COBS encoding, larger messages are written as text
+#define BINARY_RECORD_MAX       256
+// COBS adds one byte for each 254 bytes, plus one, plus the zero terminator
+#define BINARY_FRAME_MAX        (BINARY_RECORD_MAX + BINARY_RECORD_MAX / 254 + 2)
+#define BINARY_TEXT_MAX         256
+
+#define BINARY_RECORD_FORMAT    0xf1
+
+#if CONFIG_IDF_TARGET_LINUX
+// The dictionary covers everything from the end of the code to the start of writable data
+extern const char etext[];
+extern const char __data_start[];
+#define DICT_START  etext
+#define DICT_END    __data_start
+#else
+extern const char _rodata_start[];
+extern const char _rodata_end[];
+#define DICT_START  _rodata_start
+#define DICT_END    _rodata_end
+#endif
+
+static void write_stdout(const void *data, size_t size)
+{
+    fwrite(data, 1, size, stdout);
+}
+
+static esp_log_binary_write_t s_binary_write = &write_stdout;
+
+esp_log_binary_write_t esp_log_binary_set_write_func(esp_log_binary_write_t func)
+{
+    esp_log_binary_write_t orig_func = s_binary_write;
+    s_binary_write = func;
+    return orig_func;
+}
+
+static inline bool in_dictionary(const char *str)
+{
+    return str >= DICT_START && str < DICT_END;
+}
+
+static inline uint8_t *put_varint(uint8_t *pos, uint8_t *end, uint64_t value)
+{
+    while (pos < end) {
+        if (value < 0x80) {
+            *pos++ = (uint8_t) value;
+            return pos;
+        }
+        *pos++ = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    return NULL;
+}
+
+static inline uint8_t *put_zigzag(uint8_t *pos, uint8_t *end, int64_t value)
+{
+    return put_varint(pos, end, ((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+}
+
+static uint8_t *put_double(uint8_t *pos, uint8_t *end, double value)
+{
+    if (end - pos < (ptrdiff_t) sizeof(value)) {
+        return NULL;
+    }
+    // both the targets and the hosts this runs on are little endian
+    memcpy(pos, &value, sizeof(value));
+    return pos + sizeof(value);
+}
+
+static uint8_t *put_string(uint8_t *pos, uint8_t *end, const char *str, int precision)
+{
+    if (str == NULL) {
+        return put_varint(pos, end, 0);
+    }
+    if (in_dictionary(str)) {
+        return put_varint(pos, end, ((uint64_t) (str - DICT_START) << 1) | 1);
+    }
+    size_t room = end - pos;
+    size_t len = (precision >= 0 && (size_t) precision <= room) ? strnlen(str, precision) : strnlen(str, room);
+    pos = put_varint(pos, end, ((uint64_t) len + 1) << 1);
+    if (pos == NULL || (size_t) (end - pos) < len) {
+        return NULL;
+    }
+    memcpy(pos, str, len);
+    return pos + len;
+}
+
+/* Reads an integer argument, as the printf conversion in 'spec' would
+   interpret it, and packs it.
+*/
+static uint8_t *put_integer(uint8_t *pos, uint8_t *end, const esp_log_conv_spec_t *spec, va_list *args)
+{
+    bool is_signed = spec->conversion == 'd' || spec->conversion == 'i';
+    int64_t svalue;
+    uint64_t uvalue;
+    switch (spec->type) {
+    case ESP_LOG_ARG_INT: {
+        int value = va_arg(*args, int);
+        if (spec->conversion == 'c' || spec->length == 'H') {
+            svalue = (signed char) value;
+            uvalue = (unsigned char) value;
+        } else if (spec->length == 'h') {
+            svalue = (short) value;
+            uvalue = (unsigned short) value;
+        } else {
+            svalue = value;
+            uvalue = (unsigned int) value;
+        }
+        break;
+    }
+    case ESP_LOG_ARG_LONG: {
+        long value = va_arg(*args, long);
+        svalue = value;
+        uvalue = (unsigned long) value;
+        break;
+    }
+    case ESP_LOG_ARG_LLONG: {
+        long long value = va_arg(*args, long long);
+        svalue = value;
+        uvalue = (unsigned long long) value;
+        break;
+    }
+    case ESP_LOG_ARG_INTMAX: {
+        intmax_t value = va_arg(*args, intmax_t);
+        svalue = value;
+        uvalue = (uintmax_t) value;
+        break;
+    }
+    case ESP_LOG_ARG_SIZE:
+    case ESP_LOG_ARG_PTRDIFF: {
+        // size_t and ptrdiff_t have the same width
+        ptrdiff_t value = va_arg(*args, ptrdiff_t);
+        svalue = value;
+        uvalue = (size_t) value;
+        break;
+    }
+    default:
+        return NULL;
+    }
+    return is_signed ? put_zigzag(pos, end, svalue) : put_varint(pos, end, uvalue);
+}
+
+/* Packs the arguments described by 'format' into 'pos'.
+   Returns the end of the packed arguments, or NULL if they don't fit
+   or if the format uses a conversion which can't be packed.
+*/
+static uint8_t *encode_args(uint8_t *pos, uint8_t *end, const char *format, va_list *args)
+{
+    esp_log_conv_spec_t spec;
+    for (const char *p = strchr(format, '%'); p != NULL && pos != NULL; p = strchr(spec.end, '%')) {
+        esp_log_parse_conv_spec(p + 1, &spec);
+        int precision = spec.precision;
+        if (spec.star_width) {
+            pos = put_zigzag(pos, end, va_arg(*args, int));
+        }
+        if (spec.star_precision) {
+            precision = va_arg(*args, int);
+            pos = pos ? put_zigzag(pos, end, precision) : NULL;
+        }
+        if (pos == NULL) {
+            return NULL;
+        }
+        switch (spec.type) {
+        case ESP_LOG_ARG_NONE:
+            break;
+        case ESP_LOG_ARG_COUNT:
+            (void) va_arg(*args, void *);
+            break;
+        case ESP_LOG_ARG_DOUBLE:
+            pos = put_double(pos, end, va_arg(*args, double));
+            break;
+        case ESP_LOG_ARG_LDOUBLE:
+            pos = put_double(pos, end, (double) va_arg(*args, long double));
+            break;
+        case ESP_LOG_ARG_PTR:
+            pos = put_varint(pos, end, (uintptr_t) va_arg(*args, void *));
+            break;
+        case ESP_LOG_ARG_STR:
+            pos = put_string(pos, end, va_arg(*args, const char *), precision);
+            break;
+        case ESP_LOG_ARG_INVALID:
+            return NULL;
+        default:
+            pos = put_integer(pos, end, &spec, args);
+            break;
+        }
+    }
+    return pos;
+}
+
+static uint8_t crc8(const uint8_t *data, size_t len)
+{
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80) ? (uint8_t) ((crc << 1) ^ 0x07) : (uint8_t) (crc << 1);
+        }
+    }
+    return crc;
+}
+
+/* COBS encodes 'len' bytes of 'src' into 'dst' and appends the zero terminator.
+   Returns the number of bytes written.
+*/
+static size_t frame_encode(const uint8_t *src, size_t len, uint8_t *dst)
+{
+    size_t code_pos = 0;
+    size_t out = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < len; ++i) {
+        if (src[i] != 0) {
+            dst[out++] = src[i];
+            ++code;
+        }
+        if (src[i] == 0 || code == 0xff) {
+            dst[code_pos] = code;
+            code_pos = out++;
+            code = 1;
+        }
+    }
+    dst[code_pos] = code;
+    dst[out++] = 0;
+    return out;
+}
+
+static int write_text(const char *format, va_list args)
+{
+    char text[BINARY_TEXT_MAX];
+    va_list args_copy;
+    va_copy(args_copy, args);
+    int len = vsnprintf(text, sizeof(text), format, args_copy);
+    va_end(args_copy);
+    if (len < 0) {
+        return len;
+    }
+    if ((size_t) len < sizeof(text)) {
+        (*s_binary_write)(text, len);
+        return len;
+    }
+    char *long_text = malloc(len + 1);
+    if (long_text == NULL) {
+        (*s_binary_write)(text, sizeof(text) - 1);
+        return sizeof(text) - 1;
+    }
+    vsnprintf(long_text, len + 1, format, args);
+    (*s_binary_write)(long_text, len);
+    free(long_text);
+    return len;
+}
+
+int esp_log_binary_vprintf(const char *format, va_list args)
+{
+    if (!in_dictionary(format)) {
+        return write_text(format, args);
+    }
+
+    uint8_t record[BINARY_RECORD_MAX];
+    uint8_t *end = record + sizeof(record) - 1;  // room for the CRC
+    record[0] = BINARY_RECORD_FORMAT;
+    uint8_t *pos = put_varint(record + 1, end, (uint64_t) (format - DICT_START));
+    va_list args_copy;
+    va_copy(args_copy, args);
+    pos = pos ? encode_args(pos, end, format, &args_copy) : NULL;
+    va_end(args_copy);
+    if (pos == NULL) {
+        return write_text(format, args);
+    }
+    *pos = crc8(record, pos - record);
+    ++pos;
+
+    uint8_t frame[BINARY_FRAME_MAX];
+    size_t len = frame_encode(record, pos - record, frame);
+    (*s_binary_write)(frame, len);
+    return len;
+}
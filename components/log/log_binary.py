@@ -0,0 +1,336 @@
+#!/usr/bin/env python
+# SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+#
+# Binary log output tool
+#
+# 'dict' extracts the dictionary of constant strings from the application ELF file,
+# 'decode' converts the output of esp_log_binary_vprintf() back into text.
+# See log_binary.c for the description of the format.
+
+import argparse
+import bisect
+import json
+import re
+import struct
+import sys
+from typing import Any, BinaryIO, Dict, Iterator, Optional
+
+DICT_VERSION = 1
+RECORD_FORMAT = 0xf1
+
+# Start and end of the read-only data, on the targets and on Linux
+DICT_SYMBOLS = [('_rodata_start', '_rodata_end'), ('etext', '__data_start')]
+
+# Conversion specification, parsed like esp_log_parse_conv_spec() does
+CONV_SPEC_RE = re.compile(rb'%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|j|z|t|L)?(.)', re.DOTALL)
+
+ALLOWED_CONTROL_CHARS = b'\t\n\r\x1b'
+
+
+class DecodeError(Exception):
+    pass
+
+
+def is_dict_string(data: bytes) -> bool:
+    if not data:
+        return False
+    if any(c < 0x20 and c not in ALLOWED_CONTROL_CHARS or c == 0x7f for c in data):
+        return False
+    try:
+        data.decode('utf-8')
+    except UnicodeDecodeError:
+        return False
+    return True
+
+
+def generate_dict(elf_file: BinaryIO) -> Dict:
+    from elftools.elf.constants import SH_FLAGS
+    from elftools.elf.elffile import ELFFile
+    from elftools.elf.sections import SymbolTableSection
+
+    elf = ELFFile(elf_file)
+    symtab = elf.get_section_by_name('.symtab')
+    if not isinstance(symtab, SymbolTableSection):
+        raise RuntimeError('ELF file has no symbol table')
+
+    for start_name, end_name in DICT_SYMBOLS:
+        start_syms = symtab.get_symbol_by_name(start_name)
+        end_syms = symtab.get_symbol_by_name(end_name)
+        if start_syms and end_syms:
+            base = start_syms[0]['st_value']
+            end = end_syms[0]['st_value']
+            break
+    else:
+        raise RuntimeError('ELF file has no {} symbol'.format(' or '.join(s for s, _ in DICT_SYMBOLS)))
+
+    strings = {}
+    for section in elf.iter_sections():
+        flags = section['sh_flags']
+        if section['sh_type'] != 'SHT_PROGBITS' or not flags & SH_FLAGS.SHF_ALLOC:
+            continue
+        if flags & (SH_FLAGS.SHF_WRITE | SH_FLAGS.SHF_EXECINSTR):
+            continue
+        addr = section['sh_addr']
+        if addr + section['sh_size'] <= base or addr >= end:
+            continue
+        data = section.data()
+        pos = 0
+        for chunk in data.split(b'\0'):
+            offset = addr + pos - base
+            if 0 <= offset < end - base and is_dict_string(chunk):
+                strings[offset] = chunk.decode('utf-8')
+            pos += len(chunk) + 1
+
+    return {'version': DICT_VERSION, 'base_symbol': start_name, 'strings': strings}
+
+
+class Dictionary:
+    def __init__(self, strings: Dict[int, str]) -> None:
+        self.offsets = sorted(strings)
+        self.strings = [strings[o].encode('utf-8') for o in self.offsets]
+
+    def lookup(self, offset: int) -> bytes:
+        """ Returns the string at 'offset', which may point into the middle of a dictionary string """
+        i = bisect.bisect_right(self.offsets, offset) - 1
+        if i >= 0 and offset - self.offsets[i] <= len(self.strings[i]):
+            return self.strings[i][offset - self.offsets[i]:]
+        raise DecodeError('no string at offset 0x{:x}'.format(offset))
+
+    @classmethod
+    def load(cls, dict_file: str) -> 'Dictionary':
+        with open(dict_file, 'r') as f:
+            data = json.load(f)
+        if data.get('version') != DICT_VERSION:
+            raise RuntimeError('{}: unsupported dictionary version'.format(dict_file))
+        return cls({int(k): v for k, v in data['strings'].items()})
+
+    @classmethod
+    def from_elf(cls, elf_file: str) -> 'Dictionary':
+        with open(elf_file, 'rb') as f:
+            return cls(generate_dict(f)['strings'])
+
+
+def cobs_decode(data: bytes) -> bytes:
+    out = bytearray()
+    pos = 0
+    while pos < len(data):
+        code = data[pos]
+        if code == 0 or pos + code > len(data):
+            raise DecodeError('invalid COBS frame')
+        out += data[pos + 1:pos + code]
+        pos += code
+        if code < 0xff and pos < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def crc8(data: bytes) -> int:
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xff if crc & 0x80 else (crc << 1) & 0xff
+    return crc
+
+
+class Record:
+    def __init__(self, data: bytes) -> None:
+        self.data = data
+        self.pos = 0
+
+    def varint(self) -> int:
+        value = 0
+        shift = 0
+        while True:
+            if self.pos >= len(self.data):
+                raise DecodeError('truncated record')
+            byte = self.data[self.pos]
+            self.pos += 1
+            value |= (byte & 0x7f) << shift
+            shift += 7
+            if not byte & 0x80:
+                return value
+
+    def zigzag(self) -> int:
+        value = self.varint()
+        return (value >> 1) ^ -(value & 1)
+
+    def double(self) -> float:
+        if self.pos + 8 > len(self.data):
+            raise DecodeError('truncated record')
+        value = struct.unpack_from('<d', self.data, self.pos)[0]
+        self.pos += 8
+        return value
+
+    def raw(self, size: int) -> bytes:
+        if self.pos + size > len(self.data):
+            raise DecodeError('truncated record')
+        value = self.data[self.pos:self.pos + size]
+        self.pos += size
+        return value
+
+
+def format_conv(flags: str, width: Optional[int], precision: Optional[int], conversion: str, value: Any) -> str:
+    if width is not None and width < 0:
+        flags += '-'
+        width = -width
+    if precision is not None and precision < 0:
+        precision = None
+    if conversion in 'aA':
+        # C omits the trailing zeros of the mantissa
+        text = re.sub(r'\.?0*p', 'p', float.hex(value))
+        text = text.upper() if conversion == 'A' else text
+        return text.rjust(width or 0) if '-' not in flags else text.ljust(width or 0)
+    if conversion == 'o' and '#' in flags:
+        # C prints a leading zero, Python prints '0o'
+        text = ('%' + ('.' + str(precision) if precision is not None else '') + 'o') % value
+        text = text if text.startswith('0') else '0' + text
+        if '-' in flags:
+            return text.ljust(width or 0)
+        return text.rjust(width or 0, '0' if '0' in flags and precision is None else ' ')
+    if precision is not None and conversion in 'diuoxX':
+        # C ignores the '0' flag of integer conversions with a precision
+        flags = flags.replace('0', '')
+    if conversion == 'p':
+        text = '0x%x' % value
+        return text.rjust(width or 0) if '-' not in flags else text.ljust(width or 0)
+    if conversion in 'xX' and value == 0:
+        # C doesn't print the '0x' prefix for zero
+        flags = flags.replace('#', '')
+    elif conversion == 'u':
+        conversion = 'd'
+    elif conversion == 'c':
+        value = chr(value) if value < 0x80 else chr(0xdc00 + value)  # keep raw bytes, see render()
+    spec = '%' + flags
+    if width is not None:
+        spec += str(width)
+    if precision is not None:
+        spec += '.' + str(precision)
+    return (spec + conversion) % value
+
+
+def render(fmt: bytes, record: Record, dictionary: Dictionary) -> bytes:
+    """ Formats the arguments packed in 'record' as the printf format 'fmt' would """
+    out = []
+    pos = 0
+    for m in CONV_SPEC_RE.finditer(fmt):
+        out.append(fmt[pos:m.start()].decode('utf-8', 'surrogateescape'))
+        pos = m.end()
+        flags = m.group(1).decode()
+        width_str = m.group(2)
+        precision_str = m.group(3)
+        length = m.group(4)
+        conversion = m.group(5).decode('latin-1')
+
+        width = None  # type: Optional[int]
+        precision = None  # type: Optional[int]
+        if width_str == b'*':
+            width = record.zigzag()
+        elif width_str:
+            width = int(width_str)
+        if precision_str == b'*':
+            precision = record.zigzag()
+        elif precision_str is not None:
+            precision = int(precision_str or b'0')
+
+        if conversion == '%':
+            out.append('%')
+        elif conversion == 'n':
+            pass
+        elif conversion in 'di':
+            out.append(format_conv(flags, width, precision, conversion, record.zigzag()))
+        elif conversion in 'uoxXc':
+            if conversion == 'c' and length:
+                raise DecodeError('invalid conversion')
+            out.append(format_conv(flags, width, precision, conversion, record.varint()))
+        elif conversion in 'fFeEgGaA':
+            out.append(format_conv(flags, width, precision, conversion, record.double()))
+        elif conversion == 'p':
+            out.append(format_conv(flags, width, None, 'p', record.varint()))
+        elif conversion == 's' and not length:
+            value = record.varint()
+            if value == 0:
+                text = '(null)'
+            elif value & 1:
+                text = dictionary.lookup(value >> 1).decode('utf-8', 'surrogateescape')
+            else:
+                text = record.raw((value >> 1) - 1).decode('utf-8', 'surrogateescape')
+            out.append(format_conv(flags, width, precision, 's', text))
+        else:
+            raise DecodeError('invalid conversion')
+    out.append(fmt[pos:].decode('utf-8', 'surrogateescape'))
+    if record.pos != len(record.data):
+        raise DecodeError('unexpected data after the arguments')
+    return ''.join(out).encode('utf-8', 'surrogateescape')
+
+
+def decode_frame(frame: bytes, dictionary: Dictionary) -> bytes:
+    data = cobs_decode(frame)
+    if len(data) < 3 or data[0] != RECORD_FORMAT or crc8(data[:-1]) != data[-1]:
+        raise DecodeError('invalid record')
+    record = Record(data[:-1])
+    record.pos = 1
+    fmt = dictionary.lookup(record.varint())
+    return render(fmt, record, dictionary)
+
+
+def decode_chunk(chunk: bytes, dictionary: Dictionary) -> bytes:
+    """ Decodes the data preceding a zero byte: a frame, possibly preceded by text output """
+    starts = [0] + [m.end() for m in re.finditer(b'\n', chunk)]
+    for start in starts:
+        try:
+            return chunk[:start] + decode_frame(chunk[start:], dictionary)
+        except DecodeError:
+            pass
+    return chunk
+
+
+def decode_stream(stream: BinaryIO, dictionary: Dictionary) -> Iterator[bytes]:
+    pending = b''
+    while True:
+        data = stream.read1(4096) if hasattr(stream, 'read1') else stream.read(4096)  # type: ignore
+        if not data:
+            break
+        chunks = (pending + data).split(b'\0')
+        pending = chunks.pop()
+        for chunk in chunks:
+            yield decode_chunk(chunk, dictionary)
+    if pending:
+        yield pending
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description='ESP-IDF binary log output tool')
+    subparsers = parser.add_subparsers(dest='command')
+    subparsers.required = True
+
+    dict_parser = subparsers.add_parser('dict', help='Generate the string dictionary from the application ELF file')
+    dict_parser.add_argument('elf', help='Application ELF file')
+    dict_parser.add_argument('-o', '--output', required=True, help='Output dictionary file (JSON)')
+
+    decode_parser = subparsers.add_parser('decode', help='Convert binary log output into text')
+    source = decode_parser.add_mutually_exclusive_group(required=True)
+    source.add_argument('--dict', help='Dictionary file generated by the "dict" command')
+    source.add_argument('--elf', help='Application ELF file')
+    decode_parser.add_argument('input', nargs='?', type=argparse.FileType('rb'), default=sys.stdin.buffer,
+                               help='Binary log output, stdin if omitted')
+    decode_parser.add_argument('-o', '--output', type=argparse.FileType('wb'), default=sys.stdout.buffer,
+                               help='Output file, stdout if omitted')
+
+    args = parser.parse_args()
+
+    if args.command == 'dict':
+        with open(args.elf, 'rb') as f:
+            strings = generate_dict(f)
+        with open(args.output, 'w') as f:
+            json.dump(strings, f, indent=0, sort_keys=True)
+    else:
+        dictionary = Dictionary.load(args.dict) if args.dict else Dictionary.from_elf(args.elf)
+        for text in decode_stream(args.input, dictionary):
+            args.output.write(text)
+            args.output.flush()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,430 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Deferred log output implementation notes.
+ *
+ * In deferred mode a log call doesn't format its message. It walks the
+ * format string only far enough to know the type of every argument, and
+ * copies the format pointer followed by the raw argument values directly
+ * into the buffer of the core it runs on. String arguments are copied by
+ * value, as they don't have to outlive the call. The rendering task walks the same
+ * format string later, formats each conversion with snprintf and passes the
+ * text to the function set by esp_log_set_vprintf.
+ *
+ * Each buffer has one consumer at a time (whoever owns s_rendering), and
+ * its producers are the tasks of one core, which esp_log_impl_deferred_enter
+ * serializes by masking interrupts on that core only. So the buffers need no
+ * lock: the producer publishes a message by advancing 'head' and the consumer
+ * releases space by advancing 'tail'. Both are free running counters, the
+ * buffer size is a power of two. The arguments are copied straight into the
+ * buffer while interrupts are masked, which avoids a message sized buffer on
+ * the stack of every logging task and interrupt handler.
+ *
+ * Messages are 4-byte aligned and start with their length. A message which
+ * doesn't fit before the end of the buffer is preceded by a zero length word,
+ * telling the consumer to continue at the start of the buffer. The length
+ * is only known once the arguments are copied, so a message which turns out
+ * not to fit before the end of the buffer is copied once more at the start.
+ *
+ * Buffers are never freed, as a producer which saw deferred mode active may
+ * still be writing into them after esp_log_deferred_stop returns.
+ */
+
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_log_private.h"
+
+// Maximum size of a message, including its header. Messages which need more are output synchronously.
+#define DEFERRED_MSG_MAX        256
+// Length stored for a NULL string argument
+#define DEFERRED_STR_NULL       0xffff
+// Size of the buffer used to render messages, longer output is passed to the output function in pieces
+#define DEFERRED_LINE_SIZE      256
+// Maximum length of a single conversion specification, e.g. "%-08.3lld"
+#define DEFERRED_SPEC_MAX       32
+
+#define DEFERRED_MSG_HEADER     (sizeof(uint32_t) + sizeof(const char *))
+#define DEFERRED_ALIGN(n)       (((n) + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1))
+
+typedef struct {
+    uint8_t *buf;
+    uint32_t mask;
+    atomic_uint_least32_t head;
+    atomic_uint_least32_t tail;
+} log_buffer_t;
+
+static log_buffer_t *s_buffers;
+static unsigned s_buffer_count;
+static atomic_bool s_active;
+static atomic_uint s_dropped;
+static atomic_flag s_rendering = ATOMIC_FLAG_INIT;
+// Accessed only by the owner of s_rendering
+static char s_line[DEFERRED_LINE_SIZE];
+static size_t s_line_len;
+
+#define ENCODE_ARG(type) do {                       \
+        type value = va_arg(args, type);            \
+        if (len + sizeof(value) <= room) {          \
+            memcpy(buf + len, &value, sizeof(value)); \
+        }                                           \
+        len += sizeof(value);                       \
+    } while (0)
+
+/* Copies the message header and the arguments described by 'format' to
+   'buf', as far as they fit into 'room' bytes.
+   Returns the aligned length of the message, which is larger than 'room'
+   if it didn't fit (possibly not the full length if it is also larger than
+   DEFERRED_MSG_MAX), or 0 if the format uses a conversion which can't be
+   deferred.
+*/
+static size_t encode_message(uint8_t *buf, size_t room, const char *format, va_list args)
+{
+    size_t len = DEFERRED_MSG_HEADER;
+    if (room >= DEFERRED_MSG_HEADER) {
+        memcpy(buf + sizeof(uint32_t), &format, sizeof(format));
+    }
+    esp_log_conv_spec_t spec;
+    for (const char *p = strchr(format, '%'); p != NULL && len <= DEFERRED_MSG_MAX; p = strchr(spec.end, '%')) {
+        esp_log_parse_conv_spec(p + 1, &spec);
+        int precision = spec.precision;
+        if (spec.star_width) {
+            ENCODE_ARG(int);
+        }
+        if (spec.star_precision) {
+            precision = va_arg(args, int);
+            if (len + sizeof(precision) <= room) {
+                memcpy(buf + len, &precision, sizeof(precision));
+            }
+            len += sizeof(precision);
+        }
+        switch (spec.type) {
+        case ESP_LOG_ARG_NONE: break;
+        case ESP_LOG_ARG_COUNT: (void) va_arg(args, void *); break;
+        case ESP_LOG_ARG_INT: ENCODE_ARG(int); break;
+        case ESP_LOG_ARG_LONG: ENCODE_ARG(long); break;
+        case ESP_LOG_ARG_LLONG: ENCODE_ARG(long long); break;
+        case ESP_LOG_ARG_INTMAX: ENCODE_ARG(intmax_t); break;
+        case ESP_LOG_ARG_SIZE: ENCODE_ARG(size_t); break;
+        case ESP_LOG_ARG_PTRDIFF: ENCODE_ARG(ptrdiff_t); break;
+        case ESP_LOG_ARG_DOUBLE: ENCODE_ARG(double); break;
+        case ESP_LOG_ARG_LDOUBLE: ENCODE_ARG(long double); break;
+        case ESP_LOG_ARG_PTR: ENCODE_ARG(void *); break;
+        case ESP_LOG_ARG_STR: {
+            const char *str = va_arg(args, const char *);
+            uint16_t str_len = DEFERRED_STR_NULL;
+            size_t copy_len = 0;
+            if (str != NULL) {
+                // a string which doesn't fit is never truncated, the message is output synchronously instead
+                size_t max_len = (precision >= 0 && precision < DEFERRED_MSG_MAX) ? precision : DEFERRED_MSG_MAX;
+                str_len = copy_len = strnlen(str, max_len);
+            }
+            if (len + sizeof(str_len) + copy_len <= room) {
+                memcpy(buf + len, &str_len, sizeof(str_len));
+                memcpy(buf + len + sizeof(str_len), str, copy_len);
+            }
+            len += sizeof(str_len) + copy_len;
+            break;
+        }
+        default:
+            return 0;
+        }
+    }
+    len = DEFERRED_ALIGN(len);
+    if (len <= room) {
+        memcpy(buf, &len, sizeof(uint32_t));
+    }
+    return len;
+}
+
+typedef enum {
+    DEFERRED_WRITTEN,
+    DEFERRED_FULL,          // no room in the buffer, the message is dropped
+    DEFERRED_SYNCHRONOUS,   // longer than DEFERRED_MSG_MAX or not deferrable, the caller outputs it
+} deferred_write_t;
+
+static deferred_write_t buffer_write(log_buffer_t *buffer, const char *format, va_list args, bool *notify)
+{
+    uint32_t size = buffer->mask + 1;
+    uint32_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&buffer->tail, memory_order_acquire);
+    uint32_t used = head - tail;
+    uint32_t pos = head & buffer->mask;
+    // the message is encoded in place, nothing is visible to the consumer before 'head' moves
+    va_list args_copy;
+    va_copy(args_copy, args);
+    size_t len = encode_message(buffer->buf + pos, MIN(size - used, size - pos), format, args_copy);
+    va_end(args_copy);
+    if (len == 0 || len > DEFERRED_MSG_MAX) {
+        return DEFERRED_SYNCHRONOUS;
+    }
+    uint32_t skip = 0;
+    if (len > size - pos) {
+        // skip the end of the buffer and encode the message again at the start
+        skip = size - pos;
+        if (size - used < skip + len) {
+            return DEFERRED_FULL;
+        }
+        memset(buffer->buf + pos, 0, sizeof(uint32_t));
+        va_copy(args_copy, args);
+        encode_message(buffer->buf, len, format, args_copy);
+        va_end(args_copy);
+    } else if (len > size - used) {
+        return DEFERRED_FULL;
+    }
+    atomic_store_explicit(&buffer->head, head + skip + len, memory_order_release);
+    // wake the rendering task up early when the buffer becomes half full
+    *notify = used < size / 2 && used + skip + len >= size / 2;
+    return DEFERRED_WRITTEN;
+}
+
+bool esp_log_deferred_capture(const char *format, va_list args)
+{
+    if (!atomic_load_explicit(&s_active, memory_order_acquire)) {
+        return false;
+    }
+
+    uint32_t state;
+    bool notify = false;
+    unsigned index = esp_log_impl_deferred_enter(&state);
+    deferred_write_t result = buffer_write(&s_buffers[index], format, args, &notify);
+    esp_log_impl_deferred_exit(state);
+
+    if (result == DEFERRED_SYNCHRONOUS) {
+        // let the caller output this one synchronously
+        return false;
+    }
+    if (result == DEFERRED_FULL) {
+        atomic_fetch_add_explicit(&s_dropped, 1, memory_order_relaxed);
+    } else if (notify) {
+        esp_log_impl_deferred_task_notify();
+    }
+    return true;
+}
+
+static void line_flush(void)
+{
+    if (s_line_len != 0) {
+        s_line[s_line_len] = '\0';
+        esp_log_output_string(s_line);
+        s_line_len = 0;
+    }
+}
+
+static void line_append(const char *str, size_t len)
+{
+    while (len != 0) {
+        size_t room = sizeof(s_line) - 1 - s_line_len;
+        if (room == 0) {
+            line_flush();
+            continue;
+        }
+        size_t chunk = (len < room) ? len : room;
+        memcpy(s_line + s_line_len, str, chunk);
+        s_line_len += chunk;
+        str += chunk;
+        len -= chunk;
+    }
+}
+
+/* Formats one value into the line buffer. If it doesn't fit, the line
+   is flushed first; a value longer than the whole buffer is truncated.
+*/
+#define RENDER_ARG(type, value_expr) do {                                               \
+        type value = value_expr;                                                        \
+        for (;;) {                                                                      \
+            size_t room = sizeof(s_line) - s_line_len;                                  \
+            int n = snprintf(s_line + s_line_len, room, spec_format, value);            \
+            if (n < 0) {                                                                \
+                break;                                                                  \
+            }                                                                           \
+            if ((size_t) n < room || s_line_len == 0) {                                 \
+                s_line_len += ((size_t) n < room) ? (size_t) n : room - 1;              \
+                break;                                                                  \
+            }                                                                           \
+            line_flush();                                                               \
+        }                                                                               \
+    } while (0)
+
+#define DECODE_ARG(type) ({ type _v; memcpy(&_v, pos, sizeof(_v)); pos += sizeof(_v); _v; })
+
+static void render_message(const uint8_t *msg)
+{
+    const char *format;
+    memcpy(&format, msg + sizeof(uint32_t), sizeof(format));
+    const uint8_t *pos = msg + DEFERRED_MSG_HEADER;
+
+    esp_log_conv_spec_t spec;
+    const char *p = format;
+    for (const char *next = strchr(p, '%'); next != NULL; next = strchr(p, '%')) {
+        line_append(p, next - p);
+        esp_log_parse_conv_spec(next + 1, &spec);
+        p = spec.end;
+        if (spec.type == ESP_LOG_ARG_NONE) {
+            line_append("%", 1);
+            continue;
+        }
+
+        // Rebuild the conversion specification, with '*' replaced by the captured values
+        char spec_format[DEFERRED_SPEC_MAX];
+        size_t spec_len = 0;
+        for (const char *s = next; s < spec.end && spec_len < sizeof(spec_format) - 12; ++s) {
+            if (*s != '*') {
+                spec_format[spec_len++] = *s;
+                continue;
+            }
+            int value = DECODE_ARG(int);
+            if (s[-1] == '.' && value < 0) {
+                // negative precision is taken as if the precision were omitted
+                --spec_len;
+            } else {
+                spec_len += sprintf(spec_format + spec_len, "%d", value);
+            }
+        }
+        spec_format[spec_len] = '\0';
+
+        switch (spec.type) {
+        case ESP_LOG_ARG_COUNT: break;
+        case ESP_LOG_ARG_INT: RENDER_ARG(int, DECODE_ARG(int)); break;
+        case ESP_LOG_ARG_LONG: RENDER_ARG(long, DECODE_ARG(long)); break;
+        case ESP_LOG_ARG_LLONG: RENDER_ARG(long long, DECODE_ARG(long long)); break;
+        case ESP_LOG_ARG_INTMAX: RENDER_ARG(intmax_t, DECODE_ARG(intmax_t)); break;
+        case ESP_LOG_ARG_SIZE: RENDER_ARG(size_t, DECODE_ARG(size_t)); break;
+        case ESP_LOG_ARG_PTRDIFF: RENDER_ARG(ptrdiff_t, DECODE_ARG(ptrdiff_t)); break;
+        case ESP_LOG_ARG_DOUBLE: RENDER_ARG(double, DECODE_ARG(double)); break;
+        case ESP_LOG_ARG_LDOUBLE: RENDER_ARG(long double, DECODE_ARG(long double)); break;
+        case ESP_LOG_ARG_PTR: RENDER_ARG(void *, DECODE_ARG(void *)); break;
+        case ESP_LOG_ARG_STR: {
+            char str[DEFERRED_MSG_MAX];
+            uint16_t len = DECODE_ARG(uint16_t);
+            if (len == DEFERRED_STR_NULL) {
+                RENDER_ARG(const char *, NULL);
+            } else {
+                memcpy(str, pos, len);
+                str[len] = '\0';
+                pos += len;
+                RENDER_ARG(const char *, str);
+            }
+            break;
+        }
+        default:
+            // encode_args doesn't accept other conversions
+            return;
+        }
+    }
+    line_append(p, strlen(p));
+}
+
+static void buffer_render(log_buffer_t *buffer)
+{
+    uint32_t tail = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+    while (tail != head) {
+        uint32_t pos = tail & buffer->mask;
+        uint32_t len;
+        memcpy(&len, buffer->buf + pos, sizeof(len));
+        if (len == 0) {
+            tail += buffer->mask + 1 - pos;
+        } else {
+            render_message(buffer->buf + pos);
+            tail += len;
+        }
+        atomic_store_explicit(&buffer->tail, tail, memory_order_release);
+    }
+}
+
+bool esp_log_deferred_render(void)
+{
+    if (atomic_flag_test_and_set_explicit(&s_rendering, memory_order_acquire)) {
+        return false;
+    }
+    unsigned dropped = atomic_exchange_explicit(&s_dropped, 0, memory_order_relaxed);
+    if (dropped != 0) {
+        s_line_len = snprintf(s_line, sizeof(s_line), LOG_FORMAT(W, "%u messages dropped"),
+                              esp_log_timestamp(), "log", dropped);
+        line_flush();
+    }
+    for (unsigned i = 0; i < s_buffer_count; ++i) {
+        buffer_render(&s_buffers[i]);
+    }
+    line_flush();
+    atomic_flag_clear_explicit(&s_rendering, memory_order_release);
+    return true;
+}
+
+static esp_err_t buffers_alloc(size_t buffer_size)
+{
+    size_t size = 1;
+    while (size <= buffer_size / 2 && size < (1U << 30)) {
+        size *= 2;
+    }
+    if (size < 2 * DEFERRED_MSG_MAX) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    unsigned count = esp_log_impl_deferred_buffer_count();
+    log_buffer_t *buffers = calloc(count, sizeof(log_buffer_t));
+    if (buffers == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (unsigned i = 0; i < count; ++i) {
+        buffers[i].buf = malloc(size);
+        if (buffers[i].buf == NULL) {
+            for (unsigned j = 0; j < i; ++j) {
+                free(buffers[j].buf);
+            }
+            free(buffers);
+            return ESP_ERR_NO_MEM;
+        }
+        buffers[i].mask = size - 1;
+        atomic_init(&buffers[i].head, 0);
+        atomic_init(&buffers[i].tail, 0);
+    }
+    s_buffers = buffers;
+    s_buffer_count = count;
+    return ESP_OK;
+}
+
+esp_err_t esp_log_deferred_start(size_t buffer_size)
+{
+    esp_err_t err = ESP_OK;
+    esp_log_impl_lock();
+    if (atomic_load_explicit(&s_active, memory_order_relaxed)) {
+        err = ESP_ERR_INVALID_STATE;
+    } else if (s_buffers == NULL) {
+        err = buffers_alloc(buffer_size);
+    }
+    if (err == ESP_OK && !esp_log_impl_deferred_task_start()) {
+        err = ESP_ERR_NO_MEM;
+    }
+    if (err == ESP_OK) {
+        atomic_store_explicit(&s_active, true, memory_order_release);
+    }
+    esp_log_impl_unlock();
+    return err;
+}
+
+void esp_log_deferred_stop(void)
+{
+    atomic_store_explicit(&s_active, false, memory_order_release);
+    esp_log_deferred_flush();
+}
+
+void esp_log_deferred_flush(void)
+{
+    // Messages written before this call are rendered once we get to render ourselves
+    while (!esp_log_deferred_render()) {
+        esp_log_impl_deferred_yield();
+    }
+}
@@ -0,0 +1,124 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Parsing of printf format strings, for the output modes which copy the
+ * arguments of a message instead of formatting it (see log_deferred.c and
+ * log_binary.c). Encoding and decoding both use this parser, so they agree
+ * on the arguments of each conversion.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include "esp_log_private.h"
+
+void esp_log_parse_conv_spec(const char *p, esp_log_conv_spec_t *spec)
+{
+    spec->star_width = false;
+    spec->star_precision = false;
+    spec->precision = -1;
+
+    while (*p != '\0' && strchr("-+ #0", *p) != NULL) {
+        ++p;
+    }
+    if (*p == '*') {
+        spec->star_width = true;
+        ++p;
+    } else {
+        while (*p >= '0' && *p <= '9') {
+            ++p;
+        }
+    }
+    if (*p == '.') {
+        ++p;
+        if (*p == '*') {
+            spec->star_precision = true;
+            ++p;
+        } else {
+            spec->precision = 0;
+            while (*p >= '0' && *p <= '9') {
+                spec->precision = spec->precision * 10 + (*p - '0');
+                ++p;
+            }
+        }
+    }
+
+    spec->length = 0;
+    switch (*p) {
+    case 'h':
+        ++p;
+        spec->length = 'h';
+        if (*p == 'h') {
+            ++p;
+            spec->length = 'H';
+        }
+        break;
+    case 'l':
+        ++p;
+        spec->length = 'l';
+        if (*p == 'l') {
+            ++p;
+            spec->length = 'q';
+        }
+        break;
+    case 'j':
+    case 'z':
+    case 't':
+    case 'L':
+        spec->length = *p++;
+        break;
+    default:
+        break;
+    }
+
+    spec->conversion = *p;
+    switch (*p) {
+    case '%':
+        spec->type = ESP_LOG_ARG_NONE;
+        break;
+    case 'd':
+    case 'i':
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+        switch (spec->length) {
+        case 'l': spec->type = ESP_LOG_ARG_LONG; break;
+        case 'q': spec->type = ESP_LOG_ARG_LLONG; break;
+        case 'j': spec->type = ESP_LOG_ARG_INTMAX; break;
+        case 'z': spec->type = ESP_LOG_ARG_SIZE; break;
+        case 't': spec->type = ESP_LOG_ARG_PTRDIFF; break;
+        default: spec->type = ESP_LOG_ARG_INT; break;
+        }
+        break;
+    case 'c':
+        spec->type = (spec->length == 0) ? ESP_LOG_ARG_INT : ESP_LOG_ARG_INVALID;
+        break;
+    case 's':
+        spec->type = (spec->length == 0) ? ESP_LOG_ARG_STR : ESP_LOG_ARG_INVALID;
+        break;
+    case 'p':
+        spec->type = ESP_LOG_ARG_PTR;
+        break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        spec->type = (spec->length == 'L') ? ESP_LOG_ARG_LDOUBLE : ESP_LOG_ARG_DOUBLE;
+        break;
+    case 'n':
+        spec->type = ESP_LOG_ARG_COUNT;
+        break;
+    default:
+        spec->type = ESP_LOG_ARG_INVALID;
+        break;
+    }
+    spec->end = (*p != '\0') ? p + 1 : p;
+}
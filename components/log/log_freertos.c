@@ -26,6 +26,12 @@
 
 static SemaphoreHandle_t s_log_mutex = NULL;
 
+#if CONFIG_LOG_DEFERRED_OUTPUT
+#define DEFERRED_PERIOD_TICKS ((CONFIG_LOG_DEFERRED_PERIOD_MS + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS)
+
+static TaskHandle_t s_log_deferred_task = NULL;
+#endif
+
 void esp_log_impl_lock(void)
 {
     if (unlikely(!s_log_mutex)) {
@@ -56,6 +62,55 @@ void esp_log_impl_unlock(void)
     xSemaphoreGive(s_log_mutex);
 }
 
+#if CONFIG_LOG_DEFERRED_OUTPUT
+unsigned esp_log_impl_deferred_buffer_count(void)
+{
+    return portNUM_PROCESSORS;
+}
+
+unsigned esp_log_impl_deferred_enter(uint32_t *state)
+{
+    // Only tasks of this core write into its buffer, keeping them from
+    // preempting each other is enough, no need to take a spinlock.
+    *state = portSET_INTERRUPT_MASK_FROM_ISR();
+    return xPortGetCoreID();
+}
+
+void esp_log_impl_deferred_exit(uint32_t state)
+{
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(state);
+}
+
+static void log_deferred_task(void *arg)
+{
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, DEFERRED_PERIOD_TICKS);
+        esp_log_deferred_render();
+    }
+}
+
+bool esp_log_impl_deferred_task_start(void)
+{
+    if (s_log_deferred_task == NULL) {
+        return xTaskCreate(log_deferred_task, "log_deferred", CONFIG_LOG_DEFERRED_TASK_STACK_SIZE, NULL,
+                           CONFIG_LOG_DEFERRED_TASK_PRIORITY, &s_log_deferred_task) == pdPASS;
+    }
+    return true;
+}
+
+void esp_log_impl_deferred_task_notify(void)
+{
+    if (s_log_deferred_task != NULL) {
+        xTaskNotifyGive(s_log_deferred_task);
+    }
+}
+
+void esp_log_impl_deferred_yield(void)
+{
+    vTaskDelay(1);
+}
+#endif // CONFIG_LOG_DEFERRED_OUTPUT
+
 char *esp_log_system_timestamp(void)
 {
     static char buffer[18] = {0};
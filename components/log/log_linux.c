@@ -20,6 +20,15 @@
 
 static pthread_mutex_t mutex1 = PTHREAD_MUTEX_INITIALIZER;
 
+#if CONFIG_LOG_DEFERRED_OUTPUT
+// On the host, producers of the single deferred buffer are serialized with a mutex
+static pthread_mutex_t s_deferred_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t s_deferred_task_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_deferred_task_cond = PTHREAD_COND_INITIALIZER;
+static bool s_deferred_task_started = false;
+static bool s_deferred_task_notified = false;
+#endif
+
 void esp_log_impl_lock(void)
 {
     assert(pthread_mutex_lock(&mutex1) == 0);
@@ -44,3 +53,69 @@ uint32_t esp_log_timestamp(void)
     uint32_t milliseconds = current_time.tv_sec * 1000 + current_time.tv_nsec / 1000000;
     return milliseconds;
 }
+
+#if CONFIG_LOG_DEFERRED_OUTPUT
+unsigned esp_log_impl_deferred_buffer_count(void)
+{
+    return 1;
+}
+
+unsigned esp_log_impl_deferred_enter(uint32_t *state)
+{
+    (void) state;
+    pthread_mutex_lock(&s_deferred_mutex);
+    return 0;
+}
+
+void esp_log_impl_deferred_exit(uint32_t state)
+{
+    (void) state;
+    pthread_mutex_unlock(&s_deferred_mutex);
+}
+
+static void *log_deferred_task(void *arg)
+{
+    while (true) {
+        pthread_mutex_lock(&s_deferred_task_mutex);
+        if (!s_deferred_task_notified) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += CONFIG_LOG_DEFERRED_PERIOD_MS % 1000 * 1000000L;
+            deadline.tv_sec += CONFIG_LOG_DEFERRED_PERIOD_MS / 1000 + deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&s_deferred_task_cond, &s_deferred_task_mutex, &deadline);
+        }
+        s_deferred_task_notified = false;
+        pthread_mutex_unlock(&s_deferred_task_mutex);
+        esp_log_deferred_render();
+    }
+    return NULL;
+}
+
+bool esp_log_impl_deferred_task_start(void)
+{
+    if (!s_deferred_task_started) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, log_deferred_task, NULL) != 0) {
+            return false;
+        }
+        pthread_detach(thread);
+        s_deferred_task_started = true;
+    }
+    return true;
+}
+
+void esp_log_impl_deferred_task_notify(void)
+{
+    pthread_mutex_lock(&s_deferred_task_mutex);
+    s_deferred_task_notified = true;
+    pthread_cond_signal(&s_deferred_task_cond);
+    pthread_mutex_unlock(&s_deferred_task_mutex);
+}
+
+void esp_log_impl_deferred_yield(void)
+{
+    struct timespec delay = { .tv_sec = 0, .tv_nsec = 1000000 };
+    nanosleep(&delay, NULL);
+}
+#endif // CONFIG_LOG_DEFERRED_OUTPUT
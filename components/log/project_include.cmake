@@ -0,0 +1,19 @@
+# Generate the dictionary of constant strings used to decode binary log output
+if(CONFIG_LOG_BINARY_OUTPUT AND NOT BOOTLOADER_BUILD)
+    idf_build_get_property(build_dir BUILD_DIR)
+    idf_build_get_property(python PYTHON)
+    idf_build_get_property(elf EXECUTABLE GENERATOR_EXPRESSION)
+    idf_build_get_property(elf_dir EXECUTABLE_DIR GENERATOR_EXPRESSION)
+
+    add_custom_command(OUTPUT "${build_dir}/log_dict.json"
+        COMMAND ${python} "${CMAKE_CURRENT_LIST_DIR}/log_binary.py" dict
+            -o "${build_dir}/log_dict.json" "${elf_dir}/${elf}"
+        DEPENDS ${elf} "${CMAKE_CURRENT_LIST_DIR}/log_binary.py"
+        VERBATIM
+        COMMENT "Generating binary log dictionary")
+    add_custom_target(log_dict ALL DEPENDS "${build_dir}/log_dict.json")
+
+    set_property(DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}"
+        APPEND PROPERTY ADDITIONAL_MAKE_CLEAN_FILES
+        "${build_dir}/log_dict.json")
+endif()
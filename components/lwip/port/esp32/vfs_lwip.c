@@ -93,6 +93,8 @@ void esp_vfs_lwip_sockets_register(void)
         .read = &lwip_read,
         .fcntl = &lwip_fcntl_r_wrapper,
         .ioctl = &lwip_ioctl_r_wrapper,
+        .writev = &lwip_writev,
+        .readv = &lwip_readv,
 #ifdef CONFIG_VFS_SUPPORT_SELECT
         .socket_select = &lwip_select,
         .get_socket_select_semaphore = &lwip_get_socket_select_semaphore,
@@ -13,12 +13,26 @@
 extern "C" {
 #endif
 
-struct iovec;
+struct iovec {
+    void *iov_base;     /* Base address of the buffer */
+    size_t iov_len;     /* Length of the buffer */
+};
+/* lwIP defines its own struct iovec unless 'iovec' is defined */
+#define iovec iovec
 
-int writev(int s, const struct iovec *iov, int iovcnt);
+/* Maximum number of buffers passed to a single readv/writev call */
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt);
 
 ssize_t readv(int fd, const struct iovec *iov, int iovcnt);
 
+ssize_t pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+
+ssize_t preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+
 #ifdef __cplusplus
 }
 #endif
@@ -114,6 +114,16 @@ typedef struct {
  */
 typedef struct nvs_opaque_iterator_t *nvs_iterator_t;
 
+/**
+ * Opaque pointer type representing a blob being written in pieces
+ */
+typedef struct nvs_opaque_blob_writer_t *nvs_blob_writer_t;
+
+/**
+ * Opaque pointer type representing a blob being read in pieces
+ */
+typedef struct nvs_opaque_blob_reader_t *nvs_blob_reader_t;
+
 /**
  * @brief      Open non-volatile storage with a given namespace from the default NVS partition
  *
@@ -497,16 +507,173 @@ esp_err_t nvs_erase_all(nvs_handle_t handle);
  * to non-volatile storage. Individual implementations may write to storage at other times,
  * but this is not guaranteed.
  *
+ * If a batch has been started with nvs_batch_begin(), all values staged since then are
+ * written now, and the batch ends (also if writing fails).
+ *
  * @param[in]  handle  Storage handle obtained with nvs_open.
  *                     Handles that were opened read only cannot be used.
  *
  * @return
  *             - ESP_OK if the changes have been written successfully
  *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if there is not enough space in the
+ *               underlying storage to save the staged values. Nothing has been written in this case.
+ *             - ESP_ERR_NVS_REMOVE_FAILED if the previous values couldn't be erased because
+ *               a flash write operation has failed. The staged values were written however, and
+ *               update will be finished after re-initialization of nvs, provided that
+ *               flash operation doesn't fail again.
  *             - other error codes from the underlying storage driver
  */
 esp_err_t nvs_commit(nvs_handle_t handle);
 
+/**
+ * @brief      Start staging the values set through a handle in a batch
+ *
+ * After this call, the nvs_set_* functions only keep the values in RAM, until nvs_commit()
+ * writes all of them at once: they are packed into consecutive entries of one page, which takes
+ * much fewer flash operations than writing them one by one. If power goes out during nvs_commit(),
+ * either all or none of the values of the batch are visible after re-initialization of nvs.
+ *
+ * While a batch is open, the nvs_get_* functions return the values stored before the batch,
+ * and nvs_erase_key() and nvs_erase_all() fail with ESP_ERR_NVS_INVALID_STATE.
+ * Setting a key again replaces the value staged before.
+ * All staged values, plus one entry per batch and one per blob, must fit into a single page
+ * (126 entries of 32 bytes), otherwise nvs_set_* return ESP_ERR_NVS_NOT_ENOUGH_SPACE.
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ *                     Handles that were opened read only cannot be used.
+ *
+ * @return
+ *             - ESP_OK if the batch has been started
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_READ_ONLY if handle was opened as read only
+ *             - ESP_ERR_NVS_INVALID_STATE if a batch is already open for this handle
+ */
+esp_err_t nvs_batch_begin(nvs_handle_t handle);
+
+/**
+ * @brief      Discard the values staged since nvs_batch_begin() and end the batch
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ *
+ * @return
+ *             - ESP_OK if the batch has been discarded
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_INVALID_STATE if no batch is open for this handle
+ */
+esp_err_t nvs_batch_abort(nvs_handle_t handle);
+
+/**
+ * @brief      Open a writer which stores a blob piece by piece
+ *
+ * The data passed to nvs_blob_write() is written to flash as soon as it fills a chunk,
+ * so at most one chunk (4000 bytes) is kept in RAM, no matter how large the blob is.
+ * The new value replaces the previous one atomically once nvs_blob_write_finish() succeeds.
+ * Closing the writer before that discards the data written so far.
+ *
+ * Until then, the key is reserved for the writer: opening another writer for it,
+ * nvs_set_blob, nvs_erase_key and nvs_erase_all for it fail with ESP_ERR_NVS_INVALID_STATE.
+ * If the handle is closed first, the data written so far is discarded and the writer
+ * functions return ESP_ERR_NVS_INVALID_HANDLE. The writer still has to be closed.
+ *
+ * @param[in]  handle      Handle obtained from nvs_open function. Handles that were opened read only cannot be used.
+ * @param[in]  key         Key name. Maximal length is (NVS_KEY_NAME_MAX_SIZE-1) characters. Shouldn't be empty.
+ * @param[out] out_writer  Receives the writer, which has to be closed with nvs_blob_writer_close().
+ *
+ * @return
+ *             - ESP_OK if the writer has been opened
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_READ_ONLY if storage handle was opened as read only
+ *             - ESP_ERR_NVS_INVALID_STATE if a batch is open for this handle or another writer for the key is open
+ *             - ESP_ERR_NVS_KEY_TOO_LONG if the key name is too long
+ *             - ESP_ERR_NO_MEM if memory couldn't be allocated
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_blob_writer_open(nvs_handle_t handle, const char* key, nvs_blob_writer_t* out_writer);
+
+/**
+ * @brief      Append data to a blob opened with nvs_blob_writer_open()
+ *
+ * @param[in]  writer  Writer obtained from nvs_blob_writer_open.
+ * @param[in]  data    Data to append.
+ * @param[in]  length  Length of the data in bytes.
+ *
+ * @return
+ *             - ESP_OK if the data has been accepted
+ *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if there is not enough space in the underlying storage
+ *             - ESP_ERR_NVS_VALUE_TOO_LONG if the blob would need more chunks than a blob may have
+ *             - ESP_ERR_NVS_INVALID_STATE if the writer has failed or been finished before
+ *             - ESP_ERR_NVS_INVALID_HANDLE if the handle has been closed
+ *             - other error codes from the underlying storage driver. In this case, as for the error
+ *               codes above except ESP_ERR_NVS_INVALID_STATE and ESP_ERR_NVS_INVALID_HANDLE, the data
+ *               written so far is discarded and the previous value is kept.
+ */
+esp_err_t nvs_blob_write(nvs_blob_writer_t writer, const void* data, size_t length);
+
+/**
+ * @brief      Write the remaining data and the blob index, then erase the previous value
+ *
+ * @param[in]  writer  Writer obtained from nvs_blob_writer_open.
+ *
+ * @return
+ *             - ESP_OK if the blob has been stored
+ *             - ESP_ERR_NVS_REMOVE_FAILED if the blob has been stored, but the previous value couldn't be erased
+ *             - the same error codes as nvs_blob_write otherwise
+ */
+esp_err_t nvs_blob_write_finish(nvs_blob_writer_t writer);
+
+/**
+ * @brief      Close a writer, discarding the data written unless nvs_blob_write_finish() has succeeded
+ *
+ * @param[in]  writer  Writer obtained from nvs_blob_writer_open. NULL argument is allowed.
+ */
+void nvs_blob_writer_close(nvs_blob_writer_t writer);
+
+/**
+ * @brief      Open a reader which reads a blob piece by piece
+ *
+ * Chunks are read from flash as they are needed, so at most one chunk is kept in RAM.
+ * Blobs stored with nvs_set_blob or a writer can be read. The blob should not be changed
+ * while the reader is open, reading it may fail with ESP_ERR_NVS_NOT_FOUND then.
+ *
+ * @param[in]  handle      Handle obtained from nvs_open function.
+ * @param[in]  key         Key name. Maximal length is (NVS_KEY_NAME_MAX_SIZE-1) characters. Shouldn't be empty.
+ * @param[out] out_reader  Receives the reader, which has to be closed with nvs_blob_reader_close().
+ * @param[out] out_size    If not NULL, receives the size of the blob in bytes.
+ *
+ * @return
+ *             - ESP_OK if the reader has been opened
+ *             - ESP_ERR_NVS_NOT_FOUND if there is no blob with the given key
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_KEY_TOO_LONG if the key name is too long
+ *             - ESP_ERR_NO_MEM if memory couldn't be allocated
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_blob_reader_open(nvs_handle_t handle, const char* key, nvs_blob_reader_t* out_reader, size_t* out_size);
+
+/**
+ * @brief      Read the next part of a blob opened with nvs_blob_reader_open()
+ *
+ * @param[in]  reader      Reader obtained from nvs_blob_reader_open.
+ * @param[out] out_data    Buffer of at least length bytes.
+ * @param[in]  length      Maximum number of bytes to read.
+ * @param[out] out_length  Number of bytes read, less than length only at the end of the blob.
+ *
+ * @return
+ *             - ESP_OK on success
+ *             - ESP_ERR_NVS_NOT_FOUND if (a part of) the blob has been erased since the reader has been opened
+ *             - ESP_ERR_NVS_INVALID_HANDLE if the handle has been closed
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_blob_read(nvs_blob_reader_t reader, void* out_data, size_t length, size_t* out_length);
+
+/**
+ * @brief      Close a reader
+ *
+ * @param[in]  reader  Reader obtained from nvs_blob_reader_open. NULL argument is allowed.
+ */
+void nvs_blob_reader_close(nvs_blob_reader_t reader);
+
 /**
  * @brief      Close the storage handle and free any allocated resources
  *
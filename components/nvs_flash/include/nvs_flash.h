@@ -171,6 +171,33 @@ esp_err_t nvs_flash_erase_partition(const char *part_name);
  */
 esp_err_t nvs_flash_erase_partition_ptr(const esp_partition_t *partition);
 
+/**
+ * @brief Perform one step of incremental garbage collection on an NVS partition
+ *
+ * When a write needs a new page and only one erased page is left, NVS reclaims a page
+ * synchronously, which means copying all its items and erasing a flash sector while
+ * the write waits. Calling this function periodically, e.g. from a low priority task,
+ * keeps CONFIG_NVS_GC_RESERVE_PAGES additional pages erased ahead of time instead,
+ * so that writes never have to erase a page as long as the reserve keeps up.
+ *
+ * Each call does a bounded amount of work: it either moves the items of the page with
+ * the most erased entries to the active page, until at least max_entries entries
+ * have been moved, or erases that page once it holds no more items.
+ *
+ * @param[in]  partition_label  Label of the partition, or NULL for the default NVS partition
+ * @param[in]  max_entries      Number of entries to move in this step, must not be zero
+ * @param[out] done             Set to true if no further step is needed at the moment, that is
+ *                              the reserve is complete or no page can be reclaimed
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if max_entries is zero or done is NULL
+ *      - ESP_ERR_NVS_NOT_INITIALIZED if the storage for given partition was not initialized
+ *      - ESP_ERR_NVS_INVALID_STATE if the storage is in an invalid state
+ *      - one of the error codes from the underlying flash storage driver
+ */
+esp_err_t nvs_flash_gc_step(const char *partition_label, size_t max_entries, bool *done);
+
 /**
  * @brief Initialize the default NVS partition.
  *
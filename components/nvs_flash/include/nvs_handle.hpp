@@ -3,6 +3,8 @@
 
 #include <string>
 #include <memory>
+#include <new>
+#include <cstring>
 #include <type_traits>
 
 #include "nvs.h"
@@ -28,6 +30,209 @@ enum class ItemType : uint8_t {
     ANY  = NVS_TYPE_ANY
 };
 
+/**
+ * @brief Receives the data of a string or blob read with NVSHandle::visit_string or NVSHandle::visit_blob.
+ *
+ * The data is passed in order, in one piece for a string and in one piece per chunk for a blob.
+ */
+class NVSDataVisitor {
+public:
+    virtual ~NVSDataVisitor() { }
+
+    /**
+     * Called once with the total size of the data, before any data is passed. For strings, the size includes the
+     * zero terminator. Returning an error ends the read, which then returns the same error.
+     */
+    virtual esp_err_t begin(size_t /*size*/)
+    {
+        return ESP_OK;
+    }
+
+    /**
+     * Returns the memory which the size bytes of data at offset should be read into, or nullptr if they should be
+     * read into a temporary buffer.
+     */
+    virtual void *get_buffer(size_t /*offset*/, size_t /*size*/)
+    {
+        return nullptr;
+    }
+
+    /**
+     * Called with each piece of the data, which is located in the memory returned by get_buffer or in a temporary
+     * buffer valid until the function returns. Returning an error ends the read, which then returns the same error.
+     */
+    virtual esp_err_t visit(const void *data, size_t size) = 0;
+};
+
+/**
+ * @brief Owns the data of a string or blob read with NVSHandle::get_string or NVSHandle::get_blob.
+ *
+ * Data of up to INLINE_SIZE bytes is stored inside the object, larger data is allocated on the heap.
+ * The data is read from flash directly into this memory.
+ */
+class NVSData : public NVSDataVisitor {
+public:
+    static const size_t INLINE_SIZE = 32;
+
+    NVSData() : mData(mInline), mSize(0)
+    {
+        mInline[0] = 0;
+    }
+
+    NVSData(NVSData &&other) : NVSData()
+    {
+        *this = std::move(other);
+    }
+
+    NVSData &operator=(NVSData &&other)
+    {
+        if (this != &other) {
+            clear();
+            if (other.mData == other.mInline) {
+                memcpy(mInline, other.mInline, sizeof(mInline));
+            } else {
+                mData = other.mData;
+            }
+            mSize = other.mSize;
+            other.mData = other.mInline;
+            other.mSize = 0;
+            other.mInline[0] = 0;
+        }
+        return *this;
+    }
+
+    NVSData(const NVSData &) = delete;
+    NVSData &operator=(const NVSData &) = delete;
+
+    ~NVSData()
+    {
+        clear();
+    }
+
+    const uint8_t *data() const
+    {
+        return mData;
+    }
+
+    size_t size() const
+    {
+        return mSize;
+    }
+
+    /**
+     * The data as a C string, only meaningful for data read with NVSHandle::get_string.
+     */
+    const char *c_str() const
+    {
+        return reinterpret_cast<const char *>(mData);
+    }
+
+    void clear()
+    {
+        if (mData != mInline) {
+            delete [] mData;
+        }
+        mData = mInline;
+        mSize = 0;
+        mInline[0] = 0;
+    }
+
+    esp_err_t begin(size_t size) override
+    {
+        clear();
+        if (size > INLINE_SIZE) {
+            mData = new (std::nothrow) uint8_t[size];
+            if (!mData) {
+                mData = mInline;
+                return ESP_ERR_NO_MEM;
+            }
+        }
+        mSize = size;
+        return ESP_OK;
+    }
+
+    void *get_buffer(size_t offset, size_t size) override
+    {
+        return (offset + size <= mSize) ? mData + offset : nullptr;
+    }
+
+    esp_err_t visit(const void * /*data*/, size_t /*size*/) override
+    {
+        return ESP_OK;
+    }
+
+protected:
+    uint8_t *mData;
+    size_t mSize;
+    uint8_t mInline[INLINE_SIZE];
+};
+
+/**
+ * @brief Writes a blob in pieces, see NVSHandle::open_blob_writer().
+ *
+ * The member functions may be called from any task, but not concurrently for the same writer.
+ */
+class NVSBlobWriter {
+public:
+    virtual ~NVSBlobWriter() { }
+
+    /**
+     * @brief Appends len bytes to the blob.
+     *
+     * @return
+     *             - ESP_OK if the data has been accepted
+     *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if there is not enough space in the underlying storage
+     *             - ESP_ERR_NVS_VALUE_TOO_LONG if the blob would need more chunks than a blob may have
+     *             - ESP_ERR_NVS_INVALID_STATE if the writer has failed or been finished before
+     *             - ESP_ERR_NVS_INVALID_HANDLE if the handle has been closed
+     *             - other error codes from the underlying storage driver
+     *
+     * If an error other than ESP_ERR_NVS_INVALID_STATE or ESP_ERR_NVS_INVALID_HANDLE is returned, the data
+     * written so far is discarded and the previous value is kept.
+     */
+    virtual esp_err_t write(const void *data, size_t len) = 0;
+
+    /**
+     * @brief Writes the remaining data and the blob index, then erases the previous value.
+     *
+     * @return ESP_OK on success, ESP_ERR_NVS_REMOVE_FAILED if the new value has been stored but the previous one
+     *         couldn't be erased, otherwise the same error codes as write()
+     */
+    virtual esp_err_t finish() = 0;
+
+    /**
+     * Number of bytes accepted by write() so far.
+     */
+    virtual size_t size() const = 0;
+};
+
+/**
+ * @brief Reads a blob in pieces, see NVSHandle::open_blob_reader().
+ *
+ * The member functions may be called from any task, but not concurrently for the same reader.
+ */
+class NVSBlobReader {
+public:
+    virtual ~NVSBlobReader() { }
+
+    /**
+     * @brief Reads up to len bytes of the blob, continuing where the previous call has stopped.
+     *
+     * @param[out] readLen  Number of bytes read, less than len only at the end of the blob.
+     *
+     * @return
+     *             - ESP_OK on success
+     *             - ESP_ERR_NVS_NOT_FOUND if (a part of) the blob has been erased since the reader has been opened
+     *             - ESP_ERR_NVS_INVALID_HANDLE if the handle has been closed
+     *             - other error codes from the underlying storage driver
+     */
+    virtual esp_err_t read(void *data, size_t len, size_t &readLen) = 0;
+
+    /**
+     * Total size of the blob.
+     */
+    virtual size_t size() const = 0;
+};
 
 /**
  * @brief A handle allowing nvs-entry related operations on the NVS.
@@ -63,6 +268,7 @@ public:
      *               update will be finished after re-initialization of nvs, provided that
      *               flash operation doesn't fail again.
      *             - ESP_ERR_NVS_VALUE_TOO_LONG if the string value is too long
+     *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if a batch is open and the value doesn't fit into it anymore
      */
     template<typename T>
     esp_err_t set_item(const char *key, T value);
@@ -115,6 +321,7 @@ public:
      *               update will be finished after re-initialization of nvs, provided that
      *               flash operation doesn't fail again.
      *             - ESP_ERR_NVS_VALUE_TOO_LONG if the value is too long
+     *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if a batch is open and the value doesn't fit into it anymore
      *
      * @note compare to \ref nvs_set_blob in nvs.h
      */
@@ -150,6 +357,51 @@ public:
     virtual esp_err_t get_string(const char *key, char* out_str, size_t len) = 0;
     virtual esp_err_t get_blob(const char *key, void* out_blob, size_t len) = 0;
 
+    /**
+     * @brief      get value for given key, without knowing its size in advance
+     *
+     * Unlike the functions above, these functions look up the item only once, instead of once to query its size
+     * with \c get_item_size and once more to read it.
+     *
+     * get_string and get_blob read the value into out, which stores small values without allocating memory.
+     * visit_string and visit_blob pass the size and then the data of the value to visitor, see \ref NVSDataVisitor.
+     *
+     * In case of an error, the contents of out and the data passed to visitor so far are not valid.
+     *
+     * @param[in]     key        Key name. Maximum length is (NVS_KEY_NAME_MAX_SIZE-1) characters. Shouldn't be empty.
+     * @param[out]    out        Receives the value. For strings, the size includes the zero terminator.
+     * @param         visitor    Receives the size and the data of the value.
+     *
+     * @return
+     *             - ESP_OK if the value was retrieved successfully
+     *             - ESP_ERR_NVS_NOT_FOUND if the requested key doesn't exist
+     *             - ESP_ERR_NVS_INVALID_NAME if key name doesn't satisfy constraints
+     *             - ESP_ERR_NO_MEM if memory for the value or a temporary buffer couldn't be allocated
+     *             - any error returned by visitor
+     *
+     * The default implementations, for the implementations of NVSHandle which don't override these functions,
+     * look up the item twice using \c get_item_size and the functions above.
+     */
+    virtual esp_err_t get_string(const char *key, NVSData &out)
+    {
+        return visit_string(key, out);
+    }
+
+    virtual esp_err_t get_blob(const char *key, NVSData &out)
+    {
+        return visit_blob(key, out);
+    }
+
+    virtual esp_err_t visit_string(const char *key, NVSDataVisitor &visitor)
+    {
+        return visit_sized_item(ItemType::SZ, key, visitor);
+    }
+
+    virtual esp_err_t visit_blob(const char *key, NVSDataVisitor &visitor)
+    {
+        return visit_sized_item(ItemType::BLOB, key, visitor);
+    }
+
     /**
      * @brief Look up the size of an entry's data.
      *
@@ -166,11 +418,14 @@ public:
 
     /**
      * @brief Erases an entry.
+     *
+     * Not allowed while a batch is open (ESP_ERR_NVS_INVALID_STATE).
      */
     virtual esp_err_t erase_item(const char* key) = 0;
 
     /**
      * Erases all entries in the scope of this handle. The scope may vary, depending on the implementation.
+     * Not allowed while a batch is open (ESP_ERR_NVS_INVALID_STATE).
      *
      * @not If you want to erase the whole nvs flash (partition), refer to \ref
      */
@@ -178,11 +433,58 @@ public:
 
     /**
      * Commits all changes done through this handle so far.
-     * Currently, NVS writes to storage right after the set and get functions,
+     * Outside of a batch, NVS writes to storage right after the set and get functions,
      * but this is not guaranteed.
+     * If a batch has been started with \ref begin_batch, the staged values are written now, and the batch ends.
+     *
+     * @return
+     *             - ESP_OK if the changes have been written successfully
+     *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if there is not enough space in the
+     *               underlying storage to save the staged values. Nothing has been written in this case.
+     *             - ESP_ERR_NVS_REMOVE_FAILED if the previous values couldn't be erased because a flash
+     *               write operation has failed. The new values were written however, and
+     *               update will be finished after re-initialization of nvs, provided that
+     *               flash operation doesn't fail again.
+     *             - other error codes from the underlying storage driver
      */
     virtual esp_err_t commit() = 0;
 
+    /**
+     * @brief      Start staging writes into a batch
+     *
+     * Until \ref commit is called, set_item, set_string and set_blob only keep the values in RAM.
+     * commit then writes all of them into consecutive entries of one page, using much fewer flash
+     * operations than writing them one by one. After a power loss, either all or none of the values of
+     * the batch are visible.
+     *
+     * While a batch is open, reading returns the values stored before the batch, and erasing keys isn't allowed.
+     * All staged items, including the overhead of one entry per batch and one per blob, must fit into a single
+     * page (126 entries of 32 bytes), so a staged blob may not exceed 4000 bytes.
+     *
+     * @return
+     *             - ESP_OK if the batch has been started
+     *             - ESP_ERR_NVS_READ_ONLY if storage handle was opened as read only
+     *             - ESP_ERR_NVS_INVALID_STATE if a batch is already open
+     *             - ESP_ERR_NOT_SUPPORTED if the implementation of NVSHandle doesn't support batches
+     */
+    virtual esp_err_t begin_batch()
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    /**
+     * @brief      Discard all values staged since \ref begin_batch and end the batch
+     *
+     * @return
+     *             - ESP_OK if the batch has been discarded
+     *             - ESP_ERR_NVS_INVALID_STATE if no batch is open
+     *             - ESP_ERR_NOT_SUPPORTED if the implementation of NVSHandle doesn't support batches
+     */
+    virtual esp_err_t abort_batch()
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
     /**
      * @brief      Calculate all entries in the scope of the handle.
      *
@@ -200,10 +502,94 @@ public:
      */
     virtual esp_err_t get_used_entry_count(size_t& usedEntries) = 0;
 
+    /**
+     * @brief Opens a writer which stores a blob piece by piece.
+     *
+     * The data passed to NVSBlobWriter::write() is written to flash as soon as it fills a chunk, so at most one
+     * chunk (4000 bytes) is kept in RAM, no matter how large the blob is. The new value replaces the previous one
+     * with the given key atomically, once NVSBlobWriter::finish() succeeds. Destroying the writer before that
+     * discards the data written so far.
+     *
+     * Until then, the key is reserved for the writer: opening another writer for it, setting it as blob, erasing
+     * it or erasing its namespace fail with ESP_ERR_NVS_INVALID_STATE, through any handle. No batch may be started
+     * on this handle while the writer is open. If the handle is closed first, the data written so far is
+     * discarded and the writer fails with ESP_ERR_NVS_INVALID_HANDLE.
+     *
+     * @param[in]  key  Key name, maximum length is (NVS_KEY_NAME_MAX_SIZE-1) characters.
+     * @param[out] err  If not nullptr, receives ESP_OK on success, ESP_ERR_NVS_READ_ONLY, ESP_ERR_NVS_INVALID_STATE
+     *                  if a batch is in progress or another writer for the key is open, ESP_ERR_NVS_KEY_TOO_LONG,
+     *                  ESP_ERR_NO_MEM, ESP_ERR_NOT_SUPPORTED if the implementation of NVSHandle doesn't support
+     *                  blob streams, or other error codes from the underlying storage driver.
+     *
+     * @return the writer, or nullptr if it couldn't be opened
+     */
+    virtual std::unique_ptr<NVSBlobWriter> open_blob_writer(const char * /*key*/, esp_err_t *err = nullptr)
+    {
+        if (err) {
+            *err = ESP_ERR_NOT_SUPPORTED;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Opens a reader which reads a blob piece by piece.
+     *
+     * Chunks are read from flash as they are needed, so at most one chunk is kept in RAM. Blobs written with
+     * set_blob() or NVSBlobWriter can be read. If the blob is changed or erased while the reader is open,
+     * reading fails with ESP_ERR_NVS_NOT_FOUND in most cases, so the blob should not be changed while the reader
+     * is open. If the handle is closed first, the reader fails with ESP_ERR_NVS_INVALID_HANDLE.
+     *
+     * @param[in]  key  Key name, maximum length is (NVS_KEY_NAME_MAX_SIZE-1) characters.
+     * @param[out] err  If not nullptr, receives ESP_OK on success, ESP_ERR_NVS_NOT_FOUND if there is no blob with
+     *                  the given key, ESP_ERR_NO_MEM, ESP_ERR_NOT_SUPPORTED if the implementation of NVSHandle
+     *                  doesn't support blob streams, or other error codes from the underlying storage driver.
+     *
+     * @return the reader, or nullptr if it couldn't be opened
+     */
+    virtual std::unique_ptr<NVSBlobReader> open_blob_reader(const char * /*key*/, esp_err_t *err = nullptr)
+    {
+        if (err) {
+            *err = ESP_ERR_NOT_SUPPORTED;
+        }
+        return nullptr;
+    }
+
 protected:
     virtual esp_err_t set_typed_item(ItemType datatype, const char *key, const void* data, size_t dataSize) = 0;
 
     virtual esp_err_t get_typed_item(ItemType datatype, const char *key, void* data, size_t dataSize) = 0;
+
+private:
+    esp_err_t visit_sized_item(ItemType datatype, const char *key, NVSDataVisitor &visitor)
+    {
+        size_t size;
+        esp_err_t err = get_item_size(datatype, key, size);
+        if (err != ESP_OK) {
+            return err;
+        }
+        err = visitor.begin(size);
+        if (err != ESP_OK) {
+            return err;
+        }
+        std::unique_ptr<uint8_t[]> temp;
+        uint8_t *buffer = static_cast<uint8_t *>(visitor.get_buffer(0, size));
+        if (!buffer) {
+            temp.reset(new (std::nothrow) uint8_t[size]);
+            if (!temp) {
+                return ESP_ERR_NO_MEM;
+            }
+            buffer = temp.get();
+        }
+        if (datatype == ItemType::SZ) {
+            err = get_string(key, reinterpret_cast<char *>(buffer), size);
+        } else {
+            err = get_blob(key, buffer, size);
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+        return visitor.visit(buffer, size);
+    }
 };
 
 /**
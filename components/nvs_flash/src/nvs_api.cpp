@@ -49,6 +49,14 @@ private:
 
 uint32_t NVSHandleEntry::s_nvs_next_handle;
 
+struct nvs_opaque_blob_writer_t {
+    std::unique_ptr<nvs::NVSBlobWriter> writer;
+};
+
+struct nvs_opaque_blob_reader_t {
+    std::unique_ptr<nvs::NVSBlobReader> reader;
+};
+
 extern "C" void nvs_dump(const char *partName);
 
 #ifndef LINUX_TARGET
@@ -264,6 +272,28 @@ extern "C" esp_err_t nvs_flash_deinit(void)
     return nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME);
 }
 
+extern "C" esp_err_t nvs_flash_gc_step(const char *partition_label, size_t max_entries, bool *done)
+{
+    Lock lock;
+    nvs::Storage* pStorage;
+
+    if (max_entries == 0 || done == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *done = false;
+
+    pStorage = lookup_storage_from_name((partition_label == nullptr) ? NVS_DEFAULT_PART_NAME : partition_label);
+    if (pStorage == nullptr) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    if (!pStorage->isValid()) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    return pStorage->collectGarbage(max_entries, *done);
+}
+
 static esp_err_t nvs_find_ns_handle(nvs_handle_t c_handle, NVSHandleSimple** handle)
 {
     auto it = find_if(begin(s_nvs_handles), end(s_nvs_handles), [=](NVSHandleEntry& e) -> bool {
@@ -399,7 +429,7 @@ extern "C" esp_err_t nvs_set_u64 (nvs_handle_t handle, const char* key, uint64_t
 extern "C" esp_err_t nvs_commit(nvs_handle_t c_handle)
 {
     Lock lock;
-    // no-op for now, to be used when intermediate cache is added
+    // writes the batch, if any
     NVSHandleSimple *handle;
     auto err = nvs_find_ns_handle(c_handle, &handle);
     if (err != ESP_OK) {
@@ -408,6 +438,104 @@ extern "C" esp_err_t nvs_commit(nvs_handle_t c_handle)
     return handle->commit();
 }
 
+extern "C" esp_err_t nvs_batch_begin(nvs_handle_t c_handle)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s\r\n", __func__);
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->begin_batch();
+}
+
+extern "C" esp_err_t nvs_batch_abort(nvs_handle_t c_handle)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s\r\n", __func__);
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->abort_batch();
+}
+
+extern "C" esp_err_t nvs_blob_writer_open(nvs_handle_t c_handle, const char* key, nvs_blob_writer_t* out_writer)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s %s", __func__, key);
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    nvs_blob_writer_t writer = new (std::nothrow) nvs_opaque_blob_writer_t;
+    if (!writer) {
+        return ESP_ERR_NO_MEM;
+    }
+    writer->writer = handle->open_blob_writer(key, &err);
+    if (err != ESP_OK) {
+        delete writer;
+        return err;
+    }
+    *out_writer = writer;
+    return ESP_OK;
+}
+
+// The writer and reader take the lock themselves, so the following functions don't.
+
+extern "C" esp_err_t nvs_blob_write(nvs_blob_writer_t writer, const void* data, size_t length)
+{
+    return writer->writer->write(data, length);
+}
+
+extern "C" esp_err_t nvs_blob_write_finish(nvs_blob_writer_t writer)
+{
+    return writer->writer->finish();
+}
+
+extern "C" void nvs_blob_writer_close(nvs_blob_writer_t writer)
+{
+    delete writer;
+}
+
+extern "C" esp_err_t nvs_blob_reader_open(nvs_handle_t c_handle, const char* key, nvs_blob_reader_t* out_reader, size_t* out_size)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s %s", __func__, key);
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    nvs_blob_reader_t reader = new (std::nothrow) nvs_opaque_blob_reader_t;
+    if (!reader) {
+        return ESP_ERR_NO_MEM;
+    }
+    reader->reader = handle->open_blob_reader(key, &err);
+    if (err != ESP_OK) {
+        delete reader;
+        return err;
+    }
+    if (out_size) {
+        *out_size = reader->reader->size();
+    }
+    *out_reader = reader;
+    return ESP_OK;
+}
+
+extern "C" esp_err_t nvs_blob_read(nvs_blob_reader_t reader, void* out_data, size_t length, size_t* out_length)
+{
+    return reader->reader->read(out_data, length, *out_length);
+}
+
+extern "C" void nvs_blob_reader_close(nvs_blob_reader_t reader)
+{
+    delete reader;
+}
+
 extern "C" esp_err_t nvs_set_str(nvs_handle_t c_handle, const char* key, const char* value)
 {
     Lock lock;
@@ -486,6 +614,44 @@ extern "C" esp_err_t nvs_get_u64 (nvs_handle_t c_handle, const char* key, uint64
     return nvs_get(c_handle, key, out_value);
 }
 
+/**
+ * Reads a value into the buffer of the caller, checking the buffer size once the item has been found.
+ */
+class BufferVisitor : public nvs::NVSDataVisitor {
+public:
+    BufferVisitor(void* buffer, size_t* length) :
+        mBuffer(static_cast<uint8_t*>(buffer)), mLength(length), mSize(*length), mOffset(0) { }
+
+    esp_err_t begin(size_t size) override
+    {
+        *mLength = size;
+        return (size > mSize) ? ESP_ERR_NVS_INVALID_LENGTH : ESP_OK;
+    }
+
+    void* get_buffer(size_t offset, size_t size) override
+    {
+        return (offset + size <= mSize) ? mBuffer + offset : nullptr;
+    }
+
+    esp_err_t visit(const void* data, size_t size) override
+    {
+        if (mOffset + size > mSize) {
+            return ESP_ERR_NVS_INVALID_LENGTH;
+        }
+        if (data != mBuffer + mOffset) {
+            memcpy(mBuffer + mOffset, data, size);
+        }
+        mOffset += size;
+        return ESP_OK;
+    }
+
+private:
+    uint8_t* mBuffer;
+    size_t* mLength;
+    size_t mSize;
+    size_t mOffset;
+};
+
 static esp_err_t nvs_get_str_or_blob(nvs_handle_t c_handle, nvs::ItemType type, const char* key, void* out_value, size_t* length)
 {
     Lock lock;
@@ -496,6 +662,12 @@ static esp_err_t nvs_get_str_or_blob(nvs_handle_t c_handle, nvs::ItemType type,
         return err;
     }
 
+    if (length != nullptr && out_value != nullptr) {
+        // look up the item only once, the size is checked as soon as it is known
+        BufferVisitor visitor(out_value, length);
+        return (type == nvs::ItemType::SZ) ? handle->visit_string(key, visitor) : handle->visit_blob(key, visitor);
+    }
+
     size_t dataSize;
     err = handle->get_item_size(type, key, dataSize);
     if (err != ESP_OK) {
@@ -504,16 +676,9 @@ static esp_err_t nvs_get_str_or_blob(nvs_handle_t c_handle, nvs::ItemType type,
 
     if (length == nullptr) {
         return ESP_ERR_NVS_INVALID_LENGTH;
-    } else if (out_value == nullptr) {
-        *length = dataSize;
-        return ESP_OK;
-    } else if (*length < dataSize) {
-        *length = dataSize;
-        return ESP_ERR_NVS_INVALID_LENGTH;
     }
-
     *length = dataSize;
-    return handle->get_typed_item(type, key, out_value, dataSize);
+    return ESP_OK;
 }
 
 extern "C" esp_err_t nvs_get_str(nvs_handle_t c_handle, const char* key, char* out_value, size_t* length)
@@ -39,37 +39,45 @@ esp_err_t NVSEncryptedPartition::init(nvs_sec_cfg_t* cfg)
     return ESP_OK;
 }
 
-esp_err_t NVSEncryptedPartition::read(size_t src_offset, void* dst, size_t size)
+esp_err_t NVSEncryptedPartition::crypt(mbedtls_aes_xts_context *ctx, int mode, size_t addr, uint8_t *buf, size_t size)
 {
-    /** Currently upper layer of NVS reads entries one by one even for variable size
-    * multi-entry data types. So length should always be equal to size of an entry.*/
-    if (size != sizeof(Item)) return ESP_ERR_INVALID_SIZE;
+    const size_t entrySize = sizeof(Item);
 
-    // read data
-    esp_err_t read_result = esp_partition_read(mESPPartition, src_offset, dst, size);
-    if (read_result != ESP_OK) {
-        return read_result;
-    }
-
-    // decrypt data
     //sector num required as an arr by mbedtls. Should have been just uint64/32.
     uint8_t data_unit[16];
 
-    uint32_t relAddr = src_offset;
-
     memset(data_unit, 0, sizeof(data_unit));
 
-    memcpy(data_unit, &relAddr, sizeof(relAddr));
+    /* Each entry is a data unit of its own, with its address relative to the partition as
+     * tweak (relocatable, so that host-generated encrypted nvs images can be used).
+     * Only the address needs to change between the entries of a contiguous range. */
+    for (size_t offset = 0; offset < size; offset += entrySize) {
+        uint32_t relAddr = addr + offset;
+        memcpy(data_unit, &relAddr, sizeof(relAddr));
 
-    uint8_t *destination = reinterpret_cast<uint8_t*>(dst);
-
-    if (mbedtls_aes_crypt_xts(&mDctxt, MBEDTLS_AES_DECRYPT, size, data_unit, destination, destination) != 0)  {
-        return ESP_ERR_NVS_XTS_DECR_FAILED;
+        if (mbedtls_aes_crypt_xts(ctx, mode, entrySize, data_unit, buf + offset, buf + offset) != 0) {
+            return (mode == MBEDTLS_AES_ENCRYPT) ? ESP_ERR_NVS_XTS_ENCR_FAILED : ESP_ERR_NVS_XTS_DECR_FAILED;
+        }
     }
 
     return ESP_OK;
 }
 
+esp_err_t NVSEncryptedPartition::read(size_t src_offset, void* dst, size_t size)
+{
+    /** Entries are encrypted one by one, so any number of whole entries can be read at once */
+    if (size == 0 || size % sizeof(Item) != 0) return ESP_ERR_INVALID_SIZE;
+
+    // read data
+    esp_err_t read_result = esp_partition_read(mESPPartition, src_offset, dst, size);
+    if (read_result != ESP_OK) {
+        return read_result;
+    }
+
+    // decrypt data
+    return crypt(&mDctxt, MBEDTLS_AES_DECRYPT, src_offset, reinterpret_cast<uint8_t*>(dst), size);
+}
+
 esp_err_t NVSEncryptedPartition::write(size_t addr, const void* src, size_t size)
 {
     if (size % ESP_ENCRYPT_BLOCK_SIZE != 0) return ESP_ERR_INVALID_SIZE;
@@ -82,38 +90,14 @@ esp_err_t NVSEncryptedPartition::write(size_t addr, const void* src, size_t size
     memcpy(buf, src, size);
 
     // encrypt data
-    uint8_t entrySize = sizeof(Item);
-
-    //sector num required as an arr by mbedtls. Should have been just uint64/32.
-    uint8_t data_unit[16];
-
-    /* Use relative address instead of absolute address (relocatable), so that host-generated
-     * encrypted nvs images can be used*/
-    uint32_t relAddr = addr;
-
-    memset(data_unit, 0, sizeof(data_unit));
-
-    for(uint8_t entry = 0; entry < (size/entrySize); entry++)
-    {
-        uint32_t offset = entry * entrySize;
-        uint32_t *addr_loc = (uint32_t*) &data_unit[0];
-
-        *addr_loc = relAddr + offset;
-        if (mbedtls_aes_crypt_xts(&mEctxt,
-                                  MBEDTLS_AES_ENCRYPT,
-                                  entrySize,
-                                  data_unit,
-                                  buf + offset,
-                                  buf + offset) != 0)  {
-            delete buf;
-            return ESP_ERR_NVS_XTS_ENCR_FAILED;
-        }
-    }
+    esp_err_t result = crypt(&mEctxt, MBEDTLS_AES_ENCRYPT, addr, buf, size);
 
     // write data
-    esp_err_t result = esp_partition_write(mESPPartition, addr, buf, size);
+    if (result == ESP_OK) {
+        result = esp_partition_write(mESPPartition, addr, buf, size);
+    }
 
-    delete buf;
+    delete [] buf;
 
     return result;
 }
@@ -34,6 +34,11 @@ public:
     esp_err_t write(size_t dst_offset, const void* src, size_t size) override;
 
 protected:
+    /**
+     * Encrypts or decrypts (depending on mode) a range of whole entries in place, starting at partition offset addr.
+     */
+    static esp_err_t crypt(mbedtls_aes_xts_context *ctx, int mode, size_t addr, uint8_t *buf, size_t size);
+
     mbedtls_aes_xts_context mEctxt;
     mbedtls_aes_xts_context mDctxt;
 };
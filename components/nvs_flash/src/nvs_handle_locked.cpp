@@ -42,6 +42,26 @@ esp_err_t NVSHandleLocked::get_blob(const char *key, void* out_blob, size_t len)
     return handle->get_blob(key, out_blob, len);
 }
 
+esp_err_t NVSHandleLocked::get_string(const char *key, NVSData &out) {
+    Lock lock;
+    return handle->get_string(key, out);
+}
+
+esp_err_t NVSHandleLocked::get_blob(const char *key, NVSData &out) {
+    Lock lock;
+    return handle->get_blob(key, out);
+}
+
+esp_err_t NVSHandleLocked::visit_string(const char *key, NVSDataVisitor &visitor) {
+    Lock lock;
+    return handle->visit_string(key, visitor);
+}
+
+esp_err_t NVSHandleLocked::visit_blob(const char *key, NVSDataVisitor &visitor) {
+    Lock lock;
+    return handle->visit_blob(key, visitor);
+}
+
 esp_err_t NVSHandleLocked::get_item_size(ItemType datatype, const char *key, size_t &size) {
     Lock lock;
     return handle->get_item_size(datatype, key, size);
@@ -62,11 +82,31 @@ esp_err_t NVSHandleLocked::commit() {
     return handle->commit();
 }
 
+esp_err_t NVSHandleLocked::begin_batch() {
+    Lock lock;
+    return handle->begin_batch();
+}
+
+esp_err_t NVSHandleLocked::abort_batch() {
+    Lock lock;
+    return handle->abort_batch();
+}
+
 esp_err_t NVSHandleLocked::get_used_entry_count(size_t& usedEntries) {
     Lock lock;
     return handle->get_used_entry_count(usedEntries);
 }
 
+std::unique_ptr<NVSBlobWriter> NVSHandleLocked::open_blob_writer(const char *key, esp_err_t *err) {
+    Lock lock;
+    return handle->open_blob_writer(key, err);
+}
+
+std::unique_ptr<NVSBlobReader> NVSHandleLocked::open_blob_reader(const char *key, esp_err_t *err) {
+    Lock lock;
+    return handle->open_blob_reader(key, err);
+}
+
 esp_err_t NVSHandleLocked::set_typed_item(ItemType datatype, const char *key, const void* data, size_t dataSize) {
     Lock lock;
     return handle->set_typed_item(datatype, key, data, dataSize);
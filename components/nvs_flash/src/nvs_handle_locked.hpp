@@ -47,6 +47,14 @@ public:
 
     esp_err_t get_blob(const char *key, void* out_blob, size_t len) override;
 
+    esp_err_t get_string(const char *key, NVSData &out) override;
+
+    esp_err_t get_blob(const char *key, NVSData &out) override;
+
+    esp_err_t visit_string(const char *key, NVSDataVisitor &visitor) override;
+
+    esp_err_t visit_blob(const char *key, NVSDataVisitor &visitor) override;
+
     esp_err_t get_item_size(ItemType datatype, const char *key, size_t &size) override;
 
     esp_err_t erase_item(const char* key) override;
@@ -55,8 +63,16 @@ public:
 
     esp_err_t commit() override;
 
+    esp_err_t begin_batch() override;
+
+    esp_err_t abort_batch() override;
+
     esp_err_t get_used_entry_count(size_t& usedEntries) override;
 
+    std::unique_ptr<NVSBlobWriter> open_blob_writer(const char *key, esp_err_t *err = nullptr) override;
+
+    std::unique_ptr<NVSBlobReader> open_blob_reader(const char *key, esp_err_t *err = nullptr) override;
+
 protected:
     esp_err_t set_typed_item(ItemType datatype, const char *key, const void* data, size_t dataSize) override;
 
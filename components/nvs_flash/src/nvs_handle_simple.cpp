@@ -12,12 +12,21 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #include <cstdlib>
+#include <cstring>
+#include <algorithm>
 #include "nvs_handle.hpp"
 #include "nvs_partition_manager.hpp"
 
 namespace nvs {
 
 NVSHandleSimple::~NVSHandleSimple() {
+    mBatch.clearAndFreeNodes();
+    while (!mBlobWriters.empty()) {
+        mBlobWriters.front().detach();
+    }
+    while (!mBlobReaders.empty()) {
+        mBlobReaders.front().detach();
+    }
     NVSPartitionManager::get_instance()->close_handle(this);
 }
 
@@ -25,6 +34,7 @@ esp_err_t NVSHandleSimple::set_typed_item(ItemType datatype, const char *key, co
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mInBatch) return stageItem(datatype, key, data, dataSize);
 
     return mStoragePtr->writeItem(mNsIndex, datatype, key, data, dataSize);
 }
@@ -40,6 +50,7 @@ esp_err_t NVSHandleSimple::set_string(const char *key, const char* str)
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mInBatch) return stageItem(nvs::ItemType::SZ, key, str, strlen(str) + 1);
 
     return mStoragePtr->writeItem(mNsIndex, nvs::ItemType::SZ, key, str, strlen(str) + 1);
 }
@@ -48,6 +59,7 @@ esp_err_t NVSHandleSimple::set_blob(const char *key, const void* blob, size_t le
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mInBatch) return stageItem(nvs::ItemType::BLOB, key, blob, len);
 
     return mStoragePtr->writeItem(mNsIndex, nvs::ItemType::BLOB, key, blob, len);
 }
@@ -66,6 +78,30 @@ esp_err_t NVSHandleSimple::get_blob(const char *key, void* out_blob, size_t len)
     return mStoragePtr->readItem(mNsIndex, nvs::ItemType::BLOB, key, out_blob, len);
 }
 
+esp_err_t NVSHandleSimple::get_string(const char *key, NVSData &out)
+{
+    return visit_string(key, out);
+}
+
+esp_err_t NVSHandleSimple::get_blob(const char *key, NVSData &out)
+{
+    return visit_blob(key, out);
+}
+
+esp_err_t NVSHandleSimple::visit_string(const char *key, NVSDataVisitor &visitor)
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+
+    return mStoragePtr->visitItem(mNsIndex, nvs::ItemType::SZ, key, visitor);
+}
+
+esp_err_t NVSHandleSimple::visit_blob(const char *key, NVSDataVisitor &visitor)
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+
+    return mStoragePtr->visitItem(mNsIndex, nvs::ItemType::BLOB, key, visitor);
+}
+
 esp_err_t NVSHandleSimple::get_item_size(ItemType datatype, const char *key, size_t &size)
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
@@ -77,6 +113,7 @@ esp_err_t NVSHandleSimple::erase_item(const char* key)
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mInBatch) return ESP_ERR_NVS_INVALID_STATE;
 
     return mStoragePtr->eraseItem(mNsIndex, key);
 }
@@ -85,6 +122,7 @@ esp_err_t NVSHandleSimple::erase_all()
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mInBatch) return ESP_ERR_NVS_INVALID_STATE;
 
     return mStoragePtr->eraseNamespace(mNsIndex);
 }
@@ -92,7 +130,88 @@ esp_err_t NVSHandleSimple::erase_all()
 esp_err_t NVSHandleSimple::commit()
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!mInBatch) return ESP_OK;
+
+    esp_err_t err = mStoragePtr->writeBatch(mNsIndex, mBatch);
+    mBatch.clearAndFreeNodes();
+    mInBatch = false;
+    return err;
+}
+
+esp_err_t NVSHandleSimple::begin_batch()
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mInBatch) return ESP_ERR_NVS_INVALID_STATE;
+
+    mInBatch = true;
+    mBatchEntryCount = 1;
+    return ESP_OK;
+}
+
+esp_err_t NVSHandleSimple::abort_batch()
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!mInBatch) return ESP_ERR_NVS_INVALID_STATE;
+
+    mBatch.clearAndFreeNodes();
+    mInBatch = false;
+    return ESP_OK;
+}
+
+static size_t batchEntryCount(ItemType datatype, size_t dataSize)
+{
+    if (datatype == ItemType::BLOB) {
+        // one chunk and the blob index
+        return Page::getItemEntryCount(ItemType::BLOB_DATA, dataSize) + 1;
+    }
+    return Page::getItemEntryCount(datatype, dataSize);
+}
+
+esp_err_t NVSHandleSimple::stageItem(ItemType datatype, const char *key, const void *data, size_t dataSize)
+{
+    if (strlen(key) > Item::MAX_KEY_LENGTH) {
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    }
+    if (dataSize > Page::CHUNK_MAX_SIZE) {
+        return ESP_ERR_NVS_VALUE_TOO_LONG;
+    }
+
+    // a value staged again replaces the previous one
+    auto prev = std::find_if(std::begin(mBatch), std::end(mBatch), [=](const Storage::BatchItem& item) -> bool {
+        return item.datatype == datatype && strcmp(item.key, key) == 0;
+    });
+    size_t prevEntryCount = 0;
+    if (prev != std::end(mBatch)) {
+        prevEntryCount = batchEntryCount(prev->datatype, prev->dataSize);
+    }
 
+    const size_t entryCount = batchEntryCount(datatype, dataSize);
+    if (mBatchEntryCount - prevEntryCount + entryCount > Page::ENTRY_COUNT) {
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+
+    Storage::BatchItem* item = new (std::nothrow) Storage::BatchItem;
+    if (!item) {
+        return ESP_ERR_NO_MEM;
+    }
+    item->data = new (std::nothrow) uint8_t[dataSize];
+    if (!item->data) {
+        delete item;
+        return ESP_ERR_NO_MEM;
+    }
+    item->datatype = datatype;
+    strncpy(item->key, key, sizeof(item->key));
+    memcpy(item->data, data, dataSize);
+    item->dataSize = dataSize;
+
+    if (prev != std::end(mBatch)) {
+        Storage::BatchItem* prevItem = prev;
+        mBatch.erase(prev);
+        delete prevItem;
+    }
+    mBatch.push_back(item);
+    mBatchEntryCount += entryCount - prevEntryCount;
     return ESP_OK;
 }
 
@@ -134,4 +253,292 @@ const char *NVSHandleSimple::get_partition_name() const {
     return mStoragePtr->getPartName();
 }
 
+std::unique_ptr<NVSBlobWriter> NVSHandleSimple::open_blob_writer(const char *key, esp_err_t *err)
+{
+    esp_err_t result;
+    VerOffset chunkStart;
+    NVSBlobWriterSimple *writer = nullptr;
+
+    if (!valid) {
+        result = ESP_ERR_NVS_INVALID_HANDLE;
+    } else if (mReadOnly) {
+        result = ESP_ERR_NVS_READ_ONLY;
+    } else if (mInBatch) {
+        result = ESP_ERR_NVS_INVALID_STATE;
+    } else if (strlen(key) > Item::MAX_KEY_LENGTH) {
+        result = ESP_ERR_NVS_KEY_TOO_LONG;
+    } else {
+        result = mStoragePtr->beginBlobWrite(mNsIndex, key, chunkStart);
+    }
+
+    if (result == ESP_OK) {
+        uint8_t *buffer = new (std::nothrow) uint8_t[Page::CHUNK_MAX_SIZE];
+        if (buffer) {
+            writer = new (std::nothrow) NVSBlobWriterSimple(this, key, buffer, chunkStart);
+        }
+        if (writer) {
+            mBlobWriters.push_back(writer);
+        } else {
+            delete[] buffer;
+            mStoragePtr->abortBlobWrite(mNsIndex, key, 0, chunkStart);
+            result = ESP_ERR_NO_MEM;
+        }
+    }
+
+    if (err) {
+        *err = result;
+    }
+    return std::unique_ptr<NVSBlobWriter>(writer);
+}
+
+std::unique_ptr<NVSBlobReader> NVSHandleSimple::open_blob_reader(const char *key, esp_err_t *err)
+{
+    esp_err_t result;
+    size_t dataSize = 0;
+    uint8_t chunkCount = 0;
+    VerOffset chunkStart = VerOffset::VER_0_OFFSET;
+    bool legacy = false;
+    uint8_t *buffer = nullptr;
+    size_t bufferSize = 0;
+    NVSBlobReaderSimple *reader = nullptr;
+
+    if (!valid) {
+        result = ESP_ERR_NVS_INVALID_HANDLE;
+    } else if (strlen(key) > Item::MAX_KEY_LENGTH) {
+        result = ESP_ERR_NVS_KEY_TOO_LONG;
+    } else {
+        result = mStoragePtr->findBlobIndex(mNsIndex, key, dataSize, chunkCount, chunkStart);
+        if (result == ESP_ERR_NVS_NOT_FOUND) {
+            // the blob may have been stored using the old format, in a single item
+            result = mStoragePtr->getItemDataSize(mNsIndex, ItemType::BLOB, key, dataSize);
+            legacy = true;
+        }
+    }
+
+    if (result == ESP_OK && dataSize > 0) {
+        bufferSize = std::min(dataSize, static_cast<size_t>(Page::CHUNK_MAX_SIZE));
+        buffer = new (std::nothrow) uint8_t[bufferSize];
+        if (!buffer) {
+            result = ESP_ERR_NO_MEM;
+        }
+    }
+
+    // the reader is only created once nothing can fail any more, its destructor takes the lock
+    if (result == ESP_OK) {
+        reader = new (std::nothrow) NVSBlobReaderSimple(this, key, buffer, bufferSize);
+        if (reader) {
+            reader->mDataSize = dataSize;
+            reader->mChunkCount = chunkCount;
+            reader->mChunkStart = chunkStart;
+            reader->mLegacy = legacy;
+            mBlobReaders.push_back(reader);
+        } else {
+            delete[] buffer;
+            result = ESP_ERR_NO_MEM;
+        }
+    }
+
+    if (err) {
+        *err = result;
+    }
+    return std::unique_ptr<NVSBlobReader>(reader);
+}
+
+NVSBlobWriterSimple::NVSBlobWriterSimple(NVSHandleSimple *handle, const char *key, uint8_t *buffer, VerOffset chunkStart) :
+    mHandle(handle),
+    mBuffer(buffer),
+    mBufferLen(0),
+    mDataSize(0),
+    mChunkCount(0),
+    mChunkStart(chunkStart),
+    mDone(false)
+{
+    strncpy(mKey, key, sizeof(mKey));
+}
+
+NVSBlobWriterSimple::~NVSBlobWriterSimple()
+{
+    Lock lock;
+    if (mHandle) {
+        detach();
+    }
+    delete[] mBuffer;
+}
+
+void NVSBlobWriterSimple::detach()
+{
+    if (!mDone && mHandle->valid) {
+        mHandle->mStoragePtr->abortBlobWrite(mHandle->mNsIndex, mKey, mChunkCount, mChunkStart);
+        mDone = true;
+    }
+    mHandle->mBlobWriters.erase(this);
+    mHandle = nullptr;
+}
+
+esp_err_t NVSBlobWriterSimple::write(const void *data, size_t len)
+{
+    Lock lock;
+    if (!mHandle || !mHandle->valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (mDone) return ESP_ERR_NVS_INVALID_STATE;
+
+    const uint8_t *src = static_cast<const uint8_t*>(data);
+    while (len > 0) {
+        esp_err_t err;
+        if (mBufferLen == 0 && len >= Page::CHUNK_MAX_SIZE) {
+            // enough data for any chunk, no need to copy it
+            size_t written;
+            err = writeChunk(src, len, written);
+            src += written;
+            len -= written;
+        } else {
+            const size_t count = std::min(len, Page::CHUNK_MAX_SIZE - mBufferLen);
+            memcpy(mBuffer + mBufferLen, src, count);
+            mBufferLen += count;
+            src += count;
+            len -= count;
+            err = (mBufferLen == Page::CHUNK_MAX_SIZE) ? flushBuffer() : ESP_OK;
+        }
+        if (err != ESP_OK) {
+            return fail(err);
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t NVSBlobWriterSimple::finish()
+{
+    Lock lock;
+    if (!mHandle || !mHandle->valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (mDone) return ESP_ERR_NVS_INVALID_STATE;
+
+    // an empty blob still has one (empty) chunk
+    while (mBufferLen > 0 || mChunkCount == 0) {
+        esp_err_t err = flushBuffer();
+        if (err != ESP_OK) {
+            return fail(err);
+        }
+    }
+
+    esp_err_t err = mHandle->mStoragePtr->finishBlobWrite(mHandle->mNsIndex, mKey, mDataSize, mChunkCount, mChunkStart);
+    if (err != ESP_OK && err != ESP_ERR_NVS_REMOVE_FAILED) {
+        return fail(err);
+    }
+    // the new value is in place, even if the previous one couldn't be removed
+    mDone = true;
+    return err;
+}
+
+esp_err_t NVSBlobWriterSimple::writeChunk(const uint8_t *data, size_t len, size_t &written)
+{
+    written = 0;
+    if (mChunkCount == (Page::CHUNK_ANY - 1) / 2) {
+        return ESP_ERR_NVS_VALUE_TOO_LONG;
+    }
+
+    esp_err_t err = mHandle->mStoragePtr->writeBlobChunk(mHandle->mNsIndex, mKey, data, len,
+            static_cast<uint8_t>(mChunkStart) + mChunkCount, written);
+    // count the chunk even if writing failed, so that what has been written of it gets erased
+    mChunkCount++;
+    if (err != ESP_OK) {
+        return err;
+    }
+    mDataSize += written;
+    return ESP_OK;
+}
+
+esp_err_t NVSBlobWriterSimple::flushBuffer()
+{
+    size_t written;
+    esp_err_t err = writeChunk(mBuffer, mBufferLen, written);
+    if (err != ESP_OK) {
+        return err;
+    }
+    memmove(mBuffer, mBuffer + written, mBufferLen - written);
+    mBufferLen -= written;
+    return ESP_OK;
+}
+
+esp_err_t NVSBlobWriterSimple::fail(esp_err_t err)
+{
+    mHandle->mStoragePtr->abortBlobWrite(mHandle->mNsIndex, mKey, mChunkCount, mChunkStart);
+    mBufferLen = 0;
+    mDone = true;
+    return err;
+}
+
+NVSBlobReaderSimple::NVSBlobReaderSimple(NVSHandleSimple *handle, const char *key, uint8_t *buffer, size_t bufferSize) :
+    mHandle(handle),
+    mBuffer(buffer),
+    mBufferSize(bufferSize),
+    mBufferLen(0),
+    mBufferPos(0),
+    mDataSize(0),
+    mOffset(0),
+    mChunkCount(0),
+    mNextChunk(0),
+    mChunkStart(VerOffset::VER_0_OFFSET),
+    mLegacy(false)
+{
+    strncpy(mKey, key, sizeof(mKey));
+}
+
+NVSBlobReaderSimple::~NVSBlobReaderSimple()
+{
+    Lock lock;
+    if (mHandle) {
+        detach();
+    }
+    delete[] mBuffer;
+}
+
+void NVSBlobReaderSimple::detach()
+{
+    mHandle->mBlobReaders.erase(this);
+    mHandle = nullptr;
+}
+
+esp_err_t NVSBlobReaderSimple::read(void *data, size_t len, size_t &readLen)
+{
+    Lock lock;
+    readLen = 0;
+    if (!mHandle || !mHandle->valid) return ESP_ERR_NVS_INVALID_HANDLE;
+
+    uint8_t *dst = static_cast<uint8_t*>(data);
+    while (len > 0 && mOffset < mDataSize) {
+        if (mBufferPos == mBufferLen) {
+            esp_err_t err = readChunk();
+            if (err != ESP_OK) {
+                return err;
+            }
+            continue;
+        }
+        const size_t count = std::min(std::min(len, mBufferLen - mBufferPos), mDataSize - mOffset);
+        memcpy(dst, mBuffer + mBufferPos, count);
+        mBufferPos += count;
+        mOffset += count;
+        dst += count;
+        len -= count;
+        readLen += count;
+    }
+    return ESP_OK;
+}
+
+esp_err_t NVSBlobReaderSimple::readChunk()
+{
+    const uint8_t chunkCount = mLegacy ? 1 : mChunkCount;
+    if (mNextChunk == chunkCount) {
+        // the chunks hold less data than the blob index says
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    const uint8_t chunkIndex = mLegacy ? Page::CHUNK_ANY : static_cast<uint8_t>(mChunkStart) + mNextChunk;
+    esp_err_t err = mHandle->mStoragePtr->readBlobChunk(mHandle->mNsIndex, mKey, chunkIndex, mBuffer, mBufferSize, mBufferLen);
+    if (err != ESP_OK) {
+        return err;
+    }
+    mNextChunk++;
+    mBufferPos = 0;
+    return ESP_OK;
+}
+
 }
@@ -14,6 +14,7 @@
 #ifndef NVS_HANDLE_SIMPLE_HPP_
 #define NVS_HANDLE_SIMPLE_HPP_
 
+#include <memory>
 #include "intrusive_list.h"
 #include "nvs_storage.hpp"
 #include "nvs_platform.hpp"
@@ -22,6 +23,145 @@
 
 namespace nvs {
 
+class NVSHandleSimple;
+
+/**
+ * @brief Writes a blob in pieces, see NVSHandle::open_blob_writer().
+ *
+ * Unlike NVSHandleSimple, the member functions take the NVS lock themselves, since the writer is used directly by
+ * both the C and the C++ API. Hence, they must not be called with the lock held. The handle detaches the writer
+ * when it is destroyed, after which the writer fails with ESP_ERR_NVS_INVALID_HANDLE.
+ */
+class NVSBlobWriterSimple : public intrusive_list_node<NVSBlobWriterSimple>, public NVSBlobWriter {
+    friend class NVSHandleSimple;
+public:
+    ~NVSBlobWriterSimple();
+
+    esp_err_t write(const void *data, size_t len) override;
+
+    esp_err_t finish() override;
+
+    size_t size() const override
+    {
+        return mDataSize + mBufferLen;
+    }
+
+private:
+    NVSBlobWriterSimple(NVSHandleSimple *handle, const char *key, uint8_t *buffer, VerOffset chunkStart);
+
+    /**
+     * Discards the data if the writer hasn't finished and detaches the writer from its handle, with the lock held.
+     */
+    void detach();
+
+    /**
+     * Writes the first len bytes of data as the next chunk, or fewer if they don't fit into the current page.
+     */
+    esp_err_t writeChunk(const uint8_t *data, size_t len, size_t &written);
+
+    /**
+     * Writes the first bytes of mBuffer as the next chunk and moves the rest to its start.
+     */
+    esp_err_t flushBuffer();
+
+    esp_err_t fail(esp_err_t err);
+
+    /**
+     * The handle which has opened the writer, or nullptr after it has been destroyed.
+     */
+    NVSHandleSimple *mHandle;
+
+    char mKey[Item::MAX_KEY_LENGTH + 1];
+
+    /**
+     * Data not written yet, of Page::CHUNK_MAX_SIZE bytes.
+     */
+    uint8_t *mBuffer;
+
+    size_t mBufferLen;
+
+    /**
+     * Size of the data written to the chunks so far.
+     */
+    size_t mDataSize;
+
+    uint8_t mChunkCount;
+
+    VerOffset mChunkStart;
+
+    /**
+     * Whether finish() has succeeded or an error has occurred. In both cases, the writer can't be used any more.
+     */
+    bool mDone;
+};
+
+/**
+ * @brief Reads a blob in pieces, see NVSHandle::open_blob_reader().
+ *
+ * Takes the NVS lock and is detached by its handle in the same way as NVSBlobWriterSimple.
+ */
+class NVSBlobReaderSimple : public intrusive_list_node<NVSBlobReaderSimple>, public NVSBlobReader {
+    friend class NVSHandleSimple;
+public:
+    ~NVSBlobReaderSimple();
+
+    esp_err_t read(void *data, size_t len, size_t &readLen) override;
+
+    size_t size() const override
+    {
+        return mDataSize;
+    }
+
+private:
+    NVSBlobReaderSimple(NVSHandleSimple *handle, const char *key, uint8_t *buffer, size_t bufferSize);
+
+    /**
+     * Detaches the reader from its handle, with the lock held.
+     */
+    void detach();
+
+    /**
+     * Reads the next chunk into mBuffer.
+     */
+    esp_err_t readChunk();
+
+    /**
+     * The handle which has opened the reader, or nullptr after it has been destroyed.
+     */
+    NVSHandleSimple *mHandle;
+
+    char mKey[Item::MAX_KEY_LENGTH + 1];
+
+    /**
+     * The current chunk, of up to mBufferSize bytes.
+     */
+    uint8_t *mBuffer;
+
+    size_t mBufferSize;
+
+    size_t mBufferLen;
+
+    size_t mBufferPos;
+
+    size_t mDataSize;
+
+    /**
+     * Number of bytes passed to the caller so far.
+     */
+    size_t mOffset;
+
+    uint8_t mChunkCount;
+
+    uint8_t mNextChunk;
+
+    VerOffset mChunkStart;
+
+    /**
+     * Whether the blob is stored in a single item, as done before blobs could span multiple pages.
+     */
+    bool mLegacy;
+};
+
 /**
  * @brief This class implements NVSHandle according to the ESP32's flash and partitioning scheme.
  *
@@ -37,7 +177,9 @@ public:
         mStoragePtr(StoragePtr),
         mNsIndex(nsIndex),
         mReadOnly(readOnly),
-        valid(1)
+        valid(1),
+        mInBatch(false),
+        mBatchEntryCount(0)
     { }
 
     ~NVSHandleSimple();
@@ -54,6 +196,14 @@ public:
 
     esp_err_t get_blob(const char *key, void *out_blob, size_t len) override;
 
+    esp_err_t get_string(const char *key, NVSData &out) override;
+
+    esp_err_t get_blob(const char *key, NVSData &out) override;
+
+    esp_err_t visit_string(const char *key, NVSDataVisitor &visitor) override;
+
+    esp_err_t visit_blob(const char *key, NVSDataVisitor &visitor) override;
+
     esp_err_t get_item_size(ItemType datatype, const char *key, size_t &size) override;
 
     esp_err_t erase_item(const char *key) override;
@@ -62,8 +212,16 @@ public:
 
     esp_err_t commit() override;
 
+    esp_err_t begin_batch() override;
+
+    esp_err_t abort_batch() override;
+
     esp_err_t get_used_entry_count(size_t &usedEntries) override;
 
+    std::unique_ptr<NVSBlobWriter> open_blob_writer(const char *key, esp_err_t *err = nullptr) override;
+
+    std::unique_ptr<NVSBlobReader> open_blob_reader(const char *key, esp_err_t *err = nullptr) override;
+
     esp_err_t getItemDataSize(ItemType datatype, const char *key, size_t &dataSize);
 
     void debugDump();
@@ -79,6 +237,14 @@ public:
     const char *get_partition_name() const;
 
 private:
+    friend class NVSBlobWriterSimple;
+    friend class NVSBlobReaderSimple;
+
+    /**
+     * Keeps an item in mBatch instead of writing it to the storage right away.
+     */
+    esp_err_t stageItem(ItemType datatype, const char *key, const void *data, size_t dataSize);
+
     /**
      * The underlying storage's object.
      */
@@ -100,6 +266,28 @@ private:
      * Upon opening, a handle is valid. It becomes invalid if the underlying storage is de-initialized.
      */
     uint8_t valid;
+
+    /**
+     * Whether set operations are currently staged in mBatch, see begin_batch().
+     */
+    bool mInBatch;
+
+    /**
+     * Number of page entries the batch will take when written, including its marker.
+     */
+    size_t mBatchEntryCount;
+
+    /**
+     * Items staged since begin_batch(), written by commit().
+     */
+    Storage::TBatchItems mBatch;
+
+    /**
+     * Blob streams opened by this handle, detached when it is destroyed.
+     */
+    intrusive_list<NVSBlobWriterSimple> mBlobWriters;
+
+    intrusive_list<NVSBlobReaderSimple> mBlobReaders;
 };
 
 } // nvs
@@ -0,0 +1,132 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef nvs_item_hash_table_hpp
+#define nvs_item_hash_table_hpp
+
+#include <cassert>
+#include <cstdint>
+#include "nvs.h"
+#include "nvs_types.hpp"
+
+namespace nvs
+{
+
+/**
+ * Drop-in alternative to HashList for a page holding at most ENTRY_COUNT entries.
+ *
+ * Hashes are kept in an open addressing table stored inline in the object, so no memory is
+ * allocated and a lookup only probes the slots following the one its hash maps to. Uses linear
+ * probing with backward shift deletion, so erased items don't leave tombstones behind and the
+ * table is never more than 3/4 full.
+ */
+template<size_t ENTRY_COUNT>
+class HashTable
+{
+public:
+    HashTable()
+    {
+        clear();
+    }
+
+    esp_err_t insert(const Item& item, size_t index)
+    {
+        assert(index < ENTRY_COUNT);
+        erase(index);
+
+        const uint32_t hash_24 = item.calculateCrc32WithoutValue() & 0xffffff;
+        size_t slot = hash_24 % SLOT_COUNT;
+        while (mNodes[slot].mIndex != EMPTY) {
+            slot = next(slot);
+        }
+        mNodes[slot] = HashTableNode(hash_24, index);
+        mSlots[index] = slot;
+        return ESP_OK;
+    }
+
+    bool erase(size_t index)
+    {
+        if (index >= ENTRY_COUNT || mSlots[index] == EMPTY) {
+            return false;
+        }
+
+        size_t hole = mSlots[index];
+        mSlots[index] = EMPTY;
+        // move back the following nodes of the probe sequence which could no longer be reached
+        for (size_t slot = next(hole); mNodes[slot].mIndex != EMPTY; slot = next(slot)) {
+            const size_t home = mNodes[slot].mHash % SLOT_COUNT;
+            if (distance(home, slot) >= distance(hole, slot)) {
+                mNodes[hole] = mNodes[slot];
+                mSlots[mNodes[hole].mIndex] = hole;
+                hole = slot;
+            }
+        }
+        mNodes[hole] = HashTableNode();
+        return true;
+    }
+
+    /**
+     * Returns the lowest index not less than start whose hash matches the one of item, or SIZE_MAX.
+     */
+    size_t find(size_t start, const Item& item)
+    {
+        const uint32_t hash_24 = item.calculateCrc32WithoutValue() & 0xffffff;
+        size_t found = SIZE_MAX;
+        for (size_t slot = hash_24 % SLOT_COUNT; mNodes[slot].mIndex != EMPTY; slot = next(slot)) {
+            const HashTableNode& e = mNodes[slot];
+            if (e.mHash == hash_24 && e.mIndex >= start && e.mIndex < found) {
+                found = e.mIndex;
+            }
+        }
+        return found;
+    }
+
+    void clear()
+    {
+        for (size_t i = 0; i < SLOT_COUNT; ++i) {
+            mNodes[i] = HashTableNode();
+        }
+        for (size_t i = 0; i < ENTRY_COUNT; ++i) {
+            mSlots[i] = EMPTY;
+        }
+    }
+
+protected:
+    static const size_t SLOT_COUNT = ENTRY_COUNT + ENTRY_COUNT / 3;
+    static const uint8_t EMPTY = 0xff;
+    static_assert(SLOT_COUNT < EMPTY, "slot and entry indices must fit into 8 bits");
+
+    static size_t next(size_t slot)
+    {
+        return (slot + 1 == SLOT_COUNT) ? 0 : slot + 1;
+    }
+
+    static size_t distance(size_t from, size_t to)
+    {
+        return (to + SLOT_COUNT - from) % SLOT_COUNT;
+    }
+
+    struct HashTableNode {
+        HashTableNode() :
+            mIndex(EMPTY), mHash(0)
+        {
+        }
+
+        HashTableNode(uint32_t hash, size_t index) :
+            mIndex((uint32_t) index), mHash(hash)
+        {
+        }
+
+        uint32_t mIndex : 8;
+        uint32_t mHash  : 24;
+    };
+
+    HashTableNode mNodes[SLOT_COUNT];
+    uint8_t mSlots[ENTRY_COUNT]; // slot holding each entry index, or EMPTY
+}; // class HashTable
+
+} // namespace nvs
+
+#endif /* nvs_item_hash_table_hpp */
@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #include "nvs_page.hpp"
+#include "nvs_storage_index.hpp"
 #include <esp_rom_crc.h>
 #include <cstdio>
 #include <cstring>
@@ -19,7 +20,7 @@
 namespace nvs
 {
 
-Page::Page() : mPartition(nullptr) { }
+Page::Page() : mStorageIndex(nullptr), mPartition(nullptr), mPendingErase(nullptr) { }
 
 uint32_t Page::Header::calculateCrc32()
 {
@@ -28,13 +29,16 @@ uint32_t Page::Header::calculateCrc32()
                     offsetof(Header, mCrc32) - offsetof(Header, mSeqNumber));
 }
 
-esp_err_t Page::load(Partition *partition, uint32_t sectorNumber)
+esp_err_t Page::load(Partition *partition, uint32_t sectorNumber, StorageIndex *storageIndex, TPendingEraseList *pendingErase)
 {
     if (partition == nullptr) {
         return ESP_ERR_INVALID_ARG;
     }
 
     mPartition = partition;
+    mStorageIndex = storageIndex;
+    mPendingErase = pendingErase;
+    mLoaded = (pendingErase == nullptr);
     mBaseAddress = sectorNumber * SEC_SIZE;
     mUsedEntryCount = 0;
     mErasedEntryCount = 0;
@@ -47,27 +51,12 @@ esp_err_t Page::load(Partition *partition, uint32_t sectorNumber)
     }
     if (header.mState == PageState::UNINITIALIZED) {
         mState = header.mState;
-        // check if the whole page is really empty
-        // reading the whole page takes ~40 times less than erasing it
-        const int BLOCK_SIZE = 128;
-        uint32_t* block = new (std::nothrow) uint32_t[BLOCK_SIZE];
-
-        if (!block) return ESP_ERR_NO_MEM;
-
-        for (uint32_t i = 0; i < SPI_FLASH_SEC_SIZE; i += 4 * BLOCK_SIZE) {
-            rc = mPartition->read_raw(mBaseAddress + i, block, 4 * BLOCK_SIZE);
+        if (mLoaded) {
+            rc = checkErased();
             if (rc != ESP_OK) {
-                mState = PageState::INVALID;
-                delete[] block;
                 return rc;
             }
-            if (std::any_of(block, block + BLOCK_SIZE, [](uint32_t val) -> bool { return val != 0xffffffff; })) {
-                // page isn't as empty after all, mark it as corrupted
-                mState = PageState::CORRUPT;
-                break;
-            }
         }
-        delete[] block;
     } else if (header.mCrc32 != header.calculateCrc32()) {
         header.mState = PageState::CORRUPT;
     } else {
@@ -87,17 +76,87 @@ esp_err_t Page::load(Partition *partition, uint32_t sectorNumber)
     case PageState::FULL:
     case PageState::ACTIVE:
     case PageState::FREEING:
-        mLoadEntryTable();
+        if (mLoaded) {
+            mLoadEntryTable();
+        } else {
+            mLoadEntryStates();
+        }
         break;
 
     default:
         mState = PageState::CORRUPT;
+        mLoaded = true;
         break;
     }
 
     return ESP_OK;
 }
 
+esp_err_t Page::checkErased()
+{
+    // check if the whole page is really empty
+    // reading the whole page takes ~40 times less than erasing it
+    const int BLOCK_SIZE = 128;
+    uint32_t* block = new (std::nothrow) uint32_t[BLOCK_SIZE];
+
+    if (!block) return ESP_ERR_NO_MEM;
+
+    for (uint32_t i = 0; i < SPI_FLASH_SEC_SIZE; i += 4 * BLOCK_SIZE) {
+        auto rc = mPartition->read_raw(mBaseAddress + i, block, 4 * BLOCK_SIZE);
+        if (rc != ESP_OK) {
+            mState = PageState::INVALID;
+            delete[] block;
+            return rc;
+        }
+        if (std::any_of(block, block + BLOCK_SIZE, [](uint32_t val) -> bool { return val != 0xffffffff; })) {
+            // page isn't as empty after all, mark it as corrupted
+            mState = PageState::CORRUPT;
+            break;
+        }
+    }
+    delete[] block;
+    return ESP_OK;
+}
+
+esp_err_t Page::ensureLoaded()
+{
+    if (mLoaded) {
+        return ESP_OK;
+    }
+    mLoaded = true;
+
+    if (mState == PageState::UNINITIALIZED) {
+        return checkErased();
+    }
+
+    if (mState != PageState::ACTIVE && mState != PageState::FULL && mState != PageState::FREEING) {
+        return ESP_OK;
+    }
+
+    auto err = mLoadEntryTable();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // older versions of items which were found to be duplicated when the partition was initialized.
+    // Items of a page being freed may just have been copied to the last page, see PageManager::load
+    if (mState == PageState::FREEING) {
+        return ESP_OK;
+    }
+    for (auto it = mPendingErase->begin(); it != mPendingErase->end(); ++it) {
+        const Item& item = it->mItem;
+        err = eraseItem(item.nsIndex, item.datatype, item.key, item.chunkIndex);
+        if (err != ESP_OK && item.datatype == ItemType::BLOB_IDX) {
+            // the blob may have been stored using the old format, see PageManager::eraseOlderDuplicate
+            err = eraseItem(item.nsIndex, ItemType::BLOB, item.key, item.chunkIndex);
+        }
+        if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND && err != ESP_ERR_NVS_TYPE_MISMATCH) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
 esp_err_t Page::writeEntry(const Item& item)
 {
     esp_err_t err;
@@ -180,6 +239,11 @@ esp_err_t Page::writeItem(uint8_t nsIndex, ItemType datatype, const char* key, c
         return ESP_ERR_NVS_INVALID_STATE;
     }
 
+    err = ensureLoaded();
+    if (err != ESP_OK) {
+        return err;
+    }
+
     if (mState == PageState::UNINITIALIZED) {
         err = initialize();
         if (err != ESP_OK) {
@@ -226,6 +290,10 @@ esp_err_t Page::writeItem(uint8_t nsIndex, ItemType datatype, const char* key, c
         return err;
     }
 
+    if (mStorageIndex) {
+        mStorageIndex->insert(item, this, mNextFreeEntry);
+    }
+
     if (!isVariableLengthType(datatype)) {
         memcpy(item.data, data, dataSize);
         item.crc32 = item.calculateCrc32();
@@ -266,6 +334,123 @@ esp_err_t Page::writeItem(uint8_t nsIndex, ItemType datatype, const char* key, c
     return ESP_OK;
 }
 
+esp_err_t Page::writeItems(const ItemData* items, size_t count, size_t& firstIndex)
+{
+    esp_err_t err;
+
+    if (mState == PageState::INVALID) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    err = ensureLoaded();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    if (mState == PageState::UNINITIALIZED) {
+        err = initialize();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    if (mState == PageState::FULL) {
+        return ESP_ERR_NVS_PAGE_FULL;
+    }
+
+    size_t entriesCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (strlen(items[i].key) > Item::MAX_KEY_LENGTH) {
+            return ESP_ERR_NVS_KEY_TOO_LONG;
+        }
+        if (items[i].dataSize > Page::CHUNK_MAX_SIZE ||
+                (!isVariableLengthType(items[i].datatype) && items[i].dataSize > sizeof(Item::data))) {
+            return ESP_ERR_NVS_VALUE_TOO_LONG;
+        }
+        entriesCount += getItemEntryCount(items[i].datatype, items[i].dataSize);
+    }
+
+    if (entriesCount == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (mNextFreeEntry == INVALID_ENTRY || mNextFreeEntry + entriesCount > ENTRY_COUNT) {
+        // page will not fit this amount of data
+        return ESP_ERR_NVS_PAGE_FULL;
+    }
+
+    Item* entries = new (std::nothrow) Item[entriesCount];
+    if (!entries) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // lay out all the items the way writeItem would write them, one after another
+    size_t index = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const ItemData& src = items[i];
+        size_t span = getItemEntryCount(src.datatype, src.dataSize);
+        Item& item = entries[index];
+        item = Item(src.nsIndex, src.datatype, span, src.key, src.chunkIdx);
+
+        if (!isVariableLengthType(src.datatype)) {
+            memcpy(item.data, src.data, src.dataSize);
+        } else {
+            const uint8_t* data = static_cast<const uint8_t*>(src.data);
+            item.varLength.dataCrc32 = Item::calculateCrc32(data, src.dataSize);
+            item.varLength.dataSize = src.dataSize;
+            item.varLength.reserved = 0xffff;
+            for (size_t j = 1; j < span; ++j) {
+                size_t offset = (j - 1) * ENTRY_SIZE;
+                size_t size = std::min(static_cast<size_t>(ENTRY_SIZE), src.dataSize - offset);
+                std::fill_n(entries[index + j].rawData, ENTRY_SIZE, 0xff);
+                memcpy(entries[index + j].rawData, data + offset, size);
+            }
+        }
+        item.crc32 = item.calculateCrc32();
+        index += span;
+    }
+
+    for (index = 0; index < entriesCount; index += entries[index].span) {
+        err = mHashList.insert(entries[index], mNextFreeEntry + index);
+        if (err != ESP_OK) {
+            for (size_t j = 0; j < index; j += entries[j].span) {
+                mHashList.erase(mNextFreeEntry + j);
+                if (mStorageIndex) {
+                    mStorageIndex->erase(entries[j], this, mNextFreeEntry + j);
+                }
+            }
+            delete[] entries;
+            return err;
+        }
+
+        if (mStorageIndex) {
+            mStorageIndex->insert(entries[index], this, mNextFreeEntry + index);
+        }
+    }
+
+    err = mPartition->write(getEntryAddress(mNextFreeEntry), entries, entriesCount * ENTRY_SIZE);
+    delete[] entries;
+    if (err != ESP_OK) {
+        mState = PageState::INVALID;
+        return err;
+    }
+
+    // until the state word of the first entry has been written, none of the items is visible
+    err = alterEntryRangeState(mNextFreeEntry, mNextFreeEntry + entriesCount, EntryState::WRITTEN);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    if (mFirstUsedEntry == INVALID_ENTRY) {
+        mFirstUsedEntry = mNextFreeEntry;
+    }
+
+    firstIndex = mNextFreeEntry;
+    mUsedEntryCount += entriesCount;
+    mNextFreeEntry += entriesCount;
+    return ESP_OK;
+}
+
 esp_err_t Page::readItem(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize, uint8_t chunkIdx, VerOffset chunkStart)
 {
     size_t index = 0;
@@ -293,21 +478,35 @@ esp_err_t Page::readItem(uint8_t nsIndex, ItemType datatype, const char* key, vo
         return ESP_ERR_NVS_INVALID_LENGTH;
     }
 
+    return readItemData(index, item, data);
+}
+
+esp_err_t Page::readItemData(size_t index, const Item& item, void* data)
+{
+    esp_err_t rc;
     uint8_t* dst = reinterpret_cast<uint8_t*>(data);
-    size_t left = item.varLength.dataSize;
-    for (size_t i = index + 1; i < index + item.span; ++i) {
-        Item ditem;
-        rc = readEntry(i, ditem);
-        if (rc != ESP_OK) {
-            return rc;
+    const size_t size = item.varLength.dataSize;
+    const size_t fullEntries = size / ENTRY_SIZE;
+    const size_t tail = size % ENTRY_SIZE;
+    bool valid = fullEntries + (tail ? 1 : 0) < item.span;
+    if (valid) {
+        // complete entries go straight into the caller's buffer, with one read
+        if (fullEntries) {
+            rc = readEntries(index + 1, dst, fullEntries);
+            if (rc != ESP_OK) {
+                return rc;
+            }
+        }
+        if (tail) {
+            Item ditem;
+            rc = readEntry(index + 1 + fullEntries, ditem);
+            if (rc != ESP_OK) {
+                return rc;
+            }
+            memcpy(dst + fullEntries * ENTRY_SIZE, ditem.rawData, tail);
         }
-        size_t willCopy = ENTRY_SIZE;
-        willCopy = (left < willCopy)?left:willCopy;
-        memcpy(dst, ditem.rawData, willCopy);
-        left -= willCopy;
-        dst += willCopy;
     }
-    if (Item::calculateCrc32(reinterpret_cast<uint8_t*>(data), item.varLength.dataSize) != item.varLength.dataCrc32) {
+    if (!valid || Item::calculateCrc32(dst, size) != item.varLength.dataCrc32) {
         rc = eraseEntryAndSpan(index);
         if (rc != ESP_OK) {
             return rc;
@@ -348,19 +547,19 @@ esp_err_t Page::cmpItem(uint8_t nsIndex, ItemType datatype, const char* key, con
 
     const uint8_t* dst = reinterpret_cast<const uint8_t*>(data);
     size_t left = item.varLength.dataSize;
-    for (size_t i = index + 1; i < index + item.span; ++i) {
-        Item ditem;
-        rc = readEntry(i, ditem);
+    for (size_t i = index + 1; i < index + item.span && left > 0; i += ENTRY_BATCH_COUNT) {
+        Item ditems[ENTRY_BATCH_COUNT];
+        const size_t count = std::min(static_cast<size_t>(ENTRY_BATCH_COUNT), index + item.span - i);
+        rc = readEntries(i, ditems, count);
         if (rc != ESP_OK) {
             return rc;
         }
-        size_t willCopy = ENTRY_SIZE;
-        willCopy = (left < willCopy)?left:willCopy;
-        if (memcmp(dst, ditem.rawData, willCopy)) {
+        size_t willCompare = std::min(left, count * ENTRY_SIZE);
+        if (memcmp(dst, ditems, willCompare)) {
             return ESP_ERR_NVS_CONTENT_DIFFERS;
         }
-        left -= willCopy;
-        dst += willCopy;
+        left -= willCompare;
+        dst += willCompare;
     }
     if (Item::calculateCrc32(reinterpret_cast<const uint8_t*>(data), item.varLength.dataSize) != item.varLength.dataCrc32) {
         return ESP_ERR_NVS_NOT_FOUND;
@@ -389,6 +588,11 @@ esp_err_t Page::findItem(uint8_t nsIndex, ItemType datatype, const char* key, ui
 
 esp_err_t Page::eraseEntryAndSpan(size_t index)
 {
+    auto err = ensureLoaded();
+    if (err != ESP_OK) {
+        return err;
+    }
+
     uint32_t seq_num;
     getSeqNumber(seq_num);
     auto state = mEntryTable.get(index);
@@ -410,6 +614,9 @@ esp_err_t Page::eraseEntryAndSpan(size_t index)
             }
         } else {
             mHashList.erase(index);
+            if (mStorageIndex) {
+                mStorageIndex->erase(item, this, index);
+            }
             span = item.span;
             for (ptrdiff_t i = index + span - 1; i >= static_cast<ptrdiff_t>(index); --i) {
                 if (mEntryTable.get(i) == EntryState::WRITTEN) {
@@ -462,12 +669,17 @@ void Page::updateFirstUsedEntry(size_t index, size_t span)
 
 esp_err_t Page::copyItems(Page& other)
 {
+    auto err = ensureLoaded();
+    if (err != ESP_OK) {
+        return err;
+    }
+
     if (mFirstUsedEntry == INVALID_ENTRY) {
         return ESP_ERR_NVS_NOT_FOUND;
     }
 
     if (other.mState == PageState::UNINITIALIZED) {
-        auto err = other.initialize();
+        err = other.initialize();
         if (err != ESP_OK) {
             return err;
         }
@@ -483,39 +695,105 @@ esp_err_t Page::copyItems(Page& other)
             readEntryIndex++;
             continue;
         }
-        auto err = readEntry(readEntryIndex, entry);
+        err = readEntry(readEntryIndex, entry);
         if (err != ESP_OK) {
             return err;
         }
 
-        err = other.mHashList.insert(entry, other.mNextFreeEntry);
+        err = copyEntry(readEntryIndex, entry, other);
         if (err != ESP_OK) {
             return err;
         }
+        size_t end = readEntryIndex + entry.span;
+        readEntryIndex = end;
+
+    }
+    return ESP_OK;
+}
 
-        err = other.writeEntry(entry);
+esp_err_t Page::moveFirstItem(Page& other, size_t& entryCount)
+{
+    auto err = ensureLoaded();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    if (mFirstUsedEntry == INVALID_ENTRY) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    if (other.mState == PageState::UNINITIALIZED) {
+        err = other.initialize();
         if (err != ESP_OK) {
             return err;
         }
-        size_t span = entry.span;
-        size_t end = readEntryIndex + span;
+    }
 
-        assert(end <= ENTRY_COUNT);
+    if (other.mState == PageState::FULL) {
+        return ESP_ERR_NVS_PAGE_FULL;
+    }
 
-        for (size_t i = readEntryIndex + 1; i < end; ++i) {
-            readEntry(i, entry);
-            err = other.writeEntry(entry);
-            if (err != ESP_OK) {
-                return err;
-            }
+    if (other.mState != PageState::ACTIVE) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    Item entry;
+    const size_t index = mFirstUsedEntry;
+    err = readEntry(index, entry);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    entryCount = 1;
+    if (entry.calculateCrc32() == entry.crc32) {
+        if (other.mNextFreeEntry == INVALID_ENTRY || other.mNextFreeEntry + entry.span > ENTRY_COUNT) {
+            return ESP_ERR_NVS_PAGE_FULL;
         }
-        readEntryIndex = end;
 
+        // the copy is written before the original is erased. If power goes out in between,
+        // the copy is the last item of the last page and the original gets erased as an older duplicate
+        err = copyEntry(index, entry, other);
+        if (err != ESP_OK) {
+            return err;
+        }
+        entryCount = entry.span;
+    }
+
+    return eraseEntryAndSpan(index);
+}
+
+esp_err_t Page::copyEntry(size_t index, const Item& entry, Page& other)
+{
+    auto err = other.mHashList.insert(entry, other.mNextFreeEntry);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    if (other.mStorageIndex) {
+        other.mStorageIndex->insert(entry, &other, other.mNextFreeEntry);
+    }
+
+    err = other.writeEntry(entry);
+    if (err != ESP_OK) {
+        return err;
+    }
+    size_t end = index + entry.span;
+
+    assert(end <= ENTRY_COUNT);
+
+    for (size_t i = index + 1; i < end; i += ENTRY_BATCH_COUNT) {
+        Item data[ENTRY_BATCH_COUNT];
+        const size_t count = std::min(static_cast<size_t>(ENTRY_BATCH_COUNT), end - i);
+        readEntries(i, data, count);
+        err = other.writeEntryData(reinterpret_cast<const uint8_t*>(data), count * ENTRY_SIZE);
+        if (err != ESP_OK) {
+            return err;
+        }
     }
     return ESP_OK;
 }
 
-esp_err_t Page::mLoadEntryTable()
+esp_err_t Page::mLoadEntryStates()
 {
     // for states where we actually care about data in the page, read entry state table
     if (mState == PageState::ACTIVE ||
@@ -542,6 +820,15 @@ esp_err_t Page::mLoadEntryTable()
             ++mErasedEntryCount;
         }
     }
+    return ESP_OK;
+}
+
+esp_err_t Page::mLoadEntryTable()
+{
+    auto rc = mLoadEntryStates();
+    if (rc != ESP_OK) {
+        return rc;
+    }
 
     // for PageState::ACTIVE, we may have more data written to this page
     // as such, we need to figure out where the first unused entry is
@@ -553,6 +840,36 @@ esp_err_t Page::mLoadEntryTable()
             }
         }
 
+        // entries are allocated in sequence, so written entries past the first empty one are left over
+        // from a write which was interrupted while the entry states were being altered (from the last
+        // entry towards the first one, see writeItems), and have to be discarded
+        size_t lastNonEmptyEntry = INVALID_ENTRY;
+        for (size_t i = mNextFreeEntry; i < ENTRY_COUNT; ++i) {
+            if (mEntryTable.get(i) != EntryState::EMPTY) {
+                lastNonEmptyEntry = i;
+            }
+        }
+        if (lastNonEmptyEntry != INVALID_ENTRY) {
+            for (size_t i = mNextFreeEntry; i <= lastNonEmptyEntry; ++i) {
+                auto oldState = mEntryTable.get(i);
+                if (oldState == EntryState::WRITTEN) {
+                    --mUsedEntryCount;
+                }
+                if (oldState != EntryState::ERASED) {
+                    ++mErasedEntryCount;
+                }
+            }
+            auto err = alterEntryRangeState(mNextFreeEntry, lastNonEmptyEntry + 1, EntryState::ERASED);
+            if (err != ESP_OK) {
+                mState = PageState::INVALID;
+                return err;
+            }
+            if (mFirstUsedEntry != INVALID_ENTRY && mFirstUsedEntry > mNextFreeEntry) {
+                mFirstUsedEntry = INVALID_ENTRY;
+            }
+            mNextFreeEntry = lastNonEmptyEntry + 1;
+        }
+
         // however, if power failed after some data was written into the entry.
         // but before the entry state table was altered, the entry locacted via
         // entry state table may actually be half-written.
@@ -631,6 +948,10 @@ esp_err_t Page::mLoadEntryTable()
                 return err;
             }
 
+            if (mStorageIndex) {
+                mStorageIndex->insert(item, this, i);
+            }
+
             // search for potential duplicate item
             size_t duplicateIndex = mHashList.find(0, item);
 
@@ -705,6 +1026,10 @@ esp_err_t Page::mLoadEntryTable()
                 return err;
             }
 
+            if (mStorageIndex) {
+                mStorageIndex->insert(item, this, i);
+            }
+
             size_t span = item.span;
 
             if (isVariableLengthType(item.datatype)) {
@@ -808,12 +1133,23 @@ esp_err_t Page::readEntry(size_t index, Item& dst) const
     return ESP_OK;
 }
 
+esp_err_t Page::readEntries(size_t index, void* dst, size_t count) const
+{
+    assert(index + count <= ENTRY_COUNT);
+    return mPartition->read(getEntryAddress(index), dst, count * ENTRY_SIZE);
+}
+
 esp_err_t Page::findItem(uint8_t nsIndex, ItemType datatype, const char* key, size_t &itemIndex, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
 {
     if (mState == PageState::CORRUPT || mState == PageState::INVALID || mState == PageState::UNINITIALIZED) {
         return ESP_ERR_NVS_NOT_FOUND;
     }
 
+    auto err = ensureLoaded();
+    if (err != ESP_OK) {
+        return err;
+    }
+
     size_t findBeginIndex = itemIndex;
     if (findBeginIndex >= ENTRY_COUNT) {
         return ESP_ERR_NVS_NOT_FOUND;
@@ -908,6 +1244,39 @@ esp_err_t Page::findItem(uint8_t nsIndex, ItemType datatype, const char* key, si
     return ESP_ERR_NVS_NOT_FOUND;
 }
 
+esp_err_t Page::findBatchMarker(size_t &itemIndex, Item& item)
+{
+    if (mState != PageState::ACTIVE && mState != PageState::FULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    auto err = ensureLoaded();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // the marker is written with this key, see Storage::writeBatch
+    const Item marker(NS_BATCH, ItemType::U8, 0, "batch");
+    for (size_t i = mHashList.find(itemIndex, marker); i < ENTRY_COUNT; i = mHashList.find(i + 1, marker)) {
+        if (mEntryTable.get(i) != EntryState::WRITTEN) {
+            continue;
+        }
+
+        err = readEntry(i, item);
+        if (err != ESP_OK) {
+            mState = PageState::INVALID;
+            return err;
+        }
+
+        if (item.crc32 == item.calculateCrc32() && item.nsIndex == NS_BATCH) {
+            itemIndex = i;
+            return ESP_OK;
+        }
+    }
+
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
 esp_err_t Page::getSeqNumber(uint32_t& seqNumber) const
 {
     if (mState != PageState::UNINITIALIZED && mState != PageState::INVALID && mState != PageState::CORRUPT) {
@@ -948,7 +1317,11 @@ esp_err_t Page::erase()
     mFirstUsedEntry = INVALID_ENTRY;
     mNextFreeEntry = INVALID_ENTRY;
     mState = PageState::UNINITIALIZED;
+    mLoaded = true;
     mHashList.clear();
+    if (mStorageIndex) {
+        mStorageIndex->erasePage(this);
+    }
     return ESP_OK;
 }
 
@@ -968,6 +1341,16 @@ esp_err_t Page::markFull()
     return alterPageState(PageState::FULL);
 }
 
+size_t Page::getFreeEntryCount() const
+{
+    if (mState == PageState::UNINITIALIZED) {
+        return ENTRY_COUNT;
+    } else if (mState != PageState::ACTIVE || mNextFreeEntry >= ENTRY_COUNT) {
+        return 0;
+    }
+    return ENTRY_COUNT - mNextFreeEntry;
+}
+
 size_t Page::getVarDataTailroom() const
 {
     if (mState == PageState::UNINITIALIZED) {
@@ -14,6 +14,7 @@
 #ifndef nvs_page_hpp
 #define nvs_page_hpp
 
+#include "sdkconfig.h"
 #include "nvs.h"
 #include "nvs_types.hpp"
 #include <cstdint>
@@ -24,11 +25,13 @@
 #include "compressed_enum_table.hpp"
 #include "intrusive_list.h"
 #include "nvs_item_hash_list.hpp"
+#include "nvs_item_hash_table.hpp"
 #include "partition.hpp"
 
 namespace nvs
 {
 
+class StorageIndex;
 
 class Page : public intrusive_list_node<Page>
 {
@@ -52,8 +55,19 @@ public:
     static const uint8_t NS_INDEX = 0;
     static const uint8_t NS_ANY = 255;
 
+    /**
+     * Namespace index of the marker item which precedes the items of a batch, see Storage::writeBatch.
+     * Index 255 is otherwise only used as a wildcard, so no regular item is ever stored with it.
+     */
+    static const uint8_t NS_BATCH = NS_ANY;
+
     static const uint8_t CHUNK_ANY = Item::CHUNK_ANY;
 
+    /**
+     * Number of data entries read or copied at once when data is processed in pieces.
+     */
+    static const size_t ENTRY_BATCH_COUNT = 4;
+
     static const uint8_t NVS_VERSION = 0xfe; // Decrement to upgrade
 
     enum class PageState : uint32_t {
@@ -78,6 +92,16 @@ public:
         INVALID       = 0
     };
 
+    /**
+     * Item whose older versions have to be erased from pages which are loaded lazily, see PageManager::load.
+     */
+    struct PendingErase : public intrusive_list_node<PendingErase> {
+    public:
+        Item mItem;
+    };
+
+    typedef intrusive_list<PendingErase> TPendingEraseList;
+
     Page();
 
     PageState state() const
@@ -85,7 +109,24 @@ public:
         return mState;
     }
 
-    esp_err_t load(Partition *partition, uint32_t sectorNumber);
+    /**
+     * Reads the page header and sets up the page. If pendingErase is null, the entries are read right away.
+     * Otherwise only the entry state table is read, and the rest is loaded by ensureLoaded() when the page
+     * is accessed for the first time. At that point, all items in pendingErase are erased from the page.
+     */
+    esp_err_t load(Partition *partition, uint32_t sectorNumber, StorageIndex *storageIndex = nullptr,
+            TPendingEraseList *pendingErase = nullptr);
+
+    /**
+     * Finishes loading a page which was loaded lazily: reads the entries, fills the hash list and recovers
+     * from interrupted writes. For an uninitialized page, checks that the page is really erased.
+     */
+    esp_err_t ensureLoaded();
+
+    bool isLoaded() const
+    {
+        return mLoaded;
+    }
 
     esp_err_t getSeqNumber(uint32_t& seqNumber) const;
 
@@ -95,16 +136,50 @@ public:
 
     esp_err_t writeItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize, uint8_t chunkIdx = CHUNK_ANY);
 
+    /**
+     * Describes one of the items written by writeItems().
+     */
+    struct ItemData {
+        uint8_t nsIndex;
+        ItemType datatype;
+        const char* key;
+        const void* data;
+        size_t dataSize;
+        uint8_t chunkIdx;
+    };
+
+    /**
+     * Writes several items into consecutive entries using a single flash write. The entry states are
+     * altered afterwards, from the last entry towards the first one, so that after a power loss either
+     * all of the items are visible or none of them (see mLoadEntryTable).
+     * On success, firstIndex is set to the entry index of the first item.
+     */
+    esp_err_t writeItems(const ItemData* items, size_t count, size_t& firstIndex);
+
     esp_err_t readItem(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    /**
+     * Reads the data of the variable length item found at index by findItem into data, which must hold
+     * item.varLength.dataSize bytes. If the data is corrupted, the item is erased and ESP_ERR_NVS_NOT_FOUND returned.
+     */
+    esp_err_t readItemData(size_t index, const Item& item, void* data);
+
     esp_err_t cmpItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
     esp_err_t eraseItem(uint8_t nsIndex, ItemType datatype, const char* key, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    esp_err_t eraseEntryAndSpan(size_t index);
+
     esp_err_t findItem(uint8_t nsIndex, ItemType datatype, const char* key, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
     esp_err_t findItem(uint8_t nsIndex, ItemType datatype, const char* key, size_t &itemIndex, Item& item, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    /**
+     * Finds the first batch marker at or after itemIndex, see Storage::writeBatch. findItem can't be used
+     * for this, as it takes the namespace index of the marker as a wildcard.
+     */
+    esp_err_t findBatchMarker(size_t &itemIndex, Item& item);
+
     template<typename T>
     esp_err_t writeItem(uint8_t nsIndex, const char* key, const T& value)
     {
@@ -140,12 +215,33 @@ public:
     }
     size_t getVarDataTailroom() const ;
 
+    size_t getFreeEntryCount() const;
+
+    /**
+     * Number of entries taken by an item of the given type and data size.
+     */
+    static size_t getItemEntryCount(ItemType datatype, size_t dataSize)
+    {
+        if (!isVariableLengthType(datatype)) {
+            return 1;
+        }
+        return 1 + (dataSize + ENTRY_SIZE - 1) / ENTRY_SIZE;
+    }
+
     esp_err_t markFull();
 
     esp_err_t markFreeing();
 
     esp_err_t copyItems(Page& other);
 
+    /**
+     * Copies the first item of this page to the end of other (an active page) and erases it here.
+     * On success, entryCount is set to the number of entries the item took on this page.
+     * Returns ESP_ERR_NVS_PAGE_FULL if the item does not fit into other and ESP_ERR_NVS_NOT_FOUND if
+     * this page holds no items.
+     */
+    esp_err_t moveFirstItem(Page& other, size_t& entryCount);
+
     esp_err_t erase();
 
     void debugDump() const;
@@ -181,6 +277,10 @@ protected:
 
     esp_err_t mLoadEntryTable();
 
+    esp_err_t mLoadEntryStates();
+
+    esp_err_t checkErased();
+
     esp_err_t initialize();
 
     esp_err_t alterEntryState(size_t index, EntryState state);
@@ -191,12 +291,17 @@ protected:
 
     esp_err_t readEntry(size_t index, Item& dst) const;
 
+    /**
+     * Reads count consecutive entries starting at index with a single partition read.
+     */
+    esp_err_t readEntries(size_t index, void* dst, size_t count) const;
+
+    esp_err_t copyEntry(size_t index, const Item& entry, Page& other);
+
     esp_err_t writeEntry(const Item& item);
 
     esp_err_t writeEntryData(const uint8_t* data, size_t size);
 
-    esp_err_t eraseEntryAndSpan(size_t index);
-
     void updateFirstUsedEntry(size_t index, size_t span);
 
     static constexpr size_t getAlignmentForType(ItemType type)
@@ -228,10 +333,30 @@ protected:
     /**
      * This hash list stores hashes of namespace index, key, and ChunkIndex for quick lookup when searching items.
      */
-    HashList mHashList;
+#ifdef CONFIG_NVS_INLINE_HASH_TABLE
+    typedef HashTable<ENTRY_COUNT> THashList;
+#else
+    typedef HashList THashList;
+#endif
+    THashList mHashList;
+
+    /**
+     * Partition-wide index of the owning Storage, kept in sync with mHashList. May be null.
+     */
+    StorageIndex *mStorageIndex;
 
     Partition *mPartition;
 
+    /**
+     * False while only the header and the entry state table of the page have been read.
+     */
+    bool mLoaded = false;
+
+    /**
+     * Items to erase when the page gets loaded, owned by the PageManager. Null unless loaded lazily.
+     */
+    TPendingEraseList *mPendingErase;
+
     static const uint32_t HEADER_OFFSET = 0;
     static const uint32_t ENTRY_TABLE_OFFSET = HEADER_OFFSET + 32;
     static const uint32_t ENTRY_DATA_OFFSET = ENTRY_TABLE_OFFSET + 32;
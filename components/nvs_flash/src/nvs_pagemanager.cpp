@@ -15,7 +15,7 @@
 
 namespace nvs
 {
-esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t sectorCount)
+esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t sectorCount, StorageIndex *storageIndex, bool lazy)
 {
     if (partition == nullptr) {
         return ESP_ERR_INVALID_ARG;
@@ -25,12 +25,15 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
     mPageCount = sectorCount;
     mPageList.clear();
     mFreePageList.clear();
+    mPendingErase.clearAndFreeNodes();
+    mGcPage = nullptr;
+    mAllPagesLoaded = !lazy;
     mPages.reset(new (nothrow) Page[sectorCount]);
 
     if (!mPages) return ESP_ERR_NO_MEM;
 
     for (uint32_t i = 0; i < sectorCount; ++i) {
-        auto err = mPages[i].load(partition, baseSector + i);
+        auto err = mPages[i].load(partition, baseSector + i, storageIndex, lazy ? &mPendingErase : nullptr);
         if (err != ESP_OK) {
             return err;
         }
@@ -70,27 +73,10 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
         lastItemIndex = itemIndex;
     }
 
-    if (lastItemIndex != SIZE_MAX) {
-        auto last = PageManager::TPageListIterator(&lastPage);
-        TPageListIterator it;
-
-        for (it = begin(); it != last; ++it) {
-
-            if ((it->state() != Page::PageState::FREEING) &&
-                    (it->eraseItem(item.nsIndex, item.datatype, item.key, item.chunkIndex) == ESP_OK)) {
-                break;
-            }
-        }
-        if ((it == last) && (item.datatype == ItemType::BLOB_IDX)) {
-            /* Rare case in which the blob was stored using old format, but power went just after writing
-             * blob index during modification. Loop again and delete the old version blob*/
-            for (it = begin(); it != last; ++it) {
-
-                if ((it->state() != Page::PageState::FREEING) &&
-                        (it->eraseItem(item.nsIndex, ItemType::BLOB, item.key, item.chunkIndex) == ESP_OK)) {
-                    break;
-                }
-            }
+    if (lastItemIndex != SIZE_MAX && item.nsIndex != Page::NS_BATCH) {
+        auto err = eraseOlderDuplicate(item, lastPage);
+        if (err != ESP_OK) {
+            return err;
         }
     }
 
@@ -129,6 +115,24 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
         }
     }
 
+    // the same applies to all items of a batch whose marker is still present, as the marker is only
+    // erased after all the superseded items have been erased. A marker normally is on the last page,
+    // but it stays on an earlier one if erasing it failed and later writes moved on to newer pages.
+    // Finding it there would mean loading all pages, so lazy loading leaves that to finishBatches()
+    if (lazy) {
+        auto err = finishBatches(back());
+        if (err != ESP_OK) {
+            return err;
+        }
+    } else {
+        for (auto it = begin(); it != end(); ++it) {
+            auto err = finishBatches(*it);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+    }
+
     // partition should have at least one free page
     if (mFreePageList.empty()) {
         return ESP_ERR_NVS_NO_FREE_PAGES;
@@ -137,6 +141,102 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
     return ESP_OK;
 }
 
+esp_err_t PageManager::finishBatches()
+{
+    // older versions are erased right away once all pages have been loaded, see eraseOlderDuplicate
+    for (auto it = begin(); it != end(); ++it) {
+        auto err = it->ensureLoaded();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    for (auto it = begin(); it != end(); ++it) {
+        auto err = finishBatches(*it);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t PageManager::finishBatches(Page& page)
+{
+    size_t markerIndex = 0;
+    Item marker;
+    while (page.findBatchMarker(markerIndex, marker) == ESP_OK) {
+        // the marker holds the number of entries taken by the items of the batch
+        size_t batchEnd = markerIndex + marker.span + marker.data[0];
+        size_t itemIndex = markerIndex + marker.span;
+        Item item;
+        while (page.findItem(Page::NS_ANY, ItemType::ANY, nullptr, itemIndex, item) == ESP_OK
+                && itemIndex < batchEnd) {
+            auto err = eraseOlderDuplicate(item, page);
+            if (err != ESP_OK) {
+                return err;
+            }
+            itemIndex += item.span;
+        }
+        auto err = page.eraseEntryAndSpan(markerIndex);
+        if (err != ESP_OK) {
+            return err;
+        }
+        markerIndex += marker.span;
+    }
+    return ESP_OK;
+}
+
+esp_err_t PageManager::eraseOlderDuplicate(const Item& item, Page& page)
+{
+    if (!allPagesLoaded()) {
+        // apart from the last one, none of the pages has been loaded yet. The older version
+        // is erased from the page holding it once that page gets loaded, see Page::ensureLoaded
+        assert(&page == &back());
+        Page::PendingErase* entry = new (std::nothrow) Page::PendingErase;
+        if (!entry) {
+            return ESP_ERR_NO_MEM;
+        }
+        entry->mItem = item;
+        mPendingErase.push_back(entry);
+        return ESP_OK;
+    }
+
+    auto last = PageManager::TPageListIterator(&page);
+    TPageListIterator it;
+
+    for (it = begin(); it != last; ++it) {
+
+        if ((it->state() != Page::PageState::FREEING) &&
+                (it->eraseItem(item.nsIndex, item.datatype, item.key, item.chunkIndex) == ESP_OK)) {
+            break;
+        }
+    }
+    if ((it == last) && (item.datatype == ItemType::BLOB_IDX)) {
+        /* Rare case in which the blob was stored using old format, but power went just after writing
+         * blob index during modification. Loop again and delete the old version blob*/
+        for (it = begin(); it != last; ++it) {
+
+            if ((it->state() != Page::PageState::FREEING) &&
+                    (it->eraseItem(item.nsIndex, ItemType::BLOB, item.key, item.chunkIndex) == ESP_OK)) {
+                break;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+bool PageManager::allPagesLoaded()
+{
+    if (!mAllPagesLoaded) {
+        mAllPagesLoaded = std::all_of(begin(), end(), [](const Page& page) -> bool {
+            return page.isLoaded();
+        });
+        if (mAllPagesLoaded) {
+            mPendingErase.clearAndFreeNodes();
+        }
+    }
+    return mAllPagesLoaded;
+}
+
 esp_err_t PageManager::requestNewPage()
 {
     if (mFreePageList.empty()) {
@@ -173,6 +273,12 @@ esp_err_t PageManager::requestNewPage()
 
     Page* erasedPage = maxUnusedItemsPageIt;
 
+    // loading may still erase entries, so do it before taking the entry count
+    err = erasedPage->ensureLoaded();
+    if (err != ESP_OK) {
+        return err;
+    }
+
 #ifndef NDEBUG
     size_t usedEntries = erasedPage->getUsedEntryCount();
 #endif
@@ -200,14 +306,120 @@ esp_err_t PageManager::requestNewPage()
     return ESP_OK;
 }
 
+esp_err_t PageManager::collectGarbage(size_t maxEntries, size_t reservePages, bool& done)
+{
+    done = false;
+
+    // the page may have been reclaimed by requestNewPage in the meantime
+    if (mGcPage != nullptr && mGcPage->state() != Page::PageState::FULL) {
+        mGcPage = nullptr;
+    }
+
+    if (mGcPage == nullptr) {
+        // a free page which turns out not to be empty would otherwise be erased in the foreground when it is
+        // activated. Free pages loaded lazily haven't been checked yet, so this is where that happens
+        for (auto it = mFreePageList.begin(); it != mFreePageList.end(); ++it) {
+            auto err = it->ensureLoaded();
+            if (err != ESP_OK) {
+                return err;
+            }
+            if (it->state() == Page::PageState::CORRUPT) {
+                return it->erase();
+            }
+        }
+
+        // one free page is always needed by requestNewPage, the reserve comes on top of it
+        if (mFreePageList.size() > reservePages) {
+            done = true;
+            return ESP_OK;
+        }
+
+        // find the full page with the highest number of erased items
+        Page* lastPage = &back();
+        size_t maxUnusedItems = 0;
+        for (auto it = begin(); it != end(); ++it) {
+            if (static_cast<Page*>(it) == lastPage || it->state() != Page::PageState::FULL) {
+                continue;
+            }
+            auto unused = Page::ENTRY_COUNT - it->getUsedEntryCount();
+            if (unused > maxUnusedItems) {
+                mGcPage = it;
+                maxUnusedItems = unused;
+            }
+        }
+
+        if (mGcPage == nullptr) {
+            // nothing to reclaim
+            done = true;
+            return ESP_OK;
+        }
+
+        // the entry state table of a lazily loaded page may still count items which are erased by loading it
+        auto err = mGcPage->ensureLoaded();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    if (mGcPage->getUsedEntryCount() == 0) {
+        // all items have been moved, erasing gets a step on its own as it is the expensive part
+        Page* erasedPage = mGcPage;
+        mGcPage = nullptr;
+        auto err = erasedPage->erase();
+        if (err != ESP_OK) {
+            return err;
+        }
+        mPageList.erase(erasedPage);
+        mFreePageList.push_back(erasedPage);
+        done = mFreePageList.size() > reservePages;
+        return ESP_OK;
+    }
+
+    size_t movedEntries = 0;
+    while (movedEntries < maxEntries && mGcPage->getUsedEntryCount() > 0) {
+        Page& page = back();
+        size_t entryCount;
+        auto err = mGcPage->moveFirstItem(page, entryCount);
+        if (err == ESP_ERR_NVS_PAGE_FULL) {
+            if (page.state() != Page::PageState::FULL) {
+                err = page.markFull();
+                if (err != ESP_OK) {
+                    return err;
+                }
+            }
+            // with no spare page left, this reclaims a page the same way a foreground write would
+            err = requestNewPage();
+            if (err != ESP_OK) {
+                return err;
+            }
+            if (mGcPage->state() != Page::PageState::FULL) {
+                mGcPage = nullptr;
+                return ESP_OK;
+            }
+            continue;
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+        movedEntries += entryCount;
+    }
+
+    return ESP_OK;
+}
+
 esp_err_t PageManager::activatePage()
 {
     if (mFreePageList.empty()) {
         return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
     }
     Page* p = &mFreePageList.front();
+    // a lazily loaded page is only checked for being really erased when it is about to be used
+    auto err = p->ensureLoaded();
+    if (err != ESP_OK) {
+        return err;
+    }
     if (p->state() == Page::PageState::CORRUPT) {
-        auto err = p->erase();
+        err = p->erase();
         if (err != ESP_OK) {
             return err;
         }
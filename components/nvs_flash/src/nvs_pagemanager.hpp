@@ -20,6 +20,19 @@
 #include "nvs_page.hpp"
 #include "partition.hpp"
 #include "intrusive_list.h"
+#include "sdkconfig.h"
+
+#ifdef CONFIG_NVS_LAZY_PAGE_LOAD
+#define NVS_LAZY_PAGE_LOAD true
+#else
+#define NVS_LAZY_PAGE_LOAD false
+#endif
+
+#ifdef CONFIG_NVS_GC_RESERVE_PAGES
+#define NVS_GC_RESERVE_PAGES CONFIG_NVS_GC_RESERVE_PAGES
+#else
+#define NVS_GC_RESERVE_PAGES 1
+#endif
 
 namespace nvs
 {
@@ -31,7 +44,28 @@ public:
 
     PageManager() {}
 
-    esp_err_t load(Partition *partition, uint32_t baseSector, uint32_t sectorCount);
+    ~PageManager()
+    {
+        mPendingErase.clearAndFreeNodes();
+    }
+
+    /**
+     * Loads all pages of the partition. If lazy is set, only the headers and entry state tables are read
+     * for all but the last page, see Page::load. The remaining pages are loaded when first accessed.
+     */
+    esp_err_t load(Partition *partition, uint32_t baseSector, uint32_t sectorCount, StorageIndex *storageIndex = nullptr, bool lazy = false);
+
+    /**
+     * Returns true once all used pages have been loaded completely.
+     */
+    bool allPagesLoaded();
+
+    /**
+     * Finishes the batches whose marker is still present on any of the pages, see Storage::writeBatch.
+     * load does this on its own unless loading lazily, in which case it only covers the last page.
+     * Loads all pages.
+     */
+    esp_err_t finishBatches();
 
     TPageListIterator begin()
     {
@@ -54,6 +88,16 @@ public:
 
     esp_err_t requestNewPage();
 
+    /**
+     * Performs one bounded step of incremental garbage collection, which keeps reservePages erased pages
+     * available in addition to the one needed by requestNewPage, so that it doesn't have to erase a page.
+     * A step either moves the items of the full page with the most erased entries to the active page, until
+     * at least maxEntries entries have been moved, or erases that page once it holds no more items, or
+     * erases a free page which isn't empty.
+     * done is set once the reserve is complete or there is no page left to reclaim.
+     */
+    esp_err_t collectGarbage(size_t maxEntries, size_t reservePages, bool& done);
+
     esp_err_t fillStats(nvs_stats_t& nvsStats);
 
     uint32_t getBaseSector()
@@ -66,9 +110,16 @@ protected:
 
     esp_err_t activatePage();
 
+    esp_err_t eraseOlderDuplicate(const Item& item, Page& page);
+
+    esp_err_t finishBatches(Page& page);
+
     TPageList mPageList;
     TPageList mFreePageList;
     std::unique_ptr<Page[]> mPages;
+    Page::TPendingEraseList mPendingErase;
+    Page* mGcPage = nullptr;
+    bool mAllPagesLoaded = true;
     uint32_t mBaseSector;
     uint32_t mPageCount;
     uint32_t mSeqNumber;
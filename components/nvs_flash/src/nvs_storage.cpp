@@ -30,6 +30,7 @@ namespace nvs
 Storage::~Storage()
 {
     clearNamespaces();
+    mBlobWrites.clearAndFreeNodes();
 }
 
 void Storage::clearNamespaces()
@@ -96,15 +97,51 @@ void Storage::eraseOrphanDataBlobs(TBlobIndexList& blobIdxList)
 
 esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount)
 {
-    auto err = mPageManager.load(mPartition, baseSector, sectorCount);
+    // the index is filled by the pages while they are being loaded
+    mIndex.reset();
+    auto err = mPageManager.load(mPartition, baseSector, sectorCount, &mIndex, mLazyLoad);
     if (err != ESP_OK) {
         mState = StorageState::INVALID;
         return err;
     }
 
-    // load namespaces list
     clearNamespaces();
     std::fill_n(mNamespaceUsage.data(), mNamespaceUsage.byteSize() / 4, 0);
+    mNamespaceUsage.set(0, true);
+    mNamespaceUsage.set(255, true);
+    mState = StorageState::ACTIVE;
+    mInitComplete = false;
+
+    if (!mLazyLoad) {
+        err = completeInit();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+#ifdef DEBUG_STORAGE
+    debugCheck();
+#endif
+    return ESP_OK;
+}
+
+esp_err_t Storage::completeInit()
+{
+    if (mInitComplete) {
+        return ESP_OK;
+    }
+
+    if (mLazyLoad) {
+        // the markers of unfinished batches can be on any page, see PageManager::load
+        auto err = mPageManager.finishBatches();
+        if (err != ESP_OK) {
+            mState = StorageState::INVALID;
+            return err;
+        }
+    }
+
+    // load namespaces list
+    clearNamespaces();
     for (auto it = mPageManager.begin(); it != mPageManager.end(); ++it) {
         Page& p = *it;
         size_t itemIndex = 0;
@@ -124,13 +161,10 @@ esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount)
             itemIndex += item.span;
         }
     }
-    mNamespaceUsage.set(0, true);
-    mNamespaceUsage.set(255, true);
-    mState = StorageState::ACTIVE;
 
     // Populate list of multi-page index entries.
     TBlobIndexList blobIdxList;
-    err = populateBlobIndices(blobIdxList);
+    auto err = populateBlobIndices(blobIdxList);
     if (err != ESP_OK) {
         mState = StorageState::INVALID;
         return ESP_ERR_NO_MEM;
@@ -142,9 +176,7 @@ esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount)
     // Purge the blob index list
     blobIdxList.clearAndFreeNodes();
 
-#ifdef DEBUG_STORAGE
-    debugCheck();
-#endif
+    mInitComplete = true;
     return ESP_OK;
 }
 
@@ -155,8 +187,20 @@ bool Storage::isValid() const
 
 esp_err_t Storage::findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
 {
+    size_t itemIndex;
+    return findItem(nsIndex, datatype, key, page, itemIndex, item, chunkIdx, chunkStart);
+}
+
+esp_err_t Storage::findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, size_t& itemIndex, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
+{
+    // with lazy loading, the index only becomes complete once all pages have been loaded
+    if (mIndex.isActive() && nsIndex != Page::NS_ANY && datatype != ItemType::ANY && key != nullptr
+            && mPageManager.allPagesLoaded()) {
+        return mIndex.find(nsIndex, datatype, key, page, itemIndex, item, chunkIdx, chunkStart);
+    }
+
     for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
-        size_t itemIndex = 0;
+        itemIndex = 0;
         auto err = it->findItem(nsIndex, datatype, key, itemIndex, item, chunkIdx, chunkStart);
         if (err == ESP_OK) {
             page = it;
@@ -269,6 +313,285 @@ esp_err_t Storage::writeMultiPageBlob(uint8_t nsIndex, const char* key, const vo
     return err;
 }
 
+esp_err_t Storage::beginBlobWrite(uint8_t nsIndex, const char* key, VerOffset& chunkStart)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    // orphaned data of the version written next has to be gone
+    auto err = completeInit();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    if (findBlobWrite(nsIndex, key)) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    Item item;
+    Page* findPage = nullptr;
+    err = findItem(nsIndex, ItemType::BLOB_IDX, key, findPage, item);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        chunkStart = VerOffset::VER_0_OFFSET;
+    } else if (err == ESP_OK) {
+        chunkStart = (item.blobIndex.chunkStart == VerOffset::VER_1_OFFSET) ? VerOffset::VER_0_OFFSET : VerOffset::VER_1_OFFSET;
+    } else {
+        return err;
+    }
+
+    BlobWriteNode* entry = new (std::nothrow) BlobWriteNode;
+    if (!entry) {
+        return ESP_ERR_NO_MEM;
+    }
+    strncpy(entry->key, key, sizeof(entry->key) - 1);
+    entry->key[sizeof(entry->key) - 1] = 0;
+    entry->nsIndex = nsIndex;
+    mBlobWrites.push_back(entry);
+    return ESP_OK;
+}
+
+esp_err_t Storage::writeBlobChunk(uint8_t nsIndex, const char* key, const void* data, size_t dataSize, uint8_t chunkIndex, size_t& chunkSize)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    Page* page = &getCurrentPage();
+    size_t tailroom = page->getVarDataTailroom();
+    if ((tailroom < dataSize || tailroom == 0) && tailroom < Page::CHUNK_MAX_SIZE/10) {
+        /* Not worth splitting the data here, continue on a new page */
+        if (page->state() != Page::PageState::FULL) {
+            auto err = page->markFull();
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        auto err = mPageManager.requestNewPage();
+        if (err != ESP_OK) {
+            return err;
+        }
+        page = &getCurrentPage();
+        if (page->getVarDataTailroom() == tailroom) {
+            /* We got the same page or we are not improving.*/
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+        tailroom = page->getVarDataTailroom();
+    }
+
+    chunkSize = std::min(dataSize, tailroom);
+    auto err = page->writeItem(nsIndex, ItemType::BLOB_DATA, key, data, chunkSize, chunkIndex);
+    assert(err != ESP_ERR_NVS_PAGE_FULL);
+    return err;
+}
+
+esp_err_t Storage::finishBlobWrite(uint8_t nsIndex, const char* key, size_t dataSize, uint8_t chunkCount, VerOffset chunkStart)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    Item item;
+    std::fill_n(item.data, sizeof(item.data), 0xff);
+    item.blobIndex.dataSize = dataSize;
+    item.blobIndex.chunkCount = chunkCount;
+    item.blobIndex.chunkStart = chunkStart;
+
+    Page& page = getCurrentPage();
+    auto err = page.writeItem(nsIndex, ItemType::BLOB_IDX, key, item.data, sizeof(item.data));
+    if (err == ESP_ERR_NVS_PAGE_FULL) {
+        if (page.state() != Page::PageState::FULL) {
+            err = page.markFull();
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        err = mPageManager.requestNewPage();
+        if (err != ESP_OK) {
+            return err;
+        }
+        err = getCurrentPage().writeItem(nsIndex, ItemType::BLOB_IDX, key, item.data, sizeof(item.data));
+        if (err == ESP_ERR_NVS_PAGE_FULL) {
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    endBlobWrite(nsIndex, key);
+
+    /* The new value is in place, erase the blob with the other version or the one stored without index */
+    VerOffset prevStart = (chunkStart == VerOffset::VER_1_OFFSET) ? VerOffset::VER_0_OFFSET : VerOffset::VER_1_OFFSET;
+    err = eraseMultiPageBlob(nsIndex, key, prevStart);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        Page* findPage = nullptr;
+        err = findItem(nsIndex, ItemType::BLOB, key, findPage, item);
+        if (err == ESP_OK) {
+            err = findPage->eraseItem(nsIndex, ItemType::BLOB, key);
+        } else if (err == ESP_ERR_NVS_NOT_FOUND) {
+            err = ESP_OK;
+        }
+    }
+    if (err != ESP_OK) {
+        return ESP_ERR_NVS_REMOVE_FAILED;
+    }
+    return ESP_OK;
+}
+
+void Storage::abortBlobWrite(uint8_t nsIndex, const char* key, uint8_t chunkCount, VerOffset chunkStart)
+{
+    endBlobWrite(nsIndex, key);
+    if (mState != StorageState::ACTIVE) {
+        return;
+    }
+
+    for (uint8_t chunkNum = 0; chunkNum < chunkCount; chunkNum++) {
+        Item item;
+        Page* findPage = nullptr;
+        const uint8_t chunkIndex = static_cast<uint8_t> (chunkStart) + chunkNum;
+        if (findItem(nsIndex, ItemType::BLOB_DATA, key, findPage, item, chunkIndex) == ESP_OK) {
+            findPage->eraseItem(nsIndex, ItemType::BLOB_DATA, key, chunkIndex);
+        }
+    }
+}
+
+Storage::BlobWriteNode* Storage::findBlobWrite(uint8_t nsIndex, const char* key)
+{
+    for (auto it = std::begin(mBlobWrites); it != std::end(mBlobWrites); ++it) {
+        if (it->nsIndex == nsIndex && (key == nullptr || strncmp(it->key, key, sizeof(it->key)) == 0)) {
+            return it;
+        }
+    }
+    return nullptr;
+}
+
+void Storage::endBlobWrite(uint8_t nsIndex, const char* key)
+{
+    BlobWriteNode* entry = findBlobWrite(nsIndex, key);
+    if (entry) {
+        mBlobWrites.erase(entry);
+        delete entry;
+    }
+}
+
+esp_err_t Storage::findBlobIndex(uint8_t nsIndex, const char* key, size_t& dataSize, uint8_t& chunkCount, VerOffset& chunkStart)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    Item item;
+    Page* findPage = nullptr;
+    auto err = findItem(nsIndex, ItemType::BLOB_IDX, key, findPage, item);
+    if (err != ESP_OK) {
+        return err;
+    }
+    dataSize = item.blobIndex.dataSize;
+    chunkCount = item.blobIndex.chunkCount;
+    chunkStart = item.blobIndex.chunkStart;
+    return ESP_OK;
+}
+
+esp_err_t Storage::readBlobChunk(uint8_t nsIndex, const char* key, uint8_t chunkIndex, void* data, size_t maxSize, size_t& chunkSize)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    const ItemType datatype = (chunkIndex == Page::CHUNK_ANY) ? ItemType::BLOB : ItemType::BLOB_DATA;
+    Item item;
+    Page* findPage = nullptr;
+    size_t itemIndex;
+    auto err = findItem(nsIndex, datatype, key, findPage, itemIndex, item, chunkIndex);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (item.varLength.dataSize > maxSize) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    chunkSize = item.varLength.dataSize;
+    return findPage->readItemData(itemIndex, item, data);
+}
+
+esp_err_t Storage::visitItem(uint8_t nsIndex, ItemType datatype, const char* key, NVSDataVisitor& visitor)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    assert(datatype == ItemType::SZ || datatype == ItemType::BLOB);
+
+    Item item;
+    Page* findPage = nullptr;
+    size_t itemIndex;
+    esp_err_t err;
+    if (datatype == ItemType::BLOB) {
+        err = findItem(nsIndex, ItemType::BLOB_IDX, key, findPage, item);
+        if (err == ESP_OK) {
+            const uint8_t chunkCount = item.blobIndex.chunkCount;
+            const uint8_t chunkStart = static_cast<uint8_t>(item.blobIndex.chunkStart);
+            const size_t dataSize = item.blobIndex.dataSize;
+            err = visitor.begin(dataSize);
+            if (err != ESP_OK) {
+                return err;
+            }
+
+            size_t offset = 0;
+            for (uint8_t chunkNum = 0; chunkNum < chunkCount; chunkNum++) {
+                err = findItem(nsIndex, ItemType::BLOB_DATA, key, findPage, itemIndex, item, chunkStart + chunkNum);
+                if (err == ESP_OK) {
+                    if (offset + item.varLength.dataSize > dataSize) {
+                        return ESP_ERR_NVS_INVALID_LENGTH;
+                    }
+                    err = visitItemData(findPage, itemIndex, item, offset, visitor);
+                }
+                if (err == ESP_ERR_NVS_NOT_FOUND) {
+                    eraseMultiPageBlob(nsIndex, key); // cleanup if a chunk is not found
+                }
+                if (err != ESP_OK) {
+                    return err;
+                }
+                offset += item.varLength.dataSize;
+            }
+            assert(offset == dataSize);
+            return ESP_OK;
+        }
+        if (err != ESP_ERR_NVS_NOT_FOUND) {
+            return err;
+        } // else check if the blob is stored with earlier version format without index
+    }
+
+    err = findItem(nsIndex, datatype, key, findPage, itemIndex, item);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = visitor.begin(item.varLength.dataSize);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return visitItemData(findPage, itemIndex, item, 0, visitor);
+}
+
+esp_err_t Storage::visitItemData(Page* page, size_t itemIndex, const Item& item, size_t offset, NVSDataVisitor& visitor)
+{
+    const size_t size = item.varLength.dataSize;
+    std::unique_ptr<uint8_t[]> temp;
+    uint8_t* data = static_cast<uint8_t*>(visitor.get_buffer(offset, size));
+    if (data == nullptr) {
+        temp.reset(new (std::nothrow) uint8_t[size]);
+        if (!temp) {
+            return ESP_ERR_NO_MEM;
+        }
+        data = temp.get();
+    }
+
+    auto err = page->readItemData(itemIndex, item, data);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return visitor.visit(data, size);
+}
+
 esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize)
 {
     if (mState != StorageState::ACTIVE) {
@@ -280,6 +603,14 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
 
     esp_err_t err;
     if (datatype == ItemType::BLOB) {
+        if (findBlobWrite(nsIndex, key)) {
+            return ESP_ERR_NVS_INVALID_STATE;
+        }
+        // orphaned data of the version written next has to be gone
+        err = completeInit();
+        if (err != ESP_OK) {
+            return err;
+        }
         err = findItem(nsIndex, ItemType::BLOB_IDX, key, findPage, item);
     } else {
         err = findItem(nsIndex, datatype, key, findPage, item);
@@ -395,6 +726,184 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
     return ESP_OK;
 }
 
+esp_err_t Storage::writeBatch(uint8_t nsIndex, TBatchItems& batch)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    struct BatchEntry {
+        BatchItem* item;
+        bool replacesItem;
+        bool replacesOldBlob;
+        VerOffset prevStart;
+        Item blobIndex;
+    };
+
+    size_t batchSize = 0;
+    bool hasBlobs = false;
+    for (auto it = std::begin(batch); it != std::end(batch); ++it) {
+        ++batchSize;
+        if (it->datatype == ItemType::BLOB) {
+            if (findBlobWrite(nsIndex, it->key)) {
+                return ESP_ERR_NVS_INVALID_STATE;
+            }
+            hasBlobs = true;
+        }
+    }
+
+    if (hasBlobs) {
+        // as in writeItem
+        auto err = completeInit();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    std::unique_ptr<BatchEntry[]> entries(new (std::nothrow) BatchEntry[batchSize]);
+    std::unique_ptr<Page::ItemData[]> items(new (std::nothrow) Page::ItemData[2 * batchSize + 1]);
+    if (!entries || !items) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // As in writeItem, leave out the items which already have the given value.
+    // For the others, find out what they supersede.
+    size_t count = 0;
+    size_t entryCount = 1; // the batch marker
+    for (auto it = std::begin(batch); it != std::end(batch); ++it) {
+        BatchEntry& entry = entries[count];
+        entry.item = it;
+        entry.replacesItem = false;
+        entry.replacesOldBlob = false;
+        entry.prevStart = VerOffset::VER_ANY;
+
+        Page* findPage = nullptr;
+        Item item;
+        if (it->datatype == ItemType::BLOB) {
+            if (findItem(nsIndex, ItemType::BLOB_IDX, it->key, findPage, item) == ESP_OK) {
+                if (cmpMultiPageBlob(nsIndex, it->key, it->data, it->dataSize) == ESP_OK) {
+                    continue;
+                }
+                entry.replacesItem = true;
+                entry.prevStart = item.blobIndex.chunkStart;
+            } else if (findItem(nsIndex, ItemType::BLOB, it->key, findPage, item) == ESP_OK) {
+                /* Support for earlier versions where BLOBS were stored without index */
+                entry.replacesOldBlob = true;
+            }
+            // a blob in a batch is stored as a single chunk followed by its index
+            entryCount += Page::getItemEntryCount(ItemType::BLOB_DATA, it->dataSize) + 1;
+        } else {
+            if (findItem(nsIndex, it->datatype, it->key, findPage, item) == ESP_OK) {
+                if (findPage->cmpItem(nsIndex, it->datatype, it->key, it->data, it->dataSize) == ESP_OK) {
+                    continue;
+                }
+                entry.replacesItem = true;
+            }
+            entryCount += Page::getItemEntryCount(it->datatype, it->dataSize);
+        }
+        ++count;
+    }
+
+    if (count == 0) {
+        return ESP_OK;
+    }
+
+    if (entryCount > Page::ENTRY_COUNT) {
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+
+    esp_err_t err;
+    Page* page = &getCurrentPage();
+    if (page->getFreeEntryCount() < entryCount) {
+        if (page->state() != Page::PageState::FULL) {
+            err = page->markFull();
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        err = mPageManager.requestNewPage();
+        if (err != ESP_OK) {
+            return err;
+        }
+        page = &getCurrentPage();
+        if (page->getFreeEntryCount() < entryCount) {
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+    }
+
+    /* The marker goes first and holds the number of entries taken by the items of the batch.
+     * It is only erased once all the superseded items have been erased, so if power goes out
+     * in between, PageManager::load can finish the job. */
+    uint8_t markerData = entryCount - 1;
+    size_t itemCount = 0;
+    items[itemCount++] = {Page::NS_BATCH, ItemType::U8, "batch", &markerData, sizeof(markerData), Page::CHUNK_ANY};
+
+    for (size_t i = 0; i < count; ++i) {
+        BatchEntry& entry = entries[i];
+        BatchItem* bi = entry.item;
+        if (bi->datatype == ItemType::BLOB) {
+            /* Toggle the version by changing the offset */
+            VerOffset nextStart = (entry.prevStart == VerOffset::VER_0_OFFSET) ? VerOffset::VER_1_OFFSET : VerOffset::VER_0_OFFSET;
+            std::fill_n(entry.blobIndex.data, sizeof(entry.blobIndex.data), 0xff);
+            entry.blobIndex.blobIndex.dataSize = bi->dataSize;
+            entry.blobIndex.blobIndex.chunkCount = 1;
+            entry.blobIndex.blobIndex.chunkStart = nextStart;
+
+            items[itemCount++] = {nsIndex, ItemType::BLOB_DATA, bi->key, bi->data, bi->dataSize, static_cast<uint8_t>(nextStart)};
+            items[itemCount++] = {nsIndex, ItemType::BLOB_IDX, bi->key, entry.blobIndex.data, sizeof(entry.blobIndex.data), Page::CHUNK_ANY};
+        } else {
+            items[itemCount++] = {nsIndex, bi->datatype, bi->key, bi->data, bi->dataSize, Page::CHUNK_ANY};
+        }
+    }
+
+    size_t markerIndex;
+    err = page->writeItems(items.get(), itemCount, markerIndex);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // All items are visible now. Until the superseded ones are erased, looking up a key
+    // still returns the older item, which has been written first.
+    for (size_t i = 0; i < count; ++i) {
+        BatchEntry& entry = entries[i];
+        BatchItem* bi = entry.item;
+        Page* findPage = nullptr;
+        Item item;
+        err = ESP_OK;
+        if (bi->datatype == ItemType::BLOB) {
+            if (entry.replacesItem) {
+                err = eraseMultiPageBlob(nsIndex, bi->key, entry.prevStart);
+            } else if (entry.replacesOldBlob &&
+                    findItem(nsIndex, ItemType::BLOB, bi->key, findPage, item) == ESP_OK) {
+                err = findPage->eraseItem(nsIndex, ItemType::BLOB, bi->key);
+            }
+        } else if (entry.replacesItem &&
+                findItem(nsIndex, bi->datatype, bi->key, findPage, item) == ESP_OK) {
+            err = findPage->eraseItem(nsIndex, bi->datatype, bi->key);
+        }
+
+        if (err == ESP_ERR_FLASH_OP_FAIL) {
+            return ESP_ERR_NVS_REMOVE_FAILED;
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    err = page->eraseEntryAndSpan(markerIndex);
+    if (err == ESP_ERR_FLASH_OP_FAIL) {
+        return ESP_ERR_NVS_REMOVE_FAILED;
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+#ifdef DEBUG_STORAGE
+    debugCheck();
+#endif
+    return ESP_OK;
+}
+
 esp_err_t Storage::createOrOpenNamespace(const char* nsName, bool canCreate, uint8_t& nsIndex)
 {
     if (mState != StorageState::ACTIVE) {
@@ -403,11 +912,37 @@ esp_err_t Storage::createOrOpenNamespace(const char* nsName, bool canCreate, uin
     auto it = std::find_if(mNamespaces.begin(), mNamespaces.end(), [=] (const NamespaceEntry& e) -> bool {
         return strncmp(nsName, e.mName, sizeof(e.mName) - 1) == 0;
     });
+    if (it == std::end(mNamespaces) && !mInitComplete) {
+        // not all namespaces are known yet, look for this one only
+        Page* findPage = nullptr;
+        Item item;
+        auto err = findItem(Page::NS_INDEX, ItemType::U8, nsName, findPage, item);
+        if (err == ESP_OK) {
+            NamespaceEntry* entry = new (std::nothrow) NamespaceEntry;
+            if (!entry) {
+                return ESP_ERR_NO_MEM;
+            }
+            item.getKey(entry->mName, sizeof(entry->mName));
+            item.getValue(entry->mIndex);
+            mNamespaces.push_back(entry);
+            mNamespaceUsage.set(entry->mIndex, true);
+            nsIndex = entry->mIndex;
+            return ESP_OK;
+        } else if (err != ESP_ERR_NVS_NOT_FOUND) {
+            return err;
+        }
+    }
     if (it == std::end(mNamespaces)) {
         if (!canCreate) {
             return ESP_ERR_NVS_NOT_FOUND;
         }
 
+        // all namespace indices in use have to be known
+        auto err = completeInit();
+        if (err != ESP_OK) {
+            return err;
+        }
+
         uint8_t ns;
         for (ns = 1; ns < 255; ++ns) {
             if (mNamespaceUsage.get(ns) == false) {
@@ -424,7 +959,7 @@ esp_err_t Storage::createOrOpenNamespace(const char* nsName, bool canCreate, uin
             return ESP_ERR_NO_MEM;
         }
 
-        auto err = writeItem(Page::NS_INDEX, ItemType::U8, nsName, &ns, sizeof(ns));
+        err = writeItem(Page::NS_INDEX, ItemType::U8, nsName, &ns, sizeof(ns));
         if (err != ESP_OK) {
             return err;
         }
@@ -461,14 +996,15 @@ esp_err_t Storage::readMultiPageBlob(uint8_t nsIndex, const char* key, void* dat
 
     /* Now read corresponding chunks */
     for (uint8_t chunkNum = 0; chunkNum < chunkCount; chunkNum++) {
-        err = findItem(nsIndex, ItemType::BLOB_DATA, key, findPage, item, static_cast<uint8_t> (chunkStart) + chunkNum);
+        size_t itemIndex;
+        err = findItem(nsIndex, ItemType::BLOB_DATA, key, findPage, itemIndex, item, static_cast<uint8_t> (chunkStart) + chunkNum);
         if (err != ESP_OK) {
             if (err == ESP_ERR_NVS_NOT_FOUND) {
                 break;
             }
             return err;
         }
-        err = findPage->readItem(nsIndex, ItemType::BLOB_DATA, key, static_cast<uint8_t*>(data) + offset, item.varLength.dataSize, static_cast<uint8_t> (chunkStart) + chunkNum);
+        err = findPage->readItemData(itemIndex, item, static_cast<uint8_t*>(data) + offset);
         if (err != ESP_OK) {
             return err;
         }
@@ -541,10 +1077,17 @@ esp_err_t Storage::readItem(uint8_t nsIndex, ItemType datatype, const char* key,
         } // else check if the blob is stored with earlier version format without index
     }
 
-    auto err = findItem(nsIndex, datatype, key, findPage, item);
+    size_t itemIndex;
+    auto err = findItem(nsIndex, datatype, key, findPage, itemIndex, item);
     if (err != ESP_OK) {
         return err;
     }
+    if (isVariableLengthType(datatype)) {
+        if (dataSize < static_cast<size_t>(item.varLength.dataSize)) {
+            return ESP_ERR_NVS_INVALID_LENGTH;
+        }
+        return findPage->readItemData(itemIndex, item, data);
+    }
     return findPage->readItem(nsIndex, datatype, key, data, dataSize);
 
 }
@@ -600,6 +1143,10 @@ esp_err_t Storage::eraseItem(uint8_t nsIndex, ItemType datatype, const char* key
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    if ((datatype == ItemType::BLOB || datatype == ItemType::ANY) && findBlobWrite(nsIndex, key)) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
     if (datatype == ItemType::BLOB) {
         return eraseMultiPageBlob(nsIndex, key);
     }
@@ -624,6 +1171,10 @@ esp_err_t Storage::eraseNamespace(uint8_t nsIndex)
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    if (findBlobWrite(nsIndex, nullptr)) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
     for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
         while (true) {
             auto err = it->eraseItem(nsIndex, ItemType::ANY, nullptr);
@@ -677,6 +1228,14 @@ void Storage::debugCheck()
     std::map<std::string, Page*> keys;
 
     for (auto p = mPageManager.begin(); p != mPageManager.end(); ++p) {
+        if (!p->isLoaded()) {
+            // checking would load it
+            continue;
+        }
+        if (p->state() == Page::PageState::INVALID) {
+            // a flash operation on this page failed, its items can't be found until NVS is initialized again
+            continue;
+        }
         size_t itemIndex = 0;
         size_t usedCount = 0;
         Item item;
@@ -690,6 +1249,16 @@ void Storage::debugCheck()
                 assert(0);
             }
             keys.insert(std::make_pair(keystr, static_cast<Page*>(p)));
+            if (mIndex.isActive()) {
+                Page* indexedPage = nullptr;
+                Item indexedItem;
+                size_t indexedItemIndex;
+                auto err = mIndex.find(item.nsIndex, item.datatype, item.key, indexedPage, indexedItemIndex, indexedItem, item.chunkIndex, VerOffset::VER_ANY);
+                if (err != ESP_OK || indexedPage != static_cast<Page*>(p)) {
+                    printf("Key missing from storage index: %s\n", keystr.c_str());
+                    assert(0);
+                }
+            }
             itemIndex += item.span;
             usedCount += item.span;
         }
@@ -700,10 +1269,23 @@ void Storage::debugCheck()
 
 esp_err_t Storage::fillStats(nvs_stats_t& nvsStats)
 {
+    auto err = completeInit();
+    if (err != ESP_OK) {
+        return err;
+    }
     nvsStats.namespace_count = mNamespaces.size();
     return mPageManager.fillStats(nvsStats);
 }
 
+esp_err_t Storage::collectGarbage(size_t maxEntries, bool& done)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    return mPageManager.collectGarbage(maxEntries, NVS_GC_RESERVE_PAGES, done);
+}
+
 esp_err_t Storage::calcEntriesInNamespace(uint8_t nsIndex, size_t& usedEntries)
 {
     usedEntries = 0;
@@ -746,6 +1328,11 @@ void Storage::fillEntryInfo(Item &item, nvs_entry_info_t &info)
 
 bool Storage::findEntry(nvs_opaque_iterator_t* it, const char* namespace_name)
 {
+    // the entries found are reported along with their namespace names
+    if (completeInit() != ESP_OK) {
+        return false;
+    }
+
     it->entryIndex = 0;
     it->nsIndex = Page::NS_ANY;
     it->page = mPageManager.begin();
@@ -762,6 +1349,7 @@ bool Storage::findEntry(nvs_opaque_iterator_t* it, const char* namespace_name)
 inline bool isIterableItem(Item& item)
 {
     return (item.nsIndex != 0 &&
+            item.nsIndex != Page::NS_BATCH &&
             item.datatype != ItemType::BLOB &&
             item.datatype != ItemType::BLOB_IDX);
 }
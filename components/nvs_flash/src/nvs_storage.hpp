@@ -20,6 +20,7 @@
 #include "nvs_types.hpp"
 #include "nvs_page.hpp"
 #include "nvs_pagemanager.hpp"
+#include "nvs_storage_index.hpp"
 #include "partition.hpp"
 
 //extern void dumpBytes(const uint8_t* data, size_t count);
@@ -58,10 +59,40 @@ class Storage : public intrusive_list_node<Storage>
 
     typedef intrusive_list<BlobIndexNode> TBlobIndexList;
 
+    /**
+     * A blob written in pieces, between beginBlobWrite() and finishBlobWrite() or abortBlobWrite().
+     */
+    struct BlobWriteNode: public intrusive_list_node<BlobWriteNode> {
+        public:
+            char key[Item::MAX_KEY_LENGTH + 1];
+            uint8_t nsIndex;
+    };
+
+    typedef intrusive_list<BlobWriteNode> TBlobWriteList;
+
 public:
+    /**
+     * Item staged by a handle, to be written together with others by writeBatch().
+     */
+    struct BatchItem : public intrusive_list_node<BatchItem> {
+    public:
+        ~BatchItem()
+        {
+            delete[] data;
+        }
+
+        ItemType datatype;
+        char key[Item::MAX_KEY_LENGTH + 1];
+        uint8_t* data = nullptr;
+        size_t dataSize = 0;
+    };
+
+    typedef intrusive_list<BatchItem> TBatchItems;
+
     ~Storage();
 
-    Storage(Partition *partition) : mPartition(partition) {
+    Storage(Partition *partition, size_t indexMaxSize = NVS_STORAGE_INDEX_MAX_SIZE, bool lazyLoad = NVS_LAZY_PAGE_LOAD)
+        : mPartition(partition), mIndex(indexMaxSize), mLazyLoad(lazyLoad) {
         if (partition == nullptr) {
             abort();
         }
@@ -81,6 +112,8 @@ public:
 
     esp_err_t eraseItem(uint8_t nsIndex, ItemType datatype, const char* key);
 
+    esp_err_t writeBatch(uint8_t nsIndex, TBatchItems& batch);
+
     template<typename T>
     esp_err_t writeItem(uint8_t nsIndex, const char* key, const T& value)
     {
@@ -123,12 +156,50 @@ public:
 
     esp_err_t eraseMultiPageBlob(uint8_t nsIndex, const char* key, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    /**
+     * Blob writes in pieces, used by NVSBlobWriter. beginBlobWrite() picks the version which the new value is
+     * written to. Each writeBlobChunk() call stores the first chunkSize <= dataSize bytes of data as the next chunk
+     * on the current page. finishBlobWrite() writes the blob index, which replaces the previous value, and erases
+     * the previous value. If the latter fails, ESP_ERR_NVS_REMOVE_FAILED is returned and the new value is kept.
+     * abortBlobWrite() erases the chunks written so far.
+     *
+     * Until finishBlobWrite() or abortBlobWrite() is called, the key is reserved for the blob being written:
+     * beginBlobWrite() for the same key, writing it as BLOB, erasing it and erasing its namespace fail with
+     * ESP_ERR_NVS_INVALID_STATE, so that the version picked by beginBlobWrite() can't be taken by another write.
+     */
+    esp_err_t beginBlobWrite(uint8_t nsIndex, const char* key, VerOffset& chunkStart);
+
+    esp_err_t writeBlobChunk(uint8_t nsIndex, const char* key, const void* data, size_t dataSize, uint8_t chunkIndex, size_t& chunkSize);
+
+    esp_err_t finishBlobWrite(uint8_t nsIndex, const char* key, size_t dataSize, uint8_t chunkCount, VerOffset chunkStart);
+
+    void abortBlobWrite(uint8_t nsIndex, const char* key, uint8_t chunkCount, VerOffset chunkStart);
+
+    /**
+     * Blob reads in pieces, used by NVSBlobReader. readBlobChunk() reads the chunk with the given index, which
+     * must fit into maxSize bytes. Page::CHUNK_ANY as index reads a blob stored without index in the old format.
+     */
+    esp_err_t findBlobIndex(uint8_t nsIndex, const char* key, size_t& dataSize, uint8_t& chunkCount, VerOffset& chunkStart);
+
+    esp_err_t readBlobChunk(uint8_t nsIndex, const char* key, uint8_t chunkIndex, void* data, size_t maxSize, size_t& chunkSize);
+
+    /**
+     * Reads a string (ItemType::SZ) or blob (ItemType::BLOB) and passes its size and then its data to visitor.
+     * Unlike getItemDataSize() followed by readItem(), the item is only looked up once, plus once per chunk of a blob.
+     */
+    esp_err_t visitItem(uint8_t nsIndex, ItemType datatype, const char* key, NVSDataVisitor& visitor);
+
     void debugDump();
 
     void debugCheck();
 
     esp_err_t fillStats(nvs_stats_t& nvsStats);
 
+    /**
+     * Performs one step of incremental garbage collection, see PageManager::collectGarbage.
+     */
+    esp_err_t collectGarbage(size_t maxEntries, bool& done);
+
     esp_err_t calcEntriesInNamespace(uint8_t nsIndex, size_t& usedEntries);
 
     bool findEntry(nvs_opaque_iterator_t*, const char* name);
@@ -144,6 +215,12 @@ protected:
 
     void clearNamespaces();
 
+    /**
+     * Runs the steps of init() which need all pages: loading the list of namespaces and erasing orphaned
+     * blob data. With lazy page loading, they are deferred until one of them is needed.
+     */
+    esp_err_t completeInit();
+
     esp_err_t populateBlobIndices(TBlobIndexList&);
 
     void eraseOrphanDataBlobs(TBlobIndexList&);
@@ -152,13 +229,29 @@ protected:
 
     esp_err_t findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx = Page::CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    esp_err_t findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, size_t& itemIndex, Item& item, uint8_t chunkIdx = Page::CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
+
+    esp_err_t visitItemData(Page* page, size_t itemIndex, const Item& item, size_t offset, NVSDataVisitor& visitor);
+
+    /**
+     * Returns the blob being written in pieces with the given key, or nullptr. With nullptr as key, returns any
+     * blob being written in the namespace.
+     */
+    BlobWriteNode* findBlobWrite(uint8_t nsIndex, const char* key);
+
+    void endBlobWrite(uint8_t nsIndex, const char* key);
+
 protected:
     Partition *mPartition;
     size_t mPageCount;
     PageManager mPageManager;
+    StorageIndex mIndex;
     TNamespaces mNamespaces;
+    TBlobWriteList mBlobWrites;
     CompressedEnumTable<bool, 1, 256> mNamespaceUsage;
     StorageState mState = StorageState::INVALID;
+    bool mLazyLoad;
+    bool mInitComplete = false;
 };
 
 } // namespace nvs
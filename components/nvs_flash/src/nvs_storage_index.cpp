@@ -0,0 +1,180 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "nvs_storage_index.hpp"
+#include "nvs_page.hpp"
+
+namespace nvs
+{
+
+StorageIndex::~StorageIndex()
+{
+    clear();
+}
+
+void StorageIndex::clear()
+{
+    delete[] mRecords;
+    mRecords = nullptr;
+    mCapacity = 0;
+    mCount = 0;
+    mTombstones = 0;
+}
+
+void StorageIndex::reset()
+{
+    clear();
+    if (MIN_CAPACITY * sizeof(Record) <= mMaxSize) {
+        rehash(MIN_CAPACITY);
+    }
+}
+
+bool StorageIndex::rehash(size_t capacity)
+{
+    Record* records = new (std::nothrow) Record[capacity]();
+    if (!records) {
+        return false;
+    }
+
+    Record* oldRecords = mRecords;
+    size_t oldCapacity = mCapacity;
+    mRecords = records;
+    mCapacity = capacity;
+    mTombstones = 0;
+
+    for (size_t i = 0; i < oldCapacity; ++i) {
+        if (oldRecords[i].mPage != nullptr) {
+            place(oldRecords[i]);
+        }
+    }
+    delete[] oldRecords;
+    return true;
+}
+
+void StorageIndex::place(const Record& record)
+{
+    const size_t mask = mCapacity - 1;
+    size_t slot = record.mHash & mask;
+    while (mRecords[slot].mPage != nullptr) {
+        slot = (slot + 1) & mask;
+    }
+    if (mRecords[slot].mIndex == TOMBSTONE) {
+        --mTombstones;
+    }
+    mRecords[slot] = record;
+}
+
+void StorageIndex::insert(const Item& item, Page* page, size_t index)
+{
+    if (!isActive()) {
+        return;
+    }
+
+    // keep the load factor (including erased slots) below 3/4
+    if ((mCount + mTombstones + 1) * 4 > mCapacity * 3) {
+        size_t capacity = mCapacity;
+        if ((mCount + 1) * 2 > mCapacity) {
+            capacity *= 2;
+        }
+        if (capacity * sizeof(Record) > mMaxSize || !rehash(capacity)) {
+            // out of budget or memory, fall back to searching the pages
+            clear();
+            return;
+        }
+    }
+
+    Record record;
+    record.mPage = page;
+    record.mIndex = index;
+    record.mHash = hashOf(item);
+    place(record);
+    ++mCount;
+}
+
+void StorageIndex::erase(const Item& item, Page* page, size_t index)
+{
+    if (!isActive()) {
+        return;
+    }
+
+    const size_t mask = mCapacity - 1;
+    for (size_t slot = hashOf(item) & mask;
+            mRecords[slot].mPage != nullptr || mRecords[slot].mIndex == TOMBSTONE;
+            slot = (slot + 1) & mask) {
+        Record& r = mRecords[slot];
+        if (r.mPage == page && r.mIndex == index) {
+            r.mPage = nullptr;
+            r.mIndex = TOMBSTONE;
+            --mCount;
+            ++mTombstones;
+            return;
+        }
+    }
+}
+
+void StorageIndex::erasePage(Page* page)
+{
+    if (!isActive()) {
+        return;
+    }
+
+    for (size_t slot = 0; slot < mCapacity; ++slot) {
+        Record& r = mRecords[slot];
+        if (r.mPage == page) {
+            r.mPage = nullptr;
+            r.mIndex = TOMBSTONE;
+            --mCount;
+            ++mTombstones;
+        }
+    }
+}
+
+esp_err_t StorageIndex::find(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, size_t& itemIndex, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
+{
+    assert(isActive());
+
+    const size_t mask = mCapacity - 1;
+    const uint32_t hash = hashOf(Item(nsIndex, datatype, 0, key, chunkIdx));
+    Page* foundPage = nullptr;
+    size_t foundIndex = 0;
+    uint32_t foundSeqNumber = 0;
+
+    /* Records with a matching hash may belong to other keys or be stale, so every candidate
+     * is checked by the page. If (transiently) more than one page holds the item, return the
+     * oldest one, as a sequential search over the page list would.
+     * Verifying may erase corrupted entries, which only turns records into tombstones and
+     * doesn't move any of them. */
+    for (size_t slot = hash & mask;
+            mRecords[slot].mPage != nullptr || mRecords[slot].mIndex == TOMBSTONE;
+            slot = (slot + 1) & mask) {
+        const Record r = mRecords[slot];
+        if (r.mPage == nullptr || r.mHash != hash || r.mPage == foundPage) {
+            continue;
+        }
+
+        uint32_t seqNumber;
+        if (r.mPage->getSeqNumber(seqNumber) != ESP_OK || (foundPage != nullptr && seqNumber >= foundSeqNumber)) {
+            continue;
+        }
+
+        size_t candidateIndex = r.mIndex;
+        Item candidate;
+        if (r.mPage->findItem(nsIndex, datatype, key, candidateIndex, candidate, chunkIdx, chunkStart) == ESP_OK) {
+            foundPage = r.mPage;
+            foundIndex = candidateIndex;
+            foundSeqNumber = seqNumber;
+            item = candidate;
+        }
+    }
+
+    if (foundPage == nullptr) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    page = foundPage;
+    itemIndex = foundIndex;
+    return ESP_OK;
+}
+
+} // namespace nvs
@@ -0,0 +1,110 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef nvs_storage_index_hpp
+#define nvs_storage_index_hpp
+
+#include "sdkconfig.h"
+#include "nvs.h"
+#include "nvs_types.hpp"
+
+#ifdef CONFIG_NVS_STORAGE_INDEX
+#define NVS_STORAGE_INDEX_MAX_SIZE CONFIG_NVS_STORAGE_INDEX_MAX_SIZE
+#else
+#define NVS_STORAGE_INDEX_MAX_SIZE 0
+#endif
+
+namespace nvs
+{
+
+class Page;
+
+/**
+ * Partition-wide index of the items stored in all pages of one Storage.
+ *
+ * Maps the hash of <namespace index, key, chunk index> to the page and entry holding the item, so that
+ * Storage can find an item without asking every page. Records are added and removed by the pages
+ * themselves, at the same places where the per-page HashList is updated.
+ *
+ * The index may contain stale records (e.g. for entries erased because of a CRC mismatch), each
+ * candidate is therefore verified against the page. It never misses an item which is present in one
+ * of the pages, as long as it is active. If the index would grow beyond its memory budget or an
+ * allocation fails, it deactivates itself and Storage falls back to searching all pages until
+ * it is reset.
+ */
+class StorageIndex
+{
+public:
+    StorageIndex(size_t maxSize) : mMaxSize(maxSize) { }
+
+    ~StorageIndex();
+
+    /**
+     * Drops all records and allocates an empty table, if the memory budget allows it.
+     */
+    void reset();
+
+    void clear();
+
+    bool isActive() const
+    {
+        return mRecords != nullptr;
+    }
+
+    void insert(const Item& item, Page* page, size_t index);
+
+    void erase(const Item& item, Page* page, size_t index);
+
+    void erasePage(Page* page);
+
+    /**
+     * Finds an item with the same semantics as searching all pages in sequence order.
+     * Must only be called while the index is active, with a specific namespace, type and key.
+     */
+    esp_err_t find(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, size_t& itemIndex, Item& item, uint8_t chunkIdx, VerOffset chunkStart);
+
+    size_t size() const
+    {
+        return mCount;
+    }
+
+    size_t capacity() const
+    {
+        return mCapacity;
+    }
+
+private:
+    StorageIndex(const StorageIndex& other);
+    const StorageIndex& operator= (const StorageIndex& rhs);
+
+protected:
+    struct Record {
+        Page* mPage;            // nullptr if the slot is empty or erased
+        uint32_t mIndex : 8;    // entry index inside the page, TOMBSTONE if the slot has been erased
+        uint32_t mHash  : 24;
+    };
+
+    static const uint32_t TOMBSTONE = 0xff;
+    static const size_t MIN_CAPACITY = 32;
+
+    static uint32_t hashOf(const Item& item)
+    {
+        return item.calculateCrc32WithoutValue() & 0xffffff;
+    }
+
+    bool rehash(size_t capacity);
+
+    void place(const Record& record);
+
+    size_t mMaxSize;
+    Record* mRecords = nullptr;
+    size_t mCapacity = 0;
+    size_t mCount = 0;
+    size_t mTombstones = 0;
+}; // class StorageIndex
+
+} // namespace nvs
+
+#endif /* nvs_storage_index_hpp */
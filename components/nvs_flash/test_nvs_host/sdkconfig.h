@@ -1,4 +1,5 @@
 #define CONFIG_NVS_ENCRYPTION 1
+#define CONFIG_NVS_STORAGE_INDEX_MAX_SIZE 65536
 //currently use the legacy implementation, since the stubs for new HAL are not done yet
 #define CONFIG_SPI_FLASH_USE_LEGACY_IMPL 1
 #define CONFIG_LOG_MAXIMUM_LEVEL 3
@@ -0,0 +1,23 @@
+#!/usr/bin/env bash
+#
+# Run the test suite with and without the optional lookup structures and lazy page loading
+#
+
+FAIL=0
+
+for FLAGS in "" "-DCONFIG_NVS_STORAGE_INDEX" "-DCONFIG_NVS_INLINE_HASH_TABLE" \
+             "-DCONFIG_NVS_STORAGE_INDEX -DCONFIG_NVS_INLINE_HASH_TABLE" \
+             "-DCONFIG_NVS_LAZY_PAGE_LOAD" \
+             "-DCONFIG_NVS_LAZY_PAGE_LOAD -DCONFIG_NVS_STORAGE_INDEX -DCONFIG_NVS_INLINE_HASH_TABLE" ; do
+    echo "==== Testing with config: ${FLAGS:-default} ===="
+    CPPFLAGS="${FLAGS}" make clean test || FAIL=1
+done
+
+make clean
+
+if [ $FAIL == 0 ]; then
+    echo "All configurations passed"
+else
+    echo "Some configurations failed, see log."
+    exit 1
+fi
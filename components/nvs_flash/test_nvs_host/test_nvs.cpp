@@ -27,6 +27,8 @@
 #include <sys/wait.h>
 #include <string.h>
 #include <string>
+#include <chrono>
+#include <new>
 
 #include "test_fixtures.hpp"
 
@@ -38,6 +40,21 @@ using namespace nvs;
 
 stringstream s_perf;
 
+// NVS allocates using new (std::nothrow), counting these tells which structures use the heap
+static size_t s_nothrowNewCount;
+static size_t s_nothrowNewBytes;
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    ++s_nothrowNewCount;
+    s_nothrowNewBytes += size;
+    try {
+        return ::operator new(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
 void dumpBytes(const uint8_t* data, size_t count)
 {
     for (uint32_t i = 0; i < count; ++i) {
@@ -332,6 +349,96 @@ TEST_CASE("HashList is cleaned up as soon as items are erased", "[nvs]")
     CHECK(hashlist.getBlockCount() == 0);
 }
 
+TEST_CASE("HashTable finds the same entries as HashList", "[nvs][hashtable]")
+{
+    const size_t count = Page::ENTRY_COUNT;
+    HashList hashlist;
+    HashTable<count> hashtable;
+    std::mt19937 gen(42);
+    // few distinct keys, so that each hash matches several entries
+    auto itemFor = [](size_t key) {
+        char name[16];
+        snprintf(name, sizeof(name), "k%d", static_cast<int>(key));
+        return Item(1, ItemType::U32, 1, name);
+    };
+
+    for (int round = 0; round < 100; ++round) {
+        hashlist.clear();
+        hashtable.clear();
+        // like a page, write entries in order and erase some of them in between
+        for (size_t i = 0; i < count; ++i) {
+            Item item = itemFor(gen() % 20);
+            TEST_ESP_OK(hashlist.insert(item, i));
+            TEST_ESP_OK(hashtable.insert(item, i));
+            if (gen() % 3 == 0) {
+                size_t index = gen() % (i + 1);
+                CHECK(hashtable.erase(index) == hashlist.erase(index));
+            }
+            for (size_t key = 0; key < 20; ++key) {
+                size_t start = gen() % (i + 1);
+                CHECK(hashtable.find(start, itemFor(key)) == hashlist.find(start, itemFor(key)));
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            CHECK(hashtable.erase(i) == hashlist.erase(i));
+        }
+        CHECK(hashtable.find(0, itemFor(0)) == SIZE_MAX);
+    }
+}
+
+static size_t hash_find_time_ns(size_t (*find)(void*, size_t, const Item&), void* hashes, const Item* items, size_t count)
+{
+    const size_t ROUNDS = 200;
+    size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < ROUNDS; ++round) {
+        for (size_t i = 0; i < count; ++i) {
+            found += (find(hashes, 0, items[i]) == i);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    CHECK(found == ROUNDS * count);
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / (ROUNDS * count);
+}
+
+TEST_CASE("HashTable uses no heap and is faster to search than HashList", "[nvs][hashtable]")
+{
+    const size_t count = Page::ENTRY_COUNT;
+    static Item items[count];
+    HashListTestHelper hashlist;
+    HashTable<count> hashtable;
+    for (size_t i = 0; i < count; ++i) {
+        char key[16];
+        snprintf(key, sizeof(key), "key%d", static_cast<int>(i));
+        items[i] = Item(1, ItemType::U32, 1, key);
+    }
+
+    size_t allocCount = s_nothrowNewCount;
+    size_t allocBytes = s_nothrowNewBytes;
+    for (size_t i = 0; i < count; ++i) {
+        TEST_ESP_OK(hashtable.insert(items[i], i));
+    }
+    CHECK(s_nothrowNewCount == allocCount);
+    CHECK(s_nothrowNewBytes == allocBytes);
+
+    for (size_t i = 0; i < count; ++i) {
+        TEST_ESP_OK(hashlist.insert(items[i], i));
+    }
+    CHECK(s_nothrowNewCount - allocCount == hashlist.getBlockCount());
+    CHECK(s_nothrowNewBytes > allocBytes);
+
+    size_t listTime = hash_find_time_ns([](void* h, size_t start, const Item& item) {
+        return static_cast<HashList*>(h)->find(start, item);
+    }, &hashlist, items, count);
+    size_t tableTime = hash_find_time_ns([](void* h, size_t start, const Item& item) {
+        return static_cast<HashTable<count>*>(h)->find(start, item);
+    }, &hashtable, items, count);
+
+    s_perf << "Hashes of a full page (" << count << " items): HashList " << hashlist.getBlockCount() << " heap blocks ("
+        << s_nothrowNewBytes - allocBytes << " bytes), " << listTime << " ns per lookup; HashTable 0 heap blocks ("
+        << sizeof(hashtable) << " bytes inline), " << tableTime << " ns per lookup" << std::endl;
+}
+
 TEST_CASE("can init PageManager in empty flash", "[nvs]")
 {
     PartitionEmulationFixture f(0, 4);
@@ -2902,6 +3009,691 @@ TEST_CASE("check and read data from partition generated via manufacturing utilit
 
 }
 
+// the best of several rounds, so that the result can be compared against other page counts
+static size_t lookup_time_ns(Storage& storage, const char* key, esp_err_t expected)
+{
+    const size_t ROUNDS = 5;
+    const size_t LOOKUP_COUNT = 2000;
+    size_t failures = 0;
+    size_t best = SIZE_MAX;
+    uint32_t val;
+    for (size_t round = 0; round < ROUNDS; ++round) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < LOOKUP_COUNT; ++i) {
+            if (storage.readItem(1, key, val) != expected) {
+                ++failures;
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, static_cast<size_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+    }
+    CHECK(failures == 0);
+    return best / LOOKUP_COUNT;
+}
+
+TEST_CASE("storage index keeps lookup time independent of page count", "[nvs][index]")
+{
+    const size_t pageCounts[] = {8, 32, 128, 512};
+    static uint8_t blob[3900];
+    std::fill_n(blob, sizeof(blob), 0xa5);
+
+    const size_t PAGE_COUNT_NUM = sizeof(pageCounts) / sizeof(pageCounts[0]);
+    size_t lookupTime[PAGE_COUNT_NUM][2][2];
+    for (size_t n = 0; n < PAGE_COUNT_NUM; ++n) {
+        const size_t pageCount = pageCounts[n];
+        for (int indexed = 0; indexed < 2; ++indexed) {
+            PartitionEmulationFixture f(0, pageCount);
+            Storage storage(&f.part, indexed ? 1024 * 1024 : 0);
+            TEST_ESP_OK(storage.init(0, pageCount));
+
+            // each blob occupies one page, the item we look for ends up on the last one
+            for (size_t i = 0; i < pageCount - 2; ++i) {
+                char key[16];
+                snprintf(key, sizeof(key), "blob%d", static_cast<int>(i));
+                TEST_ESP_OK(storage.writeItem(1, ItemType::BLOB, key, blob, sizeof(blob)));
+            }
+            TEST_ESP_OK(storage.writeItem(1, "last", static_cast<uint32_t>(pageCount)));
+
+            lookupTime[n][indexed][0] = lookup_time_ns(storage, "last", ESP_OK);
+            lookupTime[n][indexed][1] = lookup_time_ns(storage, "missing", ESP_ERR_NVS_NOT_FOUND);
+        }
+        s_perf << "Lookup time with " << pageCount << " pages (existing/missing key): "
+            << lookupTime[n][0][0] << "/" << lookupTime[n][0][1] << " ns without index, "
+            << lookupTime[n][1][0] << "/" << lookupTime[n][1][1] << " ns with index" << std::endl;
+    }
+
+    // with 64 times as many pages, searching all pages takes much longer, while a lookup in the index
+    // stays within a small factor of the time it takes with the smallest partition
+    for (int key = 0; key < 2; ++key) {
+        INFO(key);
+        CHECK(lookupTime[PAGE_COUNT_NUM - 1][0][key] > 8 * lookupTime[0][0][key]);
+        CHECK(lookupTime[PAGE_COUNT_NUM - 1][1][key] < 3 * lookupTime[0][1][key] + 100);
+    }
+}
+
+TEST_CASE("storage falls back to searching pages if index exceeds its budget", "[nvs][index]")
+{
+    PartitionEmulationFixture f(0, 8);
+    // room for the initial table only
+    Storage storage(&f.part, 32 * 16);
+    TEST_ESP_OK(storage.init(0, 8));
+
+    for (int i = 0; i < 100; ++i) {
+        char key[16];
+        snprintf(key, sizeof(key), "key%d", i);
+        TEST_ESP_OK(storage.writeItem(1, key, i));
+    }
+    for (int i = 0; i < 100; ++i) {
+        char key[16];
+        snprintf(key, sizeof(key), "key%d", i);
+        int val;
+        TEST_ESP_OK(storage.readItem(1, key, val));
+        CHECK(val == i);
+    }
+    int val;
+    TEST_ESP_ERR(storage.readItem(1, "missing", val), ESP_ERR_NVS_NOT_FOUND);
+}
+
+static void write_calibration(nvs_handle_t handle, size_t count, uint32_t base, bool batch)
+{
+    if (batch) {
+        TEST_ESP_OK(nvs_batch_begin(handle));
+    }
+    for (size_t i = 0; i < count; ++i) {
+        char key[16];
+        snprintf(key, sizeof(key), "cal%d", static_cast<int>(i));
+        TEST_ESP_OK(nvs_set_u32(handle, key, base + i));
+    }
+    char str[16];
+    snprintf(str, sizeof(str), "rev %u", static_cast<unsigned>(base));
+    TEST_ESP_OK(nvs_set_str(handle, "rev", str));
+    uint8_t table[100];
+    std::fill_n(table, sizeof(table), static_cast<uint8_t>(base));
+    TEST_ESP_OK(nvs_set_blob(handle, "table", table, sizeof(table)));
+}
+
+/* Returns the number of calibration values having the given base, checking that the others
+ * have the value written before. */
+static size_t count_calibration(nvs_handle_t handle, size_t count, uint32_t base, uint32_t oldBase)
+{
+    size_t found = 0;
+    for (size_t i = 0; i < count; ++i) {
+        char key[16];
+        snprintf(key, sizeof(key), "cal%d", static_cast<int>(i));
+        uint32_t val;
+        TEST_ESP_OK(nvs_get_u32(handle, key, &val));
+        CHECK((val == base + i || val == oldBase + i));
+        found += (val == base + i) ? 1 : 0;
+    }
+    char str[16];
+    size_t len = sizeof(str);
+    TEST_ESP_OK(nvs_get_str(handle, "rev", str, &len));
+    char expected[16];
+    snprintf(expected, sizeof(expected), "rev %u", static_cast<unsigned>(base));
+    found += (strcmp(str, expected) == 0) ? 1 : 0;
+    uint8_t table[100];
+    len = sizeof(table);
+    TEST_ESP_OK(nvs_get_blob(handle, "table", table, &len));
+    CHECK(len == sizeof(table));
+    found += (table[0] == static_cast<uint8_t>(base)) ? 1 : 0;
+    return found;
+}
+
+TEST_CASE("nvs batch is only visible after commit", "[nvs][batch]")
+{
+    PartitionEmulationFixture f(0, 8);
+    TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 8));
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("calib", NVS_READWRITE, &handle));
+
+    write_calibration(handle, 40, 0, false);
+    write_calibration(handle, 40, 100, true);
+    CHECK(count_calibration(handle, 40, 100, 0) == 0);
+    TEST_ESP_ERR(nvs_erase_key(handle, "cal0"), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_erase_all(handle), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_OK(nvs_commit(handle));
+    CHECK(count_calibration(handle, 40, 100, 0) == 42);
+
+    // setting a key again within a batch replaces the staged value
+    TEST_ESP_OK(nvs_batch_begin(handle));
+    TEST_ESP_OK(nvs_set_u32(handle, "cal0", 1));
+    TEST_ESP_OK(nvs_set_u32(handle, "cal1", 2));
+    TEST_ESP_OK(nvs_set_u32(handle, "cal0", 100));
+    TEST_ESP_OK(nvs_commit(handle));
+    uint32_t val;
+    TEST_ESP_OK(nvs_get_u32(handle, "cal0", &val));
+    CHECK(val == 100);
+    TEST_ESP_OK(nvs_get_u32(handle, "cal1", &val));
+    CHECK(val == 2);
+    TEST_ESP_OK(nvs_set_u32(handle, "cal1", 101));
+
+    // a batch has to fit into one page
+    TEST_ESP_OK(nvs_batch_begin(handle));
+    uint8_t big[3000] = {0};
+    TEST_ESP_OK(nvs_set_blob(handle, "big", big, sizeof(big)));
+    TEST_ESP_ERR(nvs_set_blob(handle, "big2", big, sizeof(big)), ESP_ERR_NVS_NOT_ENOUGH_SPACE);
+    TEST_ESP_OK(nvs_batch_abort(handle));
+    TEST_ESP_ERR(nvs_batch_abort(handle), ESP_ERR_NVS_INVALID_STATE);
+    size_t len = 0;
+    TEST_ESP_ERR(nvs_get_blob(handle, "big", nullptr, &len), ESP_ERR_NVS_NOT_FOUND);
+
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+
+    // values survive re-initialization, no marker is left over
+    TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 8));
+    TEST_ESP_OK(nvs_open("calib", NVS_READWRITE, &handle));
+    CHECK(count_calibration(handle, 40, 100, 0) == 42);
+    nvs_iterator_t it = nvs_entry_find(NVS_DEFAULT_PART_NAME, nullptr, NVS_TYPE_ANY);
+    size_t entries = 0;
+    while (it != nullptr) {
+        nvs_entry_info_t info;
+        nvs_entry_info(it, &info);
+        CHECK(strcmp(info.namespace_name, "calib") == 0);
+        ++entries;
+        it = nvs_entry_next(it);
+    }
+    CHECK(entries == 42);
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
+
+TEST_CASE("nvs batch is either fully visible or not at all after power loss", "[nvs][batch][recovery]")
+{
+    const size_t KEY_COUNT = 40;
+    // without padding, the batch goes into the page holding the old values, otherwise into the next one
+    for (size_t padding : {0, 3000}) {
+        INFO(padding);
+        for (uint32_t errDelay = 0; ; ++errDelay) {
+            INFO(errDelay);
+            PartitionEmulationFixture f(0, 8);
+            TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 8));
+            nvs_handle_t handle;
+            TEST_ESP_OK(nvs_open("calib", NVS_READWRITE, &handle));
+            if (padding) {
+                std::vector<uint8_t> pad(padding, 0x55);
+                TEST_ESP_OK(nvs_set_blob(handle, "pad", pad.data(), pad.size()));
+            }
+            write_calibration(handle, KEY_COUNT, 0, false);
+            write_calibration(handle, KEY_COUNT, 1000, true);
+
+            f.emu.failAfter(errDelay);
+            esp_err_t res = nvs_commit(handle);
+            nvs_close(handle);
+            TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+            f.emu.failAfter(UINT32_MAX);
+
+            TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 8));
+            TEST_ESP_OK(nvs_open("calib", NVS_READWRITE, &handle));
+            size_t found = count_calibration(handle, KEY_COUNT, 1000, 0);
+            if (res == ESP_OK || res == ESP_ERR_NVS_REMOVE_FAILED) {
+                CHECK(found == KEY_COUNT + 2);
+            } else {
+                CHECK((found == 0 || found == KEY_COUNT + 2));
+            }
+            nvs_close(handle);
+            TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+
+            if (res == ESP_OK) {
+                break;
+            }
+        }
+    }
+}
+
+static void stage_u32(Storage::TBatchItems& batch, const char* key, uint32_t val)
+{
+    Storage::BatchItem* item = new Storage::BatchItem;
+    item->datatype = ItemType::U32;
+    strncpy(item->key, key, sizeof(item->key) - 1);
+    item->key[sizeof(item->key) - 1] = 0;
+    item->data = new uint8_t[sizeof(val)];
+    memcpy(item->data, &val, sizeof(val));
+    item->dataSize = sizeof(val);
+    batch.push_back(item);
+}
+
+TEST_CASE("nvs batch is finished after re-init if later writes moved on to another page", "[nvs][batch][recovery]")
+{
+    const size_t KEY_COUNT = 10;
+    static uint8_t pad[3500];
+    for (bool lazy : {false, true}) {
+        bool checked = false;
+        for (uint32_t errDelay = 0; ; ++errDelay) {
+            INFO(lazy);
+            INFO(errDelay);
+            PartitionEmulationFixture f(0, 8);
+            esp_err_t res;
+            {
+                Storage storage(&f.part, NVS_STORAGE_INDEX_MAX_SIZE, false);
+                TEST_ESP_OK(storage.init(0, 8));
+                char key[16];
+                for (size_t i = 0; i < KEY_COUNT; ++i) {
+                    snprintf(key, sizeof(key), "cal%d", static_cast<int>(i));
+                    TEST_ESP_OK(storage.writeItem(1, key, static_cast<uint32_t>(i)));
+                }
+                // the batch goes into the next page, which remains usable if erasing a superseded item fails
+                TEST_ESP_OK(storage.writeItem(2, ItemType::BLOB, "pad", pad, sizeof(pad)));
+
+                Storage::TBatchItems batch;
+                for (size_t i = 0; i < KEY_COUNT; ++i) {
+                    snprintf(key, sizeof(key), "cal%d", static_cast<int>(i));
+                    stage_u32(batch, key, 1000 + i);
+                }
+                f.emu.failAfter(errDelay);
+                res = storage.writeBatch(1, batch);
+                f.emu.failAfter(UINT32_MAX);
+                batch.clearAndFreeNodes();
+                if (res != ESP_ERR_NVS_REMOVE_FAILED) {
+                    if (res == ESP_OK) {
+                        break;
+                    }
+                    continue;
+                }
+
+                // the marker stays on the page of the batch, while these go to the next one
+                size_t filled = 0;
+                for (; filled < Page::ENTRY_COUNT; ++filled) {
+                    snprintf(key, sizeof(key), "fill%d", static_cast<int>(filled));
+                    if (storage.writeItem(2, key, static_cast<uint32_t>(filled)) != ESP_OK) {
+                        break;
+                    }
+                }
+                if (filled < Page::ENTRY_COUNT) {
+                    // erasing the marker failed, so its page can't be written any more
+                    continue;
+                }
+            }
+
+            Storage storage(&f.part, NVS_STORAGE_INDEX_MAX_SIZE, lazy);
+            TEST_ESP_OK(storage.init(0, 8));
+            // loading lazily, the marker is only found once all pages are loaded, as done by fillStats
+            nvs_stats_t stats;
+            TEST_ESP_OK(storage.fillStats(stats));
+            for (size_t i = 0; i < KEY_COUNT; ++i) {
+                char key[16];
+                snprintf(key, sizeof(key), "cal%d", static_cast<int>(i));
+                uint32_t val;
+                TEST_ESP_OK(storage.readItem(1, key, val));
+                CHECK(val == 1000 + i);
+            }
+            // neither the superseded items nor the marker are left over
+            CHECK(stats.used_entries == KEY_COUNT + Page::ENTRY_COUNT
+                    + Page::getItemEntryCount(ItemType::BLOB_DATA, sizeof(pad)) + 1);
+            checked = true;
+        }
+        CHECK(checked);
+    }
+}
+
+TEST_CASE("nvs batch takes fewer flash operations than single writes", "[nvs][batch]")
+{
+    const size_t KEY_COUNT = 40;
+    size_t writeOps[2];
+    for (bool batch : {false, true}) {
+        PartitionEmulationFixture f(0, 8);
+        TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 8));
+        nvs_handle_t handle;
+        TEST_ESP_OK(nvs_open("calib", NVS_READWRITE, &handle));
+        write_calibration(handle, KEY_COUNT, 0, false);
+
+        f.emu.clearStats();
+        write_calibration(handle, KEY_COUNT, 1000, batch);
+        TEST_ESP_OK(nvs_commit(handle));
+        writeOps[batch] = f.emu.getWriteOps();
+        s_perf << "Updating " << KEY_COUNT << " integers, a string and a blob " << (batch ? "in a batch" : "one by one")
+               << ": " << f.emu.getTotalTime() << " us (" << f.emu.getEraseOps() << "E " << f.emu.getWriteOps() << "W "
+               << f.emu.getReadOps() << "R " << f.emu.getWriteBytes() << "Wb " << f.emu.getReadBytes() << "Rb)" << std::endl;
+
+        CHECK(count_calibration(handle, KEY_COUNT, 1000, 0) == KEY_COUNT + 2);
+        nvs_close(handle);
+        TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+    }
+    CHECK(writeOps[true] * 2 < writeOps[false]);
+}
+
+TEST_CASE("nvs blob writer and reader C API", "[nvs][blob_stream]")
+{
+    PartitionEmulationFixture f(0, 8);
+    TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 8));
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("stream", NVS_READWRITE, &handle));
+
+    static uint8_t data[10000];
+    for (size_t i = 0; i < sizeof(data); ++i) {
+        data[i] = static_cast<uint8_t>(i * 7);
+    }
+    TEST_ESP_OK(nvs_set_blob(handle, "blob", data, 100));
+
+    nvs_blob_writer_t writer;
+    TEST_ESP_OK(nvs_blob_writer_open(handle, "blob", &writer));
+    nvs_blob_writer_t other;
+    TEST_ESP_ERR(nvs_blob_writer_open(handle, "blob", &other), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_set_blob(handle, "blob", data, 10), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_erase_key(handle, "blob"), ESP_ERR_NVS_INVALID_STATE);
+    TEST_ESP_ERR(nvs_erase_all(handle), ESP_ERR_NVS_INVALID_STATE);
+    for (size_t offset = 0; offset < sizeof(data); offset += 1000) {
+        TEST_ESP_OK(nvs_blob_write(writer, data + offset, 1000));
+    }
+    TEST_ESP_OK(nvs_blob_write_finish(writer));
+    nvs_blob_writer_close(writer);
+
+    nvs_blob_reader_t reader;
+    size_t size = 0;
+    TEST_ESP_OK(nvs_blob_reader_open(handle, "blob", &reader, &size));
+    CHECK(size == sizeof(data));
+    static uint8_t readBack[sizeof(data)];
+    size_t total = 0;
+    size_t len;
+    do {
+        TEST_ESP_OK(nvs_blob_read(reader, readBack + total, 3000, &len));
+        total += len;
+    } while (len == 3000);
+    CHECK(total == sizeof(data));
+    CHECK(memcmp(data, readBack, sizeof(data)) == 0);
+    nvs_blob_reader_close(reader);
+
+    // the key is free again once the writer has finished
+    TEST_ESP_OK(nvs_set_blob(handle, "blob", data, 10));
+
+    // closing the handle first discards what has been written so far
+    TEST_ESP_OK(nvs_blob_writer_open(handle, "blob", &writer));
+    TEST_ESP_OK(nvs_blob_write(writer, data, 5000));
+    TEST_ESP_OK(nvs_blob_reader_open(handle, "blob", &reader, &size));
+    nvs_close(handle);
+    TEST_ESP_ERR(nvs_blob_write(writer, data, 10), ESP_ERR_NVS_INVALID_HANDLE);
+    TEST_ESP_ERR(nvs_blob_write_finish(writer), ESP_ERR_NVS_INVALID_HANDLE);
+    TEST_ESP_ERR(nvs_blob_read(reader, readBack, 10, &len), ESP_ERR_NVS_INVALID_HANDLE);
+    nvs_blob_writer_close(writer);
+    nvs_blob_reader_close(reader);
+
+    TEST_ESP_OK(nvs_open("stream", NVS_READWRITE, &handle));
+    len = sizeof(readBack);
+    TEST_ESP_OK(nvs_get_blob(handle, "blob", readBack, &len));
+    CHECK(len == 10);
+    TEST_ESP_OK(nvs_blob_writer_open(handle, "blob", &writer));
+    nvs_blob_writer_close(writer);
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
+
+TEST_CASE("lazy page loading reads only page headers during init", "[nvs][lazy]")
+{
+    const size_t PAGE_COUNT = 512;
+    static uint8_t blob[3900];
+    std::fill_n(blob, sizeof(blob), 0x5a);
+    PartitionEmulationFixture f(0, PAGE_COUNT);
+    {
+        Storage storage(&f.part);
+        TEST_ESP_OK(storage.init(0, PAGE_COUNT));
+        // each blob occupies one page
+        for (size_t i = 0; i < PAGE_COUNT - 2; ++i) {
+            char key[16];
+            snprintf(key, sizeof(key), "blob%d", static_cast<int>(i));
+            TEST_ESP_OK(storage.writeItem(1, ItemType::BLOB, key, blob, sizeof(blob)));
+        }
+        TEST_ESP_OK(storage.writeItem(1, "last", 42));
+    }
+
+    size_t initTime[2];
+    for (bool lazy : {false, true}) {
+        Storage storage(&f.part, NVS_STORAGE_INDEX_MAX_SIZE, lazy);
+        f.emu.clearStats();
+        TEST_ESP_OK(storage.init(0, PAGE_COUNT));
+        initTime[lazy] = f.emu.getTotalTime();
+        s_perf << "Time to init storage with " << PAGE_COUNT << " full pages" << (lazy ? " (lazy)" : "") << ": "
+               << f.emu.getTotalTime() << " us (" << f.emu.getReadOps() << "R " << f.emu.getReadBytes() << "Rb)" << std::endl;
+
+        int val;
+        TEST_ESP_OK(storage.readItem(1, "last", val));
+        CHECK(val == 42);
+        uint8_t buf[sizeof(blob)];
+        TEST_ESP_OK(storage.readItem(1, ItemType::BLOB, "blob300", buf, sizeof(buf)));
+        CHECK(memcmp(buf, blob, sizeof(buf)) == 0);
+        TEST_ESP_ERR(storage.readItem(1, "missing", val), ESP_ERR_NVS_NOT_FOUND);
+
+        nvs_stats_t stats;
+        TEST_ESP_OK(storage.fillStats(stats));
+        CHECK(stats.used_entries == (PAGE_COUNT - 2) * (Page::getItemEntryCount(ItemType::BLOB_DATA, sizeof(blob)) + 1) + 1);
+    }
+    CHECK(initTime[true] * 5 < initTime[false]);
+}
+
+TEST_CASE("lazy page loading erases duplicates from pages loaded later", "[nvs][lazy]")
+{
+    PartitionEmulationFixture f(0, 4);
+
+    // power went off after the new value had been written, before the old one was erased
+    Page p;
+    p.load(&f.part, 0);
+    p.setSeqNumber(0);
+    TEST_ESP_OK(p.writeItem(1, "dup", 1));
+    TEST_ESP_OK(p.writeItem(1, "other", 3));
+    TEST_ESP_OK(p.markFull());
+    Page p2;
+    p2.load(&f.part, 1);
+    p2.setSeqNumber(1);
+    TEST_ESP_OK(p2.writeItem(1, "dup", 2));
+
+    Storage storage(&f.part, NVS_STORAGE_INDEX_MAX_SIZE, true);
+    TEST_ESP_OK(storage.init(0, 4));
+    int val;
+    TEST_ESP_OK(storage.readItem(1, "dup", val));
+    CHECK(val == 2);
+    TEST_ESP_OK(storage.readItem(1, "other", val));
+    CHECK(val == 3);
+
+    Page p3;
+    p3.load(&f.part, 0);
+    TEST_ESP_ERR(p3.findItem(1, itemTypeOf<int>(), "dup"), ESP_ERR_NVS_NOT_FOUND);
+    TEST_ESP_OK(p3.findItem(1, itemTypeOf<int>(), "other"));
+}
+
+TEST_CASE("lazy page loading keeps namespace indices unique", "[nvs][lazy]")
+{
+    static uint8_t blob[3900];
+    PartitionEmulationFixture f(0, 8);
+    uint8_t nsIndex;
+    {
+        Storage storage(&f.part);
+        TEST_ESP_OK(storage.init(0, 8));
+        TEST_ESP_OK(storage.createOrOpenNamespace("first", true, nsIndex));
+        CHECK(nsIndex == 1);
+        TEST_ESP_OK(storage.writeItem(nsIndex, ItemType::BLOB, "blob", blob, sizeof(blob)));
+        TEST_ESP_OK(storage.createOrOpenNamespace("second", true, nsIndex));
+        CHECK(nsIndex == 2);
+    }
+
+    Storage storage(&f.part, NVS_STORAGE_INDEX_MAX_SIZE, true);
+    TEST_ESP_OK(storage.init(0, 8));
+    TEST_ESP_OK(storage.createOrOpenNamespace("second", false, nsIndex));
+    CHECK(nsIndex == 2);
+    TEST_ESP_ERR(storage.createOrOpenNamespace("missing", false, nsIndex), ESP_ERR_NVS_NOT_FOUND);
+    TEST_ESP_OK(storage.createOrOpenNamespace("third", true, nsIndex));
+    CHECK(nsIndex == 3);
+    TEST_ESP_OK(storage.createOrOpenNamespace("first", false, nsIndex));
+    CHECK(nsIndex == 1);
+
+    nvs_stats_t stats;
+    TEST_ESP_OK(storage.fillStats(stats));
+    CHECK(stats.namespace_count == 3);
+}
+
+// every 16th write adds an item which is never overwritten, the others overwrite one of 8 keys
+static void fillWithOverwrites(Storage& storage, size_t writeCount)
+{
+    for (size_t i = 0; i < writeCount; ++i) {
+        char key[16];
+        if (i % 16 == 0) {
+            snprintf(key, sizeof(key), "static%d", static_cast<int>(i));
+        } else {
+            snprintf(key, sizeof(key), "key%d", static_cast<int>(i % 8));
+        }
+        TEST_ESP_OK(storage.writeItem(1, key, static_cast<int>(i)));
+    }
+}
+
+static void checkOverwrites(Storage& storage, size_t writeCount)
+{
+    int val;
+    for (size_t i = 0; i < writeCount; i += 16) {
+        char key[16];
+        snprintf(key, sizeof(key), "static%d", static_cast<int>(i));
+        TEST_ESP_OK(storage.readItem(1, key, val));
+        CHECK(val == static_cast<int>(i));
+    }
+    nvs_stats_t stats;
+    TEST_ESP_OK(storage.fillStats(stats));
+    CHECK(stats.used_entries == 8 + (writeCount + 15) / 16);
+}
+
+// runs incremental garbage collection to completion unless gc is false, and returns the number of erases
+// the writes filling the next page need in the foreground
+static size_t writeAfterGarbageCollection(bool lazy, bool gc)
+{
+    const size_t PAGE_COUNT = 8;
+    const size_t MAX_ENTRIES = 4;
+    // all but one page are used and mostly hold erased entries
+    const size_t WRITE_COUNT = (PAGE_COUNT - 1) * Page::ENTRY_COUNT - 10;
+
+    PartitionEmulationFixture f(0, PAGE_COUNT);
+    {
+        Storage storage(&f.part, NVS_STORAGE_INDEX_MAX_SIZE, false);
+        TEST_ESP_OK(storage.init(0, PAGE_COUNT));
+        fillWithOverwrites(storage, WRITE_COUNT);
+    }
+    // with lazy loading, the page to collect is picked using the entry state tables only
+    Storage storage(&f.part, NVS_STORAGE_INDEX_MAX_SIZE, lazy);
+    TEST_ESP_OK(storage.init(0, PAGE_COUNT));
+
+    size_t steps = 0;
+    bool done = !gc;
+    while (!done) {
+        f.emu.clearStats();
+        TEST_ESP_OK(storage.collectGarbage(MAX_ENTRIES, done));
+        // a step either moves a bounded number of items or erases one page
+        CHECK(f.emu.getEraseOps() <= 1);
+        CHECK(f.emu.getWriteOps() <= 3 * MAX_ENTRIES + 4);
+        CHECK(f.emu.getWriteOps() * f.emu.getEraseOps() == 0);
+        REQUIRE(++steps < PAGE_COUNT * Page::ENTRY_COUNT);
+    }
+    checkOverwrites(storage, WRITE_COUNT);
+    if (gc) {
+        // nothing left to do
+        TEST_ESP_OK(storage.collectGarbage(MAX_ENTRIES, done));
+        CHECK(done);
+    }
+
+    // the next page the writes need is taken from the reserve
+    f.emu.clearStats();
+    fillWithOverwrites(storage, Page::ENTRY_COUNT);
+    if (!lazy) {
+        s_perf << "Time to write " << Page::ENTRY_COUNT << " items" << (gc ? " after incremental GC" : "") << ": "
+               << f.emu.getTotalTime() << " us (" << f.emu.getEraseOps() << "E " << f.emu.getWriteOps() << "W)"
+               << ", " << steps << " GC steps" << std::endl;
+    }
+    return f.emu.getEraseOps();
+}
+
+TEST_CASE("incremental garbage collection keeps erased pages in reserve", "[nvs][gc]")
+{
+    for (bool lazy : {false, true}) {
+        INFO(lazy);
+        CHECK(writeAfterGarbageCollection(lazy, false) > 0);
+        CHECK(writeAfterGarbageCollection(lazy, true) == 0);
+    }
+}
+
+TEST_CASE("incremental garbage collection erases free pages which aren't empty", "[nvs][gc]")
+{
+    for (bool lazy : {false, true}) {
+        INFO(lazy);
+        PartitionEmulationFixture f(0, 4);
+        {
+            Storage storage(&f.part);
+            TEST_ESP_OK(storage.init(0, 4));
+            TEST_ESP_OK(storage.writeItem(1, "key", 1));
+        }
+        // the next page to be activated has an uninitialized header, but isn't erased
+        uint32_t garbage = 0x12345678;
+        CHECK(f.emu.write(SPI_FLASH_SEC_SIZE + 64, &garbage, sizeof(garbage)));
+
+        Storage storage(&f.part, NVS_STORAGE_INDEX_MAX_SIZE, lazy);
+        TEST_ESP_OK(storage.init(0, 4));
+        f.emu.clearStats();
+        bool done = false;
+        size_t steps = 0;
+        while (!done) {
+            TEST_ESP_OK(storage.collectGarbage(8, done));
+            REQUIRE(++steps < 4);
+        }
+        CHECK(f.emu.getEraseOps() == 1);
+
+        f.emu.clearStats();
+        fillWithOverwrites(storage, Page::ENTRY_COUNT);
+        CHECK(f.emu.getEraseOps() == 0);
+        int val;
+        TEST_ESP_OK(storage.readItem(1, "key", val));
+        CHECK(val == 1);
+    }
+}
+
+TEST_CASE("incremental garbage collection recovers from power-off", "[nvs][gc]")
+{
+    const size_t PAGE_COUNT = 8;
+    const size_t WRITE_COUNT = (PAGE_COUNT - 1) * Page::ENTRY_COUNT - 10;
+    for (bool lazy : {false, true}) {
+        bool finished = false;
+        for (uint32_t errDelay = 0; !finished; ++errDelay) {
+            INFO(lazy);
+            INFO(errDelay);
+            PartitionEmulationFixture f(0, PAGE_COUNT);
+            bool done = false;
+            {
+                Storage storage(&f.part, NVS_STORAGE_INDEX_MAX_SIZE, lazy);
+                TEST_ESP_OK(storage.init(0, PAGE_COUNT));
+                fillWithOverwrites(storage, WRITE_COUNT);
+                f.emu.failAfter(errDelay);
+                esp_err_t err;
+                do {
+                    err = storage.collectGarbage(5, done);
+                } while (err == ESP_OK && !done);
+                finished = (err == ESP_OK);
+            }
+            f.emu.failAfter(UINT32_MAX);
+
+            Storage storage(&f.part, NVS_STORAGE_INDEX_MAX_SIZE, lazy);
+            TEST_ESP_OK(storage.init(0, PAGE_COUNT));
+            checkOverwrites(storage, WRITE_COUNT);
+
+            do {
+                TEST_ESP_OK(storage.collectGarbage(5, done));
+            } while (!done);
+            checkOverwrites(storage, WRITE_COUNT);
+
+            f.emu.clearStats();
+            fillWithOverwrites(storage, Page::ENTRY_COUNT);
+            CHECK(f.emu.getEraseOps() == 0);
+        }
+    }
+}
+
+TEST_CASE("nvs_flash_gc_step checks its arguments", "[nvs][gc]")
+{
+    PartitionEmulationFixture f(0, 5);
+    bool done = true;
+    TEST_ESP_ERR(nvs_flash_gc_step(nullptr, 8, &done), ESP_ERR_NVS_NOT_INITIALIZED);
+    CHECK(!done);
+
+    TEST_ESP_OK(NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 5));
+    TEST_ESP_ERR(nvs_flash_gc_step(nullptr, 0, &done), ESP_ERR_INVALID_ARG);
+    TEST_ESP_ERR(nvs_flash_gc_step(nullptr, 8, nullptr), ESP_ERR_INVALID_ARG);
+    TEST_ESP_ERR(nvs_flash_gc_step("missing", 8, &done), ESP_ERR_NVS_NOT_INITIALIZED);
+    TEST_ESP_OK(nvs_flash_gc_step(NVS_DEFAULT_PART_NAME, 8, &done));
+    CHECK(done);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
+
 #if CONFIG_NVS_ENCRYPTION
 TEST_CASE("check underlying xts code for 32-byte size sector encryption", "[nvs]")
 {
@@ -3040,6 +3832,52 @@ TEST_CASE("test nvs apis with encryption enabled", "[nvs]")
 
 }
 
+template<typename Fixture>
+static void measure_blob_throughput(Fixture& f, const char* name)
+{
+    const size_t BLOB_SIZE = 3000;
+    const int ROUNDS = 200;
+    static uint8_t blob[BLOB_SIZE];
+    static uint8_t readBlob[BLOB_SIZE];
+
+    Storage storage(&f.part);
+    TEST_ESP_OK(storage.init(0, 8));
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ROUNDS; ++i) {
+        std::fill_n(blob, BLOB_SIZE, static_cast<uint8_t>(i));
+        TEST_ESP_OK(storage.writeItem(1, ItemType::BLOB, "blob", blob, BLOB_SIZE));
+    }
+    auto mid = std::chrono::steady_clock::now();
+    f.emu.clearStats();
+    for (int i = 0; i < ROUNDS; ++i) {
+        TEST_ESP_OK(storage.readItem(1, ItemType::BLOB, "blob", readBlob, BLOB_SIZE));
+    }
+    auto end = std::chrono::steady_clock::now();
+    CHECK(memcmp(blob, readBlob, BLOB_SIZE) == 0);
+
+    auto us = [](std::chrono::steady_clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+    };
+    s_perf << "Blob of " << BLOB_SIZE << " bytes, " << name << ": write " << us(mid - start) / ROUNDS
+        << " us, read " << us(end - mid) / ROUNDS << " us (" << f.emu.getReadOps() / ROUNDS << " flash reads)" << std::endl;
+}
+
+TEST_CASE("blob read and write time on plaintext and encrypted partitions", "[nvs][xts]")
+{
+    nvs_sec_cfg_t xts_cfg;
+    for (int count = 0; count < NVS_KEY_SIZE; count++) {
+        xts_cfg.eky[count] = 0x11;
+        xts_cfg.tky[count] = 0x22;
+    }
+
+    PartitionEmulationFixture plain(0, 8);
+    measure_blob_throughput(plain, "plaintext");
+
+    EncryptedPartitionFixture encrypted(&xts_cfg, 0, 8);
+    measure_blob_throughput(encrypted, "encrypted");
+}
+
 TEST_CASE("test nvs apis for nvs partition generator utility with encryption enabled", "[nvs_part_gen]")
 {
     int status;
@@ -191,3 +191,260 @@ TEST_CASE("NVSHandleSimple CXX api read/write blob", "[nvs cxx]")
 
     nvs::NVSPartitionManager::get_instance()->deinit_partition("nvs");
 }
+
+TEST_CASE("NVSHandleSimple CXX api batch", "[nvs cxx]")
+{
+    const uint32_t NVS_FLASH_SECTOR = 6;
+    const uint32_t NVS_FLASH_SECTOR_COUNT_MIN = 3;
+    PartitionEmulationFixture f(0, 10);
+    const char blob [6] = {15, 16, 17, 18, 19};
+    char read_blob[6] = {0};
+    char read_buffer [256];
+    uint32_t value;
+    esp_err_t result;
+    shared_ptr<nvs::NVSHandle> handle;
+
+    REQUIRE(nvs::NVSPartitionManager::get_instance()->init_custom(&f.part, NVS_FLASH_SECTOR, NVS_FLASH_SECTOR_COUNT_MIN)
+            == ESP_OK);
+
+    handle = nvs::open_nvs_handle("test_ns", NVS_READWRITE, &result);
+    CHECK(result == ESP_OK);
+    REQUIRE(handle);
+
+    CHECK(handle->set_item("value", 1u) == ESP_OK);
+
+    CHECK(handle->begin_batch() == ESP_OK);
+    CHECK(handle->begin_batch() == ESP_ERR_NVS_INVALID_STATE);
+    CHECK(handle->set_item("value", 2u) == ESP_OK);
+    CHECK(handle->set_string("str", "test string") == ESP_OK);
+    CHECK(handle->set_blob("blob", blob, sizeof(blob)) == ESP_OK);
+    CHECK(handle->erase_item("value") == ESP_ERR_NVS_INVALID_STATE);
+
+    // staged values are not visible before commit
+    CHECK(handle->get_item("value", value) == ESP_OK);
+    CHECK(value == 1);
+    CHECK(handle->get_string("str", read_buffer, sizeof(read_buffer)) == ESP_ERR_NVS_NOT_FOUND);
+
+    CHECK(handle->commit() == ESP_OK);
+    CHECK(handle->get_item("value", value) == ESP_OK);
+    CHECK(value == 2);
+    CHECK(handle->get_string("str", read_buffer, sizeof(read_buffer)) == ESP_OK);
+    CHECK(string(read_buffer) == "test string");
+    CHECK(handle->get_blob("blob", read_blob, sizeof(read_blob)) == ESP_OK);
+    CHECK(vector<char>(blob, blob + sizeof(blob)) == vector<char>(read_blob, read_blob + sizeof(read_blob)));
+
+    CHECK(handle->abort_batch() == ESP_ERR_NVS_INVALID_STATE);
+    CHECK(handle->begin_batch() == ESP_OK);
+    CHECK(handle->set_item("value", 3u) == ESP_OK);
+    CHECK(handle->abort_batch() == ESP_OK);
+    CHECK(handle->commit() == ESP_OK);
+    CHECK(handle->get_item("value", value) == ESP_OK);
+    CHECK(value == 2);
+
+    nvs::NVSPartitionManager::get_instance()->deinit_partition("nvs");
+}
+
+namespace {
+class ChunkCollector : public nvs::NVSDataVisitor {
+public:
+    esp_err_t begin(size_t size) override
+    {
+        size_seen = size;
+        return begin_result;
+    }
+
+    esp_err_t visit(const void *data, size_t size) override
+    {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        collected.insert(collected.end(), bytes, bytes + size);
+        ++chunks;
+        return ESP_OK;
+    }
+
+    esp_err_t begin_result = ESP_OK;
+    size_t size_seen = 0;
+    size_t chunks = 0;
+    vector<uint8_t> collected;
+};
+}
+
+TEST_CASE("NVSHandleSimple CXX api reads strings and blobs with a single lookup", "[nvs cxx]")
+{
+    PartitionEmulationFixture f(0, 10);
+    esp_err_t result;
+    shared_ptr<nvs::NVSHandle> handle;
+    vector<uint8_t> blob(10000);
+    for (size_t i = 0; i < blob.size(); ++i) {
+        blob[i] = static_cast<uint8_t>(i * 7);
+    }
+    const string long_str(100, 'x');
+
+    REQUIRE(nvs::NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 10) == ESP_OK);
+
+    handle = nvs::open_nvs_handle("test_ns", NVS_READWRITE, &result);
+    CHECK(result == ESP_OK);
+    REQUIRE(handle);
+
+    CHECK(handle->set_string("short", "test string") == ESP_OK);
+    CHECK(handle->set_string("long", long_str.c_str()) == ESP_OK);
+    CHECK(handle->set_blob("blob", blob.data(), blob.size()) == ESP_OK);
+
+    nvs::NVSData data;
+    CHECK(handle->get_string("short", data) == ESP_OK);
+    CHECK(data.size() == strlen("test string") + 1);
+    CHECK(string(data.c_str()) == "test string");
+    CHECK(handle->get_string("long", data) == ESP_OK);
+    CHECK(data.size() == long_str.size() + 1);
+    CHECK(string(data.c_str()) == long_str);
+    CHECK(handle->get_blob("blob", data) == ESP_OK);
+    CHECK(vector<uint8_t>(data.data(), data.data() + data.size()) == blob);
+
+    nvs::NVSData moved(std::move(data));
+    CHECK(data.size() == 0);
+    CHECK(vector<uint8_t>(moved.data(), moved.data() + moved.size()) == blob);
+    CHECK(handle->get_string("short", data) == ESP_OK);
+    moved = std::move(data);
+    CHECK(string(moved.c_str()) == "test string");
+
+    ChunkCollector collector;
+    CHECK(handle->visit_blob("blob", collector) == ESP_OK);
+    CHECK(collector.size_seen == blob.size());
+    CHECK(collector.chunks > 1);
+    CHECK(collector.collected == blob);
+
+    CHECK(handle->get_blob("missing", data) == ESP_ERR_NVS_NOT_FOUND);
+    CHECK(handle->get_string("blob", data) == ESP_ERR_NVS_NOT_FOUND);
+
+    ChunkCollector rejecting;
+    rejecting.begin_result = ESP_ERR_NO_MEM;
+    CHECK(handle->visit_string("long", rejecting) == ESP_ERR_NO_MEM);
+    CHECK(rejecting.size_seen == long_str.size() + 1);
+    CHECK(rejecting.chunks == 0);
+
+    // compared to querying the size first, the item is only found once
+    char buffer[128];
+    size_t reads[2];
+    size_t size;
+    f.emu.clearStats();
+    CHECK(handle->get_item_size(nvs::ItemType::SZ, "long", size) == ESP_OK);
+    CHECK(handle->get_string("long", buffer, size) == ESP_OK);
+    reads[0] = f.emu.getReadOps();
+    f.emu.clearStats();
+    CHECK(handle->get_string("long", data) == ESP_OK);
+    reads[1] = f.emu.getReadOps();
+    CHECK(reads[1] < reads[0]);
+
+    handle.reset();
+    nvs::NVSPartitionManager::get_instance()->deinit_partition("nvs");
+}
+
+namespace {
+// Implements only the functions which NVSHandle required before the single lookup and batch functions were added
+class ForwardingHandle : public nvs::NVSHandle {
+public:
+    ForwardingHandle(shared_ptr<nvs::NVSHandle> handle) : mHandle(handle) { }
+
+    esp_err_t set_string(const char *key, const char* value) override
+    {
+        return mHandle->set_string(key, value);
+    }
+
+    esp_err_t set_blob(const char *key, const void* blob, size_t len) override
+    {
+        return mHandle->set_blob(key, blob, len);
+    }
+
+    esp_err_t get_string(const char *key, char* out_str, size_t len) override
+    {
+        return mHandle->get_string(key, out_str, len);
+    }
+
+    esp_err_t get_blob(const char *key, void* out_blob, size_t len) override
+    {
+        return mHandle->get_blob(key, out_blob, len);
+    }
+
+    esp_err_t get_item_size(nvs::ItemType datatype, const char *key, size_t &size) override
+    {
+        return mHandle->get_item_size(datatype, key, size);
+    }
+
+    esp_err_t erase_item(const char* key) override
+    {
+        return mHandle->erase_item(key);
+    }
+
+    esp_err_t erase_all() override
+    {
+        return mHandle->erase_all();
+    }
+
+    esp_err_t commit() override
+    {
+        return mHandle->commit();
+    }
+
+    esp_err_t get_used_entry_count(size_t& usedEntries) override
+    {
+        return mHandle->get_used_entry_count(usedEntries);
+    }
+
+protected:
+    // not used by the test
+    esp_err_t set_typed_item(nvs::ItemType datatype, const char *key, const void* data, size_t dataSize) override
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    esp_err_t get_typed_item(nvs::ItemType datatype, const char *key, void* data, size_t dataSize) override
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+private:
+    shared_ptr<nvs::NVSHandle> mHandle;
+};
+}
+
+TEST_CASE("NVSHandle default implementations of the single lookup and batch functions", "[nvs cxx]")
+{
+    PartitionEmulationFixture f(0, 10);
+    esp_err_t result;
+    vector<uint8_t> blob(3000);
+    for (size_t i = 0; i < blob.size(); ++i) {
+        blob[i] = static_cast<uint8_t>(i * 3);
+    }
+
+    REQUIRE(nvs::NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 10) == ESP_OK);
+
+    shared_ptr<nvs::NVSHandle> simple = nvs::open_nvs_handle("test_ns", NVS_READWRITE, &result);
+    REQUIRE(result == ESP_OK);
+    ForwardingHandle handle(simple);
+    nvs::NVSHandle &base = handle;
+
+    CHECK(base.set_string("str", "test string") == ESP_OK);
+    CHECK(base.set_blob("blob", blob.data(), blob.size()) == ESP_OK);
+
+    nvs::NVSData data;
+    CHECK(base.get_string("str", data) == ESP_OK);
+    CHECK(string(data.c_str()) == "test string");
+    CHECK(base.get_blob("blob", data) == ESP_OK);
+    CHECK(vector<uint8_t>(data.data(), data.data() + data.size()) == blob);
+    CHECK(base.get_blob("missing", data) == ESP_ERR_NVS_NOT_FOUND);
+
+    ChunkCollector collector;
+    CHECK(base.visit_blob("blob", collector) == ESP_OK);
+    CHECK(collector.size_seen == blob.size());
+    CHECK(collector.collected == blob);
+
+    ChunkCollector rejecting;
+    rejecting.begin_result = ESP_ERR_NO_MEM;
+    CHECK(base.visit_string("str", rejecting) == ESP_ERR_NO_MEM);
+    CHECK(rejecting.chunks == 0);
+
+    CHECK(base.begin_batch() == ESP_ERR_NOT_SUPPORTED);
+    CHECK(base.abort_batch() == ESP_ERR_NOT_SUPPORTED);
+
+    simple.reset();
+    nvs::NVSPartitionManager::get_instance()->deinit_partition("nvs");
+}
@@ -279,3 +279,266 @@ TEST_CASE("NVSHandleSimple correctly sets/gets char enum", "[partition_mgr]")
 
     REQUIRE(NVSPartitionManager::get_instance()->deinit_partition(NVS_DEFAULT_PART_NAME) == ESP_OK);
 }
+
+static void fill_pattern(uint8_t *data, size_t size, uint8_t seed)
+{
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<uint8_t>(i * 7 + i / 251 + seed);
+    }
+}
+
+static void check_blob_reader(NVSHandleSimple *handle, const char *key, const uint8_t *expected, size_t size, size_t piece)
+{
+    esp_err_t err;
+    std::unique_ptr<NVSBlobReader> reader = handle->open_blob_reader(key, &err);
+    REQUIRE(err == ESP_OK);
+    REQUIRE(reader);
+    CHECK(reader->size() == size);
+
+    std::unique_ptr<uint8_t[]> buf(new uint8_t[piece]);
+    size_t offset = 0;
+    size_t readLen;
+    do {
+        REQUIRE(reader->read(buf.get(), piece, readLen) == ESP_OK);
+        REQUIRE(offset + readLen <= size);
+        CHECK((readLen == 0 || memcmp(buf.get(), expected + offset, readLen) == 0));
+        offset += readLen;
+    } while (readLen == piece);
+    CHECK(offset == size);
+}
+
+TEST_CASE("NVSHandleSimple streams a blob spanning many pages", "[partition_mgr][blob_stream]")
+{
+    const size_t BLOB_SIZE = 64 * 1024;
+    const uint32_t NVS_FLASH_SECTOR = 0;
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 40;
+    PartitionEmulationFixture f(0, NVS_FLASH_SECTOR_COUNT);
+
+    REQUIRE(NVSPartitionManager::get_instance()->init_custom(&f.part, NVS_FLASH_SECTOR, NVS_FLASH_SECTOR_COUNT)
+            == ESP_OK);
+
+    NVSHandleSimple *handle;
+    REQUIRE(NVSPartitionManager::get_instance()->open_handle(NVS_DEFAULT_PART_NAME, "ns_1", NVS_READWRITE, &handle) == ESP_OK);
+
+    static uint8_t blob[BLOB_SIZE];
+    fill_pattern(blob, BLOB_SIZE, 1);
+    CHECK(handle->set_item("before", 1) == ESP_OK);
+
+    {
+        esp_err_t err;
+        std::unique_ptr<NVSBlobWriter> writer = handle->open_blob_writer("bundle", &err);
+        REQUIRE(err == ESP_OK);
+        // pieces both smaller and larger than a chunk
+        const size_t pieces[] = {1, 100, 5000, 3999, 4000, 17, 12345};
+        size_t offset = 0;
+        for (size_t i = 0; offset < BLOB_SIZE; ++i) {
+            size_t len = std::min(pieces[i % (sizeof(pieces) / sizeof(pieces[0]))], BLOB_SIZE - offset);
+            REQUIRE(writer->write(blob + offset, len) == ESP_OK);
+            offset += len;
+        }
+        CHECK(writer->size() == BLOB_SIZE);
+        // not visible before it is finished
+        size_t size;
+        CHECK(handle->get_item_size(ItemType::BLOB, "bundle", size) == ESP_ERR_NVS_NOT_FOUND);
+        REQUIRE(writer->finish() == ESP_OK);
+        CHECK(writer->write(blob, 1) == ESP_ERR_NVS_INVALID_STATE);
+    }
+    CHECK(handle->set_item("after", 2) == ESP_OK);
+
+    size_t size;
+    CHECK(handle->get_item_size(ItemType::BLOB, "bundle", size) == ESP_OK);
+    CHECK(size == BLOB_SIZE);
+    static uint8_t readBlob[BLOB_SIZE];
+    CHECK(handle->get_blob("bundle", readBlob, BLOB_SIZE) == ESP_OK);
+    CHECK(memcmp(blob, readBlob, BLOB_SIZE) == 0);
+
+    check_blob_reader(handle, "bundle", blob, BLOB_SIZE, 333);
+    check_blob_reader(handle, "bundle", blob, BLOB_SIZE, 8192);
+
+    // blobs written in one piece can be streamed as well
+    CHECK(handle->set_blob("small", blob, 6000) == ESP_OK);
+    check_blob_reader(handle, "small", blob, 6000, 1000);
+
+    delete handle;
+
+    REQUIRE(NVSPartitionManager::get_instance()->deinit_partition(NVS_DEFAULT_PART_NAME) == ESP_OK);
+}
+
+TEST_CASE("NVSHandleSimple streamed blob replaces the previous value only when finished", "[partition_mgr][blob_stream]")
+{
+    const size_t OLD_SIZE = 5000;
+    const size_t NEW_SIZE = 10000;
+    const uint32_t NVS_FLASH_SECTOR = 0;
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 10;
+    PartitionEmulationFixture f(0, NVS_FLASH_SECTOR_COUNT);
+
+    REQUIRE(NVSPartitionManager::get_instance()->init_custom(&f.part, NVS_FLASH_SECTOR, NVS_FLASH_SECTOR_COUNT)
+            == ESP_OK);
+
+    NVSHandleSimple *handle;
+    REQUIRE(NVSPartitionManager::get_instance()->open_handle(NVS_DEFAULT_PART_NAME, "ns_1", NVS_READWRITE, &handle) == ESP_OK);
+
+    static uint8_t oldBlob[OLD_SIZE];
+    static uint8_t newBlob[NEW_SIZE];
+    fill_pattern(oldBlob, OLD_SIZE, 1);
+    fill_pattern(newBlob, NEW_SIZE, 2);
+    size_t emptyEntries;
+    REQUIRE(handle->get_used_entry_count(emptyEntries) == ESP_OK);
+    REQUIRE(handle->set_blob("blob", oldBlob, OLD_SIZE) == ESP_OK);
+    size_t usedEntries;
+    REQUIRE(handle->get_used_entry_count(usedEntries) == ESP_OK);
+
+    {
+        std::unique_ptr<NVSBlobWriter> writer = handle->open_blob_writer("blob");
+        REQUIRE(writer);
+        REQUIRE(writer->write(newBlob, NEW_SIZE) == ESP_OK);
+        // destroyed without finishing
+    }
+    size_t entries;
+    CHECK(handle->get_used_entry_count(entries) == ESP_OK);
+    CHECK(entries == usedEntries);
+    check_blob_reader(handle, "blob", oldBlob, OLD_SIZE, 512);
+
+    {
+        std::unique_ptr<NVSBlobWriter> writer = handle->open_blob_writer("blob");
+        REQUIRE(writer);
+        REQUIRE(writer->write(newBlob, NEW_SIZE) == ESP_OK);
+        REQUIRE(writer->finish() == ESP_OK);
+    }
+    check_blob_reader(handle, "blob", newBlob, NEW_SIZE, 512);
+
+    // nothing is left of the old version
+    CHECK(handle->erase_item("blob") == ESP_OK);
+    CHECK(handle->get_used_entry_count(entries) == ESP_OK);
+    CHECK(entries == emptyEntries);
+    CHECK(handle->set_blob("blob", newBlob, NEW_SIZE) == ESP_OK);
+
+    // the value is kept if the new one doesn't fit
+    {
+        std::unique_ptr<NVSBlobWriter> writer = handle->open_blob_writer("blob");
+        REQUIRE(writer);
+        esp_err_t err = ESP_OK;
+        for (int i = 0; i < 10 && err == ESP_OK; ++i) {
+            err = writer->write(newBlob, NEW_SIZE);
+        }
+        CHECK(err == ESP_ERR_NVS_NOT_ENOUGH_SPACE);
+        CHECK(writer->finish() == ESP_ERR_NVS_INVALID_STATE);
+    }
+    check_blob_reader(handle, "blob", newBlob, NEW_SIZE, 512);
+
+    // empty blob
+    {
+        std::unique_ptr<NVSBlobWriter> writer = handle->open_blob_writer("empty");
+        REQUIRE(writer);
+        REQUIRE(writer->finish() == ESP_OK);
+    }
+    size_t size = 1;
+    CHECK(handle->get_item_size(ItemType::BLOB, "empty", size) == ESP_OK);
+    CHECK(size == 0);
+    check_blob_reader(handle, "empty", nullptr, 0, 16);
+
+    delete handle;
+
+    REQUIRE(NVSPartitionManager::get_instance()->deinit_partition(NVS_DEFAULT_PART_NAME) == ESP_OK);
+}
+
+TEST_CASE("NVSHandleSimple blob streams check the handle state", "[partition_mgr][blob_stream]")
+{
+    const uint32_t NVS_FLASH_SECTOR = 0;
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 4;
+    PartitionEmulationFixture f(0, NVS_FLASH_SECTOR_COUNT);
+
+    REQUIRE(NVSPartitionManager::get_instance()->init_custom(&f.part, NVS_FLASH_SECTOR, NVS_FLASH_SECTOR_COUNT)
+            == ESP_OK);
+
+    NVSHandleSimple *handle;
+    REQUIRE(NVSPartitionManager::get_instance()->open_handle(NVS_DEFAULT_PART_NAME, "ns_1", NVS_READWRITE, &handle) == ESP_OK);
+    NVSHandleSimple *roHandle;
+    REQUIRE(NVSPartitionManager::get_instance()->open_handle(NVS_DEFAULT_PART_NAME, "ns_1", NVS_READONLY, &roHandle) == ESP_OK);
+
+    esp_err_t err;
+    CHECK(!roHandle->open_blob_writer("blob", &err));
+    CHECK(err == ESP_ERR_NVS_READ_ONLY);
+    CHECK(!handle->open_blob_writer("a_very_long_key_name", &err));
+    CHECK(err == ESP_ERR_NVS_KEY_TOO_LONG);
+    CHECK(!roHandle->open_blob_reader("blob", &err));
+    CHECK(err == ESP_ERR_NVS_NOT_FOUND);
+
+    REQUIRE(handle->begin_batch() == ESP_OK);
+    CHECK(!handle->open_blob_writer("blob", &err));
+    CHECK(err == ESP_ERR_NVS_INVALID_STATE);
+    REQUIRE(handle->abort_batch() == ESP_OK);
+
+    delete roHandle;
+    delete handle;
+
+    REQUIRE(NVSPartitionManager::get_instance()->deinit_partition(NVS_DEFAULT_PART_NAME) == ESP_OK);
+}
+
+TEST_CASE("NVSHandleSimple reserves the key of a streamed blob", "[partition_mgr][blob_stream]")
+{
+    const uint32_t NVS_FLASH_SECTOR = 0;
+    const uint32_t NVS_FLASH_SECTOR_COUNT = 4;
+    PartitionEmulationFixture f(0, NVS_FLASH_SECTOR_COUNT);
+
+    REQUIRE(NVSPartitionManager::get_instance()->init_custom(&f.part, NVS_FLASH_SECTOR, NVS_FLASH_SECTOR_COUNT)
+            == ESP_OK);
+
+    NVSHandleSimple *handle;
+    REQUIRE(NVSPartitionManager::get_instance()->open_handle(NVS_DEFAULT_PART_NAME, "ns_1", NVS_READWRITE, &handle) == ESP_OK);
+    NVSHandleSimple *other;
+    REQUIRE(NVSPartitionManager::get_instance()->open_handle(NVS_DEFAULT_PART_NAME, "ns_1", NVS_READWRITE, &other) == ESP_OK);
+
+    const uint8_t old_value[] = {1, 2, 3};
+    const uint8_t new_value[] = {4, 5, 6, 7};
+    REQUIRE(handle->set_blob("blob", old_value, sizeof(old_value)) == ESP_OK);
+
+    esp_err_t err;
+    std::unique_ptr<NVSBlobWriter> writer = handle->open_blob_writer("blob", &err);
+    REQUIRE(writer);
+
+    // the version picked by the writer must not be taken by any other write
+    CHECK(!other->open_blob_writer("blob", &err));
+    CHECK(err == ESP_ERR_NVS_INVALID_STATE);
+    CHECK(other->set_blob("blob", new_value, sizeof(new_value)) == ESP_ERR_NVS_INVALID_STATE);
+    CHECK(other->erase_item("blob") == ESP_ERR_NVS_INVALID_STATE);
+    CHECK(other->erase_all() == ESP_ERR_NVS_INVALID_STATE);
+    REQUIRE(other->begin_batch() == ESP_OK);
+    REQUIRE(other->set_blob("blob", new_value, sizeof(new_value)) == ESP_OK);
+    // a failed commit ends the batch as well
+    CHECK(other->commit() == ESP_ERR_NVS_INVALID_STATE);
+    CHECK(other->set_blob("other", new_value, sizeof(new_value)) == ESP_OK);
+
+    REQUIRE(writer->write(new_value, sizeof(new_value)) == ESP_OK);
+    REQUIRE(writer->finish() == ESP_OK);
+    CHECK(other->set_blob("blob", old_value, sizeof(old_value)) == ESP_OK);
+    writer.reset();
+
+    // aborting releases the key as well
+    writer = handle->open_blob_writer("blob", &err);
+    REQUIRE(writer);
+    writer.reset();
+    CHECK(other->erase_item("blob") == ESP_OK);
+
+    // the streams outlive the handle, but can't be used any more
+    writer = handle->open_blob_writer("blob", &err);
+    REQUIRE(writer);
+    REQUIRE(writer->write(new_value, sizeof(new_value)) == ESP_OK);
+    std::unique_ptr<NVSBlobReader> reader = handle->open_blob_reader("other", &err);
+    REQUIRE(reader);
+    delete handle;
+    CHECK(writer->write(new_value, sizeof(new_value)) == ESP_ERR_NVS_INVALID_HANDLE);
+    CHECK(writer->finish() == ESP_ERR_NVS_INVALID_HANDLE);
+    uint8_t buf[sizeof(new_value)];
+    size_t len;
+    CHECK(reader->read(buf, sizeof(buf), len) == ESP_ERR_NVS_INVALID_HANDLE);
+    writer.reset();
+    reader.reset();
+    size_t size;
+    CHECK(other->get_item_size(ItemType::BLOB, "blob", size) == ESP_ERR_NVS_NOT_FOUND);
+    CHECK(other->set_blob("blob", old_value, sizeof(old_value)) == ESP_OK);
+
+    delete other;
+
+    REQUIRE(NVSPartitionManager::get_instance()->deinit_partition(NVS_DEFAULT_PART_NAME) == ESP_OK);
+}
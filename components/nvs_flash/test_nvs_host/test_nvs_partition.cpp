@@ -26,7 +26,7 @@
 using namespace std;
 using namespace nvs;
 
-TEST_CASE("encrypted partition read size must be item size", "[nvs]")
+TEST_CASE("encrypted partition read size must be mod item size", "[nvs]")
 {
     char foo [32] = { };
     nvs_sec_cfg_t xts_cfg;
@@ -37,6 +37,36 @@ TEST_CASE("encrypted partition read size must be item size", "[nvs]")
     EncryptedPartitionFixture fix(&xts_cfg);
 
     CHECK(fix.part.read(0, foo, sizeof (foo) -1) == ESP_ERR_INVALID_SIZE);
+    CHECK(fix.part.read(0, foo, 0) == ESP_ERR_INVALID_SIZE);
+}
+
+TEST_CASE("encrypted partition reads several entries at once", "[nvs]")
+{
+    uint8_t data [4 * 32];
+    uint8_t readData [4 * 32];
+    nvs_sec_cfg_t xts_cfg;
+    for(int count = 0; count < NVS_KEY_SIZE; count++) {
+        xts_cfg.eky[count] = 0x11;
+        xts_cfg.tky[count] = 0x22;
+    }
+    for (size_t i = 0; i < sizeof (data); i++) {
+        data[i] = i;
+    }
+    EncryptedPartitionFixture fix(&xts_cfg);
+
+    CHECK(fix.part.write(64, data, sizeof (data)) == ESP_OK);
+    // each entry is encrypted with its own address
+    CHECK(fix.part.read_raw(64, readData, sizeof (readData)) == ESP_OK);
+    CHECK(memcmp(readData, readData + 32, 32) != 0);
+
+    CHECK(fix.part.read(64, readData, sizeof (readData)) == ESP_OK);
+    CHECK(memcmp(data, readData, sizeof (data)) == 0);
+    for (size_t i = 0; i < 4; i++) {
+        CHECK(fix.part.read(64 + i * 32, readData, 32) == ESP_OK);
+        CHECK(memcmp(data + i * 32, readData, 32) == 0);
+    }
+    CHECK(fix.part.read(96, readData, 64) == ESP_OK);
+    CHECK(memcmp(data + 32, readData, 64) == 0);
 }
 
 TEST_CASE("encrypted partition write size must be mod item size", "[nvs]")
@@ -22,6 +22,7 @@
 #include <sys/termios.h>
 #include <sys/poll.h>
 #include <sys/dirent.h>
+#include <sys/uio.h>
 #include <string.h>
 #include "sdkconfig.h"
 
@@ -66,6 +67,7 @@ typedef struct
 {
     bool is_sem_local;      /*!< type of "sem" is SemaphoreHandle_t when true, defined by socket driver otherwise */
     void *sem;              /*!< semaphore instance */
+    void *epoll;            /*!< registration of an esp_vfs_epoll instance to notify instead of "sem", NULL for select() */
 } esp_vfs_select_sem_t;
 
 /**
@@ -186,6 +188,22 @@ typedef struct
         int (*fsync_p)(void* ctx, int fd);                                                          /*!< fsync with context pointer */
         int (*fsync)(int fd);                                                                       /*!< fsync without context pointer */
     };
+    union {
+        ssize_t (*writev_p)(void* ctx, int fd, const struct iovec *iov, int iovcnt);                /*!< writev with context pointer */
+        ssize_t (*writev)(int fd, const struct iovec *iov, int iovcnt);                             /*!< writev without context pointer */
+    };
+    union {
+        ssize_t (*readv_p)(void* ctx, int fd, const struct iovec *iov, int iovcnt);                 /*!< readv with context pointer */
+        ssize_t (*readv)(int fd, const struct iovec *iov, int iovcnt);                              /*!< readv without context pointer */
+    };
+    union {
+        ssize_t (*pwritev_p)(void* ctx, int fd, const struct iovec *iov, int iovcnt, off_t offset); /*!< pwritev with context pointer */
+        ssize_t (*pwritev)(int fd, const struct iovec *iov, int iovcnt, off_t offset);              /*!< pwritev without context pointer */
+    };
+    union {
+        ssize_t (*preadv_p)(void* ctx, int fd, const struct iovec *iov, int iovcnt, off_t offset);  /*!< preadv with context pointer */
+        ssize_t (*preadv)(int fd, const struct iovec *iov, int iovcnt, off_t offset);               /*!< preadv without context pointer */
+    };
 #ifdef CONFIG_VFS_SUPPORT_DIR
     union {
         int (*access_p)(void* ctx, const char *path, int amode);                                    /*!< access with context pointer */
@@ -459,6 +477,69 @@ ssize_t esp_vfs_pread(int fd, void *dst, size_t size, off_t offset);
  */
 ssize_t esp_vfs_pwrite(int fd, const void *src, size_t size, off_t offset);
 
+/**
+ *
+ * @brief Implements the VFS layer of POSIX writev()
+ *
+ * If the VFS doesn't provide writev, the buffers are written one by one using write.
+ *
+ * @param fd         File descriptor used for write
+ * @param iov        Array of buffers to write, in order
+ * @param iovcnt     Number of elements in iov, up to IOV_MAX
+ *
+ * @return           A positive return value indicates the number of bytes written. -1 is return on failure and errno is
+ *                   set accordingly.
+ */
+ssize_t esp_vfs_writev(int fd, const struct iovec *iov, int iovcnt);
+
+/**
+ *
+ * @brief Implements the VFS layer of POSIX readv()
+ *
+ * If the VFS doesn't provide readv, the buffers are filled one by one using read,
+ * until a read returns less data than requested.
+ *
+ * @param fd         File descriptor used for read
+ * @param iov        Array of buffers to fill, in order
+ * @param iovcnt     Number of elements in iov, up to IOV_MAX
+ *
+ * @return           A positive return value indicates the number of bytes read. -1 is return on failure and errno is
+ *                   set accordingly.
+ */
+ssize_t esp_vfs_readv(int fd, const struct iovec *iov, int iovcnt);
+
+/**
+ *
+ * @brief Implements the VFS layer of pwritev()
+ *
+ * If the VFS doesn't provide pwritev, the buffers are written one by one using pwrite.
+ *
+ * @param fd         File descriptor used for write
+ * @param iov        Array of buffers to write, in order
+ * @param iovcnt     Number of elements in iov, up to IOV_MAX
+ * @param offset     Starting offset of the write
+ *
+ * @return           A positive return value indicates the number of bytes written. -1 is return on failure and errno is
+ *                   set accordingly.
+ */
+ssize_t esp_vfs_pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+
+/**
+ *
+ * @brief Implements the VFS layer of preadv()
+ *
+ * If the VFS doesn't provide preadv, the buffers are filled one by one using pread.
+ *
+ * @param fd         File descriptor used for read
+ * @param iov        Array of buffers to fill, in order
+ * @param iovcnt     Number of elements in iov, up to IOV_MAX
+ * @param offset     Starting offset of the read
+ *
+ * @return           A positive return value indicates the number of bytes read. -1 is return on failure and errno is
+ *                   set accordingly.
+ */
+ssize_t esp_vfs_preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -0,0 +1,124 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ESP_VFS_EPOLL_IN    (1 << 0)    /*!< File descriptor is ready for reading */
+#define ESP_VFS_EPOLL_OUT   (1 << 1)    /*!< File descriptor is ready for writing */
+#define ESP_VFS_EPOLL_ERR   (1 << 2)    /*!< Error condition on the file descriptor */
+
+/**
+ * @brief Handle of an epoll instance
+ */
+typedef struct esp_vfs_epoll *esp_vfs_epoll_handle_t;
+
+/**
+ * @brief Operations of esp_vfs_epoll_ctl
+ */
+typedef enum {
+    ESP_VFS_EPOLL_CTL_ADD,      /*!< Add a file descriptor to the instance */
+    ESP_VFS_EPOLL_CTL_MOD,      /*!< Change the events or the user data of a file descriptor */
+    ESP_VFS_EPOLL_CTL_DEL,      /*!< Remove a file descriptor from the instance */
+} esp_vfs_epoll_ctl_op_t;
+
+/**
+ * @brief Event of a file descriptor
+ */
+typedef struct {
+    uint32_t events;    /*!< ESP_VFS_EPOLL_xxx flags: events to wait for in esp_vfs_epoll_ctl, ready events in esp_vfs_epoll_wait */
+    int fd;             /*!< File descriptor, set by esp_vfs_epoll_wait */
+    void *data;         /*!< User data, given to esp_vfs_epoll_ctl and returned by esp_vfs_epoll_wait */
+} esp_vfs_epoll_event_t;
+
+/**
+ * @brief Create an epoll instance
+ *
+ * An epoll instance waits for events on a set of file descriptors, like select(),
+ * but the file descriptors are registered once using esp_vfs_epoll_ctl instead of
+ * on every call. The VFS drivers notify the instance about the file descriptors
+ * which may be ready, so that esp_vfs_epoll_wait only checks these.
+ *
+ * Like select(), this works for the file descriptors of the VFS drivers providing
+ * start_select and end_select (such as UART and eventfd) and for sockets.
+ * Events are level-triggered: a file descriptor which stays ready is returned
+ * by every call to esp_vfs_epoll_wait.
+ *
+ * @param[out] out_handle  Handle of the new instance
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if out_handle is NULL
+ *      - ESP_ERR_NO_MEM if out of memory
+ */
+esp_err_t esp_vfs_epoll_create(esp_vfs_epoll_handle_t *out_handle);
+
+/**
+ * @brief Add, modify or remove a file descriptor of an epoll instance
+ *
+ * A file descriptor must be removed from the instances it was added to before it is closed.
+ *
+ * @param handle  Handle of the instance
+ * @param op      Operation
+ * @param fd      File descriptor
+ * @param event   Events to wait for and user data for ESP_VFS_EPOLL_CTL_ADD and ESP_VFS_EPOLL_CTL_MOD,
+ *                ignored for ESP_VFS_EPOLL_CTL_DEL
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if an argument is invalid or fd is not an open file descriptor
+ *      - ESP_ERR_INVALID_STATE if fd is already added (ESP_VFS_EPOLL_CTL_ADD) or not added (otherwise)
+ *      - ESP_ERR_NOT_SUPPORTED if the VFS of fd doesn't support select
+ *      - ESP_ERR_NO_MEM if out of memory
+ *      - error returned by the start_select function of the VFS driver
+ */
+esp_err_t esp_vfs_epoll_ctl(esp_vfs_epoll_handle_t handle, esp_vfs_epoll_ctl_op_t op, int fd, const esp_vfs_epoll_event_t *event);
+
+/**
+ * @brief Wait for events on the file descriptors of an epoll instance
+ *
+ * Only one task may wait on an instance at a time. The instance can be modified
+ * by other tasks during the wait.
+ *
+ * @param handle       Handle of the instance
+ * @param[out] events  Array receiving the events
+ * @param max_events   Number of elements of events, must be positive
+ * @param timeout_ms   Maximum time to wait in milliseconds, 0 to return immediately, -1 to wait forever
+ * @param[out] out_count  Number of events returned
+ *
+ * @return
+ *      - ESP_OK if at least one event was returned
+ *      - ESP_ERR_TIMEOUT if no file descriptor was ready before the timeout
+ *      - ESP_ERR_INVALID_ARG if an argument is invalid
+ *      - ESP_ERR_INVALID_STATE if another task is waiting on the instance
+ *      - ESP_FAIL if the socket select failed, errno is set accordingly
+ */
+esp_err_t esp_vfs_epoll_wait(esp_vfs_epoll_handle_t handle, esp_vfs_epoll_event_t *events, int max_events,
+                             int timeout_ms, int *out_count);
+
+/**
+ * @brief Destroy an epoll instance
+ *
+ * The file descriptors of the instance are not closed.
+ *
+ * @param handle  Handle of the instance
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if handle is NULL
+ *      - ESP_ERR_INVALID_STATE if a task is waiting on the instance
+ */
+esp_err_t esp_vfs_epoll_destroy(esp_vfs_epoll_handle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
@@ -11,8 +11,35 @@
 extern "C" {
 #endif
 
+#define VFS_MAX_COUNT   8   /* max number of VFS entries (registered filesystems) */
+
+/* File descriptor functions of a VFS, resolved when it is registered.
+ * Each function takes 'ctx' as the first argument. Missing functions are
+ * replaced by ones which fail with ENOSYS, so they can be called without checks,
+ * except for the vectored functions: these are NULL if the VFS doesn't provide
+ * them, and the callers fall back to the scalar functions.
+ */
+typedef struct {
+    void *ctx;
+    ssize_t (*write)(void *ctx, int fd, const void *data, size_t size);
+    off_t (*lseek)(void *ctx, int fd, off_t size, int mode);
+    ssize_t (*read)(void *ctx, int fd, void *dst, size_t size);
+    ssize_t (*pread)(void *ctx, int fd, void *dst, size_t size, off_t offset);
+    ssize_t (*pwrite)(void *ctx, int fd, const void *src, size_t size, off_t offset);
+    int (*close)(void *ctx, int fd);
+    int (*fstat)(void *ctx, int fd, struct stat *st);
+    int (*fcntl)(void *ctx, int fd, int cmd, int arg);
+    int (*ioctl)(void *ctx, int fd, int cmd, va_list args);
+    int (*fsync)(void *ctx, int fd);
+    ssize_t (*writev)(void *ctx, int fd, const struct iovec *iov, int iovcnt);
+    ssize_t (*readv)(void *ctx, int fd, const struct iovec *iov, int iovcnt);
+    ssize_t (*pwritev)(void *ctx, int fd, const struct iovec *iov, int iovcnt, off_t offset);
+    ssize_t (*preadv)(void *ctx, int fd, const struct iovec *iov, int iovcnt, off_t offset);
+} vfs_fd_ops_t;
+
 typedef struct vfs_entry_ {
     esp_vfs_t vfs;          // contains pointers to VFS functions
+    vfs_fd_ops_t fd_ops;    // file descriptor functions, called through the FD table
     char path_prefix[ESP_VFS_PATH_MAX]; // path prefix mapped to this VFS
     size_t path_prefix_len; // micro-optimization to avoid doing extra strlen
     void* ctx;              // optional pointer which can be passed to VFS
@@ -96,6 +123,28 @@ const vfs_entry_t *get_vfs_for_path(const char *path);
  */
 const vfs_entry_t *get_vfs_for_index(int index);
 
+#ifdef CONFIG_VFS_SUPPORT_SELECT
+/**
+ * Get the VFS which a file descriptor belongs to.
+ *
+ * @param fd        global file descriptor
+ * @param local_fd  set to the file descriptor within the VFS
+ * @param is_socket set to true if the VFS is the socket VFS, whose select is done by socket_select
+ *
+ * @return VFS index, or -1 if the file descriptor is not valid.
+ */
+int esp_vfs_get_fd_vfs_index(int fd, int *local_fd, bool *is_socket);
+
+/**
+ * Notification from a VFS driver for a start_select call done by vfs_epoll.c.
+ *
+ * @param registration  "epoll" member of the esp_vfs_select_sem_t passed to start_select
+ * @param from_isr      true when called from esp_vfs_select_triggered_isr
+ * @param woken         see esp_vfs_select_triggered_isr, unused if from_isr is false
+ */
+void esp_vfs_epoll_triggered(void *registration, bool from_isr, BaseType_t *woken);
+#endif // CONFIG_VFS_SUPPORT_SELECT
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,330 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/fcntl.h>
+#include "driver/uart.h"
+#include "esp_vfs.h"
+#include "esp_vfs_dev.h"
+#include "esp_vfs_epoll.h"
+#include "esp_vfs_eventfd.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#include "test_utils.h"
+#include "unity.h"
+
+typedef struct {
+    int fd;
+    SemaphoreHandle_t done;
+} epoll_signal_task_args_t;
+
+static void signal_task(void *arg)
+{
+    epoll_signal_task_args_t *args = (epoll_signal_task_args_t *) arg;
+    vTaskDelay(pdMS_TO_TICKS(50));
+    uint64_t val = 1;
+    TEST_ASSERT_EQUAL(sizeof(val), write(args->fd, &val, sizeof(val)));
+    xSemaphoreGive(args->done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("epoll returns the ready eventfd", "[vfs][epoll]")
+{
+    esp_vfs_eventfd_config_t config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+    TEST_ESP_OK(esp_vfs_eventfd_register(&config));
+    int fd1 = eventfd(0, 0);
+    int fd2 = eventfd(0, 0);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, fd1);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, fd2);
+
+    esp_vfs_epoll_handle_t ep;
+    TEST_ESP_OK(esp_vfs_epoll_create(&ep));
+    esp_vfs_epoll_event_t event = { .events = ESP_VFS_EPOLL_IN, .data = &fd1 };
+    TEST_ESP_OK(esp_vfs_epoll_ctl(ep, ESP_VFS_EPOLL_CTL_ADD, fd1, &event));
+    event.data = &fd2;
+    TEST_ESP_OK(esp_vfs_epoll_ctl(ep, ESP_VFS_EPOLL_CTL_ADD, fd2, &event));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_vfs_epoll_ctl(ep, ESP_VFS_EPOLL_CTL_ADD, fd2, &event));
+
+    esp_vfs_epoll_event_t events[2];
+    int count = -1;
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, esp_vfs_epoll_wait(ep, events, 2, 0, &count));
+    TEST_ASSERT_EQUAL(0, count);
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, esp_vfs_epoll_wait(ep, events, 2, 50, &count));
+
+    epoll_signal_task_args_t args = { .fd = fd2, .done = xSemaphoreCreateBinary() };
+    TEST_ASSERT_NOT_NULL(args.done);
+    xTaskCreate(signal_task, "signal_task", 2048, &args, 5, NULL);
+    TEST_ESP_OK(esp_vfs_epoll_wait(ep, events, 2, 1000, &count));
+    TEST_ASSERT_EQUAL(1, count);
+    TEST_ASSERT_EQUAL(fd2, events[0].fd);
+    TEST_ASSERT_EQUAL(ESP_VFS_EPOLL_IN, events[0].events);
+    TEST_ASSERT_EQUAL_PTR(&fd2, events[0].data);
+    TEST_ASSERT(xSemaphoreTake(args.done, pdMS_TO_TICKS(1000)));
+    vSemaphoreDelete(args.done);
+
+    // events are level-triggered: fd2 is ready until it is read
+    TEST_ESP_OK(esp_vfs_epoll_wait(ep, events, 2, 0, &count));
+    TEST_ASSERT_EQUAL(1, count);
+    TEST_ASSERT_EQUAL(fd2, events[0].fd);
+    uint64_t val;
+    TEST_ASSERT_EQUAL(sizeof(val), read(fd2, &val, sizeof(val)));
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, esp_vfs_epoll_wait(ep, events, 2, 0, &count));
+
+    TEST_ESP_OK(esp_vfs_epoll_destroy(ep));
+    TEST_ASSERT_EQUAL(0, close(fd1));
+    TEST_ASSERT_EQUAL(0, close(fd2));
+    TEST_ESP_OK(esp_vfs_eventfd_unregister());
+}
+
+TEST_CASE("epoll modify and remove file descriptors", "[vfs][epoll]")
+{
+    esp_vfs_eventfd_config_t config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+    TEST_ESP_OK(esp_vfs_eventfd_register(&config));
+    int fd = eventfd(0, 0);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, fd);
+
+    esp_vfs_epoll_handle_t ep;
+    TEST_ESP_OK(esp_vfs_epoll_create(&ep));
+    esp_vfs_epoll_event_t event = { .events = ESP_VFS_EPOLL_IN };
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_vfs_epoll_ctl(ep, ESP_VFS_EPOLL_CTL_MOD, fd, &event));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_vfs_epoll_ctl(ep, ESP_VFS_EPOLL_CTL_DEL, fd, NULL));
+    TEST_ESP_OK(esp_vfs_epoll_ctl(ep, ESP_VFS_EPOLL_CTL_ADD, fd, &event));
+
+    // an eventfd is always writable
+    esp_vfs_epoll_event_t events[1];
+    int count;
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, esp_vfs_epoll_wait(ep, events, 1, 0, &count));
+    event.events = ESP_VFS_EPOLL_IN | ESP_VFS_EPOLL_OUT;
+    TEST_ESP_OK(esp_vfs_epoll_ctl(ep, ESP_VFS_EPOLL_CTL_MOD, fd, &event));
+    TEST_ESP_OK(esp_vfs_epoll_wait(ep, events, 1, 0, &count));
+    TEST_ASSERT_EQUAL(1, count);
+    TEST_ASSERT_EQUAL(ESP_VFS_EPOLL_OUT, events[0].events);
+
+    TEST_ESP_OK(esp_vfs_epoll_ctl(ep, ESP_VFS_EPOLL_CTL_DEL, fd, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, esp_vfs_epoll_wait(ep, events, 1, 0, &count));
+
+    TEST_ESP_OK(esp_vfs_epoll_destroy(ep));
+    TEST_ASSERT_EQUAL(0, close(fd));
+    TEST_ESP_OK(esp_vfs_eventfd_unregister());
+}
+
+typedef struct {
+    esp_vfs_epoll_handle_t ep;
+    esp_err_t err;
+    int count;
+    esp_vfs_epoll_event_t events[2];
+    SemaphoreHandle_t done;
+} epoll_wait_task_args_t;
+
+static void wait_task(void *arg)
+{
+    epoll_wait_task_args_t *args = (epoll_wait_task_args_t *) arg;
+    args->err = esp_vfs_epoll_wait(args->ep, args->events, 2, 1000, &args->count);
+    xSemaphoreGive(args->done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("epoll wait sees file descriptors added while it waits", "[vfs][epoll]")
+{
+    esp_vfs_eventfd_config_t config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+    TEST_ESP_OK(esp_vfs_eventfd_register(&config));
+    int fd1 = eventfd(0, 0);
+    int fd2 = eventfd(0, 0);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, fd1);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, fd2);
+
+    esp_vfs_epoll_handle_t ep;
+    TEST_ESP_OK(esp_vfs_epoll_create(&ep));
+    esp_vfs_epoll_event_t event = { .events = ESP_VFS_EPOLL_IN, .data = &fd1 };
+    TEST_ESP_OK(esp_vfs_epoll_ctl(ep, ESP_VFS_EPOLL_CTL_ADD, fd1, &event));
+
+    epoll_wait_task_args_t args = { .ep = ep, .done = xSemaphoreCreateBinary() };
+    TEST_ASSERT_NOT_NULL(args.done);
+    xTaskCreate(wait_task, "wait_task", 2048, &args, 5, NULL);
+    vTaskDelay(pdMS_TO_TICKS(50));
+
+    // fd2 is ready already when it is added
+    uint64_t val = 1;
+    TEST_ASSERT_EQUAL(sizeof(val), write(fd2, &val, sizeof(val)));
+    event.data = &fd2;
+    TEST_ESP_OK(esp_vfs_epoll_ctl(ep, ESP_VFS_EPOLL_CTL_ADD, fd2, &event));
+    TEST_ASSERT(xSemaphoreTake(args.done, pdMS_TO_TICKS(500)));
+    TEST_ESP_OK(args.err);
+    TEST_ASSERT_EQUAL(1, args.count);
+    TEST_ASSERT_EQUAL(fd2, args.events[0].fd);
+    TEST_ASSERT_EQUAL_PTR(&fd2, args.events[0].data);
+
+    // removing a file descriptor while waiting stops its events
+    TEST_ASSERT_EQUAL(sizeof(val), read(fd2, &val, sizeof(val)));
+    xTaskCreate(wait_task, "wait_task", 2048, &args, 5, NULL);
+    vTaskDelay(pdMS_TO_TICKS(50));
+    TEST_ESP_OK(esp_vfs_epoll_ctl(ep, ESP_VFS_EPOLL_CTL_DEL, fd1, NULL));
+    TEST_ASSERT_EQUAL(sizeof(val), write(fd1, &val, sizeof(val)));
+    TEST_ASSERT(xSemaphoreTake(args.done, pdMS_TO_TICKS(2000)));
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, args.err);
+    vSemaphoreDelete(args.done);
+
+    TEST_ESP_OK(esp_vfs_epoll_destroy(ep));
+    TEST_ASSERT_EQUAL(0, close(fd1));
+    TEST_ASSERT_EQUAL(0, close(fd2));
+    TEST_ESP_OK(esp_vfs_eventfd_unregister());
+}
+
+static const char message[] = "Hello world!";
+
+typedef struct {
+    int fd;
+    SemaphoreHandle_t done;
+} epoll_send_task_args_t;
+
+static void send_task(void *arg)
+{
+    epoll_send_task_args_t *args = (epoll_send_task_args_t *) arg;
+    vTaskDelay(pdMS_TO_TICKS(50));
+    TEST_ASSERT_EQUAL(sizeof(message), write(args->fd, message, sizeof(message)));
+    xSemaphoreGive(args->done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("UART select() works next to an epoll registration", "[vfs][epoll]")
+{
+    uart_config_t uart_config = {
+        .baud_rate = 115200,
+        .data_bits = UART_DATA_8_BITS,
+        .parity    = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_1,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .source_clk = UART_SCLK_APB,
+    };
+    TEST_ESP_OK(uart_driver_install(UART_NUM_1, 256, 256, 0, NULL, 0));
+    TEST_ESP_OK(uart_param_config(UART_NUM_1, &uart_config));
+    TEST_ESP_OK(uart_set_loop_back(UART_NUM_1, true));
+    int uart_fd = open("/dev/uart/1", O_RDWR);
+    TEST_ASSERT_NOT_EQUAL(-1, uart_fd);
+    esp_vfs_dev_uart_use_driver(1);
+
+    esp_vfs_epoll_handle_t ep;
+    TEST_ESP_OK(esp_vfs_epoll_create(&ep));
+    esp_vfs_epoll_event_t event = { .events = ESP_VFS_EPOLL_IN };
+    TEST_ESP_OK(esp_vfs_epoll_ctl(ep, ESP_VFS_EPOLL_CTL_ADD, uart_fd, &event));
+
+    // select() on the same file descriptor runs while the epoll instance keeps its select started
+    epoll_send_task_args_t args = { .fd = uart_fd, .done = xSemaphoreCreateBinary() };
+    TEST_ASSERT_NOT_NULL(args.done);
+    xTaskCreate(send_task, "send_task", 4096, &args, 5, NULL);
+    fd_set rfds;
+    FD_ZERO(&rfds);
+    FD_SET(uart_fd, &rfds);
+    struct timeval tv = { .tv_sec = 1, .tv_usec = 0 };
+    TEST_ASSERT_EQUAL(1, select(uart_fd + 1, &rfds, NULL, NULL, &tv));
+    TEST_ASSERT(FD_ISSET(uart_fd, &rfds));
+    TEST_ASSERT(xSemaphoreTake(args.done, pdMS_TO_TICKS(1000)));
+
+    // both were notified
+    esp_vfs_epoll_event_t events[1];
+    int count;
+    TEST_ESP_OK(esp_vfs_epoll_wait(ep, events, 1, 0, &count));
+    TEST_ASSERT_EQUAL(1, count);
+    TEST_ASSERT_EQUAL(uart_fd, events[0].fd);
+    TEST_ASSERT_EQUAL(ESP_VFS_EPOLL_IN, events[0].events);
+
+    char recv_message[sizeof(message)];
+    TEST_ASSERT_EQUAL(sizeof(message), read(uart_fd, recv_message, sizeof(message)));
+    TEST_ASSERT_EQUAL_MEMORY(message, recv_message, sizeof(message));
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, esp_vfs_epoll_wait(ep, events, 1, 0, &count));
+    FD_ZERO(&rfds);
+    FD_SET(uart_fd, &rfds);
+    tv.tv_sec = 0;
+    TEST_ASSERT_EQUAL(0, select(uart_fd + 1, &rfds, NULL, NULL, &tv));
+
+    // and the epoll instance still gets new data once select() has returned
+    xTaskCreate(send_task, "send_task", 4096, &args, 5, NULL);
+    TEST_ESP_OK(esp_vfs_epoll_wait(ep, events, 1, 1000, &count));
+    TEST_ASSERT_EQUAL(uart_fd, events[0].fd);
+    TEST_ASSERT(xSemaphoreTake(args.done, pdMS_TO_TICKS(1000)));
+    TEST_ASSERT_EQUAL(sizeof(message), read(uart_fd, recv_message, sizeof(message)));
+    vSemaphoreDelete(args.done);
+
+    TEST_ESP_OK(esp_vfs_epoll_destroy(ep));
+    esp_vfs_dev_uart_use_nonblocking(1);
+    close(uart_fd);
+    uart_driver_delete(UART_NUM_1);
+}
+
+static int socket_init(void)
+{
+    const struct addrinfo hints = {
+        .ai_family = AF_INET,
+        .ai_socktype = SOCK_DGRAM,
+    };
+    struct addrinfo *res;
+    TEST_ASSERT_EQUAL(0, getaddrinfo("localhost", "80", &hints, &res));
+    TEST_ASSERT_NOT_NULL(res);
+
+    int socket_fd = socket(res->ai_family, res->ai_socktype, 0);
+    TEST_ASSERT(socket_fd >= 0);
+    struct sockaddr_in saddr = {
+        .sin_family = PF_INET,
+        .sin_port = htons(80),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    TEST_ASSERT(bind(socket_fd, (struct sockaddr *) &saddr, sizeof(struct sockaddr_in)) >= 0);
+    TEST_ASSERT_EQUAL(0, connect(socket_fd, res->ai_addr, res->ai_addrlen));
+    freeaddrinfo(res);
+    return socket_fd;
+}
+
+TEST_CASE("epoll returns ready sockets and other file descriptors", "[vfs][epoll]")
+{
+    test_case_uses_tcpip();
+    esp_vfs_eventfd_config_t config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+    TEST_ESP_OK(esp_vfs_eventfd_register(&config));
+    int event_fd = eventfd(0, 0);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, event_fd);
+    int socket_fd = socket_init();
+
+    esp_vfs_epoll_handle_t ep;
+    TEST_ESP_OK(esp_vfs_epoll_create(&ep));
+    esp_vfs_epoll_event_t event = { .events = ESP_VFS_EPOLL_IN };
+    TEST_ESP_OK(esp_vfs_epoll_ctl(ep, ESP_VFS_EPOLL_CTL_ADD, event_fd, &event));
+    TEST_ESP_OK(esp_vfs_epoll_ctl(ep, ESP_VFS_EPOLL_CTL_ADD, socket_fd, &event));
+    esp_vfs_epoll_event_t events[2];
+    int count;
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, esp_vfs_epoll_wait(ep, events, 2, 50, &count));
+
+    // a datagram sent to itself makes the socket readable
+    epoll_send_task_args_t send_args = { .fd = socket_fd, .done = xSemaphoreCreateBinary() };
+    TEST_ASSERT_NOT_NULL(send_args.done);
+    xTaskCreate(send_task, "send_task", 4096, &send_args, 5, NULL);
+    TEST_ESP_OK(esp_vfs_epoll_wait(ep, events, 2, 1000, &count));
+    TEST_ASSERT_EQUAL(1, count);
+    TEST_ASSERT_EQUAL(socket_fd, events[0].fd);
+    TEST_ASSERT_EQUAL(ESP_VFS_EPOLL_IN, events[0].events);
+    TEST_ASSERT(xSemaphoreTake(send_args.done, pdMS_TO_TICKS(1000)));
+    vSemaphoreDelete(send_args.done);
+    char recv_message[sizeof(message)];
+    TEST_ASSERT_EQUAL(sizeof(message), read(socket_fd, recv_message, sizeof(message)));
+    TEST_ASSERT_EQUAL_MEMORY(message, recv_message, sizeof(message));
+
+    // the eventfd interrupts the wait in socket_select
+    epoll_signal_task_args_t signal_args = { .fd = event_fd, .done = xSemaphoreCreateBinary() };
+    TEST_ASSERT_NOT_NULL(signal_args.done);
+    xTaskCreate(signal_task, "signal_task", 2048, &signal_args, 5, NULL);
+    TEST_ESP_OK(esp_vfs_epoll_wait(ep, events, 2, 1000, &count));
+    TEST_ASSERT_EQUAL(1, count);
+    TEST_ASSERT_EQUAL(event_fd, events[0].fd);
+    TEST_ASSERT(xSemaphoreTake(signal_args.done, pdMS_TO_TICKS(1000)));
+    vSemaphoreDelete(signal_args.done);
+
+    TEST_ESP_OK(esp_vfs_epoll_destroy(ep));
+    close(socket_fd);
+    TEST_ASSERT_EQUAL(0, close(event_fd));
+    TEST_ESP_OK(esp_vfs_eventfd_unregister());
+}
@@ -17,6 +17,8 @@
 #include <unistd.h>
 #include <errno.h>
 #include <sys/fcntl.h>
+#include <sys/uio.h>
+#include <sys/param.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
@@ -266,3 +268,190 @@ TEST_CASE("Open & write & close through VFS passes performance test", "[vfs]")
 #endif
 
 }
+
+static int time_test_vfs_open_p(void *ctx, const char *path, int flags, int mode)
+{
+    return 1;
+}
+
+static int time_test_vfs_close_p(void *ctx, int fd)
+{
+    return 0;
+}
+
+TEST_CASE("Path lookup & fd dispatch through VFS pass performance test", "[vfs]")
+{
+    esp_vfs_t desc = {
+        .flags = ESP_VFS_FLAG_DEFAULT,
+        .open = time_test_vfs_open,
+        .close = time_test_vfs_close,
+        .write = time_test_vfs_write,
+    };
+    esp_vfs_t desc_ctx = {
+        .flags = ESP_VFS_FLAG_CONTEXT_PTR,
+        .open_p = time_test_vfs_open_p,
+        .close_p = time_test_vfs_close_p,
+    };
+
+    // several mount points sharing the beginning of their prefixes
+    TEST_ESP_OK( esp_vfs_register(VFS_PREF1, &desc_ctx, NULL) );
+    TEST_ESP_OK( esp_vfs_register(VFS_PREF2, &desc_ctx, NULL) );
+    TEST_ESP_OK( esp_vfs_register(VFS_PREF1 "/sub", &desc, NULL) );
+    TEST_ESP_OK( esp_vfs_register(VFS_PREF1 "/subdir", &desc_ctx, NULL) );
+
+    const int iter_count = 5000;
+    ccomp_timer_start();
+    for (int i = 0; i < iter_count; ++i) {
+        const int fd = open(VFS_PREF1 "/sub/dir" FILE1, 0, 0);
+        TEST_ASSERT_NOT_EQUAL(fd, -1);
+        TEST_ASSERT_NOT_EQUAL(close(fd), -1);
+    }
+    int64_t time_diff_us = ccomp_timer_stop();
+    const int open_ns_per_iter = (int) (time_diff_us * 1000 / iter_count);
+
+    const int fd = open(VFS_PREF1 "/sub" FILE1, 0, 0);
+    TEST_ASSERT_NOT_EQUAL(fd, -1);
+    ccomp_timer_start();
+    for (int i = 0; i < iter_count; ++i) {
+        write(fd, "a", 1);
+    }
+    time_diff_us = ccomp_timer_stop();
+    const int write_ns_per_iter = (int) (time_diff_us * 1000 / iter_count);
+
+    // functions the VFS doesn't implement fail with ENOSYS
+    errno = 0;
+    TEST_ASSERT_EQUAL(-1, fsync(fd));
+    TEST_ASSERT_EQUAL(ENOSYS, errno);
+    TEST_ASSERT_NOT_EQUAL(close(fd), -1);
+
+    TEST_ESP_OK( esp_vfs_unregister(VFS_PREF1 "/subdir") );
+    TEST_ESP_OK( esp_vfs_unregister(VFS_PREF1 "/sub") );
+    TEST_ESP_OK( esp_vfs_unregister(VFS_PREF2) );
+    TEST_ESP_OK( esp_vfs_unregister(VFS_PREF1) );
+
+    TEST_PERFORMANCE_CCOMP_LESS_THAN(VFS_NESTED_PATH_OPEN_CLOSE_TIME, "%dns", open_ns_per_iter);
+    TEST_PERFORMANCE_CCOMP_LESS_THAN(VFS_WRITE_DISPATCH_TIME, "%dns", write_ns_per_iter);
+}
+
+typedef struct {
+    char data[32];
+    size_t size;
+    size_t max_write;   // largest write accepted at once, to test short writes
+    int write_calls;
+    int fail_call;      // number of the write call which fails with EIO, 0 for none
+} iov_test_vfs_file_t;
+
+static int iov_test_vfs_open(void *ctx, const char *path, int flags, int mode)
+{
+    return 0;
+}
+
+static int iov_test_vfs_close(void *ctx, int fd)
+{
+    return 0;
+}
+
+static ssize_t iov_test_vfs_write(void *ctx, int fd, const void *data, size_t size)
+{
+    iov_test_vfs_file_t *file = (iov_test_vfs_file_t *) ctx;
+    if (++file->write_calls == file->fail_call) {
+        errno = EIO;
+        return -1;
+    }
+    size = MIN(size, MIN(file->max_write, sizeof(file->data) - file->size));
+    if (size == 0) {
+        errno = ENOSPC;
+        return -1;
+    }
+    memcpy(file->data + file->size, data, size);
+    file->size += size;
+    return size;
+}
+
+static ssize_t iov_test_vfs_pread(void *ctx, int fd, void *dst, size_t size, off_t offset)
+{
+    iov_test_vfs_file_t *file = (iov_test_vfs_file_t *) ctx;
+    size = ((size_t) offset < file->size) ? MIN(size, file->size - offset) : 0;
+    memcpy(dst, file->data + offset, size);
+    return size;
+}
+
+TEST_CASE("Vectored I/O falls back to scalar VFS functions", "[vfs]")
+{
+    iov_test_vfs_file_t file = { .max_write = sizeof(file.data) };
+    esp_vfs_t desc = {
+        .flags = ESP_VFS_FLAG_CONTEXT_PTR,
+        .open_p = iov_test_vfs_open,
+        .close_p = iov_test_vfs_close,
+        .write_p = iov_test_vfs_write,
+        .pread_p = iov_test_vfs_pread,
+    };
+    TEST_ESP_OK( esp_vfs_register(VFS_PREF1, &desc, &file) );
+    const int fd = open(VFS_PREF1 FILE1, 0, 0);
+    TEST_ASSERT_NOT_EQUAL(fd, -1);
+
+    char header[] = "head", empty[] = "", payload[] = "payload";
+    const struct iovec iov[] = {
+        { .iov_base = header, .iov_len = strlen(header) },
+        { .iov_base = empty, .iov_len = 0 },
+        { .iov_base = payload, .iov_len = strlen(payload) },
+    };
+    // empty buffers are skipped
+    TEST_ASSERT_EQUAL(11, writev(fd, iov, 3));
+    TEST_ASSERT_EQUAL(2, file.write_calls);
+    TEST_ASSERT_EQUAL_MEMORY("headpayload", file.data, 11);
+
+    // a short write ends the call
+    file.max_write = 2;
+    file.write_calls = 0;
+    TEST_ASSERT_EQUAL(2, writev(fd, iov, 3));
+    TEST_ASSERT_EQUAL(1, file.write_calls);
+
+    // an error after some buffers were written returns the amount written
+    file.max_write = sizeof(file.data);
+    file.size = 0;
+    file.write_calls = 0;
+    file.fail_call = 2;
+    TEST_ASSERT_EQUAL(4, writev(fd, iov, 3));
+    TEST_ASSERT_EQUAL(2, file.write_calls);
+    TEST_ASSERT_EQUAL_MEMORY("head", file.data, 4);
+
+    // an error before anything was written fails the call
+    file.write_calls = 0;
+    file.fail_call = 1;
+    errno = 0;
+    TEST_ASSERT_EQUAL(-1, writev(fd, iov, 3));
+    TEST_ASSERT_EQUAL(EIO, errno);
+    file.fail_call = 0;
+
+    // a short write at the end of the file, then no space left
+    file.size = sizeof(file.data) - 3;
+    TEST_ASSERT_EQUAL(3, writev(fd, iov, 3));
+    errno = 0;
+    TEST_ASSERT_EQUAL(-1, writev(fd, iov, 3));
+    TEST_ASSERT_EQUAL(ENOSPC, errno);
+
+    file.size = strlen("headpayload");
+    char buf1[4] = { 0 }, buf2[8] = { 0 };
+    const struct iovec rd_iov[] = {
+        { .iov_base = buf1, .iov_len = sizeof(buf1) },
+        { .iov_base = buf2, .iov_len = sizeof(buf2) },
+    };
+    TEST_ASSERT_EQUAL(11, preadv(fd, rd_iov, 2, 0));
+    TEST_ASSERT_EQUAL_MEMORY("head", buf1, 4);
+    TEST_ASSERT_EQUAL_MEMORY("payload", buf2, 7);
+
+    // missing scalar function, invalid arguments
+    errno = 0;
+    TEST_ASSERT_EQUAL(-1, readv(fd, rd_iov, 2));
+    TEST_ASSERT_EQUAL(ENOSYS, errno);
+    errno = 0;
+    TEST_ASSERT_EQUAL(-1, writev(fd, iov, -1));
+    TEST_ASSERT_EQUAL(EINVAL, errno);
+    errno = 0;
+    TEST_ASSERT_EQUAL(-1, preadv(fd, rd_iov, 2, -1));
+    TEST_ASSERT_EQUAL(EINVAL, errno);
+
+    TEST_ASSERT_NOT_EQUAL(close(fd), -1);
+    TEST_ESP_OK( esp_vfs_unregister(VFS_PREF1) );
+}
@@ -7,6 +7,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <stdatomic.h>
 #include <sys/errno.h>
 #include <sys/fcntl.h>
 #include <sys/ioctl.h>
@@ -17,6 +18,7 @@
 #include <dirent.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "esp_vfs.h"
 #include "esp_vfs_private.h"
 #include "sdkconfig.h"
@@ -28,9 +30,8 @@
 
 static const char *TAG = "vfs";
 
-#define VFS_MAX_COUNT   8   /* max number of VFS entries (registered filesystems) */
 #define LEN_PATH_PREFIX_IGNORED SIZE_MAX /* special length value for VFS which is never recognised by open() */
-#define FD_TABLE_ENTRY_UNUSED   (fd_table_t) { .permanent = false, .has_pending_close = false, .has_pending_select = false, .vfs_index = -1, .local_fd = -1 }
+#define FD_TABLE_ENTRY_UNUSED   (fd_table_t) { .permanent = false, .has_pending_close = false, .has_pending_select = false, .vfs_index = -1, .local_fd = -1, .fd_ops = NULL }
 
 typedef uint8_t local_fd_t;
 _Static_assert((1 << (sizeof(local_fd_t)*8)) >= MAX_FDS, "file descriptor type too small");
@@ -46,8 +47,22 @@ typedef struct {
     uint8_t _reserved :5;
     vfs_index_t vfs_index;
     local_fd_t local_fd;
+    const vfs_fd_ops_t *fd_ops; // fd_ops of the VFS, NULL if the entry is unused
 } fd_table_t;
 
+/* Node of the trie of VFS path prefixes. Node 0 is the root (empty prefix),
+ * the other nodes each add one character to the prefix of their parent.
+ */
+typedef struct {
+    char c;
+    vfs_index_t vfs_index;  // VFS registered with the prefix ending at this node, -1 if none
+    uint8_t child;          // first child node, 0 if none
+    uint8_t sibling;        // next child of the same parent, 0 if none
+} path_trie_node_t;
+
+#define PATH_TRIE_MAX_NODES     (1 + VFS_MAX_COUNT * ESP_VFS_PATH_MAX)
+_Static_assert(PATH_TRIE_MAX_NODES <= UINT8_MAX + 1, "path trie node index type too small");
+
 typedef struct {
     bool isset; // none or at least one bit is set in the following 3 fd sets
     fd_set readfds;
@@ -61,6 +76,134 @@ static size_t s_vfs_count = 0;
 static fd_table_t s_fd_table[MAX_FDS] = { [0 ... MAX_FDS-1] = FD_TABLE_ENTRY_UNUSED };
 static _lock_t s_fd_table_lock;
 
+// Rebuilt whenever a VFS with a path prefix is registered or unregistered.
+// If NULL (nothing was registered yet, or out of memory), paths are matched by scanning s_vfs.
+static path_trie_node_t *_Atomic s_path_trie = NULL;
+// Number of lookups in progress which may use s_path_trie. A rebuild frees the trie
+// it replaces only once this drops to zero, lookups don't take any lock.
+static atomic_uint s_path_trie_readers = 0;
+
+/*
+ * Adapters giving the file descriptor functions of a VFS registered without
+ * ESP_VFS_FLAG_CONTEXT_PTR the signature of vfs_fd_ops_t (their 'ctx' is the VFS entry),
+ * and functions standing in for the ones a VFS doesn't implement.
+ */
+#define FD_OPS_NO_CTX_ADAPTER(ret_type, func, params, args) \
+    static ret_type func ## _no_ctx params \
+    { \
+        const vfs_entry_t *vfs = (const vfs_entry_t *) ctx; \
+        return (*vfs->vfs.func) args; \
+    }
+#define FD_OPS_ADAPTERS(ret_type, func, params, args) \
+    FD_OPS_NO_CTX_ADAPTER(ret_type, func, params, args) \
+    static ret_type func ## _nosys params \
+    { \
+        errno = ENOSYS; \
+        return -1; \
+    }
+
+FD_OPS_ADAPTERS(ssize_t, write, (void *ctx, int fd, const void *data, size_t size), (fd, data, size))
+FD_OPS_ADAPTERS(off_t, lseek, (void *ctx, int fd, off_t size, int mode), (fd, size, mode))
+FD_OPS_ADAPTERS(ssize_t, read, (void *ctx, int fd, void *dst, size_t size), (fd, dst, size))
+FD_OPS_ADAPTERS(ssize_t, pread, (void *ctx, int fd, void *dst, size_t size, off_t offset), (fd, dst, size, offset))
+FD_OPS_ADAPTERS(ssize_t, pwrite, (void *ctx, int fd, const void *src, size_t size, off_t offset), (fd, src, size, offset))
+FD_OPS_ADAPTERS(int, close, (void *ctx, int fd), (fd))
+FD_OPS_ADAPTERS(int, fstat, (void *ctx, int fd, struct stat *st), (fd, st))
+FD_OPS_ADAPTERS(int, fcntl, (void *ctx, int fd, int cmd, int arg), (fd, cmd, arg))
+FD_OPS_ADAPTERS(int, ioctl, (void *ctx, int fd, int cmd, va_list args), (fd, cmd, args))
+FD_OPS_ADAPTERS(int, fsync, (void *ctx, int fd), (fd))
+FD_OPS_NO_CTX_ADAPTER(ssize_t, writev, (void *ctx, int fd, const struct iovec *iov, int iovcnt), (fd, iov, iovcnt))
+FD_OPS_NO_CTX_ADAPTER(ssize_t, readv, (void *ctx, int fd, const struct iovec *iov, int iovcnt), (fd, iov, iovcnt))
+FD_OPS_NO_CTX_ADAPTER(ssize_t, pwritev, (void *ctx, int fd, const struct iovec *iov, int iovcnt, off_t offset), (fd, iov, iovcnt, offset))
+FD_OPS_NO_CTX_ADAPTER(ssize_t, preadv, (void *ctx, int fd, const struct iovec *iov, int iovcnt, off_t offset), (fd, iov, iovcnt, offset))
+
+static void init_fd_ops(vfs_entry_t *entry)
+{
+    const esp_vfs_t *vfs = &entry->vfs;
+    vfs_fd_ops_t *ops = &entry->fd_ops;
+    const bool has_ctx = (vfs->flags & ESP_VFS_FLAG_CONTEXT_PTR) != 0;
+
+    ops->ctx = has_ctx ? entry->ctx : entry;
+    // as in CHECK_AND_CALL, checking one member of each union is enough
+#define INIT_FD_OP(func) \
+    ops->func = (vfs->func == NULL) ? func ## _nosys : (has_ctx ? vfs->func ## _p : func ## _no_ctx)
+    INIT_FD_OP(write);
+    INIT_FD_OP(lseek);
+    INIT_FD_OP(read);
+    INIT_FD_OP(pread);
+    INIT_FD_OP(pwrite);
+    INIT_FD_OP(close);
+    INIT_FD_OP(fstat);
+    INIT_FD_OP(fcntl);
+    INIT_FD_OP(ioctl);
+    INIT_FD_OP(fsync);
+#undef INIT_FD_OP
+    // vectored functions are emulated by the callers if missing
+#define INIT_FD_OP_OPTIONAL(func) \
+    ops->func = (vfs->func == NULL) ? NULL : (has_ctx ? vfs->func ## _p : func ## _no_ctx)
+    INIT_FD_OP_OPTIONAL(writev);
+    INIT_FD_OP_OPTIONAL(readv);
+    INIT_FD_OP_OPTIONAL(pwritev);
+    INIT_FD_OP_OPTIONAL(preadv);
+#undef INIT_FD_OP_OPTIONAL
+}
+
+static void path_trie_insert(path_trie_node_t *nodes, size_t *node_count, const char *prefix, size_t len, vfs_index_t vfs_index)
+{
+    size_t node = 0;
+    for (size_t i = 0; i < len; ++i) {
+        size_t child = nodes[node].child;
+        while (child != 0 && nodes[child].c != prefix[i]) {
+            child = nodes[child].sibling;
+        }
+        if (child == 0) {
+            child = (*node_count)++;
+            nodes[child] = (path_trie_node_t) {
+                .c = prefix[i],
+                .vfs_index = -1,
+                .child = 0,
+                .sibling = nodes[node].child,
+            };
+            nodes[node].child = child;
+        }
+        node = child;
+    }
+    // if several VFSes have the same prefix, the one with the lowest index is used
+    if (nodes[node].vfs_index == -1) {
+        nodes[node].vfs_index = vfs_index;
+    }
+}
+
+static void rebuild_path_trie(void)
+{
+    size_t max_nodes = 1;
+    for (size_t i = 0; i < s_vfs_count; ++i) {
+        if (s_vfs[i] != NULL && s_vfs[i]->path_prefix_len != LEN_PATH_PREFIX_IGNORED) {
+            max_nodes += s_vfs[i]->path_prefix_len;
+        }
+    }
+    path_trie_node_t *nodes = (path_trie_node_t *) malloc(max_nodes * sizeof(path_trie_node_t));
+    if (nodes != NULL) {
+        size_t node_count = 1;
+        nodes[0] = (path_trie_node_t) { .c = '\0', .vfs_index = -1, .child = 0, .sibling = 0 };
+        for (size_t i = 0; i < s_vfs_count; ++i) {
+            const vfs_entry_t *vfs = s_vfs[i];
+            if (vfs != NULL && vfs->path_prefix_len != LEN_PATH_PREFIX_IGNORED) {
+                path_trie_insert(nodes, &node_count, vfs->path_prefix, vfs->path_prefix_len, i);
+            }
+        }
+    } else {
+        ESP_LOGD(TAG, "no memory for the path trie, falling back to linear search");
+    }
+    path_trie_node_t *old_nodes = atomic_exchange(&s_path_trie, nodes);
+    // Lookups which started before the exchange may still use the old trie. Lookups which
+    // start from now on use the new one, so this wait ends as soon as the current ones do.
+    while (atomic_load(&s_path_trie_readers) != 0) {
+        vTaskDelay(1);
+    }
+    free(old_nodes);
+}
+
 esp_err_t esp_vfs_register_common(const char* base_path, size_t len, const esp_vfs_t* vfs, void* ctx, int *vfs_index)
 {
     if (len != LEN_PATH_PREFIX_IGNORED) {
@@ -100,6 +243,11 @@ esp_err_t esp_vfs_register_common(const char* base_path, size_t len, const esp_v
     entry->path_prefix_len = len;
     entry->ctx = ctx;
     entry->offset = index;
+    init_fd_ops(entry);
+
+    if (len != LEN_PATH_PREFIX_IGNORED) {
+        rebuild_path_trie();
+    }
 
     if (vfs_index) {
         *vfs_index = index;
@@ -127,8 +275,8 @@ esp_err_t esp_vfs_register_fd_range(const esp_vfs_t *vfs, void *ctx, int min_fd,
         _lock_acquire(&s_fd_table_lock);
         for (int i = min_fd; i < max_fd; ++i) {
             if (s_fd_table[i].vfs_index != -1) {
-                free(s_vfs[i]);
-                s_vfs[i] = NULL;
+                free(s_vfs[index]);
+                s_vfs[index] = NULL;
                 for (int j = min_fd; j < i; ++j) {
                     if (s_fd_table[j].vfs_index == index) {
                         s_fd_table[j] = FD_TABLE_ENTRY_UNUSED;
@@ -141,6 +289,7 @@ esp_err_t esp_vfs_register_fd_range(const esp_vfs_t *vfs, void *ctx, int min_fd,
             s_fd_table[i].permanent = true;
             s_fd_table[i].vfs_index = index;
             s_fd_table[i].local_fd = i;
+            s_fd_table[i].fd_ops = &s_vfs[index]->fd_ops;
         }
         _lock_release(&s_fd_table_lock);
     }
@@ -166,18 +315,22 @@ esp_err_t esp_vfs_unregister_with_id(esp_vfs_id_t vfs_id)
         return ESP_ERR_INVALID_ARG;
     }
     vfs_entry_t* vfs = s_vfs[vfs_id];
-    free(vfs);
     s_vfs[vfs_id] = NULL;
 
     _lock_acquire(&s_fd_table_lock);
     // Delete all references from the FD lookup-table
-    for (int j = 0; j < VFS_MAX_COUNT; ++j) {
+    for (int j = 0; j < MAX_FDS; ++j) {
         if (s_fd_table[j].vfs_index == vfs_id) {
             s_fd_table[j] = FD_TABLE_ENTRY_UNUSED;
         }
     }
     _lock_release(&s_fd_table_lock);
 
+    if (vfs->path_prefix_len != LEN_PATH_PREFIX_IGNORED) {
+        rebuild_path_trie();
+    }
+    free(vfs);
+
     return ESP_OK;
 }
 
@@ -204,7 +357,7 @@ esp_err_t esp_vfs_register_fd(esp_vfs_id_t vfs_id, int *fd)
 
 esp_err_t esp_vfs_register_fd_with_local_fd(esp_vfs_id_t vfs_id, int local_fd, bool permanent, int *fd)
 {
-    if (vfs_id < 0 || vfs_id >= s_vfs_count || fd == NULL) {
+    if (vfs_id < 0 || vfs_id >= s_vfs_count || s_vfs[vfs_id] == NULL || fd == NULL) {
         ESP_LOGD(TAG, "Invalid arguments for esp_vfs_register_fd_with_local_fd(%d, %d, %d, 0x%p)",
                  vfs_id, local_fd, permanent, fd);
         return ESP_ERR_INVALID_ARG;
@@ -221,6 +374,7 @@ esp_err_t esp_vfs_register_fd_with_local_fd(esp_vfs_id_t vfs_id, int local_fd, b
             } else {
                 s_fd_table[i].local_fd = i;
             }
+            s_fd_table[i].fd_ops = &s_vfs[vfs_id]->fd_ops;
             *fd = i;
             ret = ESP_OK;
             break;
@@ -270,7 +424,7 @@ static inline bool fd_valid(int fd)
     return (fd < MAX_FDS) && (fd >= 0);
 }
 
-static const vfs_entry_t *get_vfs_for_fd(int fd)
+static inline const vfs_entry_t *get_vfs_for_fd(int fd)
 {
     const vfs_entry_t *vfs = NULL;
     if (fd_valid(fd)) {
@@ -291,6 +445,18 @@ static inline int get_local_fd(const vfs_entry_t *vfs, int fd)
     return local_fd;
 }
 
+/* Returns the file descriptor functions of the VFS which 'fd' belongs to, and the VFS local fd,
+ * or NULL if 'fd' isn't valid.
+ */
+static inline const vfs_fd_ops_t *get_fd_ops(int fd, int *local_fd)
+{
+    if (!fd_valid(fd)) {
+        return NULL;
+    }
+    *local_fd = s_fd_table[fd].local_fd;   // single reads -> no locking is required
+    return s_fd_table[fd].fd_ops;
+}
+
 static const char* translate_path(const vfs_entry_t* vfs, const char* src_path)
 {
     assert(strncmp(src_path, vfs->path_prefix, vfs->path_prefix_len) == 0);
@@ -301,7 +467,29 @@ static const char* translate_path(const vfs_entry_t* vfs, const char* src_path)
     return src_path + vfs->path_prefix_len;
 }
 
-const vfs_entry_t* get_vfs_for_path(const char* path)
+static const vfs_entry_t *path_trie_lookup(const path_trie_node_t *nodes, const char *path)
+{
+    int best_match = nodes[0].vfs_index; // default VFS (empty prefix), if any
+    size_t node = 0;
+    for (const char *p = path; *p != '\0'; ++p) {
+        size_t child = nodes[node].child;
+        while (child != 0 && nodes[child].c != *p) {
+            child = nodes[child].sibling;
+        }
+        if (child == 0) {
+            break;
+        }
+        node = child;
+        // the deepest node with a VFS which is followed by a path separator (or the end of the path)
+        // is the longest matching prefix; i.e. don't match "/data" prefix for "/data1/foo.txt" path
+        if (nodes[node].vfs_index != -1 && (p[1] == '\0' || p[1] == '/')) {
+            best_match = nodes[node].vfs_index;
+        }
+    }
+    return get_vfs_for_index(best_match);
+}
+
+static const vfs_entry_t *get_vfs_for_path_linear(const char *path)
 {
     const vfs_entry_t* best_match = NULL;
     ssize_t best_match_prefix_len = -1;
@@ -330,9 +518,6 @@ const vfs_entry_t* get_vfs_for_path(const char* path)
         // Out of all matching path prefixes, select the longest one;
         // i.e. if "/dev" and "/dev/uart" both match, for "/dev/uart/1" path,
         // choose "/dev/uart",
-        // This causes all s_vfs_count VFS entries to be scanned when opening
-        // a file by name. This can be optimized by introducing a table for
-        // FS search order, sorted so that longer prefixes are checked first.
         if (best_match_prefix_len < (ssize_t) vfs->path_prefix_len) {
             best_match_prefix_len = (ssize_t) vfs->path_prefix_len;
             best_match = vfs;
@@ -341,6 +526,20 @@ const vfs_entry_t* get_vfs_for_path(const char* path)
     return best_match;
 }
 
+const vfs_entry_t* get_vfs_for_path(const char* path)
+{
+    const vfs_entry_t *vfs;
+    atomic_fetch_add(&s_path_trie_readers, 1);
+    const path_trie_node_t *trie = atomic_load(&s_path_trie);
+    if (trie != NULL) {
+        vfs = path_trie_lookup(trie, path);
+    } else {
+        vfs = get_vfs_for_path_linear(path);
+    }
+    atomic_fetch_sub(&s_path_trie_readers, 1);
+    return vfs;
+}
+
 /*
  * Using huge multi-line macros is never nice, but in this case
  * the only alternative is to repeat this chunk of code (with different function names)
@@ -404,6 +603,7 @@ int esp_vfs_open(struct _reent *r, const char * path, int flags, int mode)
                 s_fd_table[i].permanent = false;
                 s_fd_table[i].vfs_index = vfs->offset;
                 s_fd_table[i].local_fd = fd_within_vfs;
+                s_fd_table[i].fd_ops = &vfs->fd_ops;
                 _lock_release(&s_fd_table_lock);
                 return i;
             }
@@ -421,81 +621,207 @@ int esp_vfs_open(struct _reent *r, const char * path, int flags, int mode)
 
 ssize_t esp_vfs_write(struct _reent *r, int fd, const void * data, size_t size)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
-    if (vfs == NULL || local_fd < 0) {
+    int local_fd;
+    const vfs_fd_ops_t *ops = get_fd_ops(fd, &local_fd);
+    if (ops == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
-    ssize_t ret;
-    CHECK_AND_CALL(ret, r, vfs, write, local_fd, data, size);
-    return ret;
+    return (*ops->write)(ops->ctx, local_fd, data, size);
 }
 
 off_t esp_vfs_lseek(struct _reent *r, int fd, off_t size, int mode)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
-    if (vfs == NULL || local_fd < 0) {
+    int local_fd;
+    const vfs_fd_ops_t *ops = get_fd_ops(fd, &local_fd);
+    if (ops == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
-    off_t ret;
-    CHECK_AND_CALL(ret, r, vfs, lseek, local_fd, size, mode);
-    return ret;
+    return (*ops->lseek)(ops->ctx, local_fd, size, mode);
 }
 
 ssize_t esp_vfs_read(struct _reent *r, int fd, void * dst, size_t size)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
-    if (vfs == NULL || local_fd < 0) {
+    int local_fd;
+    const vfs_fd_ops_t *ops = get_fd_ops(fd, &local_fd);
+    if (ops == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
-    ssize_t ret;
-    CHECK_AND_CALL(ret, r, vfs, read, local_fd, dst, size);
-    return ret;
+    return (*ops->read)(ops->ctx, local_fd, dst, size);
 }
 
 ssize_t esp_vfs_pread(int fd, void *dst, size_t size, off_t offset)
 {
     struct _reent *r = __getreent();
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
-    if (vfs == NULL || local_fd < 0) {
+    int local_fd;
+    const vfs_fd_ops_t *ops = get_fd_ops(fd, &local_fd);
+    if (ops == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
-    ssize_t ret;
-    CHECK_AND_CALL(ret, r, vfs, pread, local_fd, dst, size, offset);
-    return ret;
+    return (*ops->pread)(ops->ctx, local_fd, dst, size, offset);
 }
 
 ssize_t esp_vfs_pwrite(int fd, const void *src, size_t size, off_t offset)
 {
     struct _reent *r = __getreent();
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
-    if (vfs == NULL || local_fd < 0) {
+    int local_fd;
+    const vfs_fd_ops_t *ops = get_fd_ops(fd, &local_fd);
+    if (ops == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
-    ssize_t ret;
-    CHECK_AND_CALL(ret, r, vfs, pwrite, local_fd, src, size, offset);
-    return ret;
+    return (*ops->pwrite)(ops->ctx, local_fd, src, size, offset);
+}
+
+/* Checks the buffers passed to the vectored functions. Their total size must fit into the return value. */
+static bool iov_valid(const struct iovec *iov, int iovcnt)
+{
+    if (iovcnt < 0 || iovcnt > IOV_MAX || (iov == NULL && iovcnt > 0)) {
+        return false;
+    }
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        if (iov[i].iov_len > (SIZE_MAX >> 1) - total) {
+            return false;
+        }
+        total += iov[i].iov_len;
+    }
+    return true;
+}
+
+typedef enum {
+    IOV_OP_WRITE,
+    IOV_OP_READ,
+    IOV_OP_PWRITE,
+    IOV_OP_PREAD,
+} iov_op_t;
+
+/* Emulates a vectored function for a VFS which doesn't implement it, by calling the scalar
+ * function for each buffer. Like a single scalar call, this stops at the first short transfer,
+ * and an error after some data has been transferred returns the amount transferred so far.
+ */
+static ssize_t iov_fallback(const vfs_fd_ops_t *ops, int fd, iov_op_t op, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    ssize_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        const size_t len = iov[i].iov_len;
+        if (len == 0) {
+            continue;
+        }
+        ssize_t ret;
+        switch (op) {
+        case IOV_OP_WRITE:
+            ret = (*ops->write)(ops->ctx, fd, iov[i].iov_base, len);
+            break;
+        case IOV_OP_READ:
+            ret = (*ops->read)(ops->ctx, fd, iov[i].iov_base, len);
+            break;
+        case IOV_OP_PWRITE:
+            ret = (*ops->pwrite)(ops->ctx, fd, iov[i].iov_base, len, offset + total);
+            break;
+        default:
+            ret = (*ops->pread)(ops->ctx, fd, iov[i].iov_base, len, offset + total);
+            break;
+        }
+        if (ret < 0) {
+            return (total > 0) ? total : -1;
+        }
+        total += ret;
+        if ((size_t) ret < len) {
+            break;
+        }
+    }
+    return total;
+}
+
+ssize_t esp_vfs_writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    struct _reent *r = __getreent();
+    int local_fd;
+    const vfs_fd_ops_t *ops = get_fd_ops(fd, &local_fd);
+    if (ops == NULL) {
+        __errno_r(r) = EBADF;
+        return -1;
+    }
+    if (!iov_valid(iov, iovcnt)) {
+        __errno_r(r) = EINVAL;
+        return -1;
+    }
+    if (ops->writev != NULL) {
+        return (*ops->writev)(ops->ctx, local_fd, iov, iovcnt);
+    }
+    return iov_fallback(ops, local_fd, IOV_OP_WRITE, iov, iovcnt, 0);
+}
+
+ssize_t esp_vfs_readv(int fd, const struct iovec *iov, int iovcnt)
+{
+    struct _reent *r = __getreent();
+    int local_fd;
+    const vfs_fd_ops_t *ops = get_fd_ops(fd, &local_fd);
+    if (ops == NULL) {
+        __errno_r(r) = EBADF;
+        return -1;
+    }
+    if (!iov_valid(iov, iovcnt)) {
+        __errno_r(r) = EINVAL;
+        return -1;
+    }
+    if (ops->readv != NULL) {
+        return (*ops->readv)(ops->ctx, local_fd, iov, iovcnt);
+    }
+    return iov_fallback(ops, local_fd, IOV_OP_READ, iov, iovcnt, 0);
+}
+
+ssize_t esp_vfs_pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    struct _reent *r = __getreent();
+    int local_fd;
+    const vfs_fd_ops_t *ops = get_fd_ops(fd, &local_fd);
+    if (ops == NULL) {
+        __errno_r(r) = EBADF;
+        return -1;
+    }
+    if (!iov_valid(iov, iovcnt) || offset < 0) {
+        __errno_r(r) = EINVAL;
+        return -1;
+    }
+    if (ops->pwritev != NULL) {
+        return (*ops->pwritev)(ops->ctx, local_fd, iov, iovcnt, offset);
+    }
+    return iov_fallback(ops, local_fd, IOV_OP_PWRITE, iov, iovcnt, offset);
+}
+
+ssize_t esp_vfs_preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    struct _reent *r = __getreent();
+    int local_fd;
+    const vfs_fd_ops_t *ops = get_fd_ops(fd, &local_fd);
+    if (ops == NULL) {
+        __errno_r(r) = EBADF;
+        return -1;
+    }
+    if (!iov_valid(iov, iovcnt) || offset < 0) {
+        __errno_r(r) = EINVAL;
+        return -1;
+    }
+    if (ops->preadv != NULL) {
+        return (*ops->preadv)(ops->ctx, local_fd, iov, iovcnt, offset);
+    }
+    return iov_fallback(ops, local_fd, IOV_OP_PREAD, iov, iovcnt, offset);
 }
 
 int esp_vfs_close(struct _reent *r, int fd)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
-    if (vfs == NULL || local_fd < 0) {
+    int local_fd;
+    const vfs_fd_ops_t *ops = get_fd_ops(fd, &local_fd);
+    if (ops == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
-    int ret;
-    CHECK_AND_CALL(ret, r, vfs, close, local_fd);
+    int ret = (*ops->close)(ops->ctx, local_fd);
 
     _lock_acquire(&s_fd_table_lock);
     if (!s_fd_table[fd].permanent) {
@@ -511,59 +837,53 @@ int esp_vfs_close(struct _reent *r, int fd)
 
 int esp_vfs_fstat(struct _reent *r, int fd, struct stat * st)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
-    if (vfs == NULL || local_fd < 0) {
+    int local_fd;
+    const vfs_fd_ops_t *ops = get_fd_ops(fd, &local_fd);
+    if (ops == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
-    int ret;
-    CHECK_AND_CALL(ret, r, vfs, fstat, local_fd, st);
-    return ret;
+    return (*ops->fstat)(ops->ctx, local_fd, st);
 }
 
 int esp_vfs_fcntl_r(struct _reent *r, int fd, int cmd, int arg)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
-    if (vfs == NULL || local_fd < 0) {
+    int local_fd;
+    const vfs_fd_ops_t *ops = get_fd_ops(fd, &local_fd);
+    if (ops == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
-    int ret;
-    CHECK_AND_CALL(ret, r, vfs, fcntl, local_fd, cmd, arg);
-    return ret;
+    return (*ops->fcntl)(ops->ctx, local_fd, cmd, arg);
 }
 
 int esp_vfs_ioctl(int fd, int cmd, ...)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
+    int local_fd;
+    const vfs_fd_ops_t *ops = get_fd_ops(fd, &local_fd);
     struct _reent* r = __getreent();
-    if (vfs == NULL || local_fd < 0) {
+    if (ops == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
     int ret;
     va_list args;
     va_start(args, cmd);
-    CHECK_AND_CALL(ret, r, vfs, ioctl, local_fd, cmd, args);
+    ret = (*ops->ioctl)(ops->ctx, local_fd, cmd, args);
     va_end(args);
     return ret;
 }
 
 int esp_vfs_fsync(int fd)
 {
-    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
-    const int local_fd = get_local_fd(vfs, fd);
+    int local_fd;
+    const vfs_fd_ops_t *ops = get_fd_ops(fd, &local_fd);
     struct _reent* r = __getreent();
-    if (vfs == NULL || local_fd < 0) {
+    if (ops == NULL) {
         __errno_r(r) = EBADF;
         return -1;
     }
-    int ret;
-    CHECK_AND_CALL(ret, r, vfs, fsync, local_fd);
-    return ret;
+    return (*ops->fsync)(ops->ctx, local_fd);
 }
 
 #ifdef CONFIG_VFS_SUPPORT_DIR
@@ -843,6 +1163,19 @@ static int set_global_fd_sets(const fds_triple_t *vfs_fds_triple, int size, fd_s
     return ret;
 }
 
+int esp_vfs_get_fd_vfs_index(int fd, int *local_fd, bool *is_socket)
+{
+    if (!fd_valid(fd)) {
+        return -1;
+    }
+    _lock_acquire(&s_fd_table_lock);
+    const int vfs_index = s_fd_table[fd].vfs_index;
+    *local_fd = s_fd_table[fd].local_fd;
+    *is_socket = s_fd_table[fd].permanent;
+    _lock_release(&s_fd_table_lock);
+    return vfs_index;
+}
+
 static void esp_vfs_log_fd_set(const char *fds_name, const fd_set *fds)
 {
     if (fds_name && fds) {
@@ -1062,7 +1395,9 @@ int esp_vfs_select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *errorfds
 
 void esp_vfs_select_triggered(esp_vfs_select_sem_t sem)
 {
-    if (sem.is_sem_local) {
+    if (sem.epoll) {
+        esp_vfs_epoll_triggered(sem.epoll, false, NULL);
+    } else if (sem.is_sem_local) {
         xSemaphoreGive(sem.sem);
     } else {
         // Another way would be to go through s_fd_table and find the VFS
@@ -1082,7 +1417,9 @@ void esp_vfs_select_triggered(esp_vfs_select_sem_t sem)
 
 void esp_vfs_select_triggered_isr(esp_vfs_select_sem_t sem, BaseType_t *woken)
 {
-    if (sem.is_sem_local) {
+    if (sem.epoll) {
+        esp_vfs_epoll_triggered(sem.epoll, true, woken);
+    } else if (sem.is_sem_local) {
         xSemaphoreGiveFromISR(sem.sem, woken);
     } else {
         // Another way would be to go through s_fd_table and find the VFS
@@ -1223,6 +1560,14 @@ ssize_t pread(int fd, void *dst, size_t size, off_t offset)
     __attribute__((alias("esp_vfs_pread")));
 ssize_t pwrite(int fd, const void *src, size_t size, off_t offset)
     __attribute__((alias("esp_vfs_pwrite")));
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
+    __attribute__((alias("esp_vfs_writev")));
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt)
+    __attribute__((alias("esp_vfs_readv")));
+ssize_t pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+    __attribute__((alias("esp_vfs_pwritev")));
+ssize_t preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+    __attribute__((alias("esp_vfs_preadv")));
 off_t _lseek_r(struct _reent *r, int fd, off_t size, int mode)
     __attribute__((alias("esp_vfs_lseek")));
 int _fcntl_r(struct _reent *r, int fd, int cmd, int arg)
@@ -0,0 +1,634 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * epoll instances keep the select() of their file descriptors running between
+ * the calls to esp_vfs_epoll_wait.
+ *
+ * The file descriptors of each VFS driver form a group. While a group is
+ * registered, start_select of its driver has been called with the fd sets of
+ * the group, and a esp_vfs_select_sem_t pointing to the group. The driver
+ * notifies the group through esp_vfs_select_triggered, which marks the group
+ * ready in the instance and wakes up the waiting task. esp_vfs_epoll_wait then
+ * calls end_select for the ready groups only, to get their ready file
+ * descriptors. These groups are re-armed with start_select by the next call to
+ * esp_vfs_epoll_wait, once the application has handled the events, so that the
+ * driver doesn't report readiness which the application is about to consume.
+ *
+ * Socket readiness can only be obtained from socket_select. The fd sets of
+ * the socket group are kept up to date by esp_vfs_epoll_ctl, and the waiting
+ * task blocks in socket_select with them. Notifications of the other groups
+ * interrupt it through stop_socket_select, as in esp_vfs_select.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/errno.h>
+#include <sys/lock.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_vfs.h"
+#include "esp_vfs_epoll.h"
+#include "esp_vfs_private.h"
+#include "sdkconfig.h"
+
+#ifdef CONFIG_VFS_SUPPORT_SELECT
+
+#ifdef CONFIG_VFS_SUPPRESS_SELECT_DEBUG_OUTPUT
+#define LOG_LOCAL_LEVEL ESP_LOG_NONE
+#endif //CONFIG_VFS_SUPPRESS_SELECT_DEBUG_OUTPUT
+#include "esp_log.h"
+
+static const char *TAG = "vfs_epoll";
+
+#define EPOLL_EVENTS_ALL    (ESP_VFS_EPOLL_IN | ESP_VFS_EPOLL_OUT | ESP_VFS_EPOLL_ERR)
+
+_Static_assert(VFS_MAX_COUNT <= 32, "ready_mask is too small");
+
+typedef struct vfs_epoll_item_ {
+    int fd;
+    int local_fd;
+    int vfs_index;
+    uint32_t events;                        // events to wait for
+    void *data;
+    uint32_t revents;                       // ready events which haven't been returned yet
+    bool is_pending;                        // revents != 0, the item is in the pending list
+    struct vfs_epoll_item_ *next_in_group;
+    struct vfs_epoll_item_ *next_pending;
+} vfs_epoll_item_t;
+
+typedef struct {
+    struct esp_vfs_epoll *ep;
+    const esp_vfs_t *vfs;
+    int vfs_index;
+    bool is_socket;
+    bool started;                           // start_select was called, end_select wasn't
+    vfs_epoll_item_t *items;
+    int nfds;                               // one more than the largest fd of the group (local fd, unless is_socket)
+    fd_set req_readfds;                     // file descriptors waiting for each kind of event
+    fd_set req_writefds;
+    fd_set req_errorfds;
+    fd_set readfds;                         // copies of the above passed to start_select, the driver sets the ready ones
+    fd_set writefds;
+    fd_set errorfds;
+    void *end_select_args;
+} vfs_epoll_group_t;
+
+struct esp_vfs_epoll {
+    _lock_t lock;                           // protects everything but the members below
+    bool is_waiting;
+    vfs_epoll_group_t *groups[VFS_MAX_COUNT];
+    vfs_epoll_group_t *socket_group;
+    vfs_epoll_item_t *items[MAX_FDS];
+    vfs_epoll_item_t *pending_head;         // items with events to return, in the order the events occurred
+    vfs_epoll_item_t *pending_tail;
+    uint32_t rearm_mask;                    // groups stopped by esp_vfs_epoll_wait, by VFS index
+    SemaphoreHandle_t sem;                  // wakes up the waiting task when it isn't in socket_select
+    portMUX_TYPE spinlock;                  // protects the members below, which drivers access from ISRs
+    uint32_t ready_mask;                    // groups notified by their driver, by VFS index
+    void *socket_sem;                       // semaphore of the waiting task, while it is in socket_select
+    const esp_vfs_t *socket_vfs;
+};
+
+static void add_pending(struct esp_vfs_epoll *ep, vfs_epoll_item_t *item, uint32_t revents)
+{
+    revents &= item->events;
+    if (revents == 0) {
+        return;
+    }
+    item->revents |= revents;
+    if (!item->is_pending) {
+        item->is_pending = true;
+        item->next_pending = NULL;
+        if (ep->pending_tail) {
+            ep->pending_tail->next_pending = item;
+        } else {
+            ep->pending_head = item;
+        }
+        ep->pending_tail = item;
+    }
+}
+
+static void remove_pending(struct esp_vfs_epoll *ep, vfs_epoll_item_t *item)
+{
+    if (!item->is_pending) {
+        return;
+    }
+    vfs_epoll_item_t *prev = NULL;
+    for (vfs_epoll_item_t *it = ep->pending_head; it != item; it = it->next_pending) {
+        prev = it;
+    }
+    if (prev) {
+        prev->next_pending = item->next_pending;
+    } else {
+        ep->pending_head = item->next_pending;
+    }
+    if (ep->pending_tail == item) {
+        ep->pending_tail = prev;
+    }
+    item->is_pending = false;
+    item->revents = 0;
+}
+
+/* Adds the events of the file descriptors set in the given fd sets to the pending list */
+static void collect_events(struct esp_vfs_epoll *ep, vfs_epoll_group_t *group,
+                           const fd_set *readfds, const fd_set *writefds, const fd_set *errorfds)
+{
+    for (vfs_epoll_item_t *item = group->items; item != NULL; item = item->next_in_group) {
+        const int fd = group->is_socket ? item->fd : item->local_fd;
+        uint32_t revents = 0;
+        if (FD_ISSET(fd, readfds)) {
+            revents |= ESP_VFS_EPOLL_IN;
+        }
+        if (FD_ISSET(fd, writefds)) {
+            revents |= ESP_VFS_EPOLL_OUT;
+        }
+        if (FD_ISSET(fd, errorfds)) {
+            revents |= ESP_VFS_EPOLL_ERR;
+        }
+        add_pending(ep, item, revents);
+    }
+}
+
+static esp_err_t group_start(vfs_epoll_group_t *group)
+{
+    group->readfds = group->req_readfds;
+    group->writefds = group->req_writefds;
+    group->errorfds = group->req_errorfds;
+    esp_vfs_select_sem_t sem = {
+        .is_sem_local = false,
+        .sem = NULL,
+        .epoll = group,
+    };
+    esp_err_t err = group->vfs->start_select(group->nfds, &group->readfds, &group->writefds, &group->errorfds,
+                                             sem, &group->end_select_args);
+    if (err != ESP_OK) {
+        ESP_LOGD(TAG, "start_select failed for VFS ID %d: %s", group->vfs_index, esp_err_to_name(err));
+        return err;
+    }
+    group->started = true;
+    return ESP_OK;
+}
+
+/* Stops the select of the group and adds the ready file descriptors to the pending list */
+static void group_stop(struct esp_vfs_epoll *ep, vfs_epoll_group_t *group)
+{
+    if (!group->started) {
+        return;
+    }
+    group->started = false;
+    esp_err_t err = group->vfs->end_select(group->end_select_args);
+    if (err != ESP_OK) {
+        ESP_LOGD(TAG, "end_select failed for VFS ID %d: %s", group->vfs_index, esp_err_to_name(err));
+    }
+    collect_events(ep, group, &group->readfds, &group->writefds, &group->errorfds);
+}
+
+/* Updates the requested fd sets after the items of the group have changed, and re-arms the group */
+static esp_err_t group_update(struct esp_vfs_epoll *ep, vfs_epoll_group_t *group)
+{
+    FD_ZERO(&group->req_readfds);
+    FD_ZERO(&group->req_writefds);
+    FD_ZERO(&group->req_errorfds);
+    group->nfds = 0;
+    for (vfs_epoll_item_t *item = group->items; item != NULL; item = item->next_in_group) {
+        const int fd = group->is_socket ? item->fd : item->local_fd;
+        if (item->events & ESP_VFS_EPOLL_IN) {
+            FD_SET(fd, &group->req_readfds);
+        }
+        if (item->events & ESP_VFS_EPOLL_OUT) {
+            FD_SET(fd, &group->req_writefds);
+        }
+        if (item->events & ESP_VFS_EPOLL_ERR) {
+            FD_SET(fd, &group->req_errorfds);
+        }
+        group->nfds = MAX(group->nfds, fd + 1);
+    }
+    if (group->is_socket) {
+        return ESP_OK;
+    }
+    group_stop(ep, group);
+    return group->items ? group_start(group) : ESP_OK;
+}
+
+static vfs_epoll_group_t *get_group(struct esp_vfs_epoll *ep, int vfs_index, bool is_socket, esp_err_t *err)
+{
+    vfs_epoll_group_t *group = ep->groups[vfs_index];
+    if (group != NULL) {
+        return group;
+    }
+    const vfs_entry_t *entry = get_vfs_for_index(vfs_index);
+    if (entry == NULL) {
+        *err = ESP_ERR_INVALID_ARG;
+        return NULL;
+    }
+    const esp_vfs_t *vfs = &entry->vfs;
+    // notifications of the other groups must be able to interrupt socket_select, also from ISRs
+    if (is_socket ? (vfs->socket_select == NULL || vfs->get_socket_select_semaphore == NULL
+                     || vfs->stop_socket_select == NULL || vfs->stop_socket_select_isr == NULL)
+                  : (vfs->start_select == NULL || vfs->end_select == NULL)) {
+        *err = ESP_ERR_NOT_SUPPORTED;
+        return NULL;
+    }
+    group = calloc(1, sizeof(vfs_epoll_group_t));
+    if (group == NULL) {
+        *err = ESP_ERR_NO_MEM;
+        return NULL;
+    }
+    group->ep = ep;
+    group->vfs = vfs;
+    group->vfs_index = vfs_index;
+    group->is_socket = is_socket;
+    ep->groups[vfs_index] = group;
+    if (is_socket) {
+        ep->socket_group = group;
+    }
+    return group;
+}
+
+static void free_group_if_unused(struct esp_vfs_epoll *ep, vfs_epoll_group_t *group)
+{
+    if (group->items != NULL) {
+        return;
+    }
+    ep->groups[group->vfs_index] = NULL;
+    if (ep->socket_group == group) {
+        ep->socket_group = NULL;
+    }
+    free(group);
+}
+
+/* Makes the waiting task check the instance again */
+static void wake_waiting_task(struct esp_vfs_epoll *ep)
+{
+    portENTER_CRITICAL(&ep->spinlock);
+    void *socket_sem = ep->socket_sem;
+    const esp_vfs_t *socket_vfs = ep->socket_vfs;
+    portEXIT_CRITICAL(&ep->spinlock);
+    if (socket_sem) {
+        socket_vfs->stop_socket_select(socket_sem);
+    } else {
+        xSemaphoreGive(ep->sem);
+    }
+}
+
+void esp_vfs_epoll_triggered(void *registration, bool from_isr, BaseType_t *woken)
+{
+    vfs_epoll_group_t *group = (vfs_epoll_group_t *) registration;
+    struct esp_vfs_epoll *ep = group->ep;
+    if (!from_isr) {
+        portENTER_CRITICAL(&ep->spinlock);
+    } else {
+        portENTER_CRITICAL_ISR(&ep->spinlock);
+    }
+    ep->ready_mask |= 1u << group->vfs_index;
+    void *socket_sem = ep->socket_sem;
+    const esp_vfs_t *socket_vfs = ep->socket_vfs;
+    if (!from_isr) {
+        portEXIT_CRITICAL(&ep->spinlock);
+    } else {
+        portEXIT_CRITICAL_ISR(&ep->spinlock);
+    }
+
+    if (socket_sem) {
+        if (!from_isr) {
+            socket_vfs->stop_socket_select(socket_sem);
+        } else {
+            socket_vfs->stop_socket_select_isr(socket_sem, woken);
+        }
+    } else if (!from_isr) {
+        xSemaphoreGive(ep->sem);
+    } else {
+        xSemaphoreGiveFromISR(ep->sem, woken);
+    }
+}
+
+esp_err_t esp_vfs_epoll_create(esp_vfs_epoll_handle_t *out_handle)
+{
+    if (out_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    struct esp_vfs_epoll *ep = calloc(1, sizeof(struct esp_vfs_epoll));
+    if (ep == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    ep->sem = xSemaphoreCreateBinary();
+    if (ep->sem == NULL) {
+        free(ep);
+        return ESP_ERR_NO_MEM;
+    }
+    _lock_init(&ep->lock);
+    portMUX_INITIALIZE(&ep->spinlock);
+    *out_handle = ep;
+    return ESP_OK;
+}
+
+static esp_err_t epoll_add(struct esp_vfs_epoll *ep, int fd, const esp_vfs_epoll_event_t *event)
+{
+    int local_fd;
+    bool is_socket;
+    const int vfs_index = esp_vfs_get_fd_vfs_index(fd, &local_fd, &is_socket);
+    if (vfs_index < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = ESP_OK;
+    vfs_epoll_group_t *group = get_group(ep, vfs_index, is_socket, &err);
+    if (group == NULL) {
+        return err;
+    }
+    vfs_epoll_item_t *item = calloc(1, sizeof(vfs_epoll_item_t));
+    if (item == NULL) {
+        free_group_if_unused(ep, group);
+        return ESP_ERR_NO_MEM;
+    }
+    item->fd = fd;
+    item->local_fd = local_fd;
+    item->vfs_index = vfs_index;
+    item->events = event->events & EPOLL_EVENTS_ALL;
+    item->data = event->data;
+    item->next_in_group = group->items;
+    group->items = item;
+    ep->items[fd] = item;
+
+    err = group_update(ep, group);
+    if (err != ESP_OK) {
+        group->items = item->next_in_group;
+        ep->items[fd] = NULL;
+        remove_pending(ep, item);
+        free(item);
+        if (group_update(ep, group) != ESP_OK) {
+            ESP_LOGD(TAG, "cannot restart the select of VFS ID %d", vfs_index);
+        }
+        free_group_if_unused(ep, group);
+    }
+    return err;
+}
+
+static esp_err_t epoll_del(struct esp_vfs_epoll *ep, vfs_epoll_item_t *item)
+{
+    vfs_epoll_group_t *group = ep->groups[item->vfs_index];
+    vfs_epoll_item_t **it = &group->items;
+    while (*it != item) {
+        it = &(*it)->next_in_group;
+    }
+    *it = item->next_in_group;
+    ep->items[item->fd] = NULL;
+    remove_pending(ep, item);
+    free(item);
+    esp_err_t err = group_update(ep, group);
+    free_group_if_unused(ep, group);
+    return err;
+}
+
+esp_err_t esp_vfs_epoll_ctl(esp_vfs_epoll_handle_t handle, esp_vfs_epoll_ctl_op_t op, int fd, const esp_vfs_epoll_event_t *event)
+{
+    struct esp_vfs_epoll *ep = handle;
+    if (ep == NULL || fd < 0 || fd >= MAX_FDS || (op != ESP_VFS_EPOLL_CTL_DEL && event == NULL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    _lock_acquire(&ep->lock);
+    vfs_epoll_item_t *item = ep->items[fd];
+    esp_err_t err;
+    switch (op) {
+    case ESP_VFS_EPOLL_CTL_ADD:
+        err = item ? ESP_ERR_INVALID_STATE : epoll_add(ep, fd, event);
+        break;
+    case ESP_VFS_EPOLL_CTL_MOD:
+        if (item == NULL) {
+            err = ESP_ERR_INVALID_STATE;
+            break;
+        }
+        item->events = event->events & EPOLL_EVENTS_ALL;
+        item->data = event->data;
+        item->revents &= item->events;
+        if (item->revents == 0) {
+            remove_pending(ep, item);
+        }
+        err = group_update(ep, ep->groups[item->vfs_index]);
+        break;
+    case ESP_VFS_EPOLL_CTL_DEL:
+        err = item ? epoll_del(ep, item) : ESP_ERR_INVALID_STATE;
+        break;
+    default:
+        err = ESP_ERR_INVALID_ARG;
+        break;
+    }
+    _lock_release(&ep->lock);
+
+    if (err == ESP_OK) {
+        // the waiting task has to use the new fd sets
+        wake_waiting_task(ep);
+    }
+    return err;
+}
+
+/* Restarts the select of the groups stopped by collect_ready_groups */
+static void rearm_groups(struct esp_vfs_epoll *ep)
+{
+    uint32_t rearm_mask = ep->rearm_mask;
+    while (rearm_mask != 0) {
+        const int vfs_index = __builtin_ctz(rearm_mask);
+        rearm_mask &= rearm_mask - 1;
+        vfs_epoll_group_t *group = ep->groups[vfs_index];
+        if (group == NULL || group->started || group_start(group) == ESP_OK) {
+            ep->rearm_mask &= ~(1u << vfs_index);
+        } else {
+            // report the failure on the file descriptors waiting for errors, as select does, and retry next time
+            fd_set no_fds;
+            FD_ZERO(&no_fds);
+            collect_events(ep, group, &no_fds, &no_fds, &group->req_errorfds);
+        }
+    }
+}
+
+/* Gets the ready file descriptors of the groups notified by their driver */
+static void collect_ready_groups(struct esp_vfs_epoll *ep)
+{
+    portENTER_CRITICAL(&ep->spinlock);
+    uint32_t ready_mask = ep->ready_mask;
+    ep->ready_mask = 0;
+    portEXIT_CRITICAL(&ep->spinlock);
+
+    while (ready_mask != 0) {
+        const int vfs_index = __builtin_ctz(ready_mask);
+        ready_mask &= ready_mask - 1;
+        vfs_epoll_group_t *group = ep->groups[vfs_index];
+        if (group == NULL || !group->started) {
+            continue;   // notification from a select which was stopped already
+        }
+        group_stop(ep, group);
+        ep->rearm_mask |= 1u << vfs_index;
+    }
+}
+
+/* Calls socket_select for the socket group, without holding the lock. Returns the result of socket_select. */
+static int select_sockets(struct esp_vfs_epoll *ep, struct timeval *timeout)
+{
+    vfs_epoll_group_t *group = ep->socket_group;
+    const esp_vfs_t *vfs = group->vfs;
+    const int nfds = group->nfds;
+    fd_set readfds = group->req_readfds;
+    fd_set writefds = group->req_writefds;
+    fd_set errorfds = group->req_errorfds;
+
+    const bool blocking = timeout == NULL || timeout->tv_sec != 0 || timeout->tv_usec != 0;
+    if (blocking) {
+        // notifications from now on interrupt socket_select
+        void *socket_sem = vfs->get_socket_select_semaphore();
+        portENTER_CRITICAL(&ep->spinlock);
+        const bool is_ready = ep->ready_mask != 0;
+        if (!is_ready) {
+            ep->socket_sem = socket_sem;
+            ep->socket_vfs = vfs;
+        }
+        portEXIT_CRITICAL(&ep->spinlock);
+        if (is_ready) {
+            return 0;
+        }
+    }
+
+    _lock_release(&ep->lock);
+    const int ret = vfs->socket_select(nfds, &readfds, &writefds, &errorfds, timeout);
+    _lock_acquire(&ep->lock);
+
+    if (blocking) {
+        portENTER_CRITICAL(&ep->spinlock);
+        ep->socket_sem = NULL;
+        ep->socket_vfs = NULL;
+        portEXIT_CRITICAL(&ep->spinlock);
+    }
+    // the socket group may have been changed or removed by esp_vfs_epoll_ctl in the meantime
+    if (ret > 0 && ep->socket_group != NULL) {
+        collect_events(ep, ep->socket_group, &readfds, &writefds, &errorfds);
+    }
+    return ret;
+}
+
+esp_err_t esp_vfs_epoll_wait(esp_vfs_epoll_handle_t handle, esp_vfs_epoll_event_t *events, int max_events,
+                             int timeout_ms, int *out_count)
+{
+    struct esp_vfs_epoll *ep = handle;
+    if (ep == NULL || events == NULL || max_events <= 0 || out_count == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_count = 0;
+
+    _lock_acquire(&ep->lock);
+    if (ep->is_waiting) {
+        _lock_release(&ep->lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    ep->is_waiting = true;
+
+    // Like in select, round up the number of ticks and add 1, to wait for at least timeout_ms
+    TickType_t ticks_to_wait = portMAX_DELAY;
+    if (timeout_ms == 0) {
+        ticks_to_wait = 0;
+    } else if (timeout_ms > 0) {
+        ticks_to_wait = ((timeout_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS) + 1;
+    }
+    const TickType_t start_ticks = xTaskGetTickCount();
+    esp_err_t err = ESP_OK;
+    while (true) {
+        if (ep->pending_head == NULL) {
+            // events left over by the previous call are returned first, before taking new snapshots
+            rearm_groups(ep);
+        }
+        collect_ready_groups(ep);
+
+        TickType_t ticks_left = portMAX_DELAY;
+        if (ticks_to_wait != portMAX_DELAY) {
+            const TickType_t elapsed = xTaskGetTickCount() - start_ticks;
+            ticks_left = (elapsed < ticks_to_wait) ? ticks_to_wait - elapsed : 0;
+        }
+        if (ep->pending_head != NULL || ticks_left == 0) {
+            // no waiting, but poll the sockets so that they can't be starved by the other file descriptors
+            if (ep->socket_group != NULL) {
+                struct timeval no_timeout = { 0 };
+                if (select_sockets(ep, &no_timeout) < 0 && ep->pending_head == NULL) {
+                    err = ESP_FAIL;
+                }
+            }
+            break;
+        }
+
+        if (ep->socket_group != NULL) {
+            struct timeval timeout;
+            if (ticks_left != portMAX_DELAY) {
+                const uint32_t ms = ticks_left * portTICK_PERIOD_MS;
+                timeout.tv_sec = ms / 1000;
+                timeout.tv_usec = (ms % 1000) * 1000;
+            }
+            if (select_sockets(ep, (ticks_left != portMAX_DELAY) ? &timeout : NULL) < 0) {
+                err = ESP_FAIL;
+                break;
+            }
+        } else {
+            _lock_release(&ep->lock);
+            xSemaphoreTake(ep->sem, ticks_left);
+            _lock_acquire(&ep->lock);
+        }
+    }
+
+    int count = 0;
+    while (count < max_events && ep->pending_head != NULL) {
+        vfs_epoll_item_t *item = ep->pending_head;
+        events[count].events = item->revents;
+        events[count].fd = item->fd;
+        events[count].data = item->data;
+        ++count;
+        ep->pending_head = item->next_pending;
+        item->is_pending = false;
+        item->revents = 0;
+    }
+    if (ep->pending_head == NULL) {
+        ep->pending_tail = NULL;
+    }
+    ep->is_waiting = false;
+    _lock_release(&ep->lock);
+
+    *out_count = count;
+    if (err == ESP_OK && count == 0) {
+        err = ESP_ERR_TIMEOUT;
+    }
+    return (count > 0) ? ESP_OK : err;
+}
+
+esp_err_t esp_vfs_epoll_destroy(esp_vfs_epoll_handle_t handle)
+{
+    struct esp_vfs_epoll *ep = handle;
+    if (ep == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    _lock_acquire(&ep->lock);
+    if (ep->is_waiting) {
+        _lock_release(&ep->lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (int i = 0; i < VFS_MAX_COUNT; ++i) {
+        vfs_epoll_group_t *group = ep->groups[i];
+        if (group == NULL) {
+            continue;
+        }
+        group_stop(ep, group);
+        while (group->items != NULL) {
+            vfs_epoll_item_t *item = group->items;
+            group->items = item->next_in_group;
+            free(item);
+        }
+        free(group);
+    }
+    _lock_release(&ep->lock);
+    _lock_close(&ep->lock);
+    vSemaphoreDelete(ep->sem);
+    free(ep);
+    return ESP_OK;
+}
+
+#endif // CONFIG_VFS_SUPPORT_SELECT
@@ -189,15 +189,9 @@ static int uart_rx_char_via_driver(int fd)
     return c;
 }
 
-static ssize_t uart_write(int fd, const void * data, size_t size)
+// Sends the data, converting line endings. Must be called with write_lock held.
+static void uart_tx_data(int fd, const char *data_c, size_t size)
 {
-    assert(fd >=0 && fd < 3);
-    const char *data_c = (const char *)data;
-    /*  Even though newlib does stream locking on each individual stream, we need
-     *  a dedicated UART lock if two streams (stdout and stderr) point to the
-     *  same UART.
-     */
-    _lock_acquire_recursive(&s_ctx[fd]->write_lock);
     for (size_t i = 0; i < size; i++) {
         int c = data_c[i];
         if (c == '\n' && s_ctx[fd]->tx_mode != ESP_LINE_ENDINGS_LF) {
@@ -208,6 +202,31 @@ static ssize_t uart_write(int fd, const void * data, size_t size)
         }
         s_ctx[fd]->tx_func(fd, c);
     }
+}
+
+static ssize_t uart_write(int fd, const void * data, size_t size)
+{
+    assert(fd >=0 && fd < 3);
+    /*  Even though newlib does stream locking on each individual stream, we need
+     *  a dedicated UART lock if two streams (stdout and stderr) point to the
+     *  same UART.
+     */
+    _lock_acquire_recursive(&s_ctx[fd]->write_lock);
+    uart_tx_data(fd, (const char *)data, size);
+    _lock_release_recursive(&s_ctx[fd]->write_lock);
+    return size;
+}
+
+static ssize_t uart_writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    assert(fd >=0 && fd < 3);
+    // Holding the lock for all the buffers keeps them together in the output
+    _lock_acquire_recursive(&s_ctx[fd]->write_lock);
+    ssize_t size = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        uart_tx_data(fd, (const char *)iov[i].iov_base, iov[i].iov_len);
+        size += iov[i].iov_len;
+    }
     _lock_release_recursive(&s_ctx[fd]->write_lock);
     return size;
 }
@@ -495,8 +514,11 @@ static esp_err_t uart_end_select(void *end_select_args)
 
     portENTER_CRITICAL(uart_get_selectlock());
     esp_err_t ret = unregister_select(args);
-    for (int i = 0; i < UART_NUM; ++i) {
-        uart_set_select_notif_callback(i, NULL);
+    // other selects (e.g. the persistent ones of epoll instances) may still need the callbacks
+    if (s_registered_select_num == 0) {
+        for (int i = 0; i < UART_NUM; ++i) {
+            uart_set_select_notif_callback(i, NULL);
+        }
     }
     portEXIT_CRITICAL(uart_get_selectlock());
 
@@ -970,6 +992,7 @@ static const esp_vfs_t vfs = {
     .read = &uart_read,
     .fcntl = &uart_fcntl,
     .fsync = &uart_fsync,
+    .writev = &uart_writev,
 #ifdef CONFIG_VFS_SUPPORT_DIR
     .access = &uart_access,
 #endif // CONFIG_VFS_SUPPORT_DIR
@@ -79,23 +79,37 @@ esp_err_t WL_Ext_Perf::erase_sector_fit(uint32_t start_sector, uint32_t count)
     esp_err_t result = ESP_OK;
 
     uint32_t pre_check_start = start_sector % this->size_factor;
+    size_t flash_sector_addr = start_sector / this->size_factor * this->flash_sector_size;
 
-
-    for (int i = 0; i < this->size_factor; i++) {
-        if ((i < pre_check_start) || (i >= count + pre_check_start)) {
-            result = this->read(start_sector / this->size_factor * this->flash_sector_size + i * this->fat_sector_size, &this->sector_buffer[i * this->fat_sector_size / sizeof(uint32_t)], this->fat_sector_size);
-            WL_EXT_RESULT_CHECK(result);
-        }
-    }
+    result = this->copy_kept(flash_sector_addr, pre_check_start, count, false);
+    WL_EXT_RESULT_CHECK(result);
 
     result = WL_Flash::erase_sector(start_sector / this->size_factor); // erase comlete flash sector
     WL_EXT_RESULT_CHECK(result);
     // And write back only data that should not be erased...
-    for (int i = 0; i < this->size_factor; i++) {
-        if ((i < pre_check_start) || (i >= count + pre_check_start)) {
-            result = this->write(start_sector / this->size_factor * this->flash_sector_size + i * this->fat_sector_size, &this->sector_buffer[i * this->fat_sector_size / sizeof(uint32_t)], this->fat_sector_size);
-            WL_EXT_RESULT_CHECK(result);
+    result = this->copy_kept(flash_sector_addr, pre_check_start, count, true);
+    WL_EXT_RESULT_CHECK(result);
+    return ESP_OK;
+}
+
+esp_err_t WL_Ext_Perf::copy_kept(size_t flash_sector_addr, uint32_t erase_start, uint32_t erase_count, bool write_back)
+{
+    // The fatfs sectors to keep are the ones before and after the erased ones, each part is copied at once
+    esp_err_t result = ESP_OK;
+    uint32_t erase_end = erase_start + erase_count;
+    uint32_t parts[2][2] = {{0, erase_start}, {erase_end, this->size_factor}};
+    for (int i = 0; i < 2; i++) {
+        if (parts[i][0] >= parts[i][1]) {
+            continue;
+        }
+        size_t offset = parts[i][0] * this->fat_sector_size;
+        size_t size = (parts[i][1] - parts[i][0]) * this->fat_sector_size;
+        if (write_back) {
+            result = WL_Flash::write(flash_sector_addr + offset, &this->sector_buffer[offset / sizeof(uint32_t)], size);
+        } else {
+            result = WL_Flash::read(flash_sector_addr + offset, &this->sector_buffer[offset / sizeof(uint32_t)], size);
         }
+        WL_EXT_RESULT_CHECK(result);
     }
     return ESP_OK;
 }
@@ -153,12 +167,9 @@ esp_err_t WL_Ext_Perf::erase_range(size_t start_address, size_t size)
     }
     ESP_LOGV(TAG, "%s rest_check_start = %i, pre_check_count=%i, rest_check_count=%i, post_check_count=%i\n", __func__, rest_check_start, pre_check_count, rest_check_count, post_check_count);
     if (rest_check_count > 0) {
-        rest_check_count = rest_check_count / this->size_factor;
-        size_t start_sector = rest_check_start / this->flash_sector_size;
-        for (size_t i = 0; i < rest_check_count; i++) {
-            result = WL_Flash::erase_sector(start_sector + i);
-            WL_EXT_RESULT_CHECK(result);
-        }
+        // Whole flash sectors are erased directly, without reading anything back
+        result = WL_Flash::erase_range(rest_check_start, rest_check_count * this->fat_sector_size);
+        WL_EXT_RESULT_CHECK(result);
     }
     if (post_check_count != 0) {
         result = this->erase_sector_fit(post_check_start, post_check_count);
@@ -13,6 +13,9 @@
 
 #include "WL_Ext_Safe.h"
 #include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include "crc32.h"
 #include "esp_log.h"
 
 static const char *TAG = "wl_ext_safe";
@@ -36,6 +39,15 @@ static const char *TAG = "wl_ext_safe";
 #define WL_EXT_SAFE_OFFSET 16
 #endif // WL_EXT_SAFE_OFFSET
 
+// Marks a transaction in the journal, different from WL_EXT_SAFE_OK so that
+// older versions, which only look at the first slot, don't replay it
+#ifndef WL_EXT_SAFE_JOURNAL
+#define WL_EXT_SAFE_JOURNAL 0x4a4c5357
+#endif // WL_EXT_SAFE_JOURNAL
+
+#ifndef WL_EXT_SAFE_DONE
+#define WL_EXT_SAFE_DONE 0x454e4f44
+#endif // WL_EXT_SAFE_DONE
 
 struct WL_Ext_Safe_State {
 public:
@@ -45,6 +57,22 @@ public:
     uint32_t count;
 };
 
+// The state sector is a journal of slots, one per transaction. A slot is marked as done
+// once the transaction completes, so the sector only has to be erased when all slots are used.
+// The parts of a slot written separately are multiples of the flash encryption unit.
+struct WL_Ext_Safe_Slot {
+public:
+    WL_Ext_Safe_State state;
+    uint32_t crc;           // CRC of state, a torn slot is not replayed
+    uint32_t reserved[3];
+    uint32_t done[4];       // WL_EXT_SAFE_DONE once the transaction completed
+    uint32_t reserved2[4];
+};
+
+static_assert(sizeof(WL_Ext_Safe_State) == 16, "Size of WL_Ext_Safe_State structure should be compatible with flash encryption");
+static_assert(offsetof(WL_Ext_Safe_Slot, done) % 16 == 0, "Parts of WL_Ext_Safe_Slot should be compatible with flash encryption");
+static_assert(sizeof(WL_Ext_Safe_Slot) == 64, "Flash sector must hold a whole number of slots");
+
 WL_Ext_Safe::WL_Ext_Safe(): WL_Ext_Perf()
 {
 }
@@ -86,33 +114,72 @@ esp_err_t WL_Ext_Safe::recover()
 {
     esp_err_t result = ESP_OK;
 
-    WL_Ext_Safe_State state;
-    result = WL_Flash::read(this->state_addr, &state, sizeof(WL_Ext_Safe_State));
-    WL_EXT_RESULT_CHECK(result);
-    ESP_LOGV(TAG, "%s recover, start_addr = 0x%08x, local_addr_base = 0x%08x, local_addr_shift = %i, count=%i", __func__, state.erase_begin, state.local_addr_base, state.local_addr_shift, state.count);
+    WL_Ext_Safe_Slot slot;
+    uint32_t slot_count = this->flash_sector_size / sizeof(WL_Ext_Safe_Slot);
+    bool pending = false;
+    bool legacy = false;
+    WL_Ext_Safe_State state = {};
 
-    // check if we have transaction
-    if (state.erase_begin == WL_EXT_SAFE_OK) {
+    // Find the first free slot, and the last transaction before it
+    this->journal_pos = slot_count;
+    for (uint32_t i = 0; i < slot_count; i++) {
+        result = WL_Flash::read(this->state_addr + i * sizeof(WL_Ext_Safe_Slot), &slot, sizeof(WL_Ext_Safe_Slot));
+        WL_EXT_RESULT_CHECK(result);
+        if (i == 0 && slot.state.erase_begin == WL_EXT_SAFE_OK) {
+            // A transaction stored by an older version, which erased the sector once done
+            state = slot.state;
+            pending = true;
+            legacy = true;
+            break;
+        }
+        bool erased = true;
+        for (size_t k = 0; k < sizeof(WL_Ext_Safe_Slot) / sizeof(uint32_t); k++) {
+            erased &= ((uint32_t *)&slot)[k] == FLASH_ERASE_VALUE;
+        }
+        if (erased) {
+            this->journal_pos = i;
+            break;
+        }
+        // A slot torn while it was written is skipped, its transaction had not started erasing yet
+        state = slot.state;
+        pending = slot.state.erase_begin == WL_EXT_SAFE_JOURNAL
+                  && slot.crc == crc32::crc32_le(WL_EXT_SAFE_JOURNAL, (const unsigned char *)&slot.state, sizeof(WL_Ext_Safe_State))
+                  && slot.done[0] != WL_EXT_SAFE_DONE;
+    }
+    ESP_LOGV(TAG, "%s recover, journal_pos = %i, pending = %i, start_addr = 0x%08x, local_addr_base = 0x%08x, local_addr_shift = %i, count=%i", __func__,
+             this->journal_pos, pending, state.erase_begin, state.local_addr_base, state.local_addr_shift, state.count);
 
-        result = this->read(this->dump_addr, this->sector_buffer, this->flash_sector_size);
+    // check if we have transaction
+    if (pending) {
+        result = WL_Flash::read(this->dump_addr, this->sector_buffer, this->flash_sector_size);
         WL_EXT_RESULT_CHECK(result);
 
         result = WL_Flash::erase_sector(state.local_addr_base); // erase comlete flash sector
         WL_EXT_RESULT_CHECK(result);
 
         // And write back...
-        for (int i = 0; i < this->size_factor; i++) {
-            if ((i < state.local_addr_shift) || (i >= state.count + state.local_addr_shift)) {
-                result = this->write(state.local_addr_base * this->flash_sector_size + i * this->fat_sector_size, &this->sector_buffer[i * this->fat_sector_size / sizeof(uint32_t)], this->fat_sector_size);
-                WL_EXT_RESULT_CHECK(result);
-            }
-        }
+        result = this->copy_kept(state.local_addr_base * this->flash_sector_size, state.local_addr_shift, state.count, true);
+        WL_EXT_RESULT_CHECK(result);
         // clear transaction
-        result = WL_Flash::erase_range(this->state_addr, this->flash_sector_size);
+        if (legacy) {
+            result = WL_Flash::erase_range(this->state_addr, this->flash_sector_size);
+            this->journal_pos = 0;
+        } else {
+            result = this->journal_done(this->journal_pos - 1);
+        }
     }
     return result;
 }
 
+esp_err_t WL_Ext_Safe::journal_done(uint32_t pos)
+{
+    WL_Ext_Safe_Slot slot;
+    for (size_t k = 0; k < sizeof(slot.done) / sizeof(uint32_t); k++) {
+        slot.done[k] = WL_EXT_SAFE_DONE;
+    }
+    return WL_Flash::write(this->state_addr + pos * sizeof(WL_Ext_Safe_Slot) + offsetof(WL_Ext_Safe_Slot, done), slot.done, sizeof(slot.done));
+}
+
 esp_err_t WL_Ext_Safe::erase_sector_fit(uint32_t start_sector, uint32_t count)
 {
     esp_err_t result = ESP_OK;
@@ -120,41 +187,41 @@ esp_err_t WL_Ext_Safe::erase_sector_fit(uint32_t start_sector, uint32_t count)
     uint32_t local_addr_base = start_sector / this->size_factor;
     uint32_t pre_check_start = start_sector % this->size_factor;
     ESP_LOGV(TAG, "%s start_sector=0x%08x, count = %i", __func__, start_sector, count);
-    for (int i = 0; i < this->size_factor; i++) {
-        if ((i < pre_check_start) || (i >= count + pre_check_start)) {
-            result = this->read(start_sector / this->size_factor * this->flash_sector_size + i * this->fat_sector_size, &this->sector_buffer[i * this->fat_sector_size / sizeof(uint32_t)], this->fat_sector_size);
-            WL_EXT_RESULT_CHECK(result);
-        }
-    }
+    result = this->copy_kept(local_addr_base * this->flash_sector_size, pre_check_start, count, false);
+    WL_EXT_RESULT_CHECK(result);
 
     result = WL_Flash::erase_sector(this->dump_addr / this->flash_sector_size);
     WL_EXT_RESULT_CHECK(result);
     result = WL_Flash::write(this->dump_addr, this->sector_buffer, this->flash_sector_size);
     WL_EXT_RESULT_CHECK(result);
 
-    WL_Ext_Safe_State state;
-    state.erase_begin = WL_EXT_SAFE_OK;
-    state.local_addr_base = local_addr_base;
-    state.local_addr_shift = pre_check_start;
-    state.count = count;
+    // The state sector is only erased once all its slots are used
+    if (this->journal_pos >= this->flash_sector_size / sizeof(WL_Ext_Safe_Slot)) {
+        result = WL_Flash::erase_sector(this->state_addr / this->flash_sector_size);
+        WL_EXT_RESULT_CHECK(result);
+        this->journal_pos = 0;
+    }
 
-    result = WL_Flash::erase_sector(this->state_addr / this->flash_sector_size);
-    WL_EXT_RESULT_CHECK(result);
-    result = WL_Flash::write(this->state_addr + 0, &state, sizeof(WL_Ext_Safe_State));
+    WL_Ext_Safe_Slot slot;
+    slot.state.erase_begin = WL_EXT_SAFE_JOURNAL;
+    slot.state.local_addr_base = local_addr_base;
+    slot.state.local_addr_shift = pre_check_start;
+    slot.state.count = count;
+    slot.crc = crc32::crc32_le(WL_EXT_SAFE_JOURNAL, (const unsigned char *)&slot.state, sizeof(WL_Ext_Safe_State));
+    memset(slot.reserved, 0xff, sizeof(slot.reserved));
+
+    uint32_t pos = this->journal_pos++;
+    result = WL_Flash::write(this->state_addr + pos * sizeof(WL_Ext_Safe_Slot), &slot, offsetof(WL_Ext_Safe_Slot, done));
     WL_EXT_RESULT_CHECK(result);
 
     // Erase
     result = WL_Flash::erase_sector(local_addr_base); // erase comlete flash sector
     WL_EXT_RESULT_CHECK(result);
     // And write back...
-    for (int i = 0; i < this->size_factor; i++) {
-        if ((i < pre_check_start) || (i >= count + pre_check_start)) {
-            result = this->write(local_addr_base * this->flash_sector_size + i * this->fat_sector_size, &this->sector_buffer[i * this->fat_sector_size / sizeof(uint32_t)], this->fat_sector_size);
-            WL_EXT_RESULT_CHECK(result);
-        }
-    }
+    result = this->copy_kept(local_addr_base * this->flash_sector_size, pre_check_start, count, true);
+    WL_EXT_RESULT_CHECK(result);
 
-    result = WL_Flash::erase_sector(this->state_addr / this->flash_sector_size);
+    result = this->journal_done(pos);
     WL_EXT_RESULT_CHECK(result);
 
     return ESP_OK;
@@ -425,15 +425,25 @@ bool WL_Flash::OkBuffSet(int n)
 }
 
 
-esp_err_t WL_Flash::updateWL()
+esp_err_t WL_Flash::updateWL(uint32_t access_count)
 {
-    esp_err_t result = ESP_OK;
-    this->state.access_count++;
-    if (this->state.access_count < this->state.max_count) {
-        return result;
+    this->state.access_count += access_count;
+    // A range erase counts one access per sector, so it can be due more than one move
+    while (this->state.access_count >= this->state.max_count) {
+        esp_err_t result = this->moveDummy();
+        if (result != ESP_OK) {
+            // The failed move and the ones still due after it are tried again with the next access
+            return result;
+        }
+        this->state.access_count -= this->state.max_count;
     }
-    // Here we have to move the block and increase the state
-    this->state.access_count = 0;
+    return ESP_OK;
+}
+
+esp_err_t WL_Flash::moveDummy()
+{
+    esp_err_t result = ESP_OK;
+    // Here we have to move the block and increase the state.
     ESP_LOGV(TAG, "%s - access_count= 0x%08x, pos= 0x%08x", __func__, this->state.access_count, this->state.pos);
     // copy data to dummy block
     size_t data_addr = this->state.pos + 1; // next block, [pos+1] copy to [pos]
@@ -445,7 +455,6 @@ esp_err_t WL_Flash::updateWL()
     result = this->flash_drv->erase_range(this->dummy_addr, this->cfg.page_size);
     if (result != ESP_OK) {
         ESP_LOGE(TAG, "%s - erase wl dummy sector result= 0x%08x", __func__, result);
-        this->state.access_count = this->state.max_count - 1; // we will update next time
         return result;
     }
 
@@ -454,13 +463,11 @@ esp_err_t WL_Flash::updateWL()
         result = this->flash_drv->read(data_addr + i * this->cfg.temp_buff_size, this->temp_buff, this->cfg.temp_buff_size);
         if (result != ESP_OK) {
             ESP_LOGE(TAG, "%s - not possible to read buffer, will try next time, result= 0x%08x", __func__, result);
-            this->state.access_count = this->state.max_count - 1; // we will update next time
             return result;
         }
         result = this->flash_drv->write(this->dummy_addr + i * this->cfg.temp_buff_size, this->temp_buff, this->cfg.temp_buff_size);
         if (result != ESP_OK) {
             ESP_LOGE(TAG, "%s - not possible to write buffer, will try next time, result= 0x%08x", __func__, result);
-            this->state.access_count = this->state.max_count - 1; // we will update next time
             return result;
         }
     }
@@ -473,14 +480,12 @@ esp_err_t WL_Flash::updateWL()
     result |= this->flash_drv->write(this->addr_state1 + sizeof(wl_state_t) + byte_pos, this->temp_buff, this->cfg.wr_size);
     if (result != ESP_OK) {
         ESP_LOGE(TAG, "%s - update position 1 result= 0x%08x", __func__, result);
-        this->state.access_count = this->state.max_count - 1; // we will update next time
         return result;
     }
     this->fillOkBuff(this->state.pos);
     result |= this->flash_drv->write(this->addr_state2 + sizeof(wl_state_t) + byte_pos, this->temp_buff, this->cfg.wr_size);
     if (result != ESP_OK) {
         ESP_LOGE(TAG, "%s - update position 2 result= 0x%08x", __func__, result);
-        this->state.access_count = this->state.max_count - 1; // we will update next time
         return result;
     }
 
@@ -526,6 +531,24 @@ size_t WL_Flash::calcAddr(size_t addr)
     return result;
 }
 
+size_t WL_Flash::calcExtent(size_t addr, size_t size, size_t *len)
+{
+    // Logical addresses map to physical ones linearly, except where the rotation by move_count
+    // wraps around and where the dummy sector is skipped, so a request splits into at most three runs
+    size_t rotated = (this->flash_size - this->state.move_count * this->cfg.page_size + addr) % this->flash_size;
+    size_t dummy_addr = this->state.pos * this->cfg.page_size;
+    size_t result = rotated;
+    size_t contiguous;
+    if (rotated < dummy_addr) {
+        contiguous = dummy_addr - rotated;
+    } else {
+        result += this->cfg.page_size;
+        contiguous = this->flash_size - rotated;
+    }
+    *len = size < contiguous ? size : contiguous;
+    ESP_LOGV(TAG, "%s - addr= 0x%08x -> result= 0x%08x, len= 0x%08x", __func__, (uint32_t) addr, (uint32_t) result, (uint32_t) *len);
+    return result;
+}
 
 size_t WL_Flash::chip_size()
 {
@@ -550,7 +573,7 @@ esp_err_t WL_Flash::erase_sector(size_t sector)
         return ESP_ERR_INVALID_STATE;
     }
     ESP_LOGD(TAG, "%s - sector= 0x%08x", __func__, (uint32_t) sector);
-    result = this->updateWL();
+    result = this->updateWL(1);
     WL_RESULT_CHECK(result);
     size_t virt_addr = this->calcAddr(sector * this->cfg.sector_size);
     result = this->flash_drv->erase_sector((this->cfg.start_addr + virt_addr) / this->cfg.sector_size);
@@ -565,10 +588,18 @@ esp_err_t WL_Flash::erase_range(size_t start_address, size_t size)
     }
     ESP_LOGD(TAG, "%s - start_address= 0x%08x, size= 0x%08x", __func__, (uint32_t) start_address, (uint32_t) size);
     size_t erase_count = (size + this->cfg.sector_size - 1) / this->cfg.sector_size;
-    size_t start_sector = start_address / this->cfg.sector_size;
-    for (size_t i = 0; i < erase_count; i++) {
-        result = this->erase_sector(start_sector + i);
+    start_address = start_address / this->cfg.sector_size * this->cfg.sector_size;
+    size = erase_count * this->cfg.sector_size;
+    // Every sector counts as an access, and sectors which are contiguous in flash are erased with a single operation
+    result = this->updateWL(erase_count);
+    WL_RESULT_CHECK(result);
+    size_t done = 0;
+    while (done < size) {
+        size_t len;
+        size_t virt_addr = this->calcExtent(start_address + done, size - done, &len);
+        result = this->flash_drv->erase_range(this->cfg.start_addr + virt_addr, len);
         WL_RESULT_CHECK(result);
+        done += len;
     }
     ESP_LOGV(TAG, "%s - result= 0x%08x", __func__, result);
     return result;
@@ -581,15 +612,16 @@ esp_err_t WL_Flash::write(size_t dest_addr, const void *src, size_t size)
         return ESP_ERR_INVALID_STATE;
     }
     ESP_LOGD(TAG, "%s - dest_addr= 0x%08x, size= 0x%08x", __func__, (uint32_t) dest_addr, (uint32_t) size);
-    uint32_t count = (size - 1) / this->cfg.page_size;
-    for (size_t i = 0; i < count; i++) {
-        size_t virt_addr = this->calcAddr(dest_addr + i * this->cfg.page_size);
-        result = this->flash_drv->write(this->cfg.start_addr + virt_addr, &((uint8_t *)src)[i * this->cfg.page_size], this->cfg.page_size);
+    this->stats.write_count++;
+    size_t done = 0;
+    while (done < size) {
+        size_t len;
+        size_t virt_addr = this->calcExtent(dest_addr + done, size - done, &len);
+        this->stats.write_ops++;
+        result = this->flash_drv->write(this->cfg.start_addr + virt_addr, &((uint8_t *)src)[done], len);
         WL_RESULT_CHECK(result);
+        done += len;
     }
-    size_t virt_addr_last = this->calcAddr(dest_addr + count * this->cfg.page_size);
-    result = this->flash_drv->write(this->cfg.start_addr + virt_addr_last, &((uint8_t *)src)[count * this->cfg.page_size], size - count * this->cfg.page_size);
-    WL_RESULT_CHECK(result);
     return result;
 }
 
@@ -600,19 +632,25 @@ esp_err_t WL_Flash::read(size_t src_addr, void *dest, size_t size)
         return ESP_ERR_INVALID_STATE;
     }
     ESP_LOGD(TAG, "%s - src_addr= 0x%08x, size= 0x%08x", __func__, (uint32_t) src_addr, (uint32_t) size);
-    uint32_t count = (size - 1) / this->cfg.page_size;
-    for (size_t i = 0; i < count; i++) {
-        size_t virt_addr = this->calcAddr(src_addr + i * this->cfg.page_size);
-        ESP_LOGV(TAG, "%s - real_addr= 0x%08x, size= 0x%08x", __func__, (uint32_t) (this->cfg.start_addr + virt_addr), (uint32_t) size);
-        result = this->flash_drv->read(this->cfg.start_addr + virt_addr, &((uint8_t *)dest)[i * this->cfg.page_size], this->cfg.page_size);
+    this->stats.read_count++;
+    size_t done = 0;
+    while (done < size) {
+        size_t len;
+        size_t virt_addr = this->calcExtent(src_addr + done, size - done, &len);
+        ESP_LOGV(TAG, "%s - real_addr= 0x%08x, size= 0x%08x", __func__, (uint32_t) (this->cfg.start_addr + virt_addr), (uint32_t) len);
+        this->stats.read_ops++;
+        result = this->flash_drv->read(this->cfg.start_addr + virt_addr, &((uint8_t *)dest)[done], len);
         WL_RESULT_CHECK(result);
+        done += len;
     }
-    size_t virt_addr_last = this->calcAddr(src_addr + count * this->cfg.page_size);
-    result = this->flash_drv->read(this->cfg.start_addr + virt_addr_last, &((uint8_t *)dest)[count * this->cfg.page_size], size - count * this->cfg.page_size);
-    WL_RESULT_CHECK(result);
     return result;
 }
 
+void WL_Flash::get_stats(wl_stats_t *stats)
+{
+    *stats = this->stats;
+}
+
 Flash_Access *WL_Flash::get_drv()
 {
     return this->flash_drv;
@@ -625,8 +663,11 @@ wl_config_t *WL_Flash::get_cfg()
 esp_err_t WL_Flash::flush()
 {
     esp_err_t result = ESP_OK;
-    this->state.access_count = this->state.max_count - 1;
-    result = this->updateWL();
+    // Force a move, without dropping the ones which may still be due after a failure
+    if (this->state.access_count < this->state.max_count - 1) {
+        this->state.access_count = this->state.max_count - 1;
+    }
+    result = this->updateWL(1);
     ESP_LOGD(TAG, "%s - result= 0x%08x, move_count= 0x%08x", __func__, result, this->state.move_count);
     return result;
 }
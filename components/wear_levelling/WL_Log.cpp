@@ -0,0 +1,371 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <stddef.h>
+#include "esp_log.h"
+#include "WL_Log.h"
+#include "crc32.h"
+
+static const char *TAG = "wl_log";
+
+#define WL_LOG_MAGIC        0x474f4c57 // "WLOG"
+#define WL_LOG_CRC_CONST    UINT32_MAX
+#define WL_LOG_ERASED       UINT32_MAX
+// Size of the buffers on stack used to write the start and the end of a record, and to check CRCs
+#define WL_LOG_BUFF_SIZE    64
+#define WL_LOG_MAX_WR_SIZE  32
+
+#define WL_RESULT_CHECK(result) \
+    if (result != ESP_OK) { \
+        ESP_LOGE(TAG,"%s(%d): result = 0x%08x", __FUNCTION__, __LINE__, result); \
+        return (result); \
+    }
+
+static_assert(WL_LOG_BUFF_SIZE % WL_LOG_MAX_WR_SIZE == 0, "buffer must hold a whole number of write units");
+
+WL_Log::WL_Log()
+{
+}
+
+WL_Log::~WL_Log()
+{
+}
+
+esp_err_t WL_Log::config(Flash_Access *flash_drv, size_t start_addr, size_t size, size_t wr_size)
+{
+    ESP_LOGV(TAG, "%s start_addr=0x%08x, size=0x%08x, wr_size=0x%08x", __func__,
+             (uint32_t) start_addr, (uint32_t) size, (uint32_t) wr_size);
+
+    this->configured = false;
+    this->initialized = false;
+    if (flash_drv == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    this->flash_drv = flash_drv;
+    this->sector_size = flash_drv->sector_size();
+    if (wr_size < sizeof(wl_log_record_header_t) || wr_size > WL_LOG_MAX_WR_SIZE || (wr_size & (wr_size - 1)) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if ((start_addr % this->sector_size) != 0 || (size % this->sector_size) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // The head sector is never released, so at least one more is needed to keep records around
+    if (size < 2 * this->sector_size || start_addr + size > flash_drv->chip_size()) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    this->start_addr = start_addr;
+    this->sector_count = size / this->sector_size;
+    this->wr_size = wr_size;
+    this->configured = true;
+    return ESP_OK;
+}
+
+esp_err_t WL_Log::init()
+{
+    esp_err_t result = ESP_OK;
+    if (this->configured == false) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    this->initialized = false;
+    this->empty = true;
+    this->head_closed = true;
+    this->head_sector = 0;
+    this->head_seq = 0;
+    this->tail_seq = 1;
+    this->write_offset = this->sector_size;
+
+    // The sector with the highest sequence number is the head of the log
+    wl_log_sector_header_t header;
+    bool valid;
+    for (uint32_t i = 0; i < this->sector_count; i++) {
+        result = this->readSectorHeader(i, &header, &valid);
+        WL_RESULT_CHECK(result);
+        if (valid && (this->empty || header.seq > this->head_seq)) {
+            this->empty = false;
+            this->head_sector = i;
+            this->head_seq = header.seq;
+        }
+    }
+
+    if (this->empty == false) {
+        // Sectors before the head are part of the log as long as their sequence numbers follow each other.
+        // The walk stops at a sector released by the reader, or at the one erased for a new head.
+        this->tail_seq = this->head_seq;
+        for (uint32_t i = 1; i < this->sector_count; i++) {
+            uint32_t sector = (this->head_sector + this->sector_count - i) % this->sector_count;
+            result = this->readSectorHeader(sector, &header, &valid);
+            WL_RESULT_CHECK(result);
+            if (!valid || header.seq != this->head_seq - i) {
+                break;
+            }
+            this->tail_seq = header.seq;
+        }
+        result = this->scanHead();
+        WL_RESULT_CHECK(result);
+    }
+
+    ESP_LOGD(TAG, "%s head_sector=%i, head_seq=%u, tail_seq=%u, write_offset=0x%08x, head_closed=%i", __func__,
+             this->head_sector, this->head_seq, this->tail_seq, (uint32_t) this->write_offset, this->head_closed);
+    this->initialized = true;
+    return ESP_OK;
+}
+
+size_t WL_Log::sectorAddr(uint32_t seq)
+{
+    uint32_t sector = (this->head_sector + this->sector_count - (this->head_seq - seq) % this->sector_count) % this->sector_count;
+    return this->start_addr + sector * this->sector_size;
+}
+
+size_t WL_Log::recordSize(size_t data_size)
+{
+    return (sizeof(wl_log_record_header_t) + data_size + this->wr_size - 1) & ~(this->wr_size - 1);
+}
+
+size_t WL_Log::max_record_size()
+{
+    return this->sector_size - this->recordSize(sizeof(wl_log_sector_header_t) - sizeof(wl_log_record_header_t)) - sizeof(wl_log_record_header_t);
+}
+
+esp_err_t WL_Log::readSectorHeader(uint32_t sector, wl_log_sector_header_t *header, bool *valid)
+{
+    esp_err_t result = this->flash_drv->read(this->start_addr + sector * this->sector_size, header, sizeof(wl_log_sector_header_t));
+    WL_RESULT_CHECK(result);
+    *valid = header->magic == WL_LOG_MAGIC
+             && header->crc == crc32::crc32_le(WL_LOG_CRC_CONST, (const unsigned char *)header, offsetof(wl_log_sector_header_t, crc));
+    return ESP_OK;
+}
+
+esp_err_t WL_Log::checkRecord(size_t addr, size_t max_size, const wl_log_record_header_t &header, void *dest, bool *valid)
+{
+    esp_err_t result = ESP_OK;
+    *valid = false;
+    if (header.size > max_size) {
+        return ESP_OK;
+    }
+    uint32_t crc = crc32::crc32_le(WL_LOG_CRC_CONST, (const unsigned char *)&header.size, sizeof(header.size));
+    size_t data_addr = addr + sizeof(wl_log_record_header_t);
+    if (dest != NULL) {
+        result = this->flash_drv->read(data_addr, dest, header.size);
+        WL_RESULT_CHECK(result);
+        crc = crc32::crc32_le(crc, (const unsigned char *)dest, header.size);
+    } else {
+        uint8_t buff[WL_LOG_BUFF_SIZE];
+        for (size_t done = 0; done < header.size; done += sizeof(buff)) {
+            size_t len = header.size - done < sizeof(buff) ? header.size - done : sizeof(buff);
+            result = this->flash_drv->read(data_addr + done, buff, len);
+            WL_RESULT_CHECK(result);
+            crc = crc32::crc32_le(crc, buff, len);
+        }
+    }
+    *valid = crc == header.crc;
+    return ESP_OK;
+}
+
+esp_err_t WL_Log::scanHead()
+{
+    esp_err_t result = ESP_OK;
+    size_t head_addr = this->sectorAddr(this->head_seq);
+    size_t offset = this->recordSize(sizeof(wl_log_sector_header_t) - sizeof(wl_log_record_header_t));
+    this->head_closed = true;
+    while (offset + sizeof(wl_log_record_header_t) <= this->sector_size) {
+        wl_log_record_header_t header;
+        result = this->flash_drv->read(head_addr + offset, &header, sizeof(header));
+        WL_RESULT_CHECK(result);
+        if (header.size == WL_LOG_ERASED && header.crc == WL_LOG_ERASED) {
+            this->head_closed = false;
+            break;
+        }
+        bool valid;
+        result = this->checkRecord(head_addr + offset, this->sector_size - offset - sizeof(header), header, NULL, &valid);
+        WL_RESULT_CHECK(result);
+        if (!valid) {
+            // A record torn by a power loss: the rest of the sector can't be trusted anymore
+            ESP_LOGW(TAG, "%s: invalid record at seq=%u, offset=0x%08x, closing sector", __func__, this->head_seq, (uint32_t) offset);
+            break;
+        }
+        offset += this->recordSize(header.size);
+    }
+    this->write_offset = offset;
+    return ESP_OK;
+}
+
+esp_err_t WL_Log::openSector()
+{
+    esp_err_t result = ESP_OK;
+    uint32_t sector = this->empty ? 0 : (this->head_sector + 1) % this->sector_count;
+    uint32_t seq = this->head_seq + 1;
+
+    if (!this->empty && this->head_seq - this->tail_seq + 1 >= this->sector_count) {
+        // All sectors are in use: the oldest one is dropped
+        this->tail_seq++;
+    }
+    result = this->flash_drv->erase_sector((this->start_addr + sector * this->sector_size) / this->sector_size);
+    WL_RESULT_CHECK(result);
+
+    uint8_t buff[WL_LOG_MAX_WR_SIZE];
+    size_t header_size = this->recordSize(sizeof(wl_log_sector_header_t) - sizeof(wl_log_record_header_t));
+    wl_log_sector_header_t *header = (wl_log_sector_header_t *)buff;
+    memset(buff, 0xff, sizeof(buff));
+    header->magic = WL_LOG_MAGIC;
+    header->seq = seq;
+    header->reserved = WL_LOG_ERASED;
+    header->crc = crc32::crc32_le(WL_LOG_CRC_CONST, (const unsigned char *)header, offsetof(wl_log_sector_header_t, crc));
+    result = this->flash_drv->write(this->start_addr + sector * this->sector_size, buff, header_size);
+    WL_RESULT_CHECK(result);
+
+    if (this->empty) {
+        this->tail_seq = seq;
+    }
+    this->empty = false;
+    this->head_sector = sector;
+    this->head_seq = seq;
+    this->write_offset = header_size;
+    this->head_closed = false;
+    return ESP_OK;
+}
+
+esp_err_t WL_Log::writeRecord(size_t addr, const void *data, size_t size)
+{
+    esp_err_t result = ESP_OK;
+    const uint8_t *src = (const uint8_t *)data;
+    uint8_t buff[WL_LOG_BUFF_SIZE];
+    wl_log_record_header_t header;
+    header.size = size;
+    header.crc = crc32::crc32_le(WL_LOG_CRC_CONST, (const unsigned char *)&header.size, sizeof(header.size));
+    header.crc = crc32::crc32_le(header.crc, src, size);
+
+    // The header goes together with the start of the data, so a small record takes a single write
+    size_t total = this->recordSize(size);
+    size_t first = total < sizeof(buff) ? total : sizeof(buff);
+    size_t done = first - sizeof(header) < size ? first - sizeof(header) : size;
+    memset(buff, 0xff, first);
+    memcpy(buff, &header, sizeof(header));
+    memcpy(buff + sizeof(header), src, done);
+    result = this->flash_drv->write(addr, buff, first);
+    WL_RESULT_CHECK(result);
+    addr += first;
+
+    // Whole write units of the data are written in place, the remainder is padded
+    size_t middle = (size - done) & ~(this->wr_size - 1);
+    if (middle > 0) {
+        result = this->flash_drv->write(addr, src + done, middle);
+        WL_RESULT_CHECK(result);
+        addr += middle;
+        done += middle;
+    }
+    if (done < size) {
+        memset(buff, 0xff, this->wr_size);
+        memcpy(buff, src + done, size - done);
+        result = this->flash_drv->write(addr, buff, this->wr_size);
+        WL_RESULT_CHECK(result);
+    }
+    return ESP_OK;
+}
+
+esp_err_t WL_Log::append(const void *data, size_t size)
+{
+    esp_err_t result = ESP_OK;
+    if (this->initialized == false) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (data == NULL && size > 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (size > this->max_record_size()) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    size_t record_size = this->recordSize(size);
+    if (this->empty || this->head_closed || this->write_offset + record_size > this->sector_size) {
+        result = this->openSector();
+        WL_RESULT_CHECK(result);
+    }
+    result = this->writeRecord(this->sectorAddr(this->head_seq) + this->write_offset, data, size);
+    if (result != ESP_OK) {
+        // Part of the record may have been written, continue in the next sector
+        this->head_closed = true;
+    }
+    WL_RESULT_CHECK(result);
+    this->write_offset += record_size;
+    return ESP_OK;
+}
+
+void WL_Log::cursor_init(wl_log_cursor_t *cursor)
+{
+    cursor->seq = this->tail_seq;
+    cursor->offset = 0;
+}
+
+esp_err_t WL_Log::read(wl_log_cursor_t *cursor, void *dest, size_t *size)
+{
+    esp_err_t result = ESP_OK;
+    if (this->initialized == false) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    size_t first_offset = this->recordSize(sizeof(wl_log_sector_header_t) - sizeof(wl_log_record_header_t));
+    while (true) {
+        if (this->empty || cursor->seq > this->head_seq) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        if (cursor->seq < this->tail_seq) {
+            // The sector was overwritten by newer records
+            ESP_LOGD(TAG, "%s: cursor seq=%u dropped, moving to seq=%u", __func__, cursor->seq, this->tail_seq);
+            cursor->seq = this->tail_seq;
+            cursor->offset = first_offset;
+        }
+        if (cursor->offset < first_offset) {
+            cursor->offset = first_offset;
+        }
+        if (cursor->seq == this->head_seq && cursor->offset >= this->write_offset) {
+            return ESP_ERR_NOT_FOUND;
+        }
+
+        size_t addr = this->sectorAddr(cursor->seq) + cursor->offset;
+        wl_log_record_header_t header;
+        bool valid = false;
+        if (cursor->offset + sizeof(header) <= this->sector_size) {
+            result = this->flash_drv->read(addr, &header, sizeof(header));
+            WL_RESULT_CHECK(result);
+            size_t max_size = this->sector_size - cursor->offset - sizeof(header);
+            // The size is only reported for a record which is not torn
+            result = this->checkRecord(addr, max_size, header, header.size > *size ? NULL : dest, &valid);
+            WL_RESULT_CHECK(result);
+            if (valid && header.size > *size) {
+                *size = header.size;
+                return ESP_ERR_INVALID_SIZE;
+            }
+        }
+        if (valid) {
+            *size = header.size;
+            cursor->offset += this->recordSize(header.size);
+            return ESP_OK;
+        }
+        // End of the sector, or the rest of it was closed after a torn record
+        cursor->seq++;
+        cursor->offset = first_offset;
+    }
+}
+
+esp_err_t WL_Log::release(const wl_log_cursor_t *cursor)
+{
+    esp_err_t result = ESP_OK;
+    if (this->initialized == false) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // The head sector is kept, so the sequence numbers continue after a remount
+    while (this->tail_seq < cursor->seq && this->tail_seq < this->head_seq) {
+        result = this->flash_drv->erase_sector(this->sectorAddr(this->tail_seq) / this->sector_size);
+        WL_RESULT_CHECK(result);
+        this->tail_seq++;
+    }
+    return ESP_OK;
+}
+
+Flash_Access *WL_Log::get_drv()
+{
+    return this->flash_drv;
+}
@@ -128,6 +128,158 @@ size_t wl_size(wl_handle_t handle);
 */
 size_t wl_sector_size(wl_handle_t handle);
 
+/**
+* @brief Statistics of the WL instance
+*
+* Each read or write request is passed to the flash driver as one operation
+* per physically contiguous run of sectors. Dividing the number of operations
+* by the number of requests gives the average cost of a request.
+*/
+typedef struct {
+    uint32_t read_count;    /*!< number of read requests*/
+    uint32_t read_ops;      /*!< number of flash driver read operations*/
+    uint32_t write_count;   /*!< number of write requests*/
+    uint32_t write_ops;     /*!< number of flash driver write operations*/
+} wl_stats_t;
+
+/**
+* @brief Get statistics of the WL instance
+*
+* The counters include the requests made internally by the WL module.
+*
+* @param handle WL module handle that was initialized before
+* @param stats Pointer to the structure to fill
+*
+* @return
+*       - ESP_OK on success;
+*       - ESP_ERR_INVALID_ARG, if stats is NULL;
+*       - ESP_ERR_NOT_FOUND, if the handle is invalid.
+*/
+esp_err_t wl_get_stats(wl_handle_t handle, wl_stats_t *stats);
+
+/**
+* @brief Log handle
+*/
+typedef int32_t wl_log_handle_t;
+
+/**
+* @brief Position of a reader in the log
+*
+* Cursors are owned by the application and may be stored to resume reading
+* after a restart. Initialize a cursor with wl_log_cursor_init.
+*/
+typedef struct {
+    uint32_t seq;       /*!< sequence number of the sector holding the next record*/
+    uint32_t offset;    /*!< offset of the next record in the sector*/
+} wl_log_cursor_t;
+
+/**
+* @brief Mount an append-only record log on the partition
+*
+* Records are appended one after another and the sectors of the partition are
+* reused in a circle, so every sector is erased once per round. Once all sectors
+* are in use, appending a record erases the oldest sector together with the
+* records it holds. Compared to fixed size blocks written through wl_write, an
+* append only writes the record itself and a sector erase is needed only
+* every few kilobytes of records.
+*
+* The partition must not be mounted with wl_mount at the same time, and its
+* contents are not compatible with the WL_Flash layout.
+*
+* @param partition that will be used for access
+* @param out_handle handle of the log instance
+*
+* @return
+*       - ESP_OK, if the log was mounted successfully;
+*       - ESP_ERR_NO_MEM, if no more log instances can be allocated;
+*       - ESP_ERR_INVALID_SIZE, if the partition holds less than two sectors;
+*       - or one of error codes from lower-level flash driver.
+*/
+esp_err_t wl_log_mount(const esp_partition_t *partition, wl_log_handle_t *out_handle);
+
+/**
+* @brief Unmount the log
+*
+* @param handle log handle
+*
+* @return
+*       - ESP_OK on success
+*       - ESP_ERR_NOT_FOUND if the handle is invalid
+*/
+esp_err_t wl_log_unmount(wl_log_handle_t handle);
+
+/**
+* @brief Append a record to the log
+*
+* The record is stored with its size and a CRC. A record torn by a power loss
+* is detected on the next mount and the log continues in the next sector.
+*
+* @param handle log handle
+* @param data Pointer to the record data
+* @param size Size of the record, up to the value returned by wl_log_max_record_size
+*
+* @return
+*       - ESP_OK on success;
+*       - ESP_ERR_INVALID_SIZE, if the record does not fit into a sector;
+*       - or one of error codes from lower-level flash driver.
+*/
+esp_err_t wl_log_append(wl_log_handle_t handle, const void *data, size_t size);
+
+/**
+* @brief Set the cursor to the oldest record in the log
+*
+* @param handle log handle
+* @param cursor cursor to initialize
+*
+* @return
+*       - ESP_OK on success
+*       - ESP_ERR_NOT_FOUND if the handle is invalid
+*/
+esp_err_t wl_log_cursor_init(wl_log_handle_t handle, wl_log_cursor_t *cursor);
+
+/**
+* @brief Read the record at the cursor and move the cursor to the next one
+*
+* If the records at the cursor were dropped to make room for new ones, reading
+* continues with the oldest record left.
+*
+* @param handle log handle
+* @param cursor position of the reader
+* @param dest Pointer to the buffer where the record should be stored
+* @param[inout] size Size of the buffer in dest; set to the size of the record
+*
+* @return
+*       - ESP_OK on success;
+*       - ESP_ERR_NOT_FOUND, if there are no more records;
+*       - ESP_ERR_INVALID_SIZE, if the buffer is too small. size is set to the size of the
+*         record and the cursor is not moved;
+*       - or one of error codes from lower-level flash driver.
+*/
+esp_err_t wl_log_read(wl_log_handle_t handle, wl_log_cursor_t *cursor, void *dest, size_t *size);
+
+/**
+* @brief Release the records before the cursor
+*
+* Erases the sectors holding only records before the cursor, so they are not
+* read again after a remount. The sector records are appended to is kept.
+*
+* @param handle log handle
+* @param cursor position of the reader
+*
+* @return
+*       - ESP_OK on success;
+*       - or one of error codes from lower-level flash driver.
+*/
+esp_err_t wl_log_release(wl_log_handle_t handle, const wl_log_cursor_t *cursor);
+
+/**
+* @brief Get the maximum size of a record
+*
+* @param handle log handle
+* @return maximum record size, in bytes
+*/
+size_t wl_log_max_record_size(wl_log_handle_t handle);
+
 
 #ifdef __cplusplus
 } // extern "C"
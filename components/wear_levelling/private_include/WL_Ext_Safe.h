@@ -35,8 +35,10 @@ protected:
     // Dump Sector
     uint32_t dump_addr; // dump buffer address
     uint32_t state_addr;// sectore where state of transaction will be stored
+    uint32_t journal_pos;// next free slot in the state sector
 
     esp_err_t recover();
+    esp_err_t journal_done(uint32_t pos);
 };
 
 #endif // _WL_Ext_Safe_H_
@@ -18,6 +18,7 @@
 #include "Flash_Access.h"
 #include "WL_Config.h"
 #include "WL_State.h"
+#include "wear_levelling.h"
 
 /**
 * @brief This class is used to make wear levelling for flash devices. Class implements Flash_Access interface
@@ -47,6 +48,8 @@ public :
     Flash_Access *get_drv();
     wl_config_t *get_cfg();
 
+    void get_stats(wl_stats_t *stats);
+
 protected:
     bool configured = false;
     bool initialized = false;
@@ -66,11 +69,14 @@ protected:
     uint8_t *temp_buff = NULL;
     size_t dummy_addr;
     uint32_t pos_data[4];
+    wl_stats_t stats = {};
 
     esp_err_t initSections();
-    esp_err_t updateWL();
+    esp_err_t updateWL(uint32_t access_count);
+    esp_err_t moveDummy();
     esp_err_t recoverPos();
     size_t calcAddr(size_t addr);
+    size_t calcExtent(size_t addr, size_t size, size_t *len);
 
     esp_err_t updateVersion();
     esp_err_t updateV1_V2();
@@ -0,0 +1,91 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef _WL_Log_H_
+#define _WL_Log_H_
+
+#include "esp_err.h"
+#include "Flash_Access.h"
+#include "wear_levelling.h"
+
+/**
+* @brief Header at the start of every sector used by the log
+*
+*/
+typedef struct WL_Log_Sector_Header_s {
+    uint32_t magic;     /*!< WL_LOG_MAGIC*/
+    uint32_t seq;       /*!< sequence number of the sector, incremented for every sector the log opens*/
+    uint32_t reserved;  /*!< always 0xffffffff*/
+    uint32_t crc;       /*!< CRC of the fields above*/
+} wl_log_sector_header_t;
+
+/**
+* @brief Header in front of the data of every record
+*
+*/
+typedef struct WL_Log_Record_Header_s {
+    uint32_t size;      /*!< size of the data following the header, in bytes*/
+    uint32_t crc;       /*!< CRC of size and data*/
+} wl_log_record_header_t;
+
+/**
+* @brief This class implements an append-only log of records on top of the Flash_Access interface.
+*
+* Records are written one after another into the sectors of the flash area, which are used in a
+* circle: once all sectors are in use, the oldest one is erased to make room. Every sector is
+* therefore erased once per round, which spreads wear evenly without the dummy sector moves of WL_Flash.
+* The position of the log is not stored anywhere: on init, it is found from the sequence numbers
+* in the sector headers, so appending a record takes a single write (or up to three, depending on
+* its alignment) and a sector erase only every few records.
+*/
+class WL_Log
+{
+public:
+    WL_Log();
+    ~WL_Log();
+
+    /**
+    * Uses size bytes of flash_drv starting at start_addr, both aligned to the sector size of flash_drv.
+    * Records are padded to a multiple of wr_size bytes, which must be a power of two of at least 8.
+    */
+    esp_err_t config(Flash_Access *flash_drv, size_t start_addr, size_t size, size_t wr_size);
+    esp_err_t init();
+
+    esp_err_t append(const void *data, size_t size);
+
+    void cursor_init(wl_log_cursor_t *cursor);
+    esp_err_t read(wl_log_cursor_t *cursor, void *dest, size_t *size);
+    esp_err_t release(const wl_log_cursor_t *cursor);
+
+    size_t max_record_size();
+
+    Flash_Access *get_drv();
+
+protected:
+    bool configured = false;
+    bool initialized = false;
+    Flash_Access *flash_drv = NULL;
+    size_t start_addr;
+    size_t sector_size;
+    uint32_t sector_count;
+    size_t wr_size;
+
+    bool empty;             // no sector is in use
+    bool head_closed;       // no more records are appended to the head sector
+    uint32_t head_sector;   // sector the records are appended to
+    uint32_t head_seq;
+    uint32_t tail_seq;      // sequence number of the oldest sector in use
+    size_t write_offset;    // offset of the next record in the head sector
+
+    size_t sectorAddr(uint32_t seq);
+    size_t recordSize(size_t data_size);
+    esp_err_t readSectorHeader(uint32_t sector, wl_log_sector_header_t *header, bool *valid);
+    esp_err_t checkRecord(size_t addr, size_t max_size, const wl_log_record_header_t &header, void *dest, bool *valid);
+    esp_err_t scanHead();
+    esp_err_t openSector();
+    esp_err_t writeRecord(size_t addr, const void *data, size_t size);
+};
+
+#endif // _WL_Log_H_
@@ -1,11 +1,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 
 #include "esp_spi_flash.h"
 #include "esp_partition.h"
 #include "wear_levelling.h"
 #include "WL_Flash.h"
+#include "WL_Log.h"
+#include "WL_Ext_Safe.h"
+#include "Partition.h"
 #include "SpiFlash.h"
 
 #include "catch.hpp"
@@ -208,3 +212,604 @@ TEST_CASE("power down test", "[wear_levelling]")
     result = wl_unmount(wl_handle);
     REQUIRE(result == ESP_OK);
 }
+
+TEST_CASE("log appends records and reads them back after remount", "[wear_levelling][log]")
+{
+    _spi_flash_init(CONFIG_ESPTOOLPY_FLASHSIZE, CONFIG_WL_SECTOR_SIZE * 16, CONFIG_WL_SECTOR_SIZE, CONFIG_WL_SECTOR_SIZE, "partition_table.bin");
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+    REQUIRE(esp_partition_erase_range(partition, 0, partition->size) == ESP_OK);
+
+    wl_log_handle_t handle;
+    REQUIRE(wl_log_mount(partition, &handle) == ESP_OK);
+    size_t max_size = wl_log_max_record_size(handle);
+    REQUIRE(max_size == SPI_FLASH_SEC_SIZE - 16 - 8);
+
+    wl_log_cursor_t cursor;
+    REQUIRE(wl_log_cursor_init(handle, &cursor) == ESP_OK);
+    uint8_t buf[SPI_FLASH_SEC_SIZE];
+    size_t size = sizeof(buf);
+    CHECK(wl_log_read(handle, &cursor, buf, &size) == ESP_ERR_NOT_FOUND);
+
+    // Records of varying size, including empty and the largest ones, spread over several sectors
+    const size_t count = 300;
+    uint8_t data[SPI_FLASH_SEC_SIZE];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = i * 7 + 3;
+    }
+    auto record_size = [max_size](size_t i) -> size_t {
+        return (i % 50 == 49) ? max_size : (i * 13) % 97;
+    };
+    for (size_t i = 0; i < count; i++) {
+        data[0] = i;
+        REQUIRE(wl_log_append(handle, data, record_size(i)) == ESP_OK);
+    }
+    CHECK(wl_log_append(handle, data, max_size + 1) == ESP_ERR_INVALID_SIZE);
+
+    for (int pass = 0; pass < 2; pass++) {
+        REQUIRE(wl_log_cursor_init(handle, &cursor) == ESP_OK);
+        for (size_t i = 0; i < count; i++) {
+            if (i == 49) {
+                // Buffer too small: the size is reported and the cursor stays
+                size = 16;
+                REQUIRE(wl_log_read(handle, &cursor, buf, &size) == ESP_ERR_INVALID_SIZE);
+                CHECK(size == max_size);
+            }
+            size = sizeof(buf);
+            REQUIRE(wl_log_read(handle, &cursor, buf, &size) == ESP_OK);
+            REQUIRE(size == record_size(i));
+            if (size > 0) {
+                CHECK(buf[0] == (uint8_t) i);
+                CHECK(memcmp(buf + 1, data + 1, size - 1) == 0);
+            }
+        }
+        size = sizeof(buf);
+        CHECK(wl_log_read(handle, &cursor, buf, &size) == ESP_ERR_NOT_FOUND);
+
+        REQUIRE(wl_log_unmount(handle) == ESP_OK);
+        REQUIRE(wl_log_mount(partition, &handle) == ESP_OK);
+    }
+
+    // Appending continues after the last record
+    data[0] = 0xaa;
+    REQUIRE(wl_log_append(handle, data, 5) == ESP_OK);
+    size = sizeof(buf);
+    REQUIRE(wl_log_read(handle, &cursor, buf, &size) == ESP_OK);
+    CHECK(size == 5);
+    CHECK(buf[0] == 0xaa);
+
+    // Released sectors are not read again
+    wl_log_cursor_t start;
+    REQUIRE(wl_log_cursor_init(handle, &start) == ESP_OK);
+    REQUIRE(wl_log_release(handle, &cursor) == ESP_OK);
+    REQUIRE(wl_log_unmount(handle) == ESP_OK);
+    REQUIRE(wl_log_mount(partition, &handle) == ESP_OK);
+    wl_log_cursor_t after;
+    REQUIRE(wl_log_cursor_init(handle, &after) == ESP_OK);
+    CHECK(after.seq == cursor.seq);
+    CHECK(after.seq > start.seq);
+
+    REQUIRE(wl_log_unmount(handle) == ESP_OK);
+}
+
+TEST_CASE("log reuses sectors in a circle and moves lagging cursors", "[wear_levelling][log]")
+{
+    _spi_flash_init(CONFIG_ESPTOOLPY_FLASHSIZE, CONFIG_WL_SECTOR_SIZE * 16, CONFIG_WL_SECTOR_SIZE, CONFIG_WL_SECTOR_SIZE, "partition_table.bin");
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+    REQUIRE(esp_partition_erase_range(partition, 0, partition->size) == ESP_OK);
+    const size_t sectors = partition->size / SPI_FLASH_SEC_SIZE;
+    const size_t first_sector = partition->address / SPI_FLASH_SEC_SIZE;
+    spiflash.reset_erase_cycles();
+
+    wl_log_handle_t handle;
+    REQUIRE(wl_log_mount(partition, &handle) == ESP_OK);
+    wl_log_cursor_t cursor;
+    REQUIRE(wl_log_cursor_init(handle, &cursor) == ESP_OK);
+
+    // Three rounds over the partition, with 4 records per sector
+    const size_t record = 1000;
+    const uint32_t count = sectors * 4 * 3;
+    uint8_t data[record];
+    memset(data, 0x5a, sizeof(data));
+    for (uint32_t i = 0; i < count; i++) {
+        memcpy(data, &i, sizeof(i));
+        REQUIRE(wl_log_append(handle, data, sizeof(data)) == ESP_OK);
+    }
+
+    // Every sector was erased once per round, the first erase of a blank sector is not counted
+    for (size_t i = 0; i < sectors; i++) {
+        uint32_t cycles = spiflash.get_erase_cycles(first_sector + i);
+        CHECK(cycles == 2);
+    }
+
+    REQUIRE(wl_log_unmount(handle) == ESP_OK);
+    REQUIRE(wl_log_mount(partition, &handle) == ESP_OK);
+
+    // The cursor from the first round moves to the oldest record left
+    uint8_t buf[record];
+    size_t size = sizeof(buf);
+    REQUIRE(wl_log_read(handle, &cursor, buf, &size) == ESP_OK);
+    uint32_t first;
+    memcpy(&first, buf, sizeof(first));
+    CHECK(first == count - sectors * 4);
+    uint32_t expected = first + 1;
+    while (true) {
+        size = sizeof(buf);
+        esp_err_t err = wl_log_read(handle, &cursor, buf, &size);
+        if (err == ESP_ERR_NOT_FOUND) {
+            break;
+        }
+        REQUIRE(err == ESP_OK);
+        uint32_t value;
+        memcpy(&value, buf, sizeof(value));
+        REQUIRE(value == expected);
+        expected++;
+    }
+    CHECK(expected == count);
+
+    REQUIRE(wl_log_unmount(handle) == ESP_OK);
+}
+
+TEST_CASE("log skips a torn record and continues in the next sector", "[wear_levelling][log]")
+{
+    _spi_flash_init(CONFIG_ESPTOOLPY_FLASHSIZE, CONFIG_WL_SECTOR_SIZE * 16, CONFIG_WL_SECTOR_SIZE, CONFIG_WL_SECTOR_SIZE, "partition_table.bin");
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+    REQUIRE(esp_partition_erase_range(partition, 0, partition->size) == ESP_OK);
+
+    wl_log_handle_t handle;
+    REQUIRE(wl_log_mount(partition, &handle) == ESP_OK);
+    uint32_t value = 1;
+    REQUIRE(wl_log_append(handle, &value, sizeof(value)) == ESP_OK);
+    value = 2;
+    REQUIRE(wl_log_append(handle, &value, sizeof(value)) == ESP_OK);
+    REQUIRE(wl_log_unmount(handle) == ESP_OK);
+
+    // Header of a record whose data was never written, after the two records at 0x10 and 0x20
+    uint32_t torn[2] = {24, 0x12345678};
+    REQUIRE(esp_partition_write(partition, 0x30, torn, sizeof(torn)) == ESP_OK);
+
+    REQUIRE(wl_log_mount(partition, &handle) == ESP_OK);
+    value = 3;
+    REQUIRE(wl_log_append(handle, &value, sizeof(value)) == ESP_OK);
+    uint32_t next_sector;
+    REQUIRE(esp_partition_read(partition, SPI_FLASH_SEC_SIZE + 0x18, &next_sector, sizeof(next_sector)) == ESP_OK);
+    CHECK(next_sector == 3);
+
+    wl_log_cursor_t cursor;
+    REQUIRE(wl_log_cursor_init(handle, &cursor) == ESP_OK);
+    for (uint32_t expected = 1; expected <= 3; expected++) {
+        size_t size = sizeof(value);
+        REQUIRE(wl_log_read(handle, &cursor, &value, &size) == ESP_OK);
+        CHECK(value == expected);
+    }
+    size_t size = sizeof(value);
+    CHECK(wl_log_read(handle, &cursor, &value, &size) == ESP_ERR_NOT_FOUND);
+
+    REQUIRE(wl_log_unmount(handle) == ESP_OK);
+}
+
+class CountingFlash : public Flash_Access
+{
+public:
+    CountingFlash(Flash_Access *flash) : flash(flash) { }
+
+    size_t chip_size() override
+    {
+        return flash->chip_size();
+    }
+
+    esp_err_t erase_sector(size_t sector) override
+    {
+        erases++;
+        erase_ops++;
+        return flash->erase_sector(sector);
+    }
+
+    esp_err_t erase_range(size_t start_address, size_t size) override
+    {
+        if (fail_erases) {
+            return ESP_FAIL;
+        }
+        erases += size / flash->sector_size();
+        erase_ops++;
+        return flash->erase_range(start_address, size);
+    }
+
+    esp_err_t write(size_t dest_addr, const void *src, size_t size) override
+    {
+        bytes_written += size;
+        return flash->write(dest_addr, src, size);
+    }
+
+    esp_err_t read(size_t src_addr, void *dest, size_t size) override
+    {
+        return flash->read(src_addr, dest, size);
+    }
+
+    size_t sector_size() override
+    {
+        return flash->sector_size();
+    }
+
+    Flash_Access *flash;
+    size_t erases = 0;
+    size_t erase_ops = 0;
+    size_t bytes_written = 0;
+    bool fail_erases = false;
+};
+
+TEST_CASE("log appends need fewer erases and writes than sector updates through WL", "[wear_levelling][log]")
+{
+    _spi_flash_init(CONFIG_ESPTOOLPY_FLASHSIZE, CONFIG_WL_SECTOR_SIZE * 16, CONFIG_WL_SECTOR_SIZE, CONFIG_WL_SECTOR_SIZE, "partition_table.bin");
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+    REQUIRE(esp_partition_erase_range(partition, 0, partition->size) == ESP_OK);
+    Partition part(partition);
+    const size_t count = 2000;
+    uint8_t data[32];
+    memset(data, 0x33, sizeof(data));
+
+    // Records appended to the log
+    CountingFlash log_flash(&part);
+    WL_Log *log = new WL_Log();
+    REQUIRE(log->config(&log_flash, 0, partition->size, 16) == ESP_OK);
+    REQUIRE(log->init() == ESP_OK);
+    for (size_t i = 0; i < count; i++) {
+        REQUIRE(log->append(data, 24 + i % 9) == ESP_OK);
+    }
+    delete log;
+
+    // The same records appended to a file on a filesystem over WL: the sector holding the end of
+    // the data is read, erased and written back for every record
+    REQUIRE(esp_partition_erase_range(partition, 0, partition->size) == ESP_OK);
+    CountingFlash wl_flash_access(&part);
+    WL_Flash *wl_flash = new WL_Flash();
+    wl_config_t cfg;
+    cfg.full_mem_size = partition->size;
+    cfg.start_addr = 0;
+    cfg.version = 2;
+    cfg.sector_size = SPI_FLASH_SEC_SIZE;
+    cfg.page_size = SPI_FLASH_SEC_SIZE;
+    cfg.updaterate = 16;
+    cfg.temp_buff_size = 32;
+    cfg.wr_size = 16;
+    REQUIRE(wl_flash->config(&cfg, &wl_flash_access) == ESP_OK);
+    REQUIRE(wl_flash->init() == ESP_OK);
+    wl_flash_access.erases = 0;
+    wl_flash_access.bytes_written = 0;
+    uint8_t *sector = new uint8_t[SPI_FLASH_SEC_SIZE];
+    size_t offset = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t size = 24 + i % 9;
+        size_t sector_addr = offset / SPI_FLASH_SEC_SIZE * SPI_FLASH_SEC_SIZE;
+        if (offset % SPI_FLASH_SEC_SIZE + size > SPI_FLASH_SEC_SIZE) {
+            sector_addr += SPI_FLASH_SEC_SIZE;
+            offset = sector_addr;
+        }
+        REQUIRE(wl_flash->read(sector_addr, sector, SPI_FLASH_SEC_SIZE) == ESP_OK);
+        memcpy(sector + offset - sector_addr, data, size);
+        REQUIRE(wl_flash->erase_sector(sector_addr / SPI_FLASH_SEC_SIZE) == ESP_OK);
+        REQUIRE(wl_flash->write(sector_addr, sector, SPI_FLASH_SEC_SIZE) == ESP_OK);
+        offset += size;
+    }
+    delete[] sector;
+    delete wl_flash;
+
+    printf("%d appends: log %d erases, %d bytes written; WL sector updates %d erases, %d bytes written\n",
+           (int) count, (int) log_flash.erases, (int) log_flash.bytes_written,
+           (int) wl_flash_access.erases, (int) wl_flash_access.bytes_written);
+    CHECK(log_flash.erases * 10 <= wl_flash_access.erases);
+    CHECK(log_flash.bytes_written * 10 <= wl_flash_access.bytes_written);
+}
+
+TEST_CASE("reads and writes take one flash operation per contiguous run of sectors", "[wear_levelling]")
+{
+    _spi_flash_init(CONFIG_ESPTOOLPY_FLASHSIZE, CONFIG_WL_SECTOR_SIZE * 16, CONFIG_WL_SECTOR_SIZE, CONFIG_WL_SECTOR_SIZE, "partition_table.bin");
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+    REQUIRE(esp_partition_erase_range(partition, 0, partition->size) == ESP_OK);
+
+    wl_handle_t wl_handle;
+    REQUIRE(wl_mount(partition, &wl_handle) == ESP_OK);
+    size_t size = wl_size(wl_handle);
+    uint32_t *data = new uint32_t[size / sizeof(uint32_t)];
+    uint32_t *read = new uint32_t[size / sizeof(uint32_t)];
+    for (size_t i = 0; i < size / sizeof(uint32_t); i++) {
+        data[i] = i;
+    }
+    REQUIRE(wl_write(wl_handle, 0, data, size) == ESP_OK);
+
+    wl_stats_t before, after;
+    uint32_t max_ops = 0;
+    // Every remount moves the dummy sector, so runs break at different places
+    for (int i = 0; i < 20; i++) {
+        REQUIRE(wl_unmount(wl_handle) == ESP_OK);
+        REQUIRE(wl_mount(partition, &wl_handle) == ESP_OK);
+
+        REQUIRE(wl_get_stats(wl_handle, &before) == ESP_OK);
+        memset(read, 0, size);
+        REQUIRE(wl_read(wl_handle, 0, read, size) == ESP_OK);
+        REQUIRE(wl_get_stats(wl_handle, &after) == ESP_OK);
+        CHECK(after.read_count - before.read_count == 1);
+        CHECK(after.read_ops - before.read_ops <= 3);
+        max_ops = std::max(max_ops, after.read_ops - before.read_ops);
+        REQUIRE(memcmp(data, read, size) == 0);
+
+        // Unaligned ranges across sector boundaries
+        size_t offset = (i * 37 + 5) * CONFIG_WL_SECTOR_SIZE / 4 + 3;
+        size_t len = 5 * CONFIG_WL_SECTOR_SIZE + 11;
+        REQUIRE(wl_read(wl_handle, offset, read, len) == ESP_OK);
+        REQUIRE(memcmp((uint8_t *) data + offset, read, len) == 0);
+    }
+
+    CHECK(max_ops > 1);
+
+    // Writing it all again takes at most three operations as well
+    REQUIRE(wl_erase_range(wl_handle, 0, size) == ESP_OK);
+    REQUIRE(wl_get_stats(wl_handle, &before) == ESP_OK);
+    REQUIRE(wl_write(wl_handle, 0, data, size) == ESP_OK);
+    REQUIRE(wl_get_stats(wl_handle, &after) == ESP_OK);
+    CHECK(after.write_count - before.write_count == 1);
+    CHECK(after.write_ops - before.write_ops <= 3);
+    REQUIRE(wl_read(wl_handle, 0, read, size) == ESP_OK);
+    REQUIRE(memcmp(data, read, size) == 0);
+
+    delete[] data;
+    delete[] read;
+    REQUIRE(wl_unmount(wl_handle) == ESP_OK);
+}
+
+static WL_Ext_Safe *mount_ext_safe(Flash_Access *flash, const esp_partition_t *partition)
+{
+    wl_ext_cfg_t cfg;
+    cfg.full_mem_size = partition->size;
+    cfg.start_addr = 0;
+    cfg.version = 2;
+    cfg.sector_size = SPI_FLASH_SEC_SIZE;
+    cfg.page_size = SPI_FLASH_SEC_SIZE;
+    cfg.updaterate = 16;
+    cfg.temp_buff_size = 32;
+    cfg.wr_size = 16;
+    cfg.fat_sector_size = 512;
+    WL_Ext_Safe *wl = new WL_Ext_Safe();
+    REQUIRE(wl->config(&cfg, flash) == ESP_OK);
+    REQUIRE(wl->init() == ESP_OK);
+    return wl;
+}
+
+TEST_CASE("range erase on 512 byte sectors erases whole flash sectors at once", "[wear_levelling]")
+{
+    _spi_flash_init(CONFIG_ESPTOOLPY_FLASHSIZE, CONFIG_WL_SECTOR_SIZE * 16, CONFIG_WL_SECTOR_SIZE, CONFIG_WL_SECTOR_SIZE, "partition_table.bin");
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+    REQUIRE(esp_partition_erase_range(partition, 0, partition->size) == ESP_OK);
+    Partition part(partition);
+    CountingFlash flash(&part);
+    WL_Ext_Safe *wl = mount_ext_safe(&flash, partition);
+
+    const size_t size = 64 * SPI_FLASH_SEC_SIZE;
+    uint32_t *data = new uint32_t[size / sizeof(uint32_t)];
+    uint32_t *read = new uint32_t[size / sizeof(uint32_t)];
+    for (size_t i = 0; i < size / sizeof(uint32_t); i++) {
+        data[i] = i;
+    }
+    REQUIRE(wl->write(0, data, size) == ESP_OK);
+
+    // 5 sectors at the end of the first flash sector, 10 whole flash sectors, and 2 sectors of the next one
+    size_t start = 3 * 512;
+    size_t len = (5 + 10 * 8 + 2) * 512;
+    flash.erase_ops = 0;
+    REQUIRE(wl->erase_range(start, len) == ESP_OK);
+    // Both partial sectors take an erase of the dump and of the sector itself, the whole sectors one
+    // more operation at most, and the dummy block moves once per 16 flash sectors
+    CHECK(flash.erase_ops <= 2 + 2 + 3 + 4);
+    memset((uint8_t *) data + start, 0xff, len);
+    REQUIRE(wl->read(0, read, size) == ESP_OK);
+    REQUIRE(memcmp(data, read, size) == 0);
+
+    // Single sectors, as erased by FAT before each write: the state sector is only erased when the journal is full
+    const size_t count = 200;
+    flash.erases = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t addr = (i * 7 % 64) * SPI_FLASH_SEC_SIZE + (i % 8) * 512;
+        REQUIRE(wl->erase_range(addr, 512) == ESP_OK);
+        memset((uint8_t *) data + addr, 0xff, 512);
+    }
+    printf("%d single sector erases: %d flash sector erases\n", (int) count, (int) flash.erases);
+    // dump and target sector, plus one move of the dummy block per 8 erases
+    CHECK(flash.erases <= count * 2 + count / 8 + count / 64 + 1);
+    REQUIRE(wl->read(0, read, size) == ESP_OK);
+    REQUIRE(memcmp(data, read, size) == 0);
+
+    delete wl;
+    delete[] data;
+    delete[] read;
+}
+
+TEST_CASE("range erase moves the dummy block once per updaterate sectors", "[wear_levelling]")
+{
+    _spi_flash_init(CONFIG_ESPTOOLPY_FLASHSIZE, CONFIG_WL_SECTOR_SIZE * 16, CONFIG_WL_SECTOR_SIZE, CONFIG_WL_SECTOR_SIZE, "partition_table.bin");
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+    REQUIRE(esp_partition_erase_range(partition, 0, partition->size) == ESP_OK);
+    Partition part(partition);
+    CountingFlash flash(&part);
+    WL_Flash *wl = new WL_Flash();
+    wl_config_t cfg;
+    cfg.full_mem_size = partition->size;
+    cfg.start_addr = 0;
+    cfg.version = 2;
+    cfg.sector_size = SPI_FLASH_SEC_SIZE;
+    cfg.page_size = SPI_FLASH_SEC_SIZE;
+    cfg.updaterate = 16;
+    cfg.temp_buff_size = 32;
+    cfg.wr_size = 16;
+    REQUIRE(wl->config(&cfg, &flash) == ESP_OK);
+    REQUIRE(wl->init() == ESP_OK);
+
+    // A move copies a sector to the dummy block and marks its position in both state copies,
+    // the erase itself writes nothing
+    const size_t move_bytes = SPI_FLASH_SEC_SIZE + 2 * cfg.wr_size;
+    flash.bytes_written = 0;
+    REQUIRE(wl->erase_range(0, 48 * SPI_FLASH_SEC_SIZE) == ESP_OK);
+    CHECK(flash.bytes_written == 3 * move_bytes);
+
+    // The accesses left over are counted towards the next move
+    flash.bytes_written = 0;
+    REQUIRE(wl->erase_range(0, 8 * SPI_FLASH_SEC_SIZE) == ESP_OK);
+    CHECK(flash.bytes_written == 0);
+    REQUIRE(wl->erase_range(0, 24 * SPI_FLASH_SEC_SIZE) == ESP_OK);
+    CHECK(flash.bytes_written == 2 * move_bytes);
+
+    delete wl;
+}
+
+TEST_CASE("dummy block moves which are due are kept when one of them fails", "[wear_levelling]")
+{
+    _spi_flash_init(CONFIG_ESPTOOLPY_FLASHSIZE, CONFIG_WL_SECTOR_SIZE * 16, CONFIG_WL_SECTOR_SIZE, CONFIG_WL_SECTOR_SIZE, "partition_table.bin");
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+    REQUIRE(esp_partition_erase_range(partition, 0, partition->size) == ESP_OK);
+    Partition part(partition);
+    CountingFlash flash(&part);
+    WL_Flash *wl = new WL_Flash();
+    wl_config_t cfg;
+    cfg.full_mem_size = partition->size;
+    cfg.start_addr = 0;
+    cfg.version = 2;
+    cfg.sector_size = SPI_FLASH_SEC_SIZE;
+    cfg.page_size = SPI_FLASH_SEC_SIZE;
+    cfg.updaterate = 16;
+    cfg.temp_buff_size = 32;
+    cfg.wr_size = 16;
+    REQUIRE(wl->config(&cfg, &flash) == ESP_OK);
+    REQUIRE(wl->init() == ESP_OK);
+
+    // The erase is due three moves, the first of which fails to erase the dummy block
+    const size_t move_bytes = SPI_FLASH_SEC_SIZE + 2 * cfg.wr_size;
+    flash.fail_erases = true;
+    CHECK(wl->erase_range(0, 48 * SPI_FLASH_SEC_SIZE) != ESP_OK);
+    flash.fail_erases = false;
+
+    // All of them are done with the next access, which is not due a move of its own
+    flash.bytes_written = 0;
+    REQUIRE(wl->erase_range(0, SPI_FLASH_SEC_SIZE) == ESP_OK);
+    CHECK(flash.bytes_written == 3 * move_bytes);
+    flash.bytes_written = 0;
+    REQUIRE(wl->erase_range(0, 14 * SPI_FLASH_SEC_SIZE) == ESP_OK);
+    CHECK(flash.bytes_written == 0);
+
+    delete wl;
+}
+
+TEST_CASE("erase interrupted by an older version is completed on mount", "[wear_levelling]")
+{
+    _spi_flash_init(CONFIG_ESPTOOLPY_FLASHSIZE, CONFIG_WL_SECTOR_SIZE * 16, CONFIG_WL_SECTOR_SIZE, CONFIG_WL_SECTOR_SIZE, "partition_table.bin");
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+    REQUIRE(esp_partition_erase_range(partition, 0, partition->size) == ESP_OK);
+    Partition part(partition);
+    WL_Ext_Safe *wl = mount_ext_safe(&part, partition);
+
+    const size_t size = 16 * SPI_FLASH_SEC_SIZE;
+    uint32_t *data = new uint32_t[size / sizeof(uint32_t)];
+    uint32_t *read = new uint32_t[size / sizeof(uint32_t)];
+    for (size_t i = 0; i < size / sizeof(uint32_t); i++) {
+        data[i] = i * 5;
+    }
+    REQUIRE(wl->write(0, data, size) == ESP_OK);
+
+    // An older version erasing 512 byte sector 2 of flash sector 3 lost power after it stored the sector
+    // in the dump sector and the transaction in the first slot of the state sector, and erased the sector
+    const size_t flash_size = wl->WL_Flash::chip_size();
+    const size_t state_addr = flash_size - 2 * SPI_FLASH_SEC_SIZE;
+    const size_t dump_addr = flash_size - SPI_FLASH_SEC_SIZE;
+    const size_t sector_addr = 3 * SPI_FLASH_SEC_SIZE;
+    REQUIRE(wl->WL_Flash::erase_range(dump_addr, SPI_FLASH_SEC_SIZE) == ESP_OK);
+    REQUIRE(wl->WL_Flash::write(dump_addr, (uint8_t *) data + sector_addr, SPI_FLASH_SEC_SIZE) == ESP_OK);
+    REQUIRE(wl->WL_Flash::erase_range(state_addr, SPI_FLASH_SEC_SIZE) == ESP_OK);
+    const uint32_t legacy_state[4] = { 0x12345678, 3, 2, 1 };
+    REQUIRE(wl->WL_Flash::write(state_addr, legacy_state, sizeof(legacy_state)) == ESP_OK);
+    REQUIRE(wl->WL_Flash::erase_range(sector_addr, SPI_FLASH_SEC_SIZE) == ESP_OK);
+    delete wl;
+
+    // Only the 512 byte sector being erased is left erased
+    wl = mount_ext_safe(&part, partition);
+    memset((uint8_t *) data + sector_addr + 2 * 512, 0xff, 512);
+    REQUIRE(wl->read(0, read, size) == ESP_OK);
+    REQUIRE(memcmp(data, read, size) == 0);
+
+    // The transaction is replayed only once, and the journal is used from its start
+    for (size_t k = 0; k < SPI_FLASH_SEC_SIZE / sizeof(uint32_t); k++) {
+        data[sector_addr / sizeof(uint32_t) + k] = k + 1;
+    }
+    REQUIRE(wl->erase_range(sector_addr, SPI_FLASH_SEC_SIZE) == ESP_OK);
+    REQUIRE(wl->write(sector_addr, (uint8_t *) data + sector_addr, SPI_FLASH_SEC_SIZE) == ESP_OK);
+    REQUIRE(wl->erase_range(5 * SPI_FLASH_SEC_SIZE, 512) == ESP_OK);
+    memset((uint8_t *) data + 5 * SPI_FLASH_SEC_SIZE, 0xff, 512);
+    delete wl;
+    wl = mount_ext_safe(&part, partition);
+    REQUIRE(wl->read(0, read, size) == ESP_OK);
+    REQUIRE(memcmp(data, read, size) == 0);
+
+    delete wl;
+    delete[] data;
+    delete[] read;
+}
+
+TEST_CASE("interrupted erase of 512 byte sectors is completed on mount", "[wear_levelling]")
+{
+    _spi_flash_init(CONFIG_ESPTOOLPY_FLASHSIZE, CONFIG_WL_SECTOR_SIZE * 16, CONFIG_WL_SECTOR_SIZE, CONFIG_WL_SECTOR_SIZE, "partition_table.bin");
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+    REQUIRE(esp_partition_erase_range(partition, 0, partition->size) == ESP_OK);
+    Partition part(partition);
+    WL_Ext_Safe *wl = mount_ext_safe(&part, partition);
+
+    const size_t size = 16 * SPI_FLASH_SEC_SIZE;
+    uint32_t *data = new uint32_t[size / sizeof(uint32_t)];
+    uint32_t *read = new uint32_t[size / sizeof(uint32_t)];
+    for (size_t i = 0; i < size / sizeof(uint32_t); i++) {
+        data[i] = i * 3;
+    }
+    REQUIRE(wl->write(0, data, size) == ESP_OK);
+
+    int failures = 0;
+    for (size_t i = 0; i < 150; i++) {
+        size_t addr = (i % 16) * SPI_FLASH_SEC_SIZE + (i * 3 % 8) * 512;
+        // Power is lost at one of the erases done for the sector
+        spiflash.set_total_erase_cycles_limit(spiflash.get_total_erase_cycles() + i % 4);
+        esp_err_t err = wl->erase_range(addr, 512);
+        spiflash.set_total_erase_cycles_limit(0);
+        delete wl;
+        wl = mount_ext_safe(&part, partition);
+
+        if (err != ESP_OK) {
+            failures++;
+            // Either the sector was not touched, or the erase was completed on mount
+            REQUIRE(wl->read(addr, read, 512) == ESP_OK);
+            uint8_t erased[512];
+            memset(erased, 0xff, sizeof(erased));
+            bool intact = memcmp((uint8_t *) data + addr, read, 512) == 0;
+            bool done = memcmp(erased, read, 512) == 0;
+            CHECK((intact || done));
+        }
+        memset((uint8_t *) data + addr, 0xff, 512);
+        REQUIRE(wl->erase_range(addr, 512) == ESP_OK);
+        // All other sectors kept their data
+        REQUIRE(wl->read(0, read, size) == ESP_OK);
+        REQUIRE(memcmp(data, read, size) == 0);
+        // Write new data to the erased sector
+        for (size_t k = 0; k < 512 / sizeof(uint32_t); k++) {
+            data[addr / sizeof(uint32_t) + k] = i + k;
+        }
+        REQUIRE(wl->write(addr, (uint8_t *) data + addr, 512) == ESP_OK);
+    }
+    CHECK(failures > 0);
+
+    delete wl;
+    delete[] data;
+    delete[] read;
+}
@@ -21,6 +21,7 @@
 #include "WL_Flash.h"
 #include "WL_Ext_Perf.h"
 #include "WL_Ext_Safe.h"
+#include "WL_Log.h"
 #include "SPI_Flash.h"
 #include "Partition.h"
 
@@ -53,11 +54,18 @@ typedef struct {
     _lock_t lock;
 } wl_instance_t;
 
+typedef struct {
+    WL_Log *instance;
+    _lock_t lock;
+} wl_log_instance_t;
+
 static wl_instance_t s_instances[MAX_WL_HANDLES];
+static wl_log_instance_t s_log_instances[MAX_WL_HANDLES];
 static _lock_t s_instances_lock;
 static const char *TAG = "wear_levelling";
 
 static esp_err_t check_handle(wl_handle_t handle, const char *func);
+static esp_err_t check_log_handle(wl_log_handle_t handle, const char *func);
 
 esp_err_t wl_mount(const esp_partition_t *partition, wl_handle_t *out_handle)
 {
@@ -249,6 +257,169 @@ size_t wl_sector_size(wl_handle_t handle)
     return result;
 }
 
+esp_err_t wl_get_stats(wl_handle_t handle, wl_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t result = check_handle(handle, __func__);
+    if (result != ESP_OK) {
+        return result;
+    }
+    _lock_acquire(&s_instances[handle].lock);
+    s_instances[handle].instance->get_stats(stats);
+    _lock_release(&s_instances[handle].lock);
+    return ESP_OK;
+}
+
+esp_err_t wl_log_mount(const esp_partition_t *partition, wl_log_handle_t *out_handle)
+{
+    // Initialize variables before the first jump to cleanup label
+    void *wl_log_ptr = NULL;
+    WL_Log *wl_log = NULL;
+    void *part_ptr = NULL;
+    Partition *part = NULL;
+
+    _lock_acquire(&s_instances_lock);
+    esp_err_t result = ESP_OK;
+    *out_handle = WL_INVALID_HANDLE;
+    for (size_t i = 0; i < MAX_WL_HANDLES; i++) {
+        if (s_log_instances[i].instance == NULL) {
+            *out_handle = i;
+            break;
+        }
+    }
+
+    if (*out_handle == WL_INVALID_HANDLE) {
+        ESP_LOGE(TAG, "MAX_WL_HANDLES=%d log instances already allocated", MAX_WL_HANDLES);
+        result = ESP_ERR_NO_MEM;
+        goto out;
+    }
+
+    part_ptr = malloc(sizeof(Partition));
+    if (part_ptr == NULL) {
+        result = ESP_ERR_NO_MEM;
+        ESP_LOGE(TAG, "%s: can't allocate Partition", __func__);
+        goto out;
+    }
+    part = new (part_ptr) Partition(partition);
+
+    wl_log_ptr = malloc(sizeof(WL_Log));
+    if (wl_log_ptr == NULL) {
+        result = ESP_ERR_NO_MEM;
+        ESP_LOGE(TAG, "%s: can't allocate WL_Log", __func__);
+        goto out;
+    }
+    wl_log = new (wl_log_ptr) WL_Log();
+
+    result = wl_log->config(part, 0, partition->size, WL_DEFAULT_WRITE_SIZE);
+    if (ESP_OK != result) {
+        ESP_LOGE(TAG, "%s: config instance=0x%08x, result=0x%x", __func__, *out_handle, result);
+        goto out;
+    }
+    result = wl_log->init();
+    if (ESP_OK != result) {
+        ESP_LOGE(TAG, "%s: init instance=0x%08x, result=0x%x", __func__, *out_handle, result);
+        goto out;
+    }
+    s_log_instances[*out_handle].instance = wl_log;
+    _lock_init(&s_log_instances[*out_handle].lock);
+    _lock_release(&s_instances_lock);
+    return ESP_OK;
+
+out:
+    _lock_release(&s_instances_lock);
+    *out_handle = WL_INVALID_HANDLE;
+    if (wl_log) {
+        wl_log->~WL_Log();
+        free(wl_log);
+    }
+    if (part) {
+        part->~Partition();
+        free(part);
+    }
+    return result;
+}
+
+esp_err_t wl_log_unmount(wl_log_handle_t handle)
+{
+    esp_err_t result = ESP_OK;
+    _lock_acquire(&s_instances_lock);
+    result = check_log_handle(handle, __func__);
+    if (result == ESP_OK) {
+        // Records are written through right away, there is no state to flush
+        Flash_Access *drv = s_log_instances[handle].instance->get_drv();
+        drv->~Flash_Access();
+        free(drv);
+        s_log_instances[handle].instance->~WL_Log();
+        free(s_log_instances[handle].instance);
+        s_log_instances[handle].instance = NULL;
+        _lock_close(&s_log_instances[handle].lock); // also zeroes the lock variable
+    }
+    _lock_release(&s_instances_lock);
+    return result;
+}
+
+esp_err_t wl_log_append(wl_log_handle_t handle, const void *data, size_t size)
+{
+    esp_err_t result = check_log_handle(handle, __func__);
+    if (result != ESP_OK) {
+        return result;
+    }
+    _lock_acquire(&s_log_instances[handle].lock);
+    result = s_log_instances[handle].instance->append(data, size);
+    _lock_release(&s_log_instances[handle].lock);
+    return result;
+}
+
+esp_err_t wl_log_cursor_init(wl_log_handle_t handle, wl_log_cursor_t *cursor)
+{
+    esp_err_t result = check_log_handle(handle, __func__);
+    if (result != ESP_OK) {
+        return result;
+    }
+    _lock_acquire(&s_log_instances[handle].lock);
+    s_log_instances[handle].instance->cursor_init(cursor);
+    _lock_release(&s_log_instances[handle].lock);
+    return ESP_OK;
+}
+
+esp_err_t wl_log_read(wl_log_handle_t handle, wl_log_cursor_t *cursor, void *dest, size_t *size)
+{
+    esp_err_t result = check_log_handle(handle, __func__);
+    if (result != ESP_OK) {
+        return result;
+    }
+    _lock_acquire(&s_log_instances[handle].lock);
+    result = s_log_instances[handle].instance->read(cursor, dest, size);
+    _lock_release(&s_log_instances[handle].lock);
+    return result;
+}
+
+esp_err_t wl_log_release(wl_log_handle_t handle, const wl_log_cursor_t *cursor)
+{
+    esp_err_t result = check_log_handle(handle, __func__);
+    if (result != ESP_OK) {
+        return result;
+    }
+    _lock_acquire(&s_log_instances[handle].lock);
+    result = s_log_instances[handle].instance->release(cursor);
+    _lock_release(&s_log_instances[handle].lock);
+    return result;
+}
+
+size_t wl_log_max_record_size(wl_log_handle_t handle)
+{
+    esp_err_t err = check_log_handle(handle, __func__);
+    if (err != ESP_OK) {
+        return 0;
+    }
+    _lock_acquire(&s_log_instances[handle].lock);
+    size_t result = s_log_instances[handle].instance->max_record_size();
+    _lock_release(&s_log_instances[handle].lock);
+    return result;
+}
+
 static esp_err_t check_handle(wl_handle_t handle, const char *func)
 {
     if (handle == WL_INVALID_HANDLE) {
@@ -265,3 +436,20 @@ static esp_err_t check_handle(wl_handle_t handle, const char *func)
     }
     return ESP_OK;
 }
+
+static esp_err_t check_log_handle(wl_log_handle_t handle, const char *func)
+{
+    if (handle == WL_INVALID_HANDLE) {
+        ESP_LOGE(TAG, "%s: invalid handle", func);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (handle >= MAX_WL_HANDLES) {
+        ESP_LOGE(TAG, "%s: log instance[0x%08x] out of range", func, handle);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_log_instances[handle].instance == NULL) {
+        ESP_LOGE(TAG, "%s: log instance[0x%08x] not initialized", func, handle);
+        return ESP_ERR_NOT_FOUND;
+    }
+    return ESP_OK;
+}